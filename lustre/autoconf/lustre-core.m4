@@ -2272,6 +2272,18 @@ lock_manager_ops_lm_compare_owner, [
 EXTRA_KCFLAGS="$tmp_flags"
 ]) # LC_LM_COMPARE_OWNER_EXISTS
 
+#
+# LC_HAVE_KTHREAD_USE_MM
+#
+# kernel 5.8 renamed use_mm() to kthread_use_mm() and exported it,
+# so that kernel threads can work on the address space of a user task
+#
+AC_DEFUN([LC_HAVE_KTHREAD_USE_MM], [
+LB_CHECK_EXPORT([kthread_use_mm], [kernel/kthread.c],
+	[AC_DEFINE(HAVE_KTHREAD_USE_MM, 1,
+		[kthread_use_mm is exported])])
+]) # LC_HAVE_KTHREAD_USE_MM
+
 AC_DEFUN([LC_PROG_LINUX_SRC], [])
 AC_DEFUN([LC_PROG_LINUX_RESULTS], [])
 
@@ -2478,6 +2490,9 @@ AC_DEFUN([LC_PROG_LINUX], [
 	LC_BIO_BI_PHYS_SEGMENTS
 	LC_LM_COMPARE_OWNER_EXISTS
 
+	# 5.8
+	LC_HAVE_KTHREAD_USE_MM
+
 	# kernel patch to extend integrity interface
 	LC_BIO_INTEGRITY_PREP_FN
 
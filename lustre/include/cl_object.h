@@ -296,6 +296,11 @@ struct cl_layout {
 	bool		cl_is_composite;
 	/** Whether layout is a HSM released one */
 	bool		cl_is_released;
+	/** Whether the file may be cached by RO-PCC */
+	bool		cl_is_pcc_rdonly;
+	/** stripe size and count of the widest initialized component */
+	u32		cl_stripe_size;
+	u16		cl_stripe_count;
 };
 
 /**
@@ -460,6 +465,12 @@ struct cl_object_header {
 	 * sub-object, etc.
 	 */
 	unsigned char		 coh_nesting;
+	/**
+	 * Time (seconds) until which the object is considered frequently
+	 * accessed. Set by the top layer from the file heat, lower layers
+	 * keep the cached pages of a hot object longer under memory pressure.
+	 */
+	time64_t		 coh_hot_expire;
 };
 
 /**
@@ -1925,6 +1936,12 @@ struct cl_io {
 	 * 2. the mirrored files are NOT in WRITE_PENDING state.
 	 */
 			     ci_need_write_intent:1,
+	/**
+	 * The file may be cached by RO-PCC, the MDS has to clear
+	 * LCM_FL_PCC_RDONLY and so invalidate the cached copies before the
+	 * file is modified.
+	 */
+			     ci_need_pccro_clear:1,
 	/**
 	 * Check if layout changed after the IO finishes. Mainly for HSM
 	 * requirement. If IO occurs to openning files, it doesn't need to
@@ -132,6 +132,8 @@ struct tg_grants_data {
 	u64			 tgd_reserved_pcnt;
 	/* number of clients using grants */
 	int			 tgd_tot_granted_clients;
+	/* write rate of the whole target, to weigh per-export rates */
+	struct tg_write_rate	 tgd_write_rate;
 	/* shall we grant space to clients not
 	 * supporting OBD_CONNECT_GRANT_PARAM? */
 	int			 tgd_grant_compat_disable;
@@ -545,6 +547,8 @@ ssize_t tot_granted_show(struct kobject *kobj, struct attribute *attr,
 			 char *buf);
 ssize_t tot_pending_show(struct kobject *kobj, struct attribute *attr,
 			 char *buf);
+ssize_t grant_write_rate_show(struct kobject *kobj, struct attribute *attr,
+			      char *buf);
 ssize_t grant_compat_disable_show(struct kobject *kobj, struct attribute *attr,
 				  char *buf);
 ssize_t grant_compat_disable_store(struct kobject *kobj,
@@ -212,6 +212,7 @@ enum ldlm_lru_flags {
 struct ldlm_pool;
 struct ldlm_lock;
 struct ldlm_resource;
+struct ldlm_bl_cancel_batch;
 struct ldlm_namespace;
 
 /**
@@ -662,6 +663,8 @@ struct ldlm_bl_desc {
 		     bl_cos_incompat:1;
 };
 
+struct ldlm_bl_ast_batch;
+
 struct ldlm_cb_set_arg {
 	struct ptlrpc_request_set	*set;
 	int				 type; /* LDLM_{CP,BL,GL}_CALLBACK */
@@ -671,11 +674,17 @@ struct ldlm_cb_set_arg {
 	ptlrpc_interpterer_t		 gl_interpret_reply;
 	void				*gl_interpret_data;
 	struct ldlm_bl_desc		*bl_desc;
+	/* multi-lock blocking ASTs being filled, only set up for
+	 * LDLM_WORK_BL_AST, see ldlm_server_blocking_ast() */
+	struct list_head		 bl_batches;
+	bool				 bl_batch;
 };
 
 struct ldlm_cb_async_args {
-	struct ldlm_cb_set_arg	*ca_set_arg;
-	struct ldlm_lock	*ca_lock;
+	struct ldlm_cb_set_arg		*ca_set_arg;
+	struct ldlm_lock		*ca_lock;
+	/* locks of a multi-lock blocking AST, ca_lock is NULL then */
+	struct ldlm_bl_ast_batch	*ca_batch;
 };
 
 /** The ldlm_glimpse_work was slab allocated & must be freed accordingly.*/
@@ -982,6 +991,13 @@ struct ldlm_lock {
 	 */
 	struct ldlm_lock	*l_blocking_lock;
 
+	/**
+	 * Client side, set under lr_lock while a bl thread handles the lock
+	 * as part of a multi-lock blocking AST: the cancel of the lock is
+	 * then sent together with the cancels of the other locks of the AST.
+	 */
+	struct ldlm_bl_cancel_batch *l_bl_batch;
+
 	/**
 	 * Protected by lr_lock, linkages to "skip lists".
 	 * For more explanations of skip lists see ldlm/ldlm_inodebits.c
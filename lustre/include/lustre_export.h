@@ -54,6 +54,17 @@ struct mdt_client_data;
 struct mds_idmap_table;
 struct mdt_idmap_table;
 
+/**
+ * Decaying average of the write bandwidth seen by a target, used to share
+ * grant space between exports by how fast they actually write.
+ * Protected by tgd_grant_lock.
+ */
+struct tg_write_rate {
+	time64_t		twr_stamp;	/* start of current period */
+	u64			twr_bytes;	/* bytes written in the period */
+	u64			twr_rate;	/* average rate, bytes/sec */
+};
+
 /**
  * Target-specific export data
  */
@@ -102,6 +113,9 @@ struct tg_export_data {
 	long			ted_grant;    /* in bytes */
 	long			ted_pending;  /* bytes just being written */
 	__u8			ted_pagebits; /* log2 of client page size */
+	struct tg_write_rate	ted_write_rate;
+	/* ted_dirty/ted_grant ratio seen at each write, in 10% buckets */
+	struct obd_histogram	ted_grant_eff;
 
 	/**
 	 * File Modification Data (FMD) tracking
@@ -430,6 +444,13 @@ static inline bool imp_connect_shortio(struct obd_import *imp)
 	return ocd->ocd_connect_flags & OBD_CONNECT_SHORTIO;
 }
 
+static inline bool imp_connect_brw_multi(struct obd_import *imp)
+{
+	struct obd_connect_data *ocd = &imp->imp_connect_data;
+
+	return ocd->ocd_connect_flags2 & OBD_CONNECT2_BRW_MULTI;
+}
+
 static inline __u64 exp_connect_ibits(struct obd_export *exp)
 {
 	struct obd_connect_data *ocd;
@@ -490,6 +511,26 @@ static inline int exp_connect_dom_lvb(struct obd_export *exp)
 	return !!(exp_connect_flags2(exp) & OBD_CONNECT2_DOM_LVB);
 }
 
+static inline int exp_connect_pccro(struct obd_export *exp)
+{
+	return !!(exp_connect_flags2(exp) & OBD_CONNECT2_PCCRO);
+}
+
+static inline int exp_connect_wbc(struct obd_export *exp)
+{
+	return !!(exp_connect_flags2(exp) & OBD_CONNECT2_WBC);
+}
+
+static inline int exp_connect_brw_multi(struct obd_export *exp)
+{
+	return !!(exp_connect_flags2(exp) & OBD_CONNECT2_BRW_MULTI);
+}
+
+static inline int exp_connect_batch_bl_ast(struct obd_export *exp)
+{
+	return !!(exp_connect_flags2(exp) & OBD_CONNECT2_BATCH_BL_AST);
+}
+
 enum {
 	/* archive_ids in array format */
 	KKUC_CT_DATA_ARRAY_MAGIC	= 0x092013cea,
@@ -126,6 +126,12 @@
 
 #define PTLRPC_NTHRS_INIT	2
 
+/**
+ * How often the thread pool controller of a service partition looks at its
+ * queue delay, in seconds; at most one idle thread is retired per interval.
+ */
+#define PTLRPC_THR_CTL_INTERVAL	1
+
 /**
  * Buffer Constants
  *
@@ -675,6 +681,8 @@ struct ptlrpc_reply_state {
         int                    rs_size;
         /** opcode */
         __u32                  rs_opc;
+	/** time the reply was handed to LNet */
+	ktime_t			rs_sent;
         /** Transaction number */
         __u64                  rs_transno;
         /** xid */
@@ -912,6 +920,8 @@ struct ptlrpc_srv_req {
 	/** @} nrs */
 	/** request arrival time */
 	struct timespec64		 sr_arrival_time;
+	/** time the request was added to NRS */
+	ktime_t				 sr_enqueue_time;
 	/** server's half ctx */
 	struct ptlrpc_svc_ctx		*sr_svc_ctx;
 	/** (server side), pointed directly into req buffer */
@@ -1629,6 +1639,32 @@ struct ptlrpc_service_ops {
  */
 #define PTLRPC_SVC_HP_RATIO 10
 
+/**
+ * Phases of a request on the server, timed for the latency histograms of
+ * its service.
+ */
+enum ptlrpc_lat_phase {
+	/** arrival from the network to NRS enqueue */
+	PTLRPC_LAT_ENQUEUE	= 0,
+	/** waiting in NRS for a service thread */
+	PTLRPC_LAT_NRS,
+	/** service handler */
+	PTLRPC_LAT_HANDLER,
+	/** reply sent to the transaction being committed */
+	PTLRPC_LAT_COMMIT,
+	/** reply sent to LNet being done with it */
+	PTLRPC_LAT_REPLY,
+	PTLRPC_LAT_MAX,
+};
+
+/**
+ * Per-CPU log2 histograms of the time one opcode spends in each phase, in
+ * microseconds; bucket i counts the samples up to 2^i usecs.
+ */
+struct ptlrpc_lat_hist {
+	unsigned long	lh_buckets[PTLRPC_LAT_MAX][OBD_HIST_MAX];
+};
+
 /**
  * Definition of PortalRPC service.
  * The service is listening on a particular portal (like tcp port)
@@ -1651,6 +1687,11 @@ struct ptlrpc_service {
 	int				srv_nthrs_cpt_init;
 	/** limit of threads number for each partition */
 	int				srv_nthrs_cpt_limit;
+	/**
+	 * queue delay the thread pool controller sizes each partition for,
+	 * in microseconds; 0 keeps the pool growing only on demand
+	 */
+	unsigned int			srv_nthrs_delay_target;
 	/** Root of debugfs dir tree for this service */
 	struct dentry		       *srv_debugfs_entry;
         /** Pointer to statistic data for this service */
@@ -1697,6 +1738,11 @@ struct ptlrpc_service {
 	/* sysfs object */
 	struct kobject			srv_kobj;
 	struct completion		srv_kobj_unregister;
+	/**
+	 * latency histograms by opcode_offset(), allocated when the service
+	 * first sees the opcode
+	 */
+	struct ptlrpc_lat_hist __percpu	*srv_lat_hist[LUSTRE_MAX_OPCODES];
 	/**
 	 * partition data for ptlrpc service
 	 */
@@ -1735,6 +1781,31 @@ struct ptlrpc_service_part {
 	/** service threads list */
 	struct list_head		scp_threads;
 
+	/** thread pool controller, see ptlrpc_thread_ctl_check() */
+	/** @{ */
+	/**
+	 * moving averages of how long requests waited before being handled
+	 * and how long they took to handle, in microseconds; updated by the
+	 * service threads without locking
+	 */
+	unsigned int			scp_thr_wait_avg;
+	unsigned int			scp_thr_svc_avg;
+	/** # requests handled since the last controller check */
+	unsigned int			scp_thr_ctl_nreqs;
+	/**
+	 * # threads the controller keeps while the queue delay is below
+	 * ptlrpc_service::srv_nthrs_delay_target, protected by scp_lock
+	 */
+	int				scp_nthrs_target;
+	/** # threads started beyond srv_nthrs_cpt_init and retired */
+	unsigned long			scp_thr_grown;
+	unsigned long			scp_thr_shrunk;
+	/** controller check timer */
+	struct timer_list		scp_thr_ctl_timer;
+	/** controller check due */
+	unsigned			scp_thr_ctl_check;
+	/** @} */
+
 	/**
 	 * serialize the following fields, used for protecting
 	 * rqbd list and incoming requests waiting for preprocess,
@@ -1887,6 +1958,24 @@ struct ptlrpcd_ctl {
 	 * Error code if the thread failed to fully start.
 	 */
 	int				pc_error;
+	/**
+	 * Set while the thread has no RPC to handle, so that a busy thread
+	 * can wake it up to take part of its queue.
+	 */
+	int				pc_idle;
+	/**
+	 * Number of RPCs this thread took from the queues of other threads,
+	 * how many of those came from its partners, and how many from
+	 * threads on another CPT.
+	 */
+	unsigned long			pc_steals;
+	unsigned long			pc_partner_steals;
+	unsigned long			pc_remote_steals;
+	/**
+	 * Number of RPCs other threads took from this thread's queue,
+	 * protected by set_new_req_lock of pc_set.
+	 */
+	unsigned long			pc_stolen;
 };
 
 /* Bits for pc_flags */
@@ -0,0 +1,133 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License version 2 for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ *
+ * Network Request Scheduler (NRS) Earliest Deadline First (EDF) policy
+ *
+ */
+
+#ifndef _LUSTRE_NRS_EDF_H
+#define _LUSTRE_NRS_EDF_H
+
+/* \name edf
+ *
+ * EDF policy
+ * @{
+ */
+
+#define NRS_EDF_RULE_NAME_MAX		16
+
+/**
+ * What a deadline rule matches requests on.
+ */
+enum nrs_edf_match {
+	NRS_EDF_MATCH_ALL	= 0,
+	NRS_EDF_MATCH_JOBID,
+	NRS_EDF_MATCH_UID,
+	NRS_EDF_MATCH_NID,
+	NRS_EDF_MATCH_OPCODE,
+};
+
+/**
+ * A deadline rule; assigns a latency objective to the requests it matches.
+ *
+ * Each rule is also the NRS resource of the requests it matched, so that a
+ * rule can not be freed while any of its requests are still queued or being
+ * handled.
+ */
+struct nrs_edf_rule {
+	struct ptlrpc_nrs_resource	 er_res;
+	/**
+	 * Link into nrs_edf_head::eh_rules
+	 */
+	struct list_head		 er_list;
+	char				 er_name[NRS_EDF_RULE_NAME_MAX];
+	enum nrs_edf_match		 er_match;
+	union {
+		/** jobid pattern, may contain '*' and '?' wildcards */
+		char			 er_jobid[LUSTRE_JOBID_SIZE];
+		__u32			 er_uid;
+		lnet_nid_t		 er_nid;
+		__u32			 er_opcode;
+	};
+	/**
+	 * Latency objective of matching requests, in milliseconds, counted
+	 * from request arrival
+	 */
+	__u32				 er_deadline_ms;
+	/**
+	 * Number of queued or in-progress requests using this rule, plus one
+	 * for nrs_edf_head::eh_rules while the rule is active
+	 */
+	atomic_t			 er_ref;
+	/**
+	 * Requests handled under this rule, and how many of those finished
+	 * after their deadline; updated under the service partition's
+	 * scp_req_lock
+	 */
+	__u64				 er_handled;
+	__u64				 er_missed;
+};
+
+/**
+ * Private data structure for the EDF policy
+ */
+struct nrs_edf_head {
+	/**
+	 * Parent resource of all rule resources
+	 */
+	struct ptlrpc_nrs_resource	 eh_res;
+	/**
+	 * Queued requests, ordered by their deadline
+	 */
+	struct cfs_binheap		*eh_binheap;
+	/**
+	 * Active rules; the most recently started rule is matched first, and
+	 * the default rule is always last
+	 */
+	struct list_head		 eh_rules;
+	spinlock_t			 eh_rule_lock;
+	/**
+	 * Catch-all rule, which can be changed but not stopped
+	 */
+	struct nrs_edf_rule		*eh_default;
+	/**
+	 * Enqueue order, used to break deadline ties
+	 */
+	__u64				 eh_sequence;
+};
+
+struct nrs_edf_req {
+	/**
+	 * Time by which the request should have been handled
+	 */
+	ktime_t		edf_deadline;
+	__u64		edf_sequence;
+};
+
+enum nrs_ctl_edf {
+	NRS_CTL_EDF_RD_RULE = PTLRPC_NRS_CTL_1ST_POL_SPEC,
+	NRS_CTL_EDF_WR_RULE,
+};
+
+/** @} edf */
+
+#endif
@@ -124,6 +124,23 @@ struct nrs_tbf_client {
 	struct cfs_binheap_node		 tc_node;
 	/** Whether the client is in heap. */
 	bool				 tc_in_heap;
+	/**
+	 * Ceiling of the RPC rate when borrowing; equal to tc_rpc_rate if the
+	 * client never borrows.
+	 */
+	u32				 tc_ceil_rate;
+	/** Time to wait for next ceiling token. */
+	__u64				 tc_ceil_nsecs;
+	/** Ceiling token number. */
+	__u64				 tc_ceil_ntoken;
+	/** Time check-point of the ceiling bucket. */
+	__u64				 tc_ceil_check_time;
+	/** Earliest time the client may borrow again. */
+	__u64				 tc_ceil_deadline;
+	/** Node in the binary heap of borrowing clients. */
+	struct cfs_binheap_node		 tc_borrow_node;
+	/** Whether the client is in the heap of borrowing clients. */
+	bool				 tc_in_borrow_heap;
 	/** Sequence of the newest rule. */
 	__u32				 tc_rule_sequence;
 	/**
@@ -174,6 +191,27 @@ struct nrs_tbf_rule {
 	u64				 tr_nsecs_per_rpc;
 	/** Token bucket depth. */
 	__u64				 tr_depth;
+	/**
+	 * Ceiling of the RPC rate of each client, up to which a client may
+	 * borrow tokens its siblings leave unused; 0 if none was set, then
+	 * the ceiling follows tr_rpc_rate and nothing is borrowed.
+	 */
+	u32				 tr_ceil_rate;
+	/** Time to wait for next ceiling token, if tr_ceil_rate is set. */
+	u64				 tr_nsecs_per_ceil;
+	/**
+	 * Aggregate RPC/s limit of all clients of the rule and of its child
+	 * rules; 0 if unlimited. Only borrowed RPCs are held back by it.
+	 */
+	u32				 tr_share_rate;
+	/** Time to wait for next shared token. */
+	u64				 tr_nsecs_per_share;
+	/** Shared token number. */
+	__u64				 tr_share_ntoken;
+	/** Time check-point of the shared bucket. */
+	__u64				 tr_share_check_time;
+	/** Parent rule, whose share also bounds this rule; holds a ref. */
+	struct nrs_tbf_rule		*tr_parent;
 	/** Lock to protect the list of clients. */
 	spinlock_t			 tr_rule_lock;
 	/** List of client. */
@@ -266,6 +304,11 @@ struct nrs_tbf_head {
 	 * Heap of queues.
 	 */
 	struct cfs_binheap		*th_binheap;
+	/**
+	 * Heap of queues of clients which may borrow tokens, ordered by the
+	 * time they may borrow next.
+	 */
+	struct cfs_binheap		*th_borrow_binheap;
 	/**
 	 * Hash of clients.
 	 */
@@ -312,10 +355,15 @@ struct nrs_tbf_cmd {
 			__u32			 ts_valid_type;
 			enum nrs_rule_flags	 ts_rule_flags;
 			char			*ts_next_name;
+			__u64			 ts_ceil_rate;
+			__u64			 ts_share_rate;
+			char			*ts_parent_name;
 		} tc_start;
 		struct nrs_tbf_cmd_change {
 			__u64			 tc_rpc_rate;
 			char			*tc_next_name;
+			__u64			 tc_ceil_rate;
+			__u64			 tc_share_rate;
 		} tc_change;
 	} u;
 };
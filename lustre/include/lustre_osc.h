@@ -132,6 +132,17 @@ struct osc_io {
 			   oi_cap_sys_resource:1;
 	/** how many LRU pages are reserved for this IO */
 	unsigned long	   oi_lru_reserved;
+	/** dirty page and grant credits taken from client_obd in batch for
+	 * the pages added to the active extent, see osc_io_credit_enter() */
+	unsigned int	   oi_dirty_credits;
+	unsigned int	   oi_grant_credits;
+	/** grant moved from oi_grant_credits into the active extent */
+	unsigned int	   oi_grant_used;
+	/** the last page committed by this IO, KMS and times are updated
+	 * for the whole run of committed pages at once, see osc_io_touch() */
+	pgoff_t		   oi_touch_index;
+	/** bytes written to oi_touch_index, 0 if there is nothing to update */
+	unsigned int	   oi_touch_to;
 
 	/** active extents, we know how many bytes is going to be written,
 	 * so having an active extent will prevent it from being fragmented */
@@ -532,12 +543,30 @@ struct osc_page {
 	 * lru page list. See osc_lru_{del|use}() in osc_page.c for usage.
 	 */
 	struct list_head	ops_lru;
+	/**
+	 * CPU partition of the LRU list the page is added to.
+	 */
+	unsigned short		ops_lru_cpt;
+	/**
+	 * Set if the page is used again while in LRU, the shrinker gives it
+	 * another pass instead of freeing it. See osc_lru_use().
+	 */
+	bool			ops_lru_ref;
 	/**
 	 * Submit time - the time when the page is starting RPC. For debugging.
 	 */
 	ktime_t			ops_submit_time;
 };
 
+/**
+ * One object of a write RPC carrying several objects, see osc_build_rpc().
+ * The pages of the objects follow each other in the page array of the RPC.
+ */
+struct osc_brw_obj {
+	struct obdo		*obo_oa;
+	u32			 obo_page_count;
+};
+
 struct osc_brw_async_args {
 	struct obdo		*aa_oa;
 	int			 aa_requested_nob;
@@ -548,6 +577,10 @@ struct osc_brw_async_args {
 	struct client_obd	*aa_cli;
 	struct list_head	 aa_oaps;
 	struct list_head	 aa_exts;
+	/* objects of a multi-object write, aa_objs[0].obo_oa is aa_oa, NULL
+	 * for an RPC of one object */
+	struct osc_brw_obj	*aa_objs;
+	u32			 aa_obj_count;
 };
 
 extern struct kmem_cache *osc_lock_kmem;
@@ -190,6 +190,7 @@ enum md_layout_opc {
 	MD_LAYOUT_DETACH,	/* detach stripes */
 	MD_LAYOUT_SHRINK,	/* shrink striped directory (destroy stripes) */
 	MD_LAYOUT_SPLIT,	/* split directory (allocate new stripes) */
+	MD_LAYOUT_PCCRO,	/* set or clear the RO-PCC state of a file */
 	MD_LAYOUT_MAX,
 };
 
@@ -145,6 +145,8 @@ struct timeout_item {
 #define OSC_MAX_DIRTY_DEFAULT	2000	 /* Arbitrary large value */
 #define OSC_MAX_DIRTY_MB_MAX	2048     /* arbitrary, but < MAX_LONG bytes */
 #define OSC_DEFAULT_RESENDS	10
+#define OSC_DEF_BRW_MULTI_OBJS	8	 /* objects per write RPC */
+#define OSC_MAX_BRW_MULTI_OBJS	256
 
 /* possible values for lut_sync_lock_cancel */
 enum tgt_sync_lock_cancel {
@@ -178,6 +180,12 @@ enum obd_cl_sem_lock_class {
 
 struct mdc_rpc_lock;
 struct obd_import;
+/* LRU list of cached pages of a client_obd in a CPU partition */
+struct cl_lru_list {
+	spinlock_t		cll_lock;
+	struct list_head	cll_pages;
+};
+
 struct client_obd {
 	struct rw_semaphore	 cl_sem;
 	struct obd_uuid		 cl_target_uuid;
@@ -239,6 +247,10 @@ struct client_obd {
 	time64_t		cl_next_shrink_grant;	/* seconds */
 	struct list_head	cl_grant_chain;
 	time64_t		cl_grant_shrink_interval; /* seconds */
+	/* last time a write RPC was sent, to spot idle writers */
+	time64_t		cl_last_write_rpc;	/* seconds */
+	/* server asked for the grant not used by recent writes */
+	bool			cl_grant_reclaim;
 
 	/* A chunk is an optimal size used by osc_extent to determine
 	 * the extent size. A chunk is max(PAGE_SIZE, OST block size) */
@@ -279,6 +291,8 @@ struct client_obd {
 	u32			cl_max_pages_per_rpc;
 	u32			cl_max_rpcs_in_flight;
 	u32			cl_max_short_io_bytes;
+	/* max number of objects whose writes share one BRW RPC */
+	u32			cl_brw_multi_objs;
 	struct obd_histogram	cl_read_rpc_hist;
 	struct obd_histogram	cl_write_rpc_hist;
 	struct obd_histogram	cl_read_page_hist;
@@ -295,8 +309,9 @@ struct client_obd {
 	 * therefore this is a pointer to cl_client_cache::ccc_lru_left. */
 	atomic_long_t           *cl_lru_left;
 	/** # of busy LRU pages. A page is considered busy if it's in writeback
-	 * queue, or in transfer. Busy pages can't be discarded so they are not
-	 * in LRU cache. */
+	 * queue, or in transfer, for the first time. Busy pages can't be
+	 * discarded so they are not in LRU cache. A page used again once in
+	 * LRU stays there, see osc_lru_use(). */
 	atomic_long_t            cl_lru_busy;
 	/** # of LRU pages in the cache for this client_obd */
 	atomic_long_t            cl_lru_in_list;
@@ -310,10 +325,14 @@ struct client_obd {
 	 * reclaim is sync, initiated by IO thread when the LRU slots are
 	 * in shortage. */
 	__u64                    cl_lru_reclaim;
-	/** List of LRU pages for this client_obd */
-	struct list_head         cl_lru_list;
-	/** Lock for LRU page list */
-	spinlock_t		 cl_lru_list_lock;
+	/** stats: # of times pages of hot objects were kept by LRU scan,
+	 * see cl_object_header::coh_hot_expire */
+	atomic_long_t		 cl_lru_hot_kept;
+	/** LRU pages for this client_obd, one list per CPU partition so
+	 * that pages can be added and removed without a global lock */
+	struct cl_lru_list	**cl_lru_lists;
+	/** CPU partition the next shrink starts from */
+	atomic_t		 cl_lru_shrink_cpt;
 	/** # of unstable pages in this client_obd.
 	 * An unstable page is a page state that WRITE RPC has finished but
 	 * the transaction has NOT yet committed. */
@@ -840,6 +859,7 @@ enum md_op_flags {
 	MF_MDC_CANCEL_FID4	= BIT(3),
 	MF_GET_MDT_IDX		= BIT(4),
 	MF_GETATTR_BY_FID	= BIT(5),
+	MF_FID2_ALLOCATED	= BIT(6),	/* op_fid2 allocated by caller */
 };
 
 enum md_cli_flags {
@@ -943,6 +963,9 @@ struct md_op_data {
 	__u32			op_stripe_index;
 	/* Archive ID for PCC attach */
 	__u32			op_archive_id;
+	/* umask of the creating process, for MDS_WBC_LOCKLESS creates which
+	 * are sent from a different context */
+	__u32			op_umask;
 };
 
 struct md_callback {
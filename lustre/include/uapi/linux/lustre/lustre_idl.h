@@ -851,6 +851,31 @@ struct ptlrpc_body_v2 {
 #define OBD_CONNECT2_GETATTR_PFID      0x20000ULL /* pack parent FID in getattr */
 #define OBD_CONNECT2_LSEEK	       0x40000ULL /* SEEK_HOLE/DATA RPC */
 #define OBD_CONNECT2_DOM_LVB	       0x80000ULL /* pack DOM glimpse data in LVB */
+/* 0x100000 - 0x10000000000 are assigned by other branches */
+#define OBD_CONNECT2_REP_MBITS		0x100000ULL /* match reply mbits not xid */
+#define OBD_CONNECT2_MODE_CONVERT	0x200000ULL /* LDLM mode convert */
+#define OBD_CONNECT2_BATCH_RPCS		0x400000ULL /* multi-RPC batch request */
+#define OBD_CONNECT2_PCCRO		0x800000ULL /* PCC read-only */
+#define OBD_CONNECT2_MNE_TYPE		0x1000000ULL /* mne_nid_type IPv6 */
+#define OBD_CONNECT2_LOCK_CONTENTION	0x2000000ULL /* contention detect */
+#define OBD_CONNECT2_ATOMIC_OPEN_LOCK	0x4000000ULL /* lock on first open */
+#define OBD_CONNECT2_ENCRYPT_NAME	0x8000000ULL /* name encrypt */
+#define OBD_CONNECT2_MKDIR_REPLAY	0x10000000ULL /* replay mkdir */
+#define OBD_CONNECT2_DMV_IMP_INHERIT	0x20000000ULL /* client handle DMV inheritance */
+#define OBD_CONNECT2_ENCRYPT_FID2PATH	0x40000000ULL /* fid2path enc file */
+#define OBD_CONNECT2_REPLAY_CREATE	0x80000000ULL /* replay OST_CREATE */
+#define OBD_CONNECT2_LARGE_NID		0x100000000ULL /* understands large/IPv6 NIDs */
+#define OBD_CONNECT2_COMPRESS		0x200000000ULL /* compressed file */
+#define OBD_CONNECT2_UNALIGNED_DIO	0x400000000ULL /* unaligned DIO */
+#define OBD_CONNECT2_CONN_POLICY	0x800000000ULL /* server-side connection policy */
+#define OBD_CONNECT2_SPARSE		0x1000000000ULL /* sparse LNet read */
+#define OBD_CONNECT2_MIRROR_ID_FIX	0x2000000000ULL /* rr_mirror_id move */
+#define OBD_CONNECT2_UPDATE_LAYOUT	0x4000000000ULL /* update compressibility */
+#define OBD_CONNECT2_READDIR_OPEN	0x8000000000ULL /* read first dir block on open */
+#define OBD_CONNECT2_FLR_EC		0x10000000000ULL /* parity support */
+#define OBD_CONNECT2_WBC		0x20000000000ULL /* metadata write-back cache */
+#define OBD_CONNECT2_BRW_MULTI		0x40000000000ULL /* multi-object BRW write */
+#define OBD_CONNECT2_BATCH_BL_AST	0x80000000000ULL /* multi-lock BL AST */
 /* XXX README XXX:
  * Please DO NOT add flag values here before first ensuring that this same
  * flag value is not in use on some other branch.  Please clear any such
@@ -910,7 +935,10 @@ struct ptlrpc_body_v2 {
 				OBD_CONNECT2_CRUSH | \
 				OBD_CONNECT2_ENCRYPT | \
 				OBD_CONNECT2_GETATTR_PFID |\
-				OBD_CONNECT2_LSEEK | OBD_CONNECT2_DOM_LVB)
+				OBD_CONNECT2_LSEEK | OBD_CONNECT2_DOM_LVB |\
+				OBD_CONNECT2_PCCRO | \
+				OBD_CONNECT2_WBC | \
+				OBD_CONNECT2_BATCH_BL_AST)
 
 #define OST_CONNECT_SUPPORTED  (OBD_CONNECT_SRVLOCK | OBD_CONNECT_GRANT | \
 				OBD_CONNECT_REQPORTAL | OBD_CONNECT_VERSION | \
@@ -932,7 +960,9 @@ struct ptlrpc_body_v2 {
 				OBD_CONNECT_SHORTIO | OBD_CONNECT_FLAGS2)
 
 #define OST_CONNECT_SUPPORTED2 (OBD_CONNECT2_LOCKAHEAD | OBD_CONNECT2_INC_XID |\
-				OBD_CONNECT2_ENCRYPT | OBD_CONNECT2_LSEEK)
+				OBD_CONNECT2_ENCRYPT | OBD_CONNECT2_LSEEK | \
+				OBD_CONNECT2_BRW_MULTI | \
+				OBD_CONNECT2_BATCH_BL_AST)
 
 #define ECHO_CONNECT_SUPPORTED (OBD_CONNECT_FID)
 #define ECHO_CONNECT_SUPPORTED2 0
@@ -1096,6 +1126,7 @@ enum obdo_flags {
         OBD_FL_NOSPC_BLK    = 0x00100000, /* no more block space on OST */
 	OBD_FL_FLUSH	    = 0x00200000, /* flush pages on the OST */
 	OBD_FL_SHORT_IO	    = 0x00400000, /* short io request */
+	OBD_FL_GRANT_RECLAIM = 0x00800000, /* server asks for unused grant */
 	/* OBD_FL_LOCAL_MASK = 0xF0000000, was local-only flags until 2.10 */
 
 	/*
@@ -1951,6 +1982,9 @@ enum mds_op_bias {
 	MDS_TRUNC_KEEP_LEASE	= 1 << 18,
 	MDS_PCC_ATTACH		= 1 << 19,
 	MDS_CLOSE_UPDATE_TIMES	= 1 << 20,
+	/* create under a directory on which the client holds an EX lock,
+	 * the handle of that lock is passed in cr_open_handle_old */
+	MDS_WBC_LOCKLESS	= 1 << 21,
 };
 
 #define MDS_CLOSE_INTENT (MDS_HSM_RELEASE | MDS_CLOSE_LAYOUT_SWAP |         \
@@ -3303,6 +3337,8 @@ enum layout_intent_opc {
 	LAYOUT_INTENT_TRUNC	= 4,	/** truncate file, for comp layout */
 	LAYOUT_INTENT_RELEASE	= 5,	/** reserved for HSM release */
 	LAYOUT_INTENT_RESTORE	= 6,	/** reserved for HSM restore */
+	LAYOUT_INTENT_PCCRO_SET	= 7,	/** set LCM_FL_PCC_RDONLY */
+	LAYOUT_INTENT_PCCRO_CLEAR = 8,	/** clear LCM_FL_PCC_RDONLY */
 };
 
 /* enqueue layout lock with intent */
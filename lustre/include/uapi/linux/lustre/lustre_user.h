@@ -629,6 +629,7 @@ struct ll_ioc_lease_id {
 #define LL_IOC_LADVISE			_IOR('f', 250, struct llapi_lu_ladvise)
 #define LL_IOC_HEAT_GET			_IOWR('f', 251, struct lu_heat)
 #define LL_IOC_HEAT_SET			_IOW('f', 251, __u64)
+#define LL_IOC_PCC_ATTACH		_IOW('f', 252, struct lu_pcc_attach)
 #define LL_IOC_PCC_DETACH		_IOW('f', 252, struct lu_pcc_detach)
 #define LL_IOC_PCC_DETACH_BY_FID	_IOW('f', 252, struct lu_pcc_detach_fid)
 #define LL_IOC_PCC_STATE		_IOR('f', 252, struct lu_pcc_state)
@@ -936,6 +937,8 @@ enum lov_comp_md_flags {
 	LCM_FL_WRITE_PENDING    = 2,
 	LCM_FL_SYNC_PENDING     = 3,
 	LCM_FL_FLR_MASK         = 0x3,
+	/* the file may be cached by RO-PCC, cleared before it is modified */
+	LCM_FL_PCC_RDONLY       = 0x8,
 };
 
 struct lov_comp_md_v1 {
@@ -2579,6 +2582,7 @@ struct lu_heat {
 enum lu_pcc_type {
 	LU_PCC_NONE = 0,
 	LU_PCC_READWRITE,
+	LU_PCC_READONLY,
 	LU_PCC_MAX
 };
 
@@ -2589,6 +2593,8 @@ static inline const char *pcc_type2string(enum lu_pcc_type type)
 		return "none";
 	case LU_PCC_READWRITE:
 		return "readwrite";
+	case LU_PCC_READONLY:
+		return "readonly";
 	default:
 		return "fault";
 	}
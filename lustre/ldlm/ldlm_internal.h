@@ -101,6 +101,9 @@ int ldlm_cancel_lru_local(struct ldlm_namespace *ns,
 			  struct list_head *cancels, int min, int max,
 			  enum ldlm_cancel_flags cancel_flags,
 			  enum ldlm_lru_flags lru_flags);
+int ldlm_request_bufsize(int count, int type);
+int ldlm_cli_cancel_handles(struct obd_import *imp,
+			    struct lustre_handle *handles, int count);
 extern unsigned int ldlm_enqueue_min;
 /* ldlm_resource.c */
 extern struct kmem_cache *ldlm_resource_slab;
@@ -181,6 +184,43 @@ void ldlm_handle_bl_callback(struct ldlm_namespace *ns,
                              struct ldlm_lock_desc *ld, struct ldlm_lock *lock);
 void ldlm_bl_desc2lock(const struct ldlm_lock_desc *ld, struct ldlm_lock *lock);
 
+/**
+ * Cancels of the locks of a multi-lock blocking AST, collected by
+ * ldlm_cli_cancel() while a bl thread runs the blocking callbacks of the
+ * locks, and sent in one LDLM_CANCEL RPC afterwards.
+ */
+struct ldlm_bl_cancel_batch {
+	/** the bl thread handling the AST, only it adds to lbc_cancels */
+	struct task_struct	*lbc_owner;
+	struct list_head	 lbc_cancels;
+	int			 lbc_count;
+};
+
+#ifdef HAVE_SERVER_SUPPORT
+/**
+ * Maximum number of locks in one multi-lock blocking AST, this keeps the
+ * request well below LDLM_MAXREQSIZE of the client callback service.
+ */
+#define LDLM_BL_AST_BATCH_MAX	64
+
+/**
+ * Granted locks of one client which get the same blocking AST, sent in one
+ * LDLM_BL_CALLBACK RPC by ldlm_server_blocking_ast().
+ */
+struct ldlm_bl_ast_batch {
+	/** link in ldlm_cb_set_arg::bl_batches until the RPC is sent */
+	struct list_head	 lbb_list;
+	struct obd_export	*lbb_exp;
+	struct ldlm_lock_desc	 lbb_desc;
+	__u64			 lbb_flags;
+	int			 lbb_count;
+	/** each lock holds a reference until the reply is interpreted */
+	struct ldlm_lock	*lbb_locks[LDLM_BL_AST_BATCH_MAX];
+};
+
+int ldlm_bl_ast_batch_flush(struct ldlm_cb_set_arg *arg);
+#endif
+
 #ifdef HAVE_SERVER_SUPPORT
 /* ldlm_plain.c */
 int ldlm_process_plain_lock(struct ldlm_lock *lock, __u64 *flags,
@@ -327,7 +327,9 @@ int client_obd_setup(struct obd_device *obd, struct lustre_cfg *lcfg)
 	char *cli_name = lustre_cfg_buf(lcfg, 0);
 	struct ptlrpc_connection fake_conn = { .c_self = 0,
 					       .c_remote_uuid.uuid[0] = 0 };
+	struct cl_lru_list *lru;
 	int rc;
+	int i;
 
 	ENTRY;
 
@@ -446,8 +448,7 @@ int client_obd_setup(struct obd_device *obd, struct lustre_cfg *lcfg)
 	atomic_set(&cli->cl_lru_shrinkers, 0);
 	atomic_long_set(&cli->cl_lru_busy, 0);
 	atomic_long_set(&cli->cl_lru_in_list, 0);
-	INIT_LIST_HEAD(&cli->cl_lru_list);
-	spin_lock_init(&cli->cl_lru_list_lock);
+	atomic_set(&cli->cl_lru_shrink_cpt, 0);
 	atomic_long_set(&cli->cl_unstable_count, 0);
 	INIT_LIST_HEAD(&cli->cl_shrink_list);
 	INIT_LIST_HEAD(&cli->cl_grant_chain);
@@ -480,6 +481,7 @@ int client_obd_setup(struct obd_device *obd, struct lustre_cfg *lcfg)
 	cli->cl_max_pages_per_rpc = PTLRPC_MAX_BRW_PAGES;
 
 	cli->cl_max_short_io_bytes = OBD_DEF_SHORT_IO_BYTES;
+	cli->cl_brw_multi_objs = OSC_DEF_BRW_MULTI_OBJS;
 
 	/*
 	 * set cl_chunkbits default value to PAGE_SHIFT,
@@ -512,6 +514,16 @@ int client_obd_setup(struct obd_device *obd, struct lustre_cfg *lcfg)
 
 	INIT_LIST_HEAD(&cli->cl_chg_dev_linkage);
 
+	cli->cl_lru_lists = cfs_percpt_alloc(cfs_cpt_tab,
+					     sizeof(struct cl_lru_list));
+	if (cli->cl_lru_lists == NULL)
+		GOTO(err, rc = -ENOMEM);
+
+	cfs_percpt_for_each(lru, i, cli->cl_lru_lists) {
+		spin_lock_init(&lru->cll_lock);
+		INIT_LIST_HEAD(&lru->cll_pages);
+	}
+
 	if (connect_op == MDS_CONNECT) {
 		cli->cl_max_mod_rpcs_in_flight = cli->cl_max_rpcs_in_flight - 1;
 		OBD_ALLOC(cli->cl_mod_tag_bitmap,
@@ -595,6 +607,9 @@ err:
 		OBD_FREE(cli->cl_mod_tag_bitmap,
 			 BITS_TO_LONGS(OBD_MAX_RIF_MAX) * sizeof(long));
 	cli->cl_mod_tag_bitmap = NULL;
+	if (cli->cl_lru_lists != NULL)
+		cfs_percpt_free(cli->cl_lru_lists);
+	cli->cl_lru_lists = NULL;
 	RETURN(rc);
 
 }
@@ -619,6 +634,10 @@ int client_obd_cleanup(struct obd_device *obd)
 			 BITS_TO_LONGS(OBD_MAX_RIF_MAX) * sizeof(long));
 	cli->cl_mod_tag_bitmap = NULL;
 
+	if (cli->cl_lru_lists != NULL)
+		cfs_percpt_free(cli->cl_lru_lists);
+	cli->cl_lru_lists = NULL;
+
 	RETURN(0);
 }
 EXPORT_SYMBOL(client_obd_cleanup);
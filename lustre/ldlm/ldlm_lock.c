@@ -2107,8 +2107,12 @@ ldlm_work_bl_ast_lock(struct ptlrpc_request_set *rqset, void *opaq)
 
 	ENTRY;
 
-	if (list_empty(arg->list))
+	if (list_empty(arg->list)) {
+		/* send the multi-lock blocking ASTs which are not full */
+		if (ldlm_bl_ast_batch_flush(arg))
+			RETURN(0);
 		RETURN(-ENOENT);
+	}
 
 	lock = list_entry(arg->list->next, struct ldlm_lock, l_bl_ast);
 
@@ -2129,6 +2133,8 @@ ldlm_work_bl_ast_lock(struct ptlrpc_request_set *rqset, void *opaq)
 	}
 
 	LASSERT(lock->l_blocking_lock);
+	/* descriptors are compared as a whole to batch blocking ASTs */
+	memset(&d, 0, sizeof(d));
 	ldlm_lock2desc(lock->l_blocking_lock, &d);
 	/* copy blocking lock ibits in cancel_bits as well,
 	 * new client may use them for lock convert and it is
@@ -2299,6 +2305,7 @@ int ldlm_run_ast_work(struct ldlm_namespace *ns, struct list_head *rpc_list,
 
 	atomic_set(&arg->restart, 0);
 	arg->list = rpc_list;
+	INIT_LIST_HEAD(&arg->bl_batches);
 
 	switch (ast_type) {
 	case LDLM_WORK_CP_AST:
@@ -2308,6 +2315,7 @@ int ldlm_run_ast_work(struct ldlm_namespace *ns, struct list_head *rpc_list,
 #ifdef HAVE_SERVER_SUPPORT
 	case LDLM_WORK_BL_AST:
 		arg->type = LDLM_BL_CALLBACK;
+		arg->bl_batch = true;
 		work_ast_lock = ldlm_work_bl_ast_lock;
 		break;
 	case LDLM_WORK_REVOKE_AST:
@@ -114,6 +114,9 @@ struct ldlm_bl_work_item {
 	struct ldlm_lock	*blwi_lock;
 	struct list_head	blwi_head;
 	int			blwi_count;
+	/* locks of a multi-lock blocking AST, NULL terminated if not full */
+	struct ldlm_lock	**blwi_locks;
+	int			blwi_nlocks;
 	struct completion	blwi_comp;
 	enum ldlm_cancel_flags	blwi_flags;
 	int			blwi_mem_pressure;
@@ -756,6 +759,25 @@ static int ldlm_cb_interpret(const struct lu_env *env,
 
 	ENTRY;
 
+	if (ca->ca_batch != NULL) {
+		struct ldlm_bl_ast_batch *batch = ca->ca_batch;
+		int i;
+
+		LASSERT(arg->type == LDLM_BL_CALLBACK);
+		for (i = 0; i < batch->lbb_count; i++) {
+			lock = batch->lbb_locks[i];
+			if (rc != 0 &&
+			    ldlm_handle_ast_error(lock, req, rc,
+						  "blocking") == -ERESTART)
+				atomic_inc(&arg->restart);
+			/* release reference taken in
+			 * ldlm_server_blocking_ast_batch() */
+			LDLM_LOCK_RELEASE(lock);
+		}
+		OBD_FREE_PTR(batch);
+		RETURN(0);
+	}
+
 	LASSERT(lock != NULL);
 
 	switch (arg->type) {
@@ -809,8 +831,17 @@ static void ldlm_update_resend(struct ptlrpc_request *req, void *data)
 {
 	struct ldlm_cb_async_args *ca = data;
 	struct ldlm_lock *lock = ca->ca_lock;
+	int i;
 
-	ldlm_refresh_waiting_lock(lock, ldlm_bl_timeout(lock));
+	if (ca->ca_batch == NULL) {
+		ldlm_refresh_waiting_lock(lock, ldlm_bl_timeout(lock));
+		return;
+	}
+
+	for (i = 0; i < ca->ca_batch->lbb_count; i++) {
+		lock = ca->ca_batch->lbb_locks[i];
+		ldlm_refresh_waiting_lock(lock, ldlm_bl_timeout(lock));
+	}
 }
 
 static inline int ldlm_ast_fini(struct ptlrpc_request *req,
@@ -869,6 +900,179 @@ static void ldlm_lock_reorder_req(struct ldlm_lock *lock)
 	EXIT;
 }
 
+/**
+ * Send the multi-lock blocking AST \a batch. The RPC carries the client
+ * and server handles of every lock one pair after the other, the same way
+ * as the blocking AST of a single lock does for its lock.
+ */
+static int ldlm_bl_ast_batch_send(struct ldlm_cb_set_arg *arg,
+				  struct ldlm_bl_ast_batch *batch)
+{
+	struct ldlm_cb_async_args *ca;
+	struct ldlm_request *body;
+	struct ptlrpc_request *req;
+	int i;
+	int rc;
+
+	ENTRY;
+
+	list_del_init(&batch->lbb_list);
+	if (batch->lbb_count == 0)
+		GOTO(out, rc = 0);
+
+	req = ptlrpc_request_alloc(batch->lbb_exp->exp_imp_reverse,
+				   &RQF_LDLM_BL_CALLBACK);
+	if (req == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	req_capsule_set_size(&req->rq_pill, &RMF_DLM_REQ, RCL_CLIENT,
+			     ldlm_request_bufsize(2 * batch->lbb_count,
+						  LDLM_BL_CALLBACK));
+	rc = ptlrpc_request_pack(req, LUSTRE_DLM_VERSION, LDLM_BL_CALLBACK);
+	if (rc) {
+		ptlrpc_request_free(req);
+		GOTO(out, rc);
+	}
+
+	body = req_capsule_client_get(&req->rq_pill, &RMF_DLM_REQ);
+	for (i = 0; i < batch->lbb_count; i++) {
+		struct ldlm_lock *lock = batch->lbb_locks[i];
+
+		body->lock_handle[2 * i] = lock->l_remote_handle;
+		body->lock_handle[2 * i + 1].cookie = lock->l_handle.h_cookie;
+	}
+	body->lock_count = batch->lbb_count;
+	body->lock_desc = batch->lbb_desc;
+	body->lock_flags = ldlm_flags_to_wire(batch->lbb_flags);
+	ptlrpc_request_set_replen(req);
+
+	ca = ptlrpc_req_async_args(ca, req);
+	ca->ca_set_arg = arg;
+	ca->ca_lock = NULL;
+	ca->ca_batch = batch;
+
+	req->rq_interpret_reply = ldlm_cb_interpret;
+	/* Do not resend after lock callback timeout */
+	req->rq_delay_limit = ldlm_bl_timeout(batch->lbb_locks[0]);
+	req->rq_resend_cb = ldlm_update_resend;
+	req->rq_send_state = LUSTRE_IMP_FULL;
+	/* ptlrpc_request_pack already set timeout */
+	if (AT_OFF)
+		req->rq_timeout = ldlm_get_rq_timeout();
+
+	CDEBUG(D_DLMTRACE, "%s: sending blocking AST for %d locks to %s\n",
+	       batch->lbb_exp->exp_obd->obd_name, batch->lbb_count,
+	       obd_export_nid2str(batch->lbb_exp));
+
+	ptlrpc_set_add_req(arg->set, req);
+	RETURN(0);
+out:
+	/*
+	 * The locks are on the waiting list already, they time out and the
+	 * client is evicted as if the AST was lost.
+	 */
+	for (i = 0; i < batch->lbb_count; i++)
+		LDLM_LOCK_RELEASE(batch->lbb_locks[i]);
+	OBD_FREE_PTR(batch);
+	RETURN(rc);
+}
+
+/**
+ * Send one of the multi-lock blocking ASTs which are not full yet, this is
+ * called once all locks of the ldlm_run_ast_work() list got their AST.
+ *
+ * \retval 1 if an AST was sent
+ * \retval 0 if there are no ASTs left
+ */
+int ldlm_bl_ast_batch_flush(struct ldlm_cb_set_arg *arg)
+{
+	struct ldlm_bl_ast_batch *batch;
+
+	if (!arg->bl_batch || list_empty(&arg->bl_batches))
+		return 0;
+
+	batch = list_first_entry(&arg->bl_batches, struct ldlm_bl_ast_batch,
+				 lbb_list);
+	ldlm_bl_ast_batch_send(arg, batch);
+
+	return 1;
+}
+
+/**
+ * Add \a lock to the multi-lock blocking AST of its client, the AST is sent
+ * once it is full or when the last lock of the list was handled, see
+ * ldlm_bl_ast_batch_flush(). Locks get into one AST if they have the same
+ * blocking lock descriptor and AST flags.
+ */
+static int ldlm_server_blocking_ast_batch(struct ldlm_lock *lock,
+					  struct ldlm_lock_desc *desc,
+					  struct ldlm_cb_set_arg *arg)
+{
+	struct obd_export *exp = lock->l_export;
+	struct ldlm_bl_ast_batch *batch;
+	__u64 flags = lock->l_flags & LDLM_FL_AST_MASK;
+	bool found = false;
+
+	ENTRY;
+
+	ldlm_lock_reorder_req(lock);
+
+	list_for_each_entry(batch, &arg->bl_batches, lbb_list) {
+		if (batch->lbb_exp == exp && batch->lbb_flags == flags &&
+		    memcmp(&batch->lbb_desc, desc, sizeof(*desc)) == 0) {
+			found = true;
+			break;
+		}
+	}
+
+	if (!found) {
+		OBD_ALLOC_PTR(batch);
+		if (batch == NULL)
+			RETURN(-ENOMEM);
+		batch->lbb_exp = exp;
+		batch->lbb_desc = *desc;
+		batch->lbb_flags = flags;
+		list_add_tail(&batch->lbb_list, &arg->bl_batches);
+	}
+
+	lock_res_and_lock(lock);
+	if (ldlm_is_destroyed(lock)) {
+		/* What's the point? */
+		unlock_res_and_lock(lock);
+		RETURN(0);
+	}
+
+	if (!ldlm_is_granted(lock)) {
+		/*
+		 * this blocking AST will be communicated as part of the
+		 * completion AST instead
+		 */
+		ldlm_add_blocked_lock(lock);
+		ldlm_set_waited(lock);
+		unlock_res_and_lock(lock);
+
+		LDLM_DEBUG(lock, "lock not granted, not sending blocking AST");
+		RETURN(0);
+	}
+
+	ldlm_set_cbpending(lock);
+	ldlm_add_waiting_lock(lock, ldlm_bl_timeout(lock));
+	unlock_res_and_lock(lock);
+
+	LDLM_DEBUG(lock, "server adding lock to blocking AST of %d locks",
+		   batch->lbb_count + 1);
+
+	if (exp->exp_nid_stats && exp->exp_nid_stats->nid_ldlm_stats)
+		lprocfs_counter_incr(exp->exp_nid_stats->nid_ldlm_stats,
+				     LDLM_BL_CALLBACK - LDLM_FIRST_OPC);
+
+	batch->lbb_locks[batch->lbb_count++] = LDLM_LOCK_GET(lock);
+	if (batch->lbb_count == LDLM_BL_AST_BATCH_MAX)
+		RETURN(ldlm_bl_ast_batch_send(arg, batch));
+
+	RETURN(0);
+}
+
 /**
  * ->l_blocking_ast() method for server-side locks. This is invoked when newly
  * enqueued server lock conflicts with given one.
@@ -903,6 +1107,15 @@ int ldlm_server_blocking_ast(struct ldlm_lock *lock,
 	if (lock->l_export->exp_obd->obd_recovering != 0)
 		LDLM_ERROR(lock, "BUG 6063: lock collide during recovery");
 
+	/*
+	 * Clients which support it get one blocking AST for all their locks
+	 * conflicting with the same lock. Cancel-on-block locks are cancelled
+	 * right here and keep their own AST.
+	 */
+	if (arg->bl_batch && !ldlm_is_cancel_on_block(lock) &&
+	    exp_connect_batch_bl_ast(lock->l_export))
+		RETURN(ldlm_server_blocking_ast_batch(lock, desc, arg));
+
 	ldlm_lock_reorder_req(lock);
 
 	req = ptlrpc_request_alloc_pack(lock->l_export->exp_imp_reverse,
@@ -914,6 +1127,7 @@ int ldlm_server_blocking_ast(struct ldlm_lock *lock,
 	ca = ptlrpc_req_async_args(ca, req);
 	ca->ca_set_arg = arg;
 	ca->ca_lock = lock;
+	ca->ca_batch = NULL;
 
 	req->rq_interpret_reply = ldlm_cb_interpret;
 
@@ -1035,6 +1249,7 @@ int ldlm_server_completion_ast(struct ldlm_lock *lock, __u64 flags, void *data)
 	ca = ptlrpc_req_async_args(ca, req);
 	ca->ca_set_arg = arg;
 	ca->ca_lock = lock;
+	ca->ca_batch = NULL;
 
 	req->rq_interpret_reply = ldlm_cb_interpret;
 	body = req_capsule_client_get(&req->rq_pill, &RMF_DLM_REQ);
@@ -1164,6 +1379,7 @@ int ldlm_server_glimpse_ast(struct ldlm_lock *lock, void *data)
 	ca = ptlrpc_req_async_args(ca, req);
 	ca->ca_set_arg = arg;
 	ca->ca_lock = lock;
+	ca->ca_batch = NULL;
 
 	/* server namespace, doesn't need lock */
 	req_capsule_set_size(&req->rq_pill, &RMF_DLM_LVB, RCL_SERVER,
@@ -1894,6 +2110,53 @@ void ldlm_handle_bl_callback(struct ldlm_namespace *ns,
 	EXIT;
 }
 
+/**
+ * Run the blocking callbacks of the locks of a multi-lock blocking AST.
+ *
+ * The locks which are unused are cancelled by their callbacks right away,
+ * ldlm_cli_cancel() puts them into one list while lock->l_bl_batch is set
+ * and they are all sent to the server in one LDLM_CANCEL RPC at the end.
+ * The references of the locks in \a locks are dropped.
+ */
+static void ldlm_handle_bl_batch(struct ldlm_namespace *ns,
+				 struct ldlm_lock_desc *ld,
+				 struct ldlm_lock **locks, int count)
+{
+	struct ldlm_bl_cancel_batch batch;
+	int i;
+
+	ENTRY;
+
+	batch.lbc_owner = current;
+	INIT_LIST_HEAD(&batch.lbc_cancels);
+	batch.lbc_count = 0;
+
+	for (i = 0; i < count && locks[i] != NULL; i++) {
+		struct ldlm_lock *lock = locks[i];
+
+		lock_res_and_lock(lock);
+		lock->l_bl_batch = &batch;
+		unlock_res_and_lock(lock);
+
+		/* keep the lock for the reset below */
+		LDLM_LOCK_GET(lock);
+		ldlm_handle_bl_callback(ns, ld, lock);
+
+		lock_res_and_lock(lock);
+		lock->l_bl_batch = NULL;
+		unlock_res_and_lock(lock);
+		LDLM_LOCK_RELEASE(lock);
+	}
+
+	if (batch.lbc_count > 0) {
+		CDEBUG(D_DLMTRACE, "%s: cancel %d of %d locks of blocking AST\n",
+		       ldlm_ns_name(ns), batch.lbc_count, i);
+		ldlm_cli_cancel_list(&batch.lbc_cancels, batch.lbc_count, NULL,
+				     LCF_ASYNC);
+	}
+	EXIT;
+}
+
 static int ldlm_callback_reply(struct ptlrpc_request *req, int rc)
 {
 	if (req->rq_no_reply)
@@ -2116,8 +2379,10 @@ static int __ldlm_bl_to_thread(struct ldlm_bl_work_item *blwi,
 	ENTRY;
 
 	spin_lock(&blp->blp_lock);
-	if (blwi->blwi_lock &&
-	    ldlm_is_discard_data(blwi->blwi_lock)) {
+	if ((blwi->blwi_lock &&
+	     ldlm_is_discard_data(blwi->blwi_lock)) ||
+	    (blwi->blwi_locks &&
+	     ldlm_is_discard_data(blwi->blwi_locks[0]))) {
 		/* add LDLM_FL_DISCARD_DATA requests to the priority list */
 		list_add_tail(&blwi->blwi_entry, &blp->blp_prio_list);
 	} else {
@@ -2212,6 +2477,27 @@ int ldlm_bl_to_thread_lock(struct ldlm_namespace *ns, struct ldlm_lock_desc *ld,
 	return ldlm_bl_to_thread(ns, ld, lock, NULL, 0, LCF_ASYNC);
 }
 
+/**
+ * Queue the locks of a multi-lock blocking AST to a bl thread, which frees
+ * the \a locks array of \a count entries when done.
+ */
+static int ldlm_bl_to_thread_batch(struct ldlm_namespace *ns,
+				   struct ldlm_lock_desc *ld,
+				   struct ldlm_lock **locks, int count)
+{
+	struct ldlm_bl_work_item *blwi;
+
+	OBD_ALLOC(blwi, sizeof(*blwi));
+	if (blwi == NULL)
+		return -ENOMEM;
+
+	init_blwi(blwi, ns, ld, NULL, 0, NULL, LCF_ASYNC);
+	blwi->blwi_locks = locks;
+	blwi->blwi_nlocks = count;
+
+	return __ldlm_bl_to_thread(blwi, LCF_ASYNC);
+}
+
 int ldlm_bl_to_thread_list(struct ldlm_namespace *ns, struct ldlm_lock_desc *ld,
 			   struct list_head *cancels, int count,
 			   enum ldlm_cancel_flags cancel_flags)
@@ -2289,6 +2575,132 @@ static inline void ldlm_callback_errmsg(struct ptlrpc_request *req,
 		CWARN("Send reply failed, maybe cause b=21636.\n");
 }
 
+/**
+ * Handle a blocking AST for several locks, see ldlm_bl_ast_batch_send().
+ *
+ * The AST is replied at once. The locks which cover no cached data are
+ * handed to a bl thread as a whole and cancelled in one LDLM_CANCEL RPC,
+ * the others go to the bl threads one by one to be flushed in parallel.
+ * The server handles of the locks which are gone or being cancelled
+ * already are sent back in one LDLM_CANCEL RPC, because the reply can not
+ * tell the server about single locks.
+ */
+static int ldlm_handle_bl_callback_batch(struct ptlrpc_request *req,
+					 struct ldlm_namespace *ns,
+					 struct ldlm_request *dlm_req)
+{
+	struct lustre_handle *stale;
+	struct ldlm_lock **locks;
+	int count = dlm_req->lock_count;
+	int max, nlocks = 0, nstale = 0, nbatch = 0;
+	int i, rc;
+
+	ENTRY;
+
+	req_capsule_extend(&req->rq_pill, &RQF_LDLM_BL_CALLBACK);
+
+	max = (req_capsule_get_size(&req->rq_pill, &RMF_DLM_REQ, RCL_CLIENT) -
+	       offsetof(struct ldlm_request, lock_handle)) /
+	      (2 * sizeof(struct lustre_handle));
+	if (dlm_req->lock_count > max) {
+		rc = ldlm_callback_reply(req, -EPROTO);
+		ldlm_callback_errmsg(req, "Operate with short handle array",
+				     rc, &dlm_req->lock_handle[0]);
+		RETURN(0);
+	}
+
+	OBD_ALLOC_PTR_ARRAY(locks, count);
+	OBD_ALLOC_PTR_ARRAY(stale, count);
+	if (locks == NULL || stale == NULL) {
+		if (locks != NULL)
+			OBD_FREE_PTR_ARRAY(locks, count);
+		if (stale != NULL)
+			OBD_FREE_PTR_ARRAY(stale, count);
+		rc = ldlm_callback_reply(req, -ENOMEM);
+		ldlm_callback_errmsg(req, "Operate without memory", rc,
+				     &dlm_req->lock_handle[0]);
+		RETURN(0);
+	}
+
+	for (i = 0; i < count; i++) {
+		struct lustre_handle *lockh = &dlm_req->lock_handle[2 * i];
+		struct ldlm_lock *lock;
+
+		lock = ldlm_handle2lock_long(lockh, 0);
+		if (lock == NULL) {
+			CDEBUG(D_DLMTRACE,
+			       "callback on lock %#llx - lock disappeared\n",
+			       lockh->cookie);
+			stale[nstale++] = lockh[1];
+			continue;
+		}
+
+		/* Copy hints/flags (e.g. LDLM_FL_DISCARD_DATA) from AST. */
+		lock_res_and_lock(lock);
+		lock->l_flags |= ldlm_flags_from_wire(dlm_req->lock_flags &
+						      LDLM_FL_AST_MASK);
+		/* see ldlm_callback_handler() */
+		if ((ldlm_is_canceling(lock) && ldlm_is_bl_done(lock)) ||
+		     ldlm_is_failed(lock)) {
+			LDLM_DEBUG(lock,
+				   "callback on lock %llx - lock disappeared",
+				   lockh->cookie);
+			unlock_res_and_lock(lock);
+			LDLM_LOCK_RELEASE(lock);
+			stale[nstale++] = lockh[1];
+			continue;
+		}
+		ldlm_lock_remove_from_lru(lock);
+		ldlm_set_bl_ast(lock);
+		if (lock->l_remote_handle.cookie == 0)
+			lock->l_remote_handle = lockh[1];
+		unlock_res_and_lock(lock);
+
+		locks[nlocks++] = lock;
+	}
+
+	CDEBUG(D_INODE, "blocking ast for %d locks, %d stale\n", count,
+	       nstale);
+	rc = ldlm_callback_reply(req, 0);
+	if (req->rq_no_reply || rc)
+		ldlm_callback_errmsg(req, "Normal process", rc,
+				     &dlm_req->lock_handle[0]);
+
+	if (nstale > 0)
+		ldlm_cli_cancel_handles(class_exp2cliimp(req->rq_export),
+					stale, nstale);
+	OBD_FREE_PTR_ARRAY(stale, count);
+
+	/* The callback of a lock which covers cached data has to write it
+	 * back or discard it, which may take long.  Such locks are handed to
+	 * the bl threads one by one like for a single-lock AST, so that they
+	 * are flushed in parallel and each is cancelled as soon as it is
+	 * done.  Only the locks which can be cancelled right away are kept
+	 * in the batch. */
+	for (i = 0; i < nlocks; i++) {
+		struct ldlm_lock *lock = locks[i];
+
+		if (ns->ns_cancel != NULL && ns->ns_cancel(lock) != 0) {
+			locks[nbatch++] = lock;
+			continue;
+		}
+		if (ldlm_bl_to_thread_lock(ns, &dlm_req->lock_desc, lock))
+			ldlm_handle_bl_callback(ns, &dlm_req->lock_desc, lock);
+	}
+	if (nbatch < count)
+		locks[nbatch] = NULL;
+
+	if (nbatch == 0) {
+		OBD_FREE_PTR_ARRAY(locks, count);
+	} else if (ldlm_bl_to_thread_batch(ns, &dlm_req->lock_desc, locks,
+					   count)) {
+		ldlm_handle_bl_batch(ns, &dlm_req->lock_desc, locks, count);
+		OBD_FREE_PTR_ARRAY(locks, count);
+	}
+
+	RETURN(0);
+}
+
 /* TODO: handle requests in a similar way as MDT: see mdt_handle_common() */
 static int ldlm_callback_handler(struct ptlrpc_request *req)
 {
@@ -2373,6 +2785,11 @@ static int ldlm_callback_handler(struct ptlrpc_request *req)
 			CERROR("ldlm_cli_cancel: %d\n", rc);
 	}
 
+	/* a blocking AST of one lock has lock_count 0 */
+	if (lustre_msg_get_opc(req->rq_reqmsg) == LDLM_BL_CALLBACK &&
+	    dlm_req->lock_count > 1)
+		RETURN(ldlm_handle_bl_callback_batch(req, ns, dlm_req));
+
 	lock = ldlm_handle2lock_long(&dlm_req->lock_handle[0], 0);
 	if (!lock) {
 		CDEBUG(D_DLMTRACE,
@@ -2844,6 +3261,10 @@ static int ldlm_bl_thread_blwi(struct ldlm_bl_pool *blp,
 						   LCF_BL_AST);
 		ldlm_cli_cancel_list(&blwi->blwi_head, count, NULL,
 				     blwi->blwi_flags);
+	} else if (blwi->blwi_locks) {
+		ldlm_handle_bl_batch(blwi->blwi_ns, &blwi->blwi_ld,
+				     blwi->blwi_locks, blwi->blwi_nlocks);
+		OBD_FREE_PTR_ARRAY(blwi->blwi_locks, blwi->blwi_nlocks);
 	} else if (blwi->blwi_lock) {
 		ldlm_handle_bl_callback(blwi->blwi_ns, &blwi->blwi_ld,
 					blwi->blwi_lock);
@@ -1406,6 +1406,55 @@ out:
 	return sent ? sent : rc;
 }
 
+/**
+ * Send an asynchronous LDLM_CANCEL RPC for \a count server lock handles,
+ * for locks of a multi-lock blocking AST which the client has no more.
+ */
+int ldlm_cli_cancel_handles(struct obd_import *imp,
+			    struct lustre_handle *handles, int count)
+{
+	struct ptlrpc_request *req;
+	struct ldlm_request *dlm;
+	int rc;
+
+	ENTRY;
+
+	if (imp == NULL || imp->imp_invalid)
+		RETURN(0);
+
+	/* a blocking AST carries two handles per lock, so they should fit */
+	count = min(count, ldlm_format_handles_avail(imp, &RQF_LDLM_CANCEL,
+						     RCL_CLIENT, 0));
+
+	req = ptlrpc_request_alloc(imp, &RQF_LDLM_CANCEL);
+	if (req == NULL)
+		RETURN(-ENOMEM);
+
+	req_capsule_filled_sizes(&req->rq_pill, RCL_CLIENT);
+	req_capsule_set_size(&req->rq_pill, &RMF_DLM_REQ, RCL_CLIENT,
+			     ldlm_request_bufsize(count, LDLM_CANCEL));
+
+	rc = ptlrpc_request_pack(req, LUSTRE_DLM_VERSION, LDLM_CANCEL);
+	if (rc) {
+		ptlrpc_request_free(req);
+		RETURN(rc);
+	}
+
+	req->rq_request_portal = LDLM_CANCEL_REQUEST_PORTAL;
+	req->rq_reply_portal = LDLM_CANCEL_REPLY_PORTAL;
+	ptlrpc_at_set_req_timeout(req);
+
+	dlm = req_capsule_client_get(&req->rq_pill, &RMF_DLM_REQ);
+	memcpy(dlm->lock_handle, handles, count * sizeof(*handles));
+	dlm->lock_count = count;
+	CDEBUG(D_DLMTRACE, "%d stale locks packed\n", count);
+
+	ptlrpc_request_set_replen(req);
+	ptlrpcd_add_req(req);
+
+	RETURN(0);
+}
+
 static inline struct ldlm_pool *ldlm_imp2pl(struct obd_import *imp)
 {
 	LASSERT(imp != NULL);
@@ -1570,6 +1619,27 @@ int ldlm_cli_cancel(const struct lustre_handle *lockh,
 	 * here and send them all as one LDLM_CANCEL RPC.
 	 */
 	LASSERT(list_empty(&lock->l_bl_ast));
+
+	/*
+	 * A bl thread handling a multi-lock blocking AST sends the cancels
+	 * of all its locks together, see ldlm_handle_bl_batch().
+	 */
+	if (READ_ONCE(lock->l_bl_batch) != NULL) {
+		struct ldlm_bl_cancel_batch *batch;
+
+		lock_res_and_lock(lock);
+		batch = lock->l_bl_batch;
+		if (batch != NULL && batch->lbc_owner == current) {
+			list_add_tail(&lock->l_bl_ast, &batch->lbc_cancels);
+			batch->lbc_count++;
+		} else {
+			batch = NULL;
+		}
+		unlock_res_and_lock(lock);
+		if (batch != NULL)
+			RETURN(0);
+	}
+
 	list_add(&lock->l_bl_ast, &cancels);
 
 	exp = lock->l_conn_export;
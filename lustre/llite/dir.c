@@ -318,6 +318,9 @@ static int ll_readdir(struct file *filp, void *cookie, filldir_t filldir)
 		 */
 		GOTO(out, rc = 0);
 
+	/* the entries created locally must be in the pages read */
+	ll_wbc_flush(inode);
+
 	if (unlikely(ll_dir_striped(inode))) {
 		/*
 		 * This is only needed for striped dir to fill ..,
@@ -2260,10 +2263,17 @@ static int ll_dir_release(struct inode *inode, struct file *file)
         RETURN(ll_file_release(inode, file));
 }
 
+/* catch the errors of the creates queued in the directory, see llite/wbc.c */
+static int ll_dir_flush(struct file *file, fl_owner_t id)
+{
+	return ll_wbc_dir_rc(file_inode(file));
+}
+
 const struct file_operations ll_dir_operations = {
 	.llseek		= ll_dir_seek,
 	.open		= ll_dir_open,
 	.release	= ll_dir_release,
+	.flush		= ll_dir_flush,
 	.read		= generic_read_dir,
 #ifdef HAVE_DIR_CONTEXT
 	.iterate_shared	= ll_iterate,
@@ -40,6 +40,7 @@
 #include <lustre_dlm.h>
 #include <linux/pagemap.h>
 #include <linux/file.h>
+#include <linux/kthread.h>
 #include <linux/sched.h>
 #include <linux/user_namespace.h>
 #include <linux/uidgid.h>
@@ -769,6 +770,11 @@ int ll_file_open(struct inode *inode, struct file *file)
 	it = file->private_data; /* XXX: compat macro */
 	file->private_data = NULL; /* prevent ll_local_open assertion */
 
+	/* the object must exist on the MDT to be opened */
+	rc = ll_wbc_wait(inode);
+	if (rc)
+		GOTO(out_nofiledata, rc);
+
 	if (S_ISREG(inode->i_mode)) {
 		rc = llcrypt_file_open(inode, file);
 		if (rc)
@@ -938,6 +944,7 @@ restart:
 	if (!S_ISREG(inode->i_mode))
 		GOTO(out_och_free, rc);
 	cl_lov_delay_create_clear(&file->f_flags);
+	pcc_readonly_open(inode, file);
 	GOTO(out_och_free, rc);
 
 out_och_free:
@@ -1509,6 +1516,8 @@ static void ll_heat_add(struct inode *inode, enum cl_io_type iot,
 	enum obd_heat_type sample_type;
 	enum obd_heat_type iobyte_type;
 	__u64 now = ktime_get_real_seconds();
+	struct cl_object_header *hdr;
+	__u64 heat;
 
 	if (!ll_sbi_has_file_heat(sbi) ||
 	    lli->lli_heat_flags & LU_HEAT_FLAG_OFF)
@@ -1529,7 +1538,31 @@ static void ll_heat_add(struct inode *inode, enum cl_io_type iot,
 		     sbi->ll_heat_decay_weight, sbi->ll_heat_period_second);
 	obd_heat_add(&lli->lli_heat_instances[iobyte_type], now, count,
 		     sbi->ll_heat_decay_weight, sbi->ll_heat_period_second);
+	if (sbi->ll_heat_hot_threshold == 0 || lli->lli_clob == NULL) {
+		spin_unlock(&lli->lli_heat_lock);
+		return;
+	}
+
+	heat = obd_heat_get(&lli->lli_heat_instances[OBD_HEAT_READSAMPLE],
+			    now, sbi->ll_heat_decay_weight,
+			    sbi->ll_heat_period_second) +
+	       obd_heat_get(&lli->lli_heat_instances[OBD_HEAT_WRITESAMPLE],
+			    now, sbi->ll_heat_decay_weight,
+			    sbi->ll_heat_period_second);
 	spin_unlock(&lli->lli_heat_lock);
+
+	if (heat < sbi->ll_heat_hot_threshold)
+		return;
+
+	/* the file stays hot for one heat period after the last access at
+	 * the hot rate */
+	hdr = cl_object_header(lli->lli_clob);
+	if (hdr->coh_hot_expire <= now) {
+		CDEBUG(D_CACHE, "%s: "DFID" is hot, heat %llu\n",
+		       sbi->ll_fsname, PFID(ll_inode2fid(inode)), heat);
+		ll_stats_ops_tally(sbi, LPROC_LL_HEAT_HOT, 1);
+	}
+	hdr->coh_hot_expire = now + sbi->ll_heat_period_second;
 }
 
 static ssize_t
@@ -1556,7 +1589,7 @@ ll_file_io_generic(const struct lu_env *env, struct vvp_io_args *args,
 		iot == CIT_READ ? "read" : "write", *ppos, count);
 
 	io = vvp_env_thread_io(env);
-	if (file->f_flags & O_DIRECT) {
+	if (ll_iocb_direct(args->u.normal.via_iocb)) {
 		if (!is_sync_kiocb(args->u.normal.via_iocb))
 			is_aio = true;
 		ci_aio = cl_aio_alloc(args->u.normal.via_iocb);
@@ -1585,10 +1618,15 @@ restart:
 		/* Direct IO reads must also take range lock,
 		 * or multiple reads will try to work on the same pages
 		 * See LU-6227 for details.
+		 * Each direct IO read has its own transient pages, so reads
+		 * take the range lock shared and only exclude writes.
 		 */
 		if (((iot == CIT_WRITE) ||
-		    (iot == CIT_READ && (file->f_flags & O_DIRECT))) &&
-		    !(vio->vui_fd->fd_flags & LL_FILE_GROUP_LOCKED)) {
+		    (iot == CIT_READ && ll_iocb_direct(vio->vui_iocb))) &&
+		    !(vio->vui_fd->fd_flags & LL_FILE_GROUP_LOCKED) &&
+		    !args->via_range_locked) {
+			if (iot == CIT_READ)
+				range.rl_shared = 1;
 			CDEBUG(D_VFSTRACE, "Range lock "RL_FMT"\n",
 			       RL_PARA(&range));
 			rc = range_lock(&lli->lli_write_tree, &range);
@@ -1764,6 +1802,335 @@ ll_do_fast_read(struct kiocb *iocb, struct iov_iter *iter)
 	return result;
 }
 
+/*
+ * Hybrid IO: buffered reads and writes of at least the configured threshold
+ * are done as direct IO, to avoid the CPU and page cache locking overhead of
+ * buffered IO for large streaming requests. Only IO that direct IO can handle
+ * without bounce pages is switched, i.e. page aligned file offset, length and
+ * user buffers. Files mapped into memory keep using the page cache, and so do
+ * appends, which need the file size protected by DLM locks. Cached pages in
+ * the IO range are flushed and invalidated by the generic direct IO code.
+ *
+ * \retval true if \a iocb has been switched to direct IO
+ */
+static bool ll_hybrid_io_switch(struct kiocb *iocb, struct iov_iter *iter,
+				enum cl_io_type iot)
+{
+#ifdef IOCB_DIRECT
+	struct file *file = iocb->ki_filp;
+	struct ll_sb_info *sbi = ll_i2sbi(file_inode(file));
+	size_t count = iov_iter_count(iter);
+	unsigned long threshold;
+
+	if (!ll_sbi_has_hybrid_io(sbi) || (iocb->ki_flags & IOCB_DIRECT))
+		return false;
+
+	/* AIO submitters which want async direct IO ask for it with O_DIRECT */
+	if (!is_sync_kiocb(iocb) || !iter_is_iovec(iter))
+		return false;
+
+	threshold = iot == CIT_READ ? sbi->ll_hybrid_io_read_threshold :
+				      sbi->ll_hybrid_io_write_threshold;
+	if (count < threshold)
+		return false;
+
+	if ((iocb->ki_pos | count | iov_iter_alignment(iter)) & ~PAGE_MASK)
+		return false;
+
+	if (iot == CIT_WRITE && (file->f_flags & O_APPEND))
+		return false;
+
+	if (mapping_mapped(file->f_mapping))
+		return false;
+
+	iocb->ki_flags |= IOCB_DIRECT;
+	return true;
+#else
+	return false;
+#endif
+}
+
+static void ll_hybrid_io_done(struct kiocb *iocb, enum cl_io_type iot,
+			      ssize_t result)
+{
+#ifdef IOCB_DIRECT
+	iocb->ki_flags &= ~IOCB_DIRECT;
+	if (result > 0)
+		ll_stats_ops_tally(ll_i2sbi(file_inode(iocb->ki_filp)),
+				   iot == CIT_READ ? LPROC_LL_HYBRID_READ :
+						     LPROC_LL_HYBRID_WRITE,
+				   result);
+#endif
+}
+
+/*
+ * Parallel IO: a large buffered read or write of a file striped over several
+ * OSTs is cut at stripe boundaries, and the stripe units are spread over the
+ * ll-pio-wq workers so that each worker drives its own set of stripes through
+ * its own cl_io. The DLM enqueue, page setup and RPC queueing of different
+ * OSTs then run on different CPUs, instead of cl_io_loop() walking the
+ * stripes one after another on the thread of the application.
+ *
+ * The workers borrow the address space and credentials of the submitter to
+ * copy the user data, so the submitter waits for all of them to finish. For
+ * writes the submitter holds the range lock over the whole IO on behalf of
+ * the workers, so the write stays atomic against other local writers.
+ *
+ * Only the bytes before the first failed or short stripe unit are reported,
+ * but the workers of the later units may have written theirs already.  If
+ * that extended the file, it is truncated back to the reported end of the
+ * write, so that the file size matches what write() returned.
+ */
+#ifdef HAVE_KTHREAD_USE_MM
+struct ll_pio_task {
+	struct work_struct	 pt_work;
+	struct completion	 pt_done;
+	struct kiocb		*pt_iocb;	/* IO of the submitter */
+	struct iov_iter		*pt_iter;
+	struct mm_struct	*pt_mm;
+	const struct cred	*pt_cred;
+	enum cl_io_type		 pt_iot;
+	bool			 pt_range_locked;
+	/* this task does stripe units pt_index, pt_index + pt_nr, ... */
+	unsigned int		 pt_index;
+	unsigned int		 pt_nr;
+	size_t			 pt_unit;
+	/* first byte this task failed to transfer, end of IO if none */
+	loff_t			 pt_pos;
+	int			 pt_rc;
+};
+
+static void ll_pio_task_fn(struct work_struct *work)
+{
+	struct ll_pio_task *pt = container_of(work, struct ll_pio_task,
+					      pt_work);
+	struct file *file = pt->pt_iocb->ki_filp;
+	loff_t pos = pt->pt_iocb->ki_pos;
+	loff_t end = pos + iov_iter_count(pt->pt_iter);
+	const struct cred *old_cred;
+	struct vvp_io_args *args;
+	struct lu_env *env;
+	u64 unit_nr;
+	__u16 refcheck;
+
+	env = cl_env_get(&refcheck);
+	if (IS_ERR(env)) {
+		pt->pt_rc = PTR_ERR(env);
+		pt->pt_pos = pos;
+		complete(&pt->pt_done);
+		return;
+	}
+
+	kthread_use_mm(pt->pt_mm);
+	old_cred = override_creds(pt->pt_cred);
+
+	args = ll_env_args(env);
+	unit_nr = pos;
+	do_div(unit_nr, pt->pt_unit);
+	for (unit_nr += pt->pt_index; ; unit_nr += pt->pt_nr) {
+		loff_t start = max_t(loff_t, unit_nr * pt->pt_unit, pos);
+		struct iov_iter iter = *pt->pt_iter;
+		struct kiocb iocb = *pt->pt_iocb;
+		size_t count;
+		ssize_t rc;
+
+		if (start >= end)
+			break;
+
+		count = min_t(loff_t, (unit_nr + 1) * pt->pt_unit, end) -
+			start;
+		iov_iter_advance(&iter, start - pos);
+		iov_iter_truncate(&iter, count);
+		iocb.ki_pos = start;
+
+		args->u.normal.via_iter = &iter;
+		args->u.normal.via_iocb = &iocb;
+		args->via_range_locked = pt->pt_range_locked;
+		rc = ll_file_io_generic(env, args, file, pt->pt_iot,
+					&iocb.ki_pos, count);
+		args->via_range_locked = 0;
+		if (rc < (ssize_t)count) {
+			pt->pt_pos = start + max_t(ssize_t, rc, 0);
+			pt->pt_rc = min_t(ssize_t, rc, 0);
+			break;
+		}
+	}
+
+	revert_creds(old_cred);
+	kthread_unuse_mm(pt->pt_mm);
+	cl_env_put(env, &refcheck);
+	complete(&pt->pt_done);
+}
+#endif
+
+/**
+ * Decide whether \a iocb is done as parallel IO.
+ *
+ * \retval number of worker tasks to split the IO over, 0 for normal IO
+ */
+static unsigned int ll_pio_switch(const struct lu_env *env, struct kiocb *iocb,
+				  struct iov_iter *iter, enum cl_io_type iot,
+				  size_t *unit)
+{
+#ifdef HAVE_KTHREAD_USE_MM
+	struct file *file = iocb->ki_filp;
+	struct inode *inode = file_inode(file);
+	struct ll_sb_info *sbi = ll_i2sbi(inode);
+	struct cl_object *obj = ll_i2info(inode)->lli_clob;
+	struct cl_layout cl = {
+		.cl_layout_gen = 0,
+	};
+	size_t count = iov_iter_count(iter);
+	u64 units;
+	unsigned int nr;
+
+	if (!ll_sbi_has_pio(sbi) || ll_iocb_direct(iocb))
+		return 0;
+
+	if (!is_sync_kiocb(iocb) || !iter_is_iovec(iter) || !current->mm)
+		return 0;
+
+	if (count < sbi->ll_pio_threshold || obj == NULL)
+		return 0;
+
+	if (iot == CIT_WRITE && (file->f_flags & O_APPEND))
+		return 0;
+
+	if (cl_object_layout_get(env, obj, &cl) < 0 ||
+	    cl.cl_stripe_count < 2 || cl.cl_stripe_size == 0)
+		return 0;
+
+	*unit = cl.cl_stripe_size;
+	units = iocb->ki_pos + count + *unit - 1;
+	do_div(units, *unit);
+	units -= div_u64(iocb->ki_pos, *unit);
+
+	nr = min_t(u64, units, cl.cl_stripe_count);
+	nr = min_t(unsigned int, nr,
+		   cfs_cpt_weight(cfs_cpt_tab, CFS_CPT_ANY));
+
+	return nr > 1 ? nr : 0;
+#else
+	return 0;
+#endif
+}
+
+static ssize_t ll_file_pio(struct kiocb *iocb, struct iov_iter *iter,
+			   enum cl_io_type iot, unsigned int nr, size_t unit)
+{
+#ifdef HAVE_KTHREAD_USE_MM
+	struct file *file = iocb->ki_filp;
+	struct inode *inode = file_inode(file);
+	struct ll_inode_info *lli = ll_i2info(inode);
+	struct ll_file_data *fd = file->private_data;
+	loff_t end = iocb->ki_pos + iov_iter_count(iter);
+	struct ll_pio_task *tasks;
+	struct range_lock range;
+	bool range_locked = false;
+	loff_t done = iocb->ki_pos;
+	loff_t size = 0;
+	ssize_t result = 0;
+	unsigned int i;
+	int rc = 0;
+
+	ENTRY;
+
+	OBD_ALLOC_PTR_ARRAY(tasks, nr);
+	if (tasks == NULL)
+		RETURN(-ENOMEM);
+
+	if (iot == CIT_WRITE && !(fd->fd_flags & LL_FILE_GROUP_LOCKED)) {
+		range_lock_init(&range, iocb->ki_pos, end - 1);
+		rc = range_lock(&lli->lli_write_tree, &range);
+		if (rc < 0)
+			GOTO(out, rc);
+		range_locked = true;
+	}
+
+	/* size before the write, to undo what it extended past a failure */
+	if (iot == CIT_WRITE) {
+		rc = cl_glimpse_size(inode);
+		if (rc < 0)
+			GOTO(out_unlock, rc);
+		size = i_size_read(inode);
+	}
+
+	CDEBUG(D_VFSTRACE, "%s: parallel %s [%llu, %llu) over %u tasks\n",
+	       file_dentry(file)->d_name.name,
+	       iot == CIT_READ ? "read" : "write", iocb->ki_pos, end, nr);
+
+	done = end;
+	for (i = 0; i < nr; i++) {
+		struct ll_pio_task *pt = &tasks[i];
+
+		INIT_WORK(&pt->pt_work, ll_pio_task_fn);
+		init_completion(&pt->pt_done);
+		pt->pt_iocb = iocb;
+		pt->pt_iter = iter;
+		pt->pt_mm = current->mm;
+		pt->pt_cred = current_cred();
+		pt->pt_iot = iot;
+		pt->pt_range_locked = range_locked;
+		pt->pt_index = i;
+		pt->pt_nr = nr;
+		pt->pt_unit = unit;
+		pt->pt_pos = end;
+		queue_work(ll_i2sbi(inode)->ll_pio_wq, &pt->pt_work);
+	}
+
+	/* only the bytes before the first failure count as transferred */
+	for (i = 0; i < nr; i++) {
+		wait_for_completion(&tasks[i].pt_done);
+		if (tasks[i].pt_pos < done) {
+			done = tasks[i].pt_pos;
+			rc = tasks[i].pt_rc;
+		}
+	}
+
+	/* Cut what the later units added to the file past the short count.
+	 * A size beyond the end of the write was set by somebody else. */
+	if (iot == CIT_WRITE && done < end && size < end &&
+	    i_size_read(inode) > max(size, done) &&
+	    i_size_read(inode) <= end) {
+		struct iattr attr = {
+			.ia_valid = ATTR_SIZE | ATTR_MTIME | ATTR_CTIME,
+			.ia_size = max(size, done),
+		};
+		int rc2;
+
+		inode_lock(inode);
+		rc2 = ll_setattr_raw(file_dentry(file), &attr, 0, false);
+		inode_unlock(inode);
+		if (rc2 < 0) {
+			CWARN("%s: cannot truncate "DFID" to %llu after short parallel write: rc = %d\n",
+			      ll_i2sbi(inode)->ll_fsname,
+			      PFID(ll_inode2fid(inode)), attr.ia_size, rc2);
+			if (rc == 0)
+				rc = rc2;
+		}
+	}
+
+out_unlock:
+	if (range_locked)
+		range_unlock(&lli->lli_write_tree, &range);
+
+	result = done - iocb->ki_pos;
+	if (result > 0) {
+		iov_iter_advance(iter, result);
+		iocb->ki_pos += result;
+		ll_stats_ops_tally(ll_i2sbi(inode), iot == CIT_READ ?
+				   LPROC_LL_PIO_READ : LPROC_LL_PIO_WRITE,
+				   result);
+	}
+out:
+	OBD_FREE_PTR_ARRAY(tasks, nr);
+
+	RETURN(result > 0 ? result : rc);
+#else
+	return -EOPNOTSUPP;
+#endif
+}
+
 /*
  * Read from a file (through the page cache).
  */
@@ -1777,20 +2144,23 @@ static ssize_t ll_file_read_iter(struct kiocb *iocb, struct iov_iter *to)
 	__u16 refcheck;
 	ktime_t kstart = ktime_get();
 	bool cached;
+	bool hybrid;
+	size_t unit;
+	unsigned int pio = 0;
 
 	if (!iov_iter_count(to))
 		return 0;
 
 	/**
-	 * Currently when PCC read failed, we do not fall back to the
+	 * Currently when RW-PCC read failed, we do not fall back to the
 	 * normal read path, just return the error.
 	 * The resaon is that: for RW-PCC, the file data may be modified
 	 * in the PCC and inconsistent with the data on OSTs (or file
 	 * data has been removed from the Lustre file system), at this
 	 * time, fallback to the normal read path may read the wrong
 	 * data.
-	 * TODO: for RO-PCC (readonly PCC), fall back to normal read
-	 * path: read data from data copy on OSTs.
+	 * For RO-PCC (readonly PCC), pcc_file_read_iter() detaches the
+	 * file and returns uncached, so the data is read from OSTs.
 	 */
 	result = pcc_file_read_iter(iocb, to, &cached);
 	if (cached)
@@ -1810,8 +2180,16 @@ static ssize_t ll_file_read_iter(struct kiocb *iocb, struct iov_iter *to)
 	args->u.normal.via_iter = to;
 	args->u.normal.via_iocb = iocb;
 
-	rc2 = ll_file_io_generic(env, args, file, CIT_READ,
-				 &iocb->ki_pos, iov_iter_count(to));
+	hybrid = ll_hybrid_io_switch(iocb, to, CIT_READ);
+	if (!hybrid)
+		pio = ll_pio_switch(env, iocb, to, CIT_READ, &unit);
+	if (pio)
+		rc2 = ll_file_pio(iocb, to, CIT_READ, pio, unit);
+	else
+		rc2 = ll_file_io_generic(env, args, file, CIT_READ,
+					 &iocb->ki_pos, iov_iter_count(to));
+	if (hybrid)
+		ll_hybrid_io_done(iocb, CIT_READ, rc2);
 	if (rc2 > 0)
 		result += rc2;
 	else if (result == 0)
@@ -1900,6 +2278,9 @@ static ssize_t ll_file_write_iter(struct kiocb *iocb, struct iov_iter *from)
 	struct file *file = iocb->ki_filp;
 	__u16 refcheck;
 	bool cached;
+	bool hybrid;
+	size_t unit;
+	unsigned int pio = 0;
 	ktime_t kstart = ktime_get();
 	int result;
 
@@ -1945,8 +2326,17 @@ static ssize_t ll_file_write_iter(struct kiocb *iocb, struct iov_iter *from)
 	args->u.normal.via_iter = from;
 	args->u.normal.via_iocb = iocb;
 
-	rc_normal = ll_file_io_generic(env, args, file, CIT_WRITE,
-				       &iocb->ki_pos, iov_iter_count(from));
+	hybrid = ll_hybrid_io_switch(iocb, from, CIT_WRITE);
+	if (!hybrid)
+		pio = ll_pio_switch(env, iocb, from, CIT_WRITE, &unit);
+	if (pio)
+		rc_normal = ll_file_pio(iocb, from, CIT_WRITE, pio, unit);
+	else
+		rc_normal = ll_file_io_generic(env, args, file, CIT_WRITE,
+					       &iocb->ki_pos,
+					       iov_iter_count(from));
+	if (hybrid)
+		ll_hybrid_io_done(iocb, CIT_WRITE, rc_normal);
 
 	/* On success, combine bytes written. */
 	if (rc_tiny >= 0 && rc_normal > 0)
@@ -3998,6 +4388,33 @@ out_ladvise:
 		rc = ll_heat_set(inode, flags);
 		RETURN(rc);
 	}
+	case LL_IOC_PCC_ATTACH: {
+		struct lu_pcc_attach *attach;
+
+		if (!S_ISREG(inode->i_mode))
+			RETURN(-EINVAL);
+
+		if (!(file->f_mode & FMODE_READ))
+			RETURN(-EBADF);
+
+		OBD_ALLOC_PTR(attach);
+		if (attach == NULL)
+			RETURN(-ENOMEM);
+
+		if (copy_from_user(attach,
+				   (const struct lu_pcc_attach __user *)arg,
+				   sizeof(*attach)))
+			GOTO(out_attach_free, rc = -EFAULT);
+
+		/* RW-PCC attach goes through the LL_LEASE_PCC_ATTACH lease */
+		if (attach->pcca_type != LU_PCC_READONLY)
+			GOTO(out_attach_free, rc = -EOPNOTSUPP);
+
+		rc = pcc_readonly_attach(file, inode, attach->pcca_id);
+out_attach_free:
+		OBD_FREE_PTR(attach);
+		RETURN(rc);
+	}
 	case LL_IOC_PCC_DETACH: {
 		struct lu_pcc_detach *detach;
 
@@ -4270,6 +4687,15 @@ int ll_fsync(struct file *file, loff_t start, loff_t end, int datasync)
 		}
 	}
 
+	/* the creates queued in the directory are made durable as well,
+	 * and those which failed are reported */
+	if (S_ISDIR(inode->i_mode)) {
+		ll_wbc_flush(inode);
+		err = ll_wbc_dir_rc(inode);
+		if (rc == 0)
+			rc = err;
+	}
+
 	err = md_fsync(ll_i2sbi(inode)->ll_md_exp, ll_inode2fid(inode), &req);
 	if (!rc)
 		rc = err;
@@ -4668,7 +5094,8 @@ int ll_have_md_lock(struct inode *inode, __u64 *bits, enum ldlm_mode l_req_mode)
 	struct lustre_handle lockh;
 	union ldlm_policy_data policy;
 	enum ldlm_mode mode = (l_req_mode == LCK_MINMODE) ?
-			      (LCK_CR | LCK_CW | LCK_PR | LCK_PW) : l_req_mode;
+			      (LCK_CR | LCK_CW | LCK_PR | LCK_PW | LCK_EX) :
+			      l_req_mode;
 	struct lu_fid *fid;
 	__u64 flags;
 	int i;
@@ -4766,6 +5193,10 @@ static int ll_inode_revalidate(struct dentry *dentry, enum ldlm_intent_flags op)
 	CDEBUG(D_VFSTRACE, "VFS Op:inode="DFID"(%p),name=%s\n",
 	       PFID(ll_inode2fid(inode)), inode, dentry->d_name.name);
 
+	rc = ll_wbc_wait(inode);
+	if (rc)
+		RETURN(rc);
+
 	if (exp_connect_flags2(exp) & OBD_CONNECT2_GETATTR_PFID) {
 		parent = dentry->d_parent->d_inode;
 		name = dentry->d_name.name;
@@ -5188,6 +5619,10 @@ int ll_set_acl(struct inode *inode, struct posix_acl *acl, int type)
 	if (rc)
 		return rc;
 
+	rc = ll_wbc_wait(inode);
+	if (rc)
+		return rc;
+
 	if (acl) {
 		value_size = posix_acl_xattr_size(acl->a_count);
 		value = kmalloc(value_size, GFP_NOFS);
@@ -5629,7 +6064,9 @@ static int ll_layout_intent(struct inode *inode, struct layout_intent *intent)
 	memset(&it, 0, sizeof(it));
 	it.it_op = IT_LAYOUT;
 	if (intent->li_opc == LAYOUT_INTENT_WRITE ||
-	    intent->li_opc == LAYOUT_INTENT_TRUNC)
+	    intent->li_opc == LAYOUT_INTENT_TRUNC ||
+	    intent->li_opc == LAYOUT_INTENT_PCCRO_SET ||
+	    intent->li_opc == LAYOUT_INTENT_PCCRO_CLEAR)
 		it.it_flags = FMODE_WRITE;
 
 	LDLM_DEBUG_NOLOCK("%s: requeue layout lock for file "DFID"(%p)",
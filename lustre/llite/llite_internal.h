@@ -177,6 +177,15 @@ struct ll_inode_info {
 			struct lmv_stripe_md		*lli_lsm_md;
 			/* directory default LMV */
 			struct lmv_stripe_md		*lli_default_lsm_md;
+			/* metadata write-back cache, EX lock owning the
+			 * directory, creates queued in it and MDT index new
+			 * entries are allocated on, see llite/wbc.c */
+			struct lustre_handle		lli_wbc_lockh;
+			atomic_t			lli_wbc_pending;
+			__u32				lli_wbc_mdt;
+			/* first error of the creates queued in the
+			 * directory, not yet returned by fsync or close */
+			int				lli_wbc_dir_rc;
 		};
 
 		/* for non-directory */
@@ -262,6 +271,9 @@ struct ll_inode_info {
 	struct rw_semaphore		lli_xattrs_list_rwsem;
 	struct mutex			lli_xattrs_enq_lock;
 	struct list_head		lli_xattrs; /* ll_xattr_entry->xe_list */
+
+	/* result of the write-back create of this inode */
+	int				lli_wbc_rc;
 };
 
 static inline void ll_trunc_sem_init(struct ll_trunc_sem *sem)
@@ -403,6 +415,10 @@ enum ll_file_flags {
 	LLIF_PROJECT_INHERIT	= 3,
 	/* update atime from MDS even if it's older than local inode atime. */
 	LLIF_UPDATE_ATIME	= 4,
+	/* Directory is owned by this client with an EX lock */
+	LLIF_WBC_OWNED		= 5,
+	/* Inode is created locally, create RPC is not finished yet */
+	LLIF_WBC_PENDING	= 6,
 
 };
 
@@ -541,6 +557,10 @@ enum ra_stat {
 	RA_STAT_ASYNC,
 	RA_STAT_FAILED_FAST_READ,
 	RA_STAT_MMAP_RANGE_READ,
+	RA_STAT_PATTERN_STRIDE_HIT,
+	RA_STAT_PATTERN_STRIDE_MISS,
+	RA_STAT_PATTERN_NESTED_HIT,
+	RA_STAT_PATTERN_NESTED_MISS,
 	_NR_RA_STAT,
 };
 
@@ -645,12 +665,12 @@ enum stats_track_type {
 				       * suppress_pings */
 #define LL_SBI_FAST_READ     0x400000 /* fast read support */
 #define LL_SBI_FILE_SECCTX   0x800000 /* set file security context at create */
-/*	LL_SBI_PIO	    0x1000000    parallel IO support, introduced in
-					 2.10, abandoned */
+#define LL_SBI_PIO	    0x1000000 /* large IO split over worker threads */
 #define LL_SBI_TINY_WRITE   0x2000000 /* tiny write support */
 #define LL_SBI_FILE_HEAT    0x4000000 /* file heat support */
 #define LL_SBI_TEST_DUMMY_ENCRYPTION    0x8000000 /* test dummy encryption */
 #define LL_SBI_ENCRYPT	   0x10000000 /* client side encryption */
+#define LL_SBI_HYBRID_IO    0x20000000 /* large IO switched to direct IO */
 #define LL_SBI_FLAGS { 	\
 	"nolck",	\
 	"checksum",	\
@@ -681,6 +701,7 @@ enum stats_track_type {
 	"file_heat",	\
 	"test_dummy_encryption", \
 	"noencrypt",	\
+	"hybrid_io",	\
 }
 
 /* This is embedded into llite super-blocks to keep track of connect
@@ -714,7 +735,8 @@ struct ll_sb_info {
 	unsigned int		  ll_xattr_cache_enabled:1,
 				  ll_xattr_cache_set:1, /* already set to 0/1 */
 				  ll_client_common_fill_super_succeeded:1,
-				  ll_checksum_set:1;
+				  ll_checksum_set:1,
+				  ll_wbc_enabled:1;
 
         struct lustre_client_ocd  ll_lco;
 
@@ -772,19 +794,59 @@ struct ll_sb_info {
 	struct kset		  ll_kset;	/* sysfs object */
 	struct completion	  ll_kobj_unregister;
 
+	/* hybrid IO, buffered IO at least this large is done as direct IO */
+	unsigned long		  ll_hybrid_io_read_threshold;
+	unsigned long		  ll_hybrid_io_write_threshold;
+
+	/* parallel IO, buffered IO at least this large is split into
+	 * stripe chunks which are done by ll_pio_wq workers */
+	unsigned long		  ll_pio_threshold;
+	struct workqueue_struct	 *ll_pio_wq;
+
+	/* unaligned direct IO, bounce pages in flight are limited to
+	 * ll_dio_bounce_max, async rounds are finished by ll_dio_wq
+	 */
+	unsigned long		  ll_dio_bounce_max;
+	atomic_t		  ll_dio_bounce_pages;
+	wait_queue_head_t	  ll_dio_bounce_waitq;
+	struct workqueue_struct	 *ll_dio_wq;
+
 	/* File heat */
 	unsigned int		  ll_heat_decay_weight;
 	unsigned int		  ll_heat_period_second;
+	/* read and write sample heat at which a file is hot, 0 to disable
+	 * the heat policy, see ll_file_is_hot() */
+	unsigned int		  ll_heat_hot_threshold;
 
 	/* filesystem fsname */
 	char			  ll_fsname[LUSTRE_MAXFSNAME + 1];
 
 	/* Persistent Client Cache */
 	struct pcc_super	  ll_pcc_super;
+
+	/* metadata write-back cache, revoked locks are released by
+	 * ll_wbc_flush_wq once the creates queued to ll_wbc_wq are sent
+	 */
+	struct workqueue_struct	 *ll_wbc_wq;
+	struct workqueue_struct	 *ll_wbc_flush_wq;
+	wait_queue_head_t	  ll_wbc_waitq;
+	atomic_t		  ll_wbc_inflight;
+	unsigned int		  ll_wbc_max_inflight;
 };
 
+#define SBI_DEFAULT_HYBRID_IO_THRESHOLD	(8 << 20)
+#define SBI_DEFAULT_PIO_THRESHOLD	(16 << 20)
+#define SBI_DEFAULT_DIO_BOUNCE_MAX	(256 << 20)
+
 #define SBI_DEFAULT_HEAT_DECAY_WEIGHT	((80 * 256 + 50) / 100)
 #define SBI_DEFAULT_HEAT_PERIOD_SECOND	(60)
+/* number of read offset deltas kept by the pattern detector */
+#define RAS_PATTERN_HISTORY	16
+/* longest repeating sequence of deltas which is detected */
+#define RAS_PATTERN_PERIOD_MAX	(RAS_PATTERN_HISTORY / 2)
+/* maximum number of predicted reads which are prefetched ahead */
+#define RAS_PATTERN_DEPTH	8
+
 /*
  * per file-descriptor read-ahead data.
  */
@@ -874,6 +936,32 @@ struct ll_readahead_state {
 	bool		ras_need_increase_window;
 	/* whether ra miss check should be skipped */
 	bool		ras_no_miss_check;
+	/*
+	 * The following items are used by the pattern detector, which
+	 * recognizes a repeating sequence of offset deltas between reads
+	 * of the same size, e.g. nested strides of multi-dimensional arrays
+	 * or interleaved per-rank accesses:
+	 *
+	 * |-a-|  |-b-|  |-c-|        |-d-|  |-e-|  |-f-|        |-g-|
+	 *  <-d1-> <-d1->  <-----d2----->  <-d1-> <-d1->  <-----d2----->
+	 *
+	 * ras_pat_deltas is a ring of the last deltas between read offsets,
+	 * and once the last ras_pat_period deltas repeat the ones before
+	 * them, the next reads are predicted and prefetched asynchronously.
+	 */
+	loff_t		ras_pat_deltas[RAS_PATTERN_HISTORY];
+	/* offset and size of the last read seen by the pattern detector */
+	loff_t		ras_pat_last_pos;
+	size_t		ras_pat_count;
+	/* number of valid entries in ras_pat_deltas, and next slot to use */
+	unsigned int	ras_pat_nr;
+	unsigned int	ras_pat_head;
+	/* length of the detected delta sequence, 0 if none */
+	unsigned int	ras_pat_period;
+	/* number of predicted reads which have been prefetched ahead */
+	unsigned int	ras_pat_issued;
+	/* offset where the next read is predicted */
+	loff_t		ras_pat_next_pos;
 };
 
 struct ll_readahead_work {
@@ -881,6 +969,8 @@ struct ll_readahead_work {
 	struct file			*lrw_file;
 	pgoff_t				 lrw_start_idx;
 	pgoff_t				 lrw_end_idx;
+	/* extent predicted by the pattern detector, read it exactly */
+	bool				 lrw_pattern;
 
 	/* async worker to handler read */
 	struct work_struct		 lrw_readahead_work;
@@ -965,6 +1055,16 @@ static inline bool ll_sbi_has_file_heat(struct ll_sb_info *sbi)
 	return !!(sbi->ll_flags & LL_SBI_FILE_HEAT);
 }
 
+static inline bool ll_sbi_has_hybrid_io(struct ll_sb_info *sbi)
+{
+	return !!(sbi->ll_flags & LL_SBI_HYBRID_IO);
+}
+
+static inline bool ll_sbi_has_pio(struct ll_sb_info *sbi)
+{
+	return !!(sbi->ll_flags & LL_SBI_PIO);
+}
+
 void ll_ras_enter(struct file *f, loff_t pos, size_t count);
 
 /* llite/lcommon_misc.c */
@@ -1013,6 +1113,17 @@ enum {
 	LPROC_LL_REMOVEXATTR,
 	LPROC_LL_INODE_PERM,
 	LPROC_LL_FALLOCATE,
+	LPROC_LL_DIO_BOUNCE,
+	LPROC_LL_HYBRID_READ,
+	LPROC_LL_HYBRID_WRITE,
+	LPROC_LL_PIO_READ,
+	LPROC_LL_PIO_WRITE,
+	LPROC_LL_WBC_CREATE,
+	LPROC_LL_WBC_FLUSH,
+	LPROC_LL_HEAT_HOT,
+	LPROC_LL_HEAT_READAHEAD,
+	LPROC_LL_HEAT_PCC_ADMIT,
+	LPROC_LL_HEAT_PCC_DEFER,
 	LPROC_LL_FILE_OPCODES
 };
 
@@ -1265,6 +1376,8 @@ struct vvp_io_args {
 			struct iov_iter   *via_iter;
                 } normal;
         } u;
+	/** range lock is held by the submitter of a parallel IO */
+	unsigned int		via_range_locked:1;
 };
 
 enum lcc_type {
@@ -1371,6 +1484,19 @@ static inline bool ll_dir_striped(struct inode *inode)
 	       lmv_dir_striped(ll_i2info(inode)->lli_lsm_md);
 }
 
+/*
+ * A file is hot while it is accessed at the rate set by heat_hot_threshold.
+ * Hot files get the full readahead window at once, are admitted to PCC by
+ * read-only attach rules and their pages are kept longer in the OSC LRU.
+ */
+static inline bool ll_file_is_hot(struct inode *inode)
+{
+	struct cl_object *obj = ll_i2info(inode)->lli_clob;
+
+	return obj != NULL && ll_i2sbi(inode)->ll_heat_hot_threshold > 0 &&
+	       cl_object_header(obj)->coh_hot_expire > ktime_get_real_seconds();
+}
+
 static inline loff_t ll_file_maxbytes(struct inode *inode)
 {
 	struct cl_object *obj = ll_i2info(inode)->lli_clob;
@@ -1475,6 +1601,42 @@ int ll_start_statahead(struct inode *dir, struct dentry *dentry, bool agl);
 void ll_authorize_statahead(struct inode *dir, void *key);
 void ll_deauthorize_statahead(struct inode *dir, void *key);
 
+/* wbc.c */
+#define LL_WBC_INFLIGHT_DEF	256
+/* all queued creates must be active in ll_wbc_wq, a create waits for the
+ * create of its parent queued before it */
+#define LL_WBC_INFLIGHT_MAX	WQ_MAX_ACTIVE
+
+static inline bool ll_wbc_pending(struct inode *inode)
+{
+	return test_bit(LLIF_WBC_PENDING, &ll_i2info(inode)->lli_flags);
+}
+
+bool ll_wbc_may_create(struct inode *dir);
+void ll_wbc_prep_create(struct inode *dir, struct md_op_data *op_data,
+			__u32 umask);
+int ll_wbc_mkdir_owned(struct inode *dir, struct md_op_data *op_data,
+		       struct lustre_handle *lockh);
+void ll_wbc_mkdir_done(struct inode *inode, struct lustre_handle *lockh,
+		       __u32 mdt);
+int ll_wbc_create(struct inode *dir, struct dentry *dchild, umode_t mode,
+		  int rdev, __u32 opc);
+int __ll_wbc_wait(struct inode *inode);
+void ll_wbc_flush(struct inode *dir);
+int ll_wbc_dir_rc(struct inode *dir);
+bool ll_wbc_lock_blocking(struct ldlm_lock *lock);
+void ll_wbc_lock_cancel(struct inode *dir, struct ldlm_lock *lock);
+void ll_wbc_inode_fini(struct inode *inode);
+
+/* wait for the write-back create of \a inode, if any, to reach the MDT */
+static inline int ll_wbc_wait(struct inode *inode)
+{
+	if (likely(!ll_wbc_pending(inode)))
+		return ll_i2info(inode)->lli_wbc_rc;
+
+	return __ll_wbc_wait(inode);
+}
+
 /* glimpse.c */
 blkcnt_t dirty_cnt(struct inode *inode);
 
@@ -1570,6 +1732,18 @@ static inline int ll_file_nolock(const struct file *file)
 		(ll_i2sbi(inode)->ll_flags & LL_SBI_NOLCK));
 }
 
+/* IO is done through ->direct_IO(), either because the file was opened with
+ * O_DIRECT, or because hybrid IO switched a large buffered IO to direct IO.
+ */
+static inline bool ll_iocb_direct(const struct kiocb *iocb)
+{
+#ifdef IOCB_DIRECT
+	return !!(iocb->ki_flags & IOCB_DIRECT);
+#else
+	return !!(iocb->ki_filp->f_flags & O_DIRECT);
+#endif
+}
+
 static inline void ll_set_lock_data(struct obd_export *exp, struct inode *inode,
                                     struct lookup_intent *it, __u64 *bits)
 {
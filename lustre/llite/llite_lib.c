@@ -124,10 +124,38 @@ static struct ll_sb_info *ll_init_sbi(void)
 	if (IS_ERR(sbi->ll_ra_info.ll_readahead_wq))
 		GOTO(out_pcc, rc = PTR_ERR(sbi->ll_ra_info.ll_readahead_wq));
 
+	sbi->ll_wbc_wq = alloc_workqueue("ll-wbc-wq", WQ_UNBOUND,
+					 LL_WBC_INFLIGHT_MAX);
+	if (sbi->ll_wbc_wq == NULL)
+		GOTO(out_destroy_ra, rc = -ENOMEM);
+	init_waitqueue_head(&sbi->ll_wbc_waitq);
+	atomic_set(&sbi->ll_wbc_inflight, 0);
+	sbi->ll_wbc_max_inflight = LL_WBC_INFLIGHT_DEF;
+
+	sbi->ll_wbc_flush_wq = alloc_workqueue("ll-wbc-flush-wq", WQ_UNBOUND,
+					       0);
+	if (sbi->ll_wbc_flush_wq == NULL)
+		GOTO(out_destroy_wbc, rc = -ENOMEM);
+
+	sbi->ll_pio_wq = cfs_cpt_bind_workqueue("ll-pio-wq", cfs_cpt_tab,
+						0, CFS_CPT_ANY,
+						cfs_cpt_weight(cfs_cpt_tab,
+							       CFS_CPT_ANY));
+	if (IS_ERR(sbi->ll_pio_wq))
+		GOTO(out_destroy_wbc_flush, rc = PTR_ERR(sbi->ll_pio_wq));
+
+	sbi->ll_dio_wq = alloc_workqueue("ll-dio-wq", WQ_UNBOUND, 0);
+	if (sbi->ll_dio_wq == NULL)
+		GOTO(out_destroy_pio, rc = -ENOMEM);
+	sbi->ll_dio_bounce_max = min_t(unsigned long, pages / 16,
+				       SBI_DEFAULT_DIO_BOUNCE_MAX >> PAGE_SHIFT);
+	atomic_set(&sbi->ll_dio_bounce_pages, 0);
+	init_waitqueue_head(&sbi->ll_dio_bounce_waitq);
+
 	/* initialize ll_cache data */
 	sbi->ll_cache = cl_cache_init(lru_page_max);
 	if (sbi->ll_cache == NULL)
-		GOTO(out_destroy_ra, rc = -ENOMEM);
+		GOTO(out_destroy_dio, rc = -ENOMEM);
 
 	sbi->ll_ra_info.ra_max_pages =
 		min(pages / 32, SBI_DEFAULT_READ_AHEAD_MAX);
@@ -170,6 +198,9 @@ static struct ll_sb_info *ll_init_sbi(void)
 	sbi->ll_flags |= LL_SBI_AGL_ENABLED;
 	sbi->ll_flags |= LL_SBI_FAST_READ;
 	sbi->ll_flags |= LL_SBI_TINY_WRITE;
+	sbi->ll_hybrid_io_read_threshold = SBI_DEFAULT_HYBRID_IO_THRESHOLD;
+	sbi->ll_hybrid_io_write_threshold = SBI_DEFAULT_HYBRID_IO_THRESHOLD;
+	sbi->ll_pio_threshold = SBI_DEFAULT_PIO_THRESHOLD;
 	ll_sbi_set_encrypt(sbi, true);
 
 	/* root squash */
@@ -182,6 +213,14 @@ static struct ll_sb_info *ll_init_sbi(void)
 	sbi->ll_heat_decay_weight = SBI_DEFAULT_HEAT_DECAY_WEIGHT;
 	sbi->ll_heat_period_second = SBI_DEFAULT_HEAT_PERIOD_SECOND;
 	RETURN(sbi);
+out_destroy_dio:
+	destroy_workqueue(sbi->ll_dio_wq);
+out_destroy_pio:
+	destroy_workqueue(sbi->ll_pio_wq);
+out_destroy_wbc_flush:
+	destroy_workqueue(sbi->ll_wbc_flush_wq);
+out_destroy_wbc:
+	destroy_workqueue(sbi->ll_wbc_wq);
 out_destroy_ra:
 	destroy_workqueue(sbi->ll_ra_info.ll_readahead_wq);
 out_pcc:
@@ -201,6 +240,14 @@ static void ll_free_sbi(struct super_block *sb)
 			cfs_free_nidlist(&sbi->ll_squash.rsi_nosquash_nids);
 		if (sbi->ll_ra_info.ll_readahead_wq)
 			destroy_workqueue(sbi->ll_ra_info.ll_readahead_wq);
+		if (sbi->ll_wbc_wq)
+			destroy_workqueue(sbi->ll_wbc_wq);
+		if (sbi->ll_wbc_flush_wq)
+			destroy_workqueue(sbi->ll_wbc_flush_wq);
+		if (sbi->ll_pio_wq)
+			destroy_workqueue(sbi->ll_pio_wq);
+		if (sbi->ll_dio_wq)
+			destroy_workqueue(sbi->ll_dio_wq);
 		if (sbi->ll_cache != NULL) {
 			cl_cache_decref(sbi->ll_cache);
 			sbi->ll_cache = NULL;
@@ -281,7 +328,10 @@ static int client_common_fill_super(struct super_block *sb, char *md, char *dt)
 				   OBD_CONNECT2_PCC |
 				   OBD_CONNECT2_CRUSH | OBD_CONNECT2_LSEEK |
 				   OBD_CONNECT2_GETATTR_PFID |
-				   OBD_CONNECT2_DOM_LVB;
+				   OBD_CONNECT2_DOM_LVB |
+				   OBD_CONNECT2_PCCRO |
+				   OBD_CONNECT2_WBC |
+				   OBD_CONNECT2_BATCH_BL_AST;
 
 #ifdef HAVE_LRU_RESIZE_SUPPORT
         if (sbi->ll_flags & LL_SBI_LRU_RESIZE)
@@ -479,7 +529,9 @@ static int client_common_fill_super(struct super_block *sb, char *md, char *dt)
 				  OBD_CONNECT_BULK_MBITS | OBD_CONNECT_SHORTIO |
 				  OBD_CONNECT_FLAGS2 | OBD_CONNECT_GRANT_SHRINK;
 	data->ocd_connect_flags2 = OBD_CONNECT2_LOCKAHEAD |
-				   OBD_CONNECT2_INC_XID | OBD_CONNECT2_LSEEK;
+				   OBD_CONNECT2_INC_XID | OBD_CONNECT2_LSEEK |
+				   OBD_CONNECT2_BRW_MULTI |
+				   OBD_CONNECT2_BATCH_BL_AST;
 
 	if (!OBD_FAIL_CHECK(OBD_FAIL_OSC_CONNECT_GRANT_PARAM))
 		data->ocd_connect_flags |= OBD_CONNECT_GRANT_PARAM;
@@ -836,6 +888,12 @@ void ll_kill_super(struct super_block *sb)
 		while (atomic_read(&sbi->ll_sa_running) > 0)
 			schedule_timeout_uninterruptible(
 				cfs_time_seconds(1) >> 3);
+
+		/* send the queued write-back creates and release the locks
+		 * revoked meanwhile
+		 */
+		flush_workqueue(sbi->ll_wbc_wq);
+		flush_workqueue(sbi->ll_wbc_flush_wq);
 	}
 
 	EXIT;
@@ -1024,6 +1082,7 @@ void ll_lli_init(struct ll_inode_info *lli)
 
 	init_rwsem(&lli->lli_xattrs_list_rwsem);
 	mutex_init(&lli->lli_xattrs_enq_lock);
+	lli->lli_wbc_rc = 0;
 
 	LASSERT(lli->lli_vfs_inode.i_mode != 0);
 	if (S_ISDIR(lli->lli_vfs_inode.i_mode)) {
@@ -1033,6 +1092,10 @@ void ll_lli_init(struct ll_inode_info *lli)
 		lli->lli_opendir_pid = 0;
 		lli->lli_sa_enabled = 0;
 		init_rwsem(&lli->lli_lsm_sem);
+		memset(&lli->lli_wbc_lockh, 0, sizeof(lli->lli_wbc_lockh));
+		atomic_set(&lli->lli_wbc_pending, 0);
+		lli->lli_wbc_dir_rc = 0;
+		lli->lli_wbc_mdt = 0;
 	} else {
 		mutex_init(&lli->lli_size_mutex);
 		mutex_init(&lli->lli_setattr_mutex);
@@ -1640,6 +1703,7 @@ void ll_clear_inode(struct inode *inode)
 	}
 
 	md_null_inode(sbi->ll_md_exp, ll_inode2fid(inode));
+	ll_wbc_inode_fini(inode);
 
         LASSERT(!lli->lli_open_fd_write_count);
         LASSERT(!lli->lli_open_fd_read_count);
@@ -1952,6 +2016,11 @@ int ll_setattr_raw(struct dentry *dentry, struct iattr *attr,
 			RETURN(-EPERM);
 	}
 
+	/* setattr is done on the MDT object */
+	rc = ll_wbc_wait(inode);
+	if (rc)
+		RETURN(rc);
+
 	/* We mark all of the fields "set" so MDS/OST does not re-set them */
 	if (!(xvalid & OP_XVALID_CTIME_SET) &&
 	     (attr->ia_valid & ATTR_CTIME)) {
@@ -1239,6 +1239,297 @@ static ssize_t fast_read_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(fast_read);
 
+static ssize_t hybrid_io_show(struct kobject *kobj,
+			      struct attribute *attr,
+			      char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return sprintf(buf, "%u\n", !!(sbi->ll_flags & LL_SBI_HYBRID_IO));
+}
+
+static ssize_t hybrid_io_store(struct kobject *kobj,
+			       struct attribute *attr,
+			       const char *buffer,
+			       size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	bool val;
+	int rc;
+
+	rc = kstrtobool(buffer, &val);
+	if (rc)
+		return rc;
+
+#ifndef IOCB_DIRECT
+	if (val)
+		return -EOPNOTSUPP;
+#endif
+
+	spin_lock(&sbi->ll_lock);
+	if (val)
+		sbi->ll_flags |= LL_SBI_HYBRID_IO;
+	else
+		sbi->ll_flags &= ~LL_SBI_HYBRID_IO;
+	spin_unlock(&sbi->ll_lock);
+
+	return count;
+}
+LUSTRE_RW_ATTR(hybrid_io);
+
+static ssize_t hybrid_io_threshold_show(unsigned long threshold, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%lu\n", threshold >> 20);
+}
+
+static ssize_t hybrid_io_threshold_store(struct ll_sb_info *sbi,
+					 unsigned long *threshold,
+					 const char *buffer, size_t count)
+{
+	u64 val;
+	int rc;
+
+	rc = sysfs_memparse(buffer, count, &val, "MiB");
+	if (rc < 0)
+		return rc;
+
+	/* direct IO is done in whole pages */
+	if (val < PAGE_SIZE || val > MAX_LFS_FILESIZE)
+		return -ERANGE;
+
+	spin_lock(&sbi->ll_lock);
+	*threshold = round_up(val, PAGE_SIZE);
+	spin_unlock(&sbi->ll_lock);
+
+	return count;
+}
+
+static ssize_t hybrid_io_read_threshold_mb_show(struct kobject *kobj,
+						struct attribute *attr,
+						char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return hybrid_io_threshold_show(sbi->ll_hybrid_io_read_threshold, buf);
+}
+
+static ssize_t hybrid_io_read_threshold_mb_store(struct kobject *kobj,
+						 struct attribute *attr,
+						 const char *buffer,
+						 size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return hybrid_io_threshold_store(sbi,
+					 &sbi->ll_hybrid_io_read_threshold,
+					 buffer, count);
+}
+LUSTRE_RW_ATTR(hybrid_io_read_threshold_mb);
+
+static ssize_t hybrid_io_write_threshold_mb_show(struct kobject *kobj,
+						 struct attribute *attr,
+						 char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return hybrid_io_threshold_show(sbi->ll_hybrid_io_write_threshold, buf);
+}
+
+static ssize_t hybrid_io_write_threshold_mb_store(struct kobject *kobj,
+						  struct attribute *attr,
+						  const char *buffer,
+						  size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return hybrid_io_threshold_store(sbi,
+					 &sbi->ll_hybrid_io_write_threshold,
+					 buffer, count);
+}
+LUSTRE_RW_ATTR(hybrid_io_write_threshold_mb);
+
+static ssize_t pio_show(struct kobject *kobj, struct attribute *attr,
+			char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return sprintf(buf, "%u\n", !!(sbi->ll_flags & LL_SBI_PIO));
+}
+
+static ssize_t pio_store(struct kobject *kobj, struct attribute *attr,
+			 const char *buffer, size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	bool val;
+	int rc;
+
+	rc = kstrtobool(buffer, &val);
+	if (rc)
+		return rc;
+
+	/* workers need to borrow the address space of the IO submitter */
+#ifndef HAVE_KTHREAD_USE_MM
+	if (val)
+		return -EOPNOTSUPP;
+#endif
+
+	spin_lock(&sbi->ll_lock);
+	if (val)
+		sbi->ll_flags |= LL_SBI_PIO;
+	else
+		sbi->ll_flags &= ~LL_SBI_PIO;
+	spin_unlock(&sbi->ll_lock);
+
+	return count;
+}
+LUSTRE_RW_ATTR(pio);
+
+static ssize_t pio_threshold_mb_show(struct kobject *kobj,
+				     struct attribute *attr, char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return snprintf(buf, PAGE_SIZE, "%lu\n", sbi->ll_pio_threshold >> 20);
+}
+
+static ssize_t pio_threshold_mb_store(struct kobject *kobj,
+				      struct attribute *attr,
+				      const char *buffer, size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	u64 val;
+	int rc;
+
+	rc = sysfs_memparse(buffer, count, &val, "MiB");
+	if (rc < 0)
+		return rc;
+
+	if (val < PAGE_SIZE || val > MAX_LFS_FILESIZE)
+		return -ERANGE;
+
+	spin_lock(&sbi->ll_lock);
+	sbi->ll_pio_threshold = round_up(val, PAGE_SIZE);
+	spin_unlock(&sbi->ll_lock);
+
+	return count;
+}
+LUSTRE_RW_ATTR(pio_threshold_mb);
+
+static ssize_t wbc_enable_show(struct kobject *kobj,
+			       struct attribute *attr,
+			       char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return sprintf(buf, "%u\n", sbi->ll_wbc_enabled);
+}
+
+static ssize_t wbc_enable_store(struct kobject *kobj,
+				struct attribute *attr,
+				const char *buffer,
+				size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	bool val;
+	int rc;
+
+	rc = kstrtobool(buffer, &val);
+	if (rc)
+		return rc;
+
+	if (val && !exp_connect_wbc(sbi->ll_md_exp))
+		return -EOPNOTSUPP;
+
+	spin_lock(&sbi->ll_lock);
+	sbi->ll_wbc_enabled = val;
+	spin_unlock(&sbi->ll_lock);
+
+	return count;
+}
+LUSTRE_RW_ATTR(wbc_enable);
+
+static ssize_t wbc_max_inflight_show(struct kobject *kobj,
+				     struct attribute *attr,
+				     char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return sprintf(buf, "%u\n", sbi->ll_wbc_max_inflight);
+}
+
+static ssize_t wbc_max_inflight_store(struct kobject *kobj,
+				      struct attribute *attr,
+				      const char *buffer,
+				      size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 10, &val);
+	if (rc)
+		return rc;
+
+	if (val == 0 || val > LL_WBC_INFLIGHT_MAX)
+		return -ERANGE;
+
+	sbi->ll_wbc_max_inflight = val;
+	wake_up_all(&sbi->ll_wbc_waitq);
+
+	return count;
+}
+LUSTRE_RW_ATTR(wbc_max_inflight);
+
+static ssize_t dio_bounce_max_mb_show(struct kobject *kobj,
+				      struct attribute *attr,
+				      char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return scnprintf(buf, PAGE_SIZE, "%lu\n",
+			 PAGES_TO_MiB(sbi->ll_dio_bounce_max));
+}
+
+static ssize_t dio_bounce_max_mb_store(struct kobject *kobj,
+				       struct attribute *attr,
+				       const char *buffer,
+				       size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	u64 val, pages_number;
+	int rc;
+
+	rc = sysfs_memparse(buffer, count, &val, "MiB");
+	if (rc)
+		return rc;
+
+	pages_number = round_up(val, 1024 * 1024) >> PAGE_SHIFT;
+	if (pages_number == 0 || pages_number > cfs_totalram_pages() / 2)
+		return -ERANGE;
+
+	sbi->ll_dio_bounce_max = pages_number;
+	wake_up_all(&sbi->ll_dio_bounce_waitq);
+
+	return count;
+}
+LUSTRE_RW_ATTR(dio_bounce_max_mb);
+
 static ssize_t file_heat_show(struct kobject *kobj,
 			      struct attribute *attr,
 			      char *buf)
@@ -1342,6 +1633,36 @@ static ssize_t heat_period_second_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(heat_period_second);
 
+static ssize_t heat_hot_threshold_show(struct kobject *kobj,
+				       struct attribute *attr,
+				       char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return snprintf(buf, PAGE_SIZE, "%u\n", sbi->ll_heat_hot_threshold);
+}
+
+static ssize_t heat_hot_threshold_store(struct kobject *kobj,
+					struct attribute *attr,
+					const char *buffer,
+					size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 10, &val);
+	if (rc)
+		return rc;
+
+	sbi->ll_heat_hot_threshold = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(heat_hot_threshold);
+
 static int ll_unstable_stats_seq_show(struct seq_file *m, void *v)
 {
 	struct super_block	*sb    = m->private;
@@ -1551,10 +1872,19 @@ static struct attribute *llite_attrs[] = {
 	&lustre_attr_default_easize.attr,
 	&lustre_attr_xattr_cache.attr,
 	&lustre_attr_fast_read.attr,
+	&lustre_attr_hybrid_io.attr,
+	&lustre_attr_hybrid_io_read_threshold_mb.attr,
+	&lustre_attr_hybrid_io_write_threshold_mb.attr,
+	&lustre_attr_pio.attr,
+	&lustre_attr_pio_threshold_mb.attr,
+	&lustre_attr_wbc_enable.attr,
+	&lustre_attr_wbc_max_inflight.attr,
+	&lustre_attr_dio_bounce_max_mb.attr,
 	&lustre_attr_tiny_write.attr,
 	&lustre_attr_file_heat.attr,
 	&lustre_attr_heat_decay_percentage.attr,
 	&lustre_attr_heat_period_second.attr,
+	&lustre_attr_heat_hot_threshold.attr,
 	NULL,
 };
 
@@ -1596,6 +1926,11 @@ static const struct llite_file_opcode {
 	{ LPROC_LL_FLOCK,	LPROCFS_TYPE_LATENCY,	"flock" },
 	{ LPROC_LL_GETATTR,	LPROCFS_TYPE_LATENCY,	"getattr" },
 	{ LPROC_LL_FALLOCATE,	LPROCFS_TYPE_LATENCY, "fallocate"},
+	{ LPROC_LL_DIO_BOUNCE,	LPROCFS_TYPE_BYTES_FULL, "dio_bounce_bytes" },
+	{ LPROC_LL_HYBRID_READ,	LPROCFS_TYPE_BYTES_FULL, "hybrid_read_bytes" },
+	{ LPROC_LL_HYBRID_WRITE, LPROCFS_TYPE_BYTES_FULL, "hybrid_write_bytes" },
+	{ LPROC_LL_PIO_READ,	LPROCFS_TYPE_BYTES_FULL, "pio_read_bytes" },
+	{ LPROC_LL_PIO_WRITE,	LPROCFS_TYPE_BYTES_FULL, "pio_write_bytes" },
 	/* dir inode operation */
 	{ LPROC_LL_CREATE,	LPROCFS_TYPE_LATENCY,	"create" },
 	{ LPROC_LL_LINK,	LPROCFS_TYPE_LATENCY,	"link" },
@@ -1605,6 +1940,12 @@ static const struct llite_file_opcode {
 	{ LPROC_LL_RMDIR,	LPROCFS_TYPE_LATENCY,	"rmdir" },
 	{ LPROC_LL_MKNOD,	LPROCFS_TYPE_LATENCY,	"mknod" },
 	{ LPROC_LL_RENAME,	LPROCFS_TYPE_LATENCY,	"rename" },
+	{ LPROC_LL_WBC_CREATE,	LPROCFS_TYPE_REQS,	"wbc_create" },
+	{ LPROC_LL_WBC_FLUSH,	LPROCFS_TYPE_REQS,	"wbc_flush" },
+	{ LPROC_LL_HEAT_HOT,	LPROCFS_TYPE_REQS,	"heat_hot" },
+	{ LPROC_LL_HEAT_READAHEAD, LPROCFS_TYPE_REQS,	"heat_readahead" },
+	{ LPROC_LL_HEAT_PCC_ADMIT, LPROCFS_TYPE_REQS,	"heat_pcc_admit" },
+	{ LPROC_LL_HEAT_PCC_DEFER, LPROCFS_TYPE_REQS,	"heat_pcc_defer" },
 	/* special inode operation */
 	{ LPROC_LL_STATFS,	LPROCFS_TYPE_LATENCY,	"statfs" },
 	{ LPROC_LL_SETXATTR,	LPROCFS_TYPE_LATENCY,	"setxattr" },
@@ -1652,6 +1993,10 @@ static const char *ra_stat_string[] = {
 	[RA_STAT_ASYNC] = "async readahead",
 	[RA_STAT_FAILED_FAST_READ] = "failed to fast read",
 	[RA_STAT_MMAP_RANGE_READ] = "mmap range read",
+	[RA_STAT_PATTERN_STRIDE_HIT] = "pattern stride hit",
+	[RA_STAT_PATTERN_STRIDE_MISS] = "pattern stride miss",
+	[RA_STAT_PATTERN_NESTED_HIT] = "pattern nested hit",
+	[RA_STAT_PATTERN_NESTED_MISS] = "pattern nested miss",
 };
 
 int ll_debugfs_register_super(struct super_block *sb, const char *name)
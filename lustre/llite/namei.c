@@ -254,6 +254,11 @@ static void ll_lock_cancel_bits(struct ldlm_lock *lock, __u64 to_cancel)
 		LBUG();
 	}
 
+	/* creates done under the lock are sent before it is released */
+	if ((bits & MDS_INODELOCK_UPDATE) && S_ISDIR(inode->i_mode) &&
+	    lock->l_req_mode == LCK_EX)
+		ll_wbc_lock_cancel(inode, lock);
+
 	if (bits & MDS_INODELOCK_XATTR) {
 		ll_xattr_cache_destroy(inode);
 		bits &= ~MDS_INODELOCK_XATTR;
@@ -453,6 +458,12 @@ int ll_md_blocking_ast(struct ldlm_lock *lock, struct ldlm_lock_desc *ld,
 	{
 		__u64 cancel_flags = LCF_ASYNC;
 
+		/* the lock owns a directory with queued creates, it is
+		 * cancelled by ll_wbc_flush_wq once they are sent
+		 */
+		if (lock->l_req_mode == LCK_EX && ll_wbc_lock_blocking(lock))
+			RETURN(0);
+
 		/* if lock convert is not needed then still have to
 		 * pass lock via ldlm_cli_convert() to keep all states
 		 * correct, set cancel_bits to full lock bits to cause
@@ -815,6 +826,11 @@ static struct dentry *ll_lookup_it(struct inode *parent, struct dentry *dentry,
 	if (d_mountpoint(dentry))
 		CERROR("Tell Peter, lookup on mtpt, it %s\n", LL_IT2STR(it));
 
+	/* the parent may be created by the write-back cache */
+	rc = ll_wbc_wait(parent);
+	if (rc)
+		RETURN(ERR_PTR(rc));
+
 	if (it == NULL || it->it_op == IT_GETXATTR)
 		it = &lookup_it;
 
@@ -842,6 +858,12 @@ static struct dentry *ll_lookup_it(struct inode *parent, struct dentry *dentry,
 	if (!IS_POSIXACL(parent) || !exp_connect_umask(ll_i2mdexp(parent)))
 		it->it_create_mode &= ~current_umask();
 
+	if (!(it->it_op & IT_CREAT))
+		/* the name may be created locally but not yet on the MDT */
+		ll_wbc_flush(parent);
+	else if (test_bit(LLIF_WBC_OWNED, &ll_i2info(parent)->lli_flags))
+		ll_wbc_prep_create(parent, op_data, current_umask());
+
 	if (it->it_op & IT_CREAT &&
 	    ll_i2sbi(parent)->ll_flags & LL_SBI_FILE_SECCTX) {
 		rc = ll_dentry_init_security(dentry, it->it_create_mode,
@@ -1113,6 +1135,7 @@ static int ll_atomic_open(struct inode *dir, struct dentry *dentry,
 			item.pm_projid = ll_i2info(dir)->lli_projid;
 			item.pm_name = &dentry->d_name;
 			dataset = pcc_dataset_match_get(&sbi->ll_pcc_super,
+							LU_PCC_READWRITE,
 							&item);
 			pca.pca_dataset = dataset;
 		}
@@ -1356,6 +1379,7 @@ static int ll_new_node(struct inode *dir, struct dentry *dchild,
 	struct md_op_data *op_data = NULL;
 	struct inode *inode = NULL;
 	struct ll_sb_info *sbi = ll_i2sbi(dir);
+	struct lustre_handle lockh = { 0 };
 	int tgt_len = 0;
 	bool encrypt = false;
 	int err;
@@ -1364,6 +1388,14 @@ static int ll_new_node(struct inode *dir, struct dentry *dchild,
 	if (unlikely(tgt != NULL))
 		tgt_len = strlen(tgt) + 1;
 
+	if ((opc == LUSTRE_OPC_MKDIR || opc == LUSTRE_OPC_MKNOD) &&
+	    ll_wbc_may_create(dir))
+		RETURN(ll_wbc_create(dir, dchild, mode, rdev, opc));
+
+	err = ll_wbc_wait(dir);
+	if (err)
+		RETURN(err);
+
 again:
 	op_data = ll_prep_md_op_data(NULL, dir, NULL, name->name,
 				     name->len, 0, opc, NULL);
@@ -1397,6 +1429,15 @@ again:
 			GOTO(err_exit, err);
 	}
 
+	if (test_bit(LLIF_WBC_OWNED, &ll_i2info(dir)->lli_flags)) {
+		ll_wbc_prep_create(dir, op_data, current_umask());
+	} else if (opc == LUSTRE_OPC_MKDIR && !encrypt &&
+		   !(sbi->ll_flags & LL_SBI_FILE_SECCTX)) {
+		err = ll_wbc_mkdir_owned(dir, op_data, &lockh);
+		if (err)
+			GOTO(err_exit, err);
+	}
+
 	err = md_create(sbi->ll_md_exp, op_data, tgt, tgt_len, mode,
 			from_kuid(&init_user_ns, current_fsuid()),
 			from_kgid(&init_user_ns, current_fsgid()),
@@ -1414,6 +1455,8 @@ again:
 
 		ptlrpc_req_finished(request);
 		request = NULL;
+		if (lustre_handle_is_used(&lockh))
+			ll_wbc_mkdir_done(NULL, &lockh, 0);
 
 		err2 = ll_dir_getstripe(dir, (void **)&lum, &lumsize, &request,
 					OBD_MD_DEFAULT_MEA);
@@ -1474,6 +1517,10 @@ again:
 	if (err)
 		GOTO(err_exit, err);
 
+	if (lustre_handle_is_used(&lockh))
+		ll_wbc_mkdir_done(inode, &lockh,
+				  ll_get_mdt_idx_by_fid(sbi, ll_inode2fid(inode)));
+
 	if (sbi->ll_flags & LL_SBI_FILE_SECCTX) {
 		/* must be done before d_instantiate, because it calls
 		 * security_d_instantiate, which means a getxattr if security
@@ -1506,6 +1553,9 @@ again:
 
 	EXIT;
 err_exit:
+	if (lustre_handle_is_used(&lockh))
+		ll_wbc_mkdir_done(NULL, &lockh, 0);
+
 	if (request != NULL)
 		ptlrpc_req_finished(request);
 
@@ -1624,6 +1674,10 @@ static int ll_link(struct dentry *old_dentry, struct inode *dir,
 	if (err)
 		RETURN(err);
 
+	err = ll_wbc_wait(src) ?: ll_wbc_wait(dir);
+	if (err)
+		RETURN(err);
+
 	op_data = ll_prep_md_op_data(NULL, src, dir, name->name, name->len,
 				     0, LUSTRE_OPC_ANY, NULL);
 	if (IS_ERR(op_data))
@@ -1681,6 +1735,14 @@ static int ll_rmdir(struct inode *dir, struct dentry *dchild)
 	if (unlikely(d_mountpoint(dchild)))
                 RETURN(-EBUSY);
 
+	if (dchild->d_inode != NULL) {
+		/* the entries queued in it are to be removed first */
+		ll_wbc_flush(dchild->d_inode);
+		rc = ll_wbc_wait(dchild->d_inode);
+		if (rc)
+			RETURN(rc);
+	}
+
 	op_data = ll_prep_md_op_data(NULL, dir, NULL, name->name, name->len,
 				     S_IFDIR, LUSTRE_OPC_ANY, NULL);
 	if (IS_ERR(op_data))
@@ -1766,6 +1828,10 @@ static int ll_unlink(struct inode *dir, struct dentry *dchild)
 	if (unlikely(d_mountpoint(dchild)))
 		RETURN(-EBUSY);
 
+	rc = ll_wbc_wait(dchild->d_inode);
+	if (rc)
+		RETURN(rc);
+
 	op_data = ll_prep_md_op_data(NULL, dir, NULL, name->name, name->len, 0,
 				     LUSTRE_OPC_ANY, NULL);
 	if (IS_ERR(op_data))
@@ -1839,6 +1905,14 @@ static int ll_rename(struct inode *src, struct dentry *src_dchild,
 	if (err)
 		RETURN(err);
 
+	err = ll_wbc_wait(src) ?: ll_wbc_wait(tgt);
+	if (!err && src_dchild->d_inode)
+		err = ll_wbc_wait(src_dchild->d_inode);
+	if (!err && tgt_dchild->d_inode)
+		err = ll_wbc_wait(tgt_dchild->d_inode);
+	if (err)
+		RETURN(err);
+
 	if (src_dchild->d_inode)
 		mode = src_dchild->d_inode->i_mode;
 
@@ -120,6 +120,13 @@ int pcc_super_init(struct pcc_super *super)
 	if (!cred)
 		return -ENOMEM;
 
+	super->pccs_attach_wq = alloc_workqueue("pcc-attach-wq", WQ_UNBOUND,
+						0);
+	if (!super->pccs_attach_wq) {
+		put_cred(cred);
+		return -ENOMEM;
+	}
+
 	/* Never override disk quota limits or use reserved space */
 	cap_lower(cred->cap_effective, CAP_SYS_RESOURCE);
 	init_rwsem(&super->pccs_rw_sem);
@@ -695,14 +702,27 @@ pcc_cond_match(struct pcc_match_rule *rule, struct pcc_matcher *matcher)
 }
 
 struct pcc_dataset*
-pcc_dataset_match_get(struct pcc_super *super, struct pcc_matcher *matcher)
+pcc_dataset_match_get(struct pcc_super *super, enum lu_pcc_type type,
+		      struct pcc_matcher *matcher)
 {
 	struct pcc_dataset *dataset;
 	struct pcc_dataset *selected = NULL;
 
 	down_read(&super->pccs_rw_sem);
 	list_for_each_entry(dataset, &super->pccs_datasets, pccd_linkage) {
-		if (!(dataset->pccd_flags & PCC_DATASET_RWPCC))
+		if (type == LU_PCC_READWRITE &&
+		    !(dataset->pccd_flags & PCC_DATASET_RWPCC))
+			continue;
+
+		/*
+		 * Copying files in at open is only done for backends added
+		 * with "ropcc=1" and open attach enabled, so the rules of an
+		 * existing shared backend do not start caching every read.
+		 */
+		if (type == LU_PCC_READONLY &&
+		    ((dataset->pccd_flags & PCC_DATASET_PCC_ALL) !=
+		     PCC_DATASET_ROPCC ||
+		     !(dataset->pccd_flags & PCC_DATASET_OPEN_ATTACH)))
 			continue;
 
 		if (pcc_cond_match(&dataset->pccd_rule, matcher)) {
@@ -713,7 +733,8 @@ pcc_dataset_match_get(struct pcc_super *super, struct pcc_matcher *matcher)
 	}
 	up_read(&super->pccs_rw_sem);
 	if (selected)
-		CDEBUG(D_CACHE, "PCC create, matched %s - %d:%d:%d:%s\n",
+		CDEBUG(D_CACHE, "PCC %s, matched %s - %d:%d:%d:%s\n",
+		       type == LU_PCC_READONLY ? "open" : "create",
 		       dataset->pccd_rule.pmr_conds_str,
 		       matcher->pm_uid, matcher->pm_gid,
 		       matcher->pm_projid, matcher->pm_name->name);
@@ -799,6 +820,14 @@ pcc_dataset_get(struct pcc_super *super, enum lu_pcc_type type, __u32 id)
 		if (type == LU_PCC_READWRITE && (dataset->pccd_rwid != id ||
 		    !(dataset->pccd_flags & PCC_DATASET_RWPCC)))
 			continue;
+		/*
+		 * A backend shared by both modes may be addressed by either
+		 * of its IDs for RO-PCC.
+		 */
+		if (type == LU_PCC_READONLY && ((dataset->pccd_roid != id &&
+		    dataset->pccd_rwid != id) ||
+		    !(dataset->pccd_flags & PCC_DATASET_ROPCC)))
+			continue;
 		atomic_inc(&dataset->pccd_refcount);
 		selected = dataset;
 		break;
@@ -880,6 +909,8 @@ static void pcc_remove_datasets(struct pcc_super *super)
 
 void pcc_super_fini(struct pcc_super *super)
 {
+	/* the pending attaches hold dataset references */
+	destroy_workqueue(super->pccs_attach_wq);
 	pcc_remove_datasets(super);
 	put_cred(super->pccs_cred);
 }
@@ -1094,6 +1125,7 @@ static inline bool pcc_auto_attach_enabled(enum pcc_dataset_flags flags,
 }
 
 static const char pcc_xattr_layout[] = XATTR_USER_PREFIX "PCC.layout";
+static const char pcc_xattr_dv[] = XATTR_USER_PREFIX "PCC.dv";
 
 static int pcc_layout_xattr_set(struct pcc_inode *pcci, __u32 gen)
 {
@@ -1198,6 +1230,19 @@ static inline bool pcc_inode_has_layout(struct pcc_inode *pcci)
 	return pcci->pcci_layout_gen != CL_LAYOUT_GEN_NONE;
 }
 
+static void __pcc_layout_invalidate(struct pcc_inode *pcci)
+{
+	pcci->pcci_type = LU_PCC_NONE;
+	pcc_layout_gen_set(pcci, CL_LAYOUT_GEN_NONE);
+	if (atomic_read(&pcci->pcci_active_ios) == 0)
+		return;
+
+	CDEBUG(D_CACHE, "Waiting for IO completion: %d\n",
+		       atomic_read(&pcci->pcci_active_ios));
+	wait_event_idle(pcci->pcci_waitq,
+			atomic_read(&pcci->pcci_active_ios) == 0);
+}
+
 static int pcc_try_dataset_attach(struct inode *inode, __u32 gen,
 				  enum lu_pcc_type type,
 				  struct pcc_dataset *dataset,
@@ -1218,6 +1263,10 @@ static int pcc_try_dataset_attach(struct inode *inode, __u32 gen,
 	    !(dataset->pccd_flags & PCC_DATASET_RWPCC))
 		RETURN(0);
 
+	if (type == LU_PCC_READONLY &&
+	    !(dataset->pccd_flags & PCC_DATASET_ROPCC))
+		RETURN(0);
+
 	OBD_ALLOC(pathname, PATH_MAX);
 	if (pathname == NULL)
 		RETURN(-ENOMEM);
@@ -1435,14 +1484,39 @@ static inline bool pcc_may_auto_attach(struct inode *inode,
 	return lli->lli_pcc_dsflags & PCC_DATASET_IO_ATTACH;
 }
 
-int pcc_file_open(struct inode *inode, struct file *file)
+/* Must be called with pcc_inode_lock held */
+static int __pcc_file_open(struct inode *inode, struct file *file,
+			   struct pcc_inode *pcci)
 {
-	struct pcc_inode *pcci;
-	struct ll_inode_info *lli = ll_i2info(inode);
 	struct ll_file_data *fd = file->private_data;
 	struct pcc_file *pccf = &fd->fd_pcc_file;
 	struct file *pcc_file;
 	struct path *path;
+	int rc = 0;
+
+	pcc_inode_get(pcci);
+	WARN_ON(pccf->pccf_file);
+
+	path = &pcci->pcci_path;
+	CDEBUG(D_CACHE, "opening pcc file '%pd'\n", path->dentry);
+
+	pcc_file = dentry_open(path, file->f_flags,
+			       pcc_super_cred(inode->i_sb));
+	if (IS_ERR_OR_NULL(pcc_file)) {
+		rc = pcc_file == NULL ? -EINVAL : PTR_ERR(pcc_file);
+		pcc_inode_put(pcci);
+	} else {
+		pccf->pccf_file = pcc_file;
+		pccf->pccf_type = pcci->pcci_type;
+	}
+
+	return rc;
+}
+
+int pcc_file_open(struct inode *inode, struct file *file)
+{
+	struct pcc_inode *pcci;
+	struct ll_inode_info *lli = ll_i2info(inode);
 	bool cached = false;
 	int rc = 0;
 
@@ -1468,22 +1542,22 @@ int pcc_file_open(struct inode *inode, struct file *file)
 			pcci = ll_i2pcci(inode);
 	}
 
-	pcc_inode_get(pcci);
-	WARN_ON(pccf->pccf_file);
-
-	path = &pcci->pcci_path;
-	CDEBUG(D_CACHE, "opening pcc file '%pd'\n", path->dentry);
-
-	pcc_file = dentry_open(path, file->f_flags,
-			       pcc_super_cred(inode->i_sb));
-	if (IS_ERR_OR_NULL(pcc_file)) {
-		rc = pcc_file == NULL ? -EINVAL : PTR_ERR(pcc_file);
+	/*
+	 * The RO-PCC copy becomes stale once the file is written, detach it
+	 * when the file is opened for write on this client. The first write
+	 * from any client clears LCM_FL_PCC_RDONLY, which revokes the layout
+	 * lock and so invalidates the copy on the other clients.
+	 */
+	if (pcci->pcci_type == LU_PCC_READONLY && file->f_mode & FMODE_WRITE) {
+		CDEBUG(D_CACHE, "Detach RO-PCC "DFID" on write open\n",
+		       PFID(&lli->lli_fid));
+		__pcc_layout_invalidate(pcci);
 		pcc_inode_put(pcci);
-	} else {
-		pccf->pccf_file = pcc_file;
-		pccf->pccf_type = pcci->pcci_type;
+		GOTO(out_unlock, rc = 0);
 	}
 
+	rc = __pcc_file_open(inode, file, pcci);
+
 out_unlock:
 	pcc_inode_unlock(inode);
 	RETURN(rc);
@@ -1551,6 +1625,22 @@ static void pcc_io_fini(struct inode *inode)
 		wake_up_all(&pcci->pcci_waitq);
 }
 
+/* Stop using the RO-PCC copy of @inode, the copy itself is kept */
+static void pcc_readonly_detach(struct inode *inode)
+{
+	struct pcc_inode *pcci;
+
+	pcc_inode_lock(inode);
+	pcci = ll_i2pcci(inode);
+	if (pcci && pcc_inode_has_layout(pcci) &&
+	    pcci->pcci_type == LU_PCC_READONLY) {
+		LASSERT(atomic_read(&pcci->pcci_refcount) > 0);
+		__pcc_layout_invalidate(pcci);
+		pcc_inode_put(pcci);
+	}
+	pcc_inode_unlock(inode);
+}
+
 
 static ssize_t
 __pcc_file_read_iter(struct kiocb *iocb, struct iov_iter *iter)
@@ -1616,6 +1706,20 @@ ssize_t pcc_file_read_iter(struct kiocb *iocb,
 	iocb->ki_filp = file;
 
 	pcc_io_fini(inode);
+
+	/*
+	 * The RO-PCC copy only duplicates the data on OSTs, so a failed read
+	 * of it is retried via the normal read path instead.
+	 */
+	if (result < 0 && result != -EIOCBQUEUED &&
+	    pccf->pccf_type == LU_PCC_READONLY) {
+		CDEBUG(D_CACHE, "RO-PCC read of "DFID" failed: rc = %zd\n",
+		       PFID(ll_inode2fid(inode)), result);
+		pcc_readonly_detach(inode);
+		*cached = false;
+		result = 0;
+	}
+
 	RETURN(result);
 }
 
@@ -1715,6 +1819,15 @@ int pcc_inode_setattr(struct inode *inode, struct iattr *attr,
 	if (!*cached)
 		RETURN(0);
 
+	if (ll_i2pcci(inode)->pcci_type == LU_PCC_READONLY) {
+		pcc_io_fini(inode);
+		/* Truncate makes the RO-PCC copy stale */
+		if (attr->ia_valid & ATTR_SIZE)
+			pcc_readonly_detach(inode);
+		*cached = false;
+		RETURN(0);
+	}
+
 	attr2.ia_valid = attr->ia_valid & (ATTR_SIZE | ATTR_ATIME |
 			 ATTR_ATIME_SET | ATTR_MTIME | ATTR_MTIME_SET |
 			 ATTR_CTIME | ATTR_UID | ATTR_GID);
@@ -1752,6 +1865,13 @@ int pcc_inode_getattr(struct inode *inode, u32 request_mask,
 	if (!*cached)
 		RETURN(0);
 
+	/* The attributes of the Lustre file are not kept in RO-PCC */
+	if (ll_i2pcci(inode)->pcci_type == LU_PCC_READONLY) {
+		pcc_io_fini(inode);
+		*cached = false;
+		RETURN(0);
+	}
+
 	old_cred = override_creds(pcc_super_cred(inode->i_sb));
 	rc = ll_vfs_getattr(&ll_i2pcci(inode)->pcci_path, &stat, request_mask,
 			    flags);
@@ -1832,7 +1952,8 @@ int pcc_fsync(struct file *file, loff_t start, loff_t end,
 
 	ENTRY;
 
-	if (!pcc_file) {
+	/* Nothing is ever dirtied in the RO-PCC copy */
+	if (!pcc_file || fd->fd_pcc_file.pccf_type == LU_PCC_READONLY) {
 		*cached = false;
 		RETURN(0);
 	}
@@ -2044,19 +2165,6 @@ int pcc_fault(struct vm_area_struct *vma, struct vm_fault *vmf,
 	RETURN(rc);
 }
 
-static void __pcc_layout_invalidate(struct pcc_inode *pcci)
-{
-	pcci->pcci_type = LU_PCC_NONE;
-	pcc_layout_gen_set(pcci, CL_LAYOUT_GEN_NONE);
-	if (atomic_read(&pcci->pcci_active_ios) == 0)
-		return;
-
-	CDEBUG(D_CACHE, "Waiting for IO completion: %d\n",
-		       atomic_read(&pcci->pcci_active_ios));
-	wait_event_idle(pcci->pcci_waitq,
-			atomic_read(&pcci->pcci_active_ios) == 0);
-}
-
 void pcc_layout_invalidate(struct inode *inode)
 {
 	struct pcc_inode *pcci;
@@ -2545,6 +2653,459 @@ out_unlock:
 	RETURN(rc);
 }
 
+static int pcc_readonly_xattr_set(struct dentry *dentry, __u32 gen, __u64 dv)
+{
+	int rc;
+
+	rc = ll_vfs_setxattr(dentry, dentry->d_inode, pcc_xattr_layout,
+			     &gen, sizeof(gen), 0);
+	if (rc)
+		return rc;
+
+	return ll_vfs_setxattr(dentry, dentry->d_inode, pcc_xattr_dv,
+			       &dv, sizeof(dv), 0);
+}
+
+/*
+ * Copy the data of @file into the RO-PCC backend @dataset and attach it.
+ *
+ * Unlike RW-PCC, the Lustre copy stays valid and only the shared layout lock
+ * cached by every reader is held. The file is first marked with
+ * LCM_FL_PCC_RDONLY on the MDT. The first write clears it again, which bumps
+ * the layout generation and so revokes the layout lock of every client that
+ * caches the file. The layout generation and data version of the file are
+ * recorded with the copy, and checked again once the copy is done: if the
+ * file was written meanwhile the attach fails with -ESTALE.
+ * The caller must have set PCC_STATE_FL_ATTACHING.
+ */
+static int __pcc_readonly_attach(struct file *file, struct inode *inode,
+				 struct pcc_dataset *dataset)
+{
+	struct ll_inode_info *lli = ll_i2info(inode);
+	struct pcc_super *super = ll_i2pccs(inode);
+	struct cl_layout clt = {
+		.cl_layout_gen = 0,
+		.cl_is_released = false,
+	};
+	struct pcc_inode *pcci;
+	const struct cred *old_cred;
+	struct dentry *dentry;
+	struct file *pcc_filp;
+	struct path path;
+	__u64 dv, dv2;
+	__u32 gen, gen2;
+	ssize_t ret;
+	int rc;
+
+	ENTRY;
+
+	rc = ll_layout_refresh(inode, &gen);
+	if (rc)
+		RETURN(rc);
+
+	rc = pcc_get_layout_info(inode, &clt);
+	if (rc)
+		RETURN(rc);
+
+	/* The data of a released file can only be cached by RW-PCC */
+	if (clt.cl_is_released)
+		RETURN(-ENODATA);
+
+	if (!clt.cl_is_pcc_rdonly) {
+		struct lu_extent ext = { .e_start = 0,
+					 .e_end = OBD_OBJECT_EOF };
+
+		rc = ll_layout_write_intent(inode, LAYOUT_INTENT_PCCRO_SET,
+					    &ext);
+		if (rc)
+			RETURN(rc);
+
+		rc = ll_layout_refresh(inode, &gen);
+		if (rc)
+			RETURN(rc);
+
+		rc = pcc_get_layout_info(inode, &clt);
+		if (rc)
+			RETURN(rc);
+
+		/* Cleared again by a writer */
+		if (!clt.cl_is_pcc_rdonly)
+			RETURN(-ESTALE);
+	}
+
+	rc = ll_data_version(inode, &dv, LL_DV_RD_FLUSH);
+	if (rc)
+		RETURN(rc);
+
+	old_cred = override_creds(super->pccs_cred);
+	rc = __pcc_inode_create(dataset, &lli->lli_fid, &dentry);
+	if (rc)
+		GOTO(out_cred, rc);
+
+	path.mnt = dataset->pccd_path.mnt;
+	path.dentry = dentry;
+	pcc_filp = dentry_open(&path, O_WRONLY | O_LARGEFILE, current_cred());
+	if (IS_ERR_OR_NULL(pcc_filp)) {
+		rc = pcc_filp == NULL ? -EINVAL : PTR_ERR(pcc_filp);
+		GOTO(out_dentry, rc);
+	}
+
+	ret = pcc_copy_data(file, pcc_filp);
+	if (ret < 0)
+		GOTO(out_fput, rc = ret);
+
+	/* The copy may replace a stale and longer one, see LU-13023 */
+	rc = pcc_inode_reset_iattr(dentry, ATTR_SIZE, KUIDT_INIT(0),
+				   KGIDT_INIT(0), ret);
+	if (rc)
+		GOTO(out_fput, rc);
+
+	rc = pcc_readonly_xattr_set(dentry, gen, dv);
+	if (rc)
+		GOTO(out_fput, rc);
+
+	/* Pause to allow for a race with a concurrent writer */
+	OBD_FAIL_TIMEOUT(OBD_FAIL_LLITE_PCC_ATTACH_PAUSE, cfs_fail_val);
+
+	rc = ll_data_version(inode, &dv2, LL_DV_RD_FLUSH);
+	if (rc)
+		GOTO(out_fput, rc);
+
+	pcc_inode_lock(inode);
+	rc = ll_layout_refresh(inode, &gen2);
+	if (rc)
+		GOTO(out_unlock, rc);
+
+	if (gen2 != gen || dv2 != dv) {
+		CDEBUG(D_CACHE,
+		       DFID" changed during attach, layout gen %u/%u, data version %llu/%llu\n",
+		       PFID(&lli->lli_fid), gen, gen2, dv, dv2);
+		GOTO(out_unlock, rc = -ESTALE);
+	}
+
+	/* The file was opened for write on this client during the copy */
+	if (lli->lli_open_fd_write_count > 0)
+		GOTO(out_unlock, rc = -EBUSY);
+
+	pcci = ll_i2pcci(inode);
+	if (pcci) {
+		/*
+		 * Still referenced by files opened while it was attached
+		 * before, which keep the cache path it was attached with.
+		 */
+		if (pcci->pcci_path.dentry != dentry)
+			GOTO(out_unlock, rc = -EBUSY);
+
+		pcc_inode_get(pcci);
+		pcci->pcci_type = LU_PCC_READONLY;
+		down_read(&super->pccs_rw_sem);
+		pcc_inode_dsflags_set(lli, dataset);
+		up_read(&super->pccs_rw_sem);
+		dput(dentry);
+	} else {
+		OBD_SLAB_ALLOC_PTR_GFP(pcci, pcc_inode_slab, GFP_NOFS);
+		if (pcci == NULL)
+			GOTO(out_unlock, rc = -ENOMEM);
+
+		pcc_inode_attach_set(super, dataset, lli, pcci, dentry,
+				     LU_PCC_READONLY);
+	}
+	pcc_layout_gen_set(pcci, gen);
+out_unlock:
+	pcc_inode_unlock(inode);
+out_fput:
+	fput(pcc_filp);
+out_dentry:
+	if (rc) {
+		(void) pcc_inode_remove(inode, dentry);
+		dput(dentry);
+	}
+out_cred:
+	revert_creds(old_cred);
+
+	RETURN(rc);
+}
+
+int pcc_readonly_attach(struct file *file, struct inode *inode, __u32 roid)
+{
+	struct ll_inode_info *lli = ll_i2info(inode);
+	struct pcc_dataset *dataset;
+	int rc;
+
+	ENTRY;
+
+	/* the MDT must clear LCM_FL_PCC_RDONLY for clients unaware of it */
+	if (!exp_connect_pccro(ll_i2mdexp(inode)))
+		RETURN(-EOPNOTSUPP);
+
+	rc = pcc_attach_allowed_check(inode);
+	if (rc)
+		RETURN(rc);
+
+	dataset = pcc_dataset_get(&ll_i2sbi(inode)->ll_pcc_super,
+				  LU_PCC_READONLY, roid);
+	if (dataset == NULL)
+		GOTO(out, rc = -ENOENT);
+
+	rc = __pcc_readonly_attach(file, inode, dataset);
+	pcc_dataset_put(dataset);
+out:
+	pcc_inode_lock(inode);
+	lli->lli_pcc_state &= ~PCC_STATE_FL_ATTACHING;
+	pcc_inode_unlock(inode);
+
+	RETURN(rc);
+}
+
+/*
+ * Find a RO-PCC backend keeping a copy of @inode made at layout generation
+ * @gen. The caller has checked that LCM_FL_PCC_RDONLY is still set, so the
+ * file was not written since the copy was made.
+ */
+static struct pcc_dataset *pcc_readonly_copy_find(struct inode *inode,
+						  __u32 gen)
+{
+	struct pcc_super *super = ll_i2pccs(inode);
+	struct ll_inode_info *lli = ll_i2info(inode);
+	struct pcc_dataset *dataset, *selected = NULL;
+	const struct cred *old_cred;
+	struct dentry *pcc_dentry;
+	struct path path;
+	char *pathname;
+	__u32 pcc_gen;
+	__u64 pcc_dv;
+	int rc;
+
+	OBD_ALLOC(pathname, PATH_MAX);
+	if (pathname == NULL)
+		return NULL;
+
+	old_cred = override_creds(pcc_super_cred(inode->i_sb));
+	down_read(&super->pccs_rw_sem);
+	list_for_each_entry(dataset, &super->pccs_datasets, pccd_linkage) {
+		if (!(dataset->pccd_flags & PCC_DATASET_ROPCC) ||
+		    !pcc_auto_attach_enabled(dataset->pccd_flags, PIT_OPEN))
+			continue;
+
+		pcc_fid2dataset_fullpath(pathname, PATH_MAX, &lli->lli_fid,
+					 dataset);
+		if (kern_path(pathname, LOOKUP_FOLLOW, &path))
+			continue;
+
+		/* Only copies made by RO-PCC carry a data version */
+		pcc_dentry = path.dentry;
+		rc = ll_vfs_getxattr(pcc_dentry, pcc_dentry->d_inode,
+				     pcc_xattr_layout, &pcc_gen,
+				     sizeof(pcc_gen));
+		if (rc >= 0 && pcc_gen == gen)
+			rc = ll_vfs_getxattr(pcc_dentry, pcc_dentry->d_inode,
+					     pcc_xattr_dv, &pcc_dv,
+					     sizeof(pcc_dv));
+		else
+			rc = -ESTALE;
+		path_put(&path);
+
+		if (rc >= 0) {
+			atomic_inc(&dataset->pccd_refcount);
+			selected = dataset;
+			break;
+		}
+	}
+	up_read(&super->pccs_rw_sem);
+	revert_creds(old_cred);
+	OBD_FREE(pathname, PATH_MAX);
+
+	return selected;
+}
+
+/* RO-PCC attach started by a read-only open, done by pccs_attach_wq */
+struct pcc_readonly_attach_work {
+	struct work_struct	 prw_work;
+	/* the opened Lustre file and the creds of the opener */
+	struct path		 prw_path;
+	const struct cred	*prw_cred;
+	struct pcc_dataset	*prw_dataset;
+	bool			 prw_heat_admit;
+};
+
+static void pcc_readonly_attach_work_fn(struct work_struct *work)
+{
+	struct pcc_readonly_attach_work *prw;
+	struct inode *inode;
+	struct ll_inode_info *lli;
+	const struct cred *old_cred;
+	struct file *file;
+	int rc;
+
+	ENTRY;
+
+	prw = container_of(work, struct pcc_readonly_attach_work, prw_work);
+	inode = prw->prw_path.dentry->d_inode;
+	lli = ll_i2info(inode);
+
+	/* The layout intent is sent with the creds of the opener */
+	old_cred = override_creds(prw->prw_cred);
+	file = dentry_open(&prw->prw_path, O_RDONLY | O_LARGEFILE,
+			   prw->prw_cred);
+	if (IS_ERR_OR_NULL(file)) {
+		rc = file == NULL ? -EINVAL : PTR_ERR(file);
+	} else {
+		rc = __pcc_readonly_attach(file, inode, prw->prw_dataset);
+		fput(file);
+	}
+	revert_creds(old_cred);
+
+	if (!rc && prw->prw_heat_admit)
+		ll_stats_ops_tally(ll_i2sbi(inode), LPROC_LL_HEAT_PCC_ADMIT, 1);
+	if (rc)
+		CDEBUG(D_CACHE, "%s: RO-PCC attach of "DFID" failed: rc = %d\n",
+		       ll_i2sbi(inode)->ll_fsname, PFID(&lli->lli_fid), rc);
+
+	pcc_inode_lock(inode);
+	lli->lli_pcc_state &= ~PCC_STATE_FL_ATTACHING;
+	pcc_inode_unlock(inode);
+
+	pcc_dataset_put(prw->prw_dataset);
+	put_cred(prw->prw_cred);
+	path_put(&prw->prw_path);
+	OBD_FREE_PTR(prw);
+	EXIT;
+}
+
+/*
+ * Queue the copy of @file into @dataset. The reference on @dataset and
+ * PCC_STATE_FL_ATTACHING are handed over to the work item on success.
+ */
+static int pcc_readonly_attach_async(struct file *file, struct inode *inode,
+				     struct pcc_dataset *dataset,
+				     bool heat_admit)
+{
+	struct pcc_readonly_attach_work *prw;
+
+	OBD_ALLOC_PTR(prw);
+	if (prw == NULL)
+		return -ENOMEM;
+
+	INIT_WORK(&prw->prw_work, pcc_readonly_attach_work_fn);
+	prw->prw_path = file->f_path;
+	path_get(&prw->prw_path);
+	prw->prw_cred = get_current_cred();
+	prw->prw_dataset = dataset;
+	prw->prw_heat_admit = heat_admit;
+	queue_work(ll_i2pccs(inode)->pccs_attach_wq, &prw->prw_work);
+
+	return 0;
+}
+
+/*
+ * Called once a read-only open has succeeded without a RO-PCC copy.
+ *
+ * A copy kept by an earlier attach is attached again if the layout still
+ * carries LCM_FL_PCC_RDONLY at the generation the copy was made at, as any
+ * write since would have cleared the flag. This only needs the layout lock
+ * the open has cached. Otherwise, if a RO-PCC backend rule matches the opener
+ * and the file name, the file is copied into it in the background, and later
+ * opens use the copy once it is attached.
+ */
+void pcc_readonly_open(struct inode *inode, struct file *file)
+{
+	struct pcc_super *super = ll_i2pccs(inode);
+	struct ll_inode_info *lli = ll_i2info(inode);
+	struct ll_sb_info *sbi = ll_i2sbi(inode);
+	struct ll_file_data *fd = file->private_data;
+	struct pcc_file *pccf = &fd->fd_pcc_file;
+	struct cl_layout clt = {
+		.cl_layout_gen = 0,
+		.cl_is_released = false,
+	};
+	struct pcc_dataset *found = NULL;
+	struct pcc_dataset *dataset;
+	struct pcc_matcher item;
+	struct pcc_inode *pcci;
+	bool heat_admit = false;
+	bool cached = false;
+	__u32 gen;
+	int rc;
+
+	ENTRY;
+
+	if (!S_ISREG(inode->i_mode) ||
+	    (file->f_mode & (FMODE_READ | FMODE_WRITE)) != FMODE_READ ||
+	    file->f_flags & O_DIRECT || list_empty(&super->pccs_datasets) ||
+	    pccf->pccf_file || !exp_connect_pccro(ll_i2mdexp(inode)))
+		RETURN_EXIT;
+
+	item.pm_uid = from_kuid(&init_user_ns, current_uid());
+	item.pm_gid = from_kgid(&init_user_ns, current_gid());
+	item.pm_projid = lli->lli_projid;
+	item.pm_name = &file->f_path.dentry->d_name;
+	dataset = pcc_dataset_match_get(super, LU_PCC_READONLY, &item);
+	/* with the heat policy only hot files are copied by the rules */
+	if (dataset && ll_sbi_has_file_heat(sbi) &&
+	    sbi->ll_heat_hot_threshold > 0) {
+		heat_admit = ll_file_is_hot(inode);
+		if (!heat_admit) {
+			ll_stats_ops_tally(sbi, LPROC_LL_HEAT_PCC_DEFER, 1);
+			pcc_dataset_put(dataset);
+			dataset = NULL;
+		}
+	}
+	if (!dataset && !pcc_may_auto_attach(inode, PIT_OPEN))
+		RETURN_EXIT;
+
+	rc = pcc_attach_allowed_check(inode);
+	if (rc)
+		GOTO(out_dataset_put, rc);
+
+	rc = ll_layout_refresh(inode, &gen);
+	if (rc)
+		GOTO(out, rc);
+
+	rc = pcc_get_layout_info(inode, &clt);
+	if (rc || clt.cl_is_released)
+		GOTO(out, rc);
+
+	if (clt.cl_is_pcc_rdonly)
+		found = pcc_readonly_copy_find(inode, gen);
+	if (found) {
+		pcc_inode_lock(inode);
+		if (lli->lli_open_fd_write_count == 0) {
+			down_read(&super->pccs_rw_sem);
+			rc = pcc_try_dataset_attach(inode, gen, LU_PCC_READONLY,
+						    found, &cached);
+			up_read(&super->pccs_rw_sem);
+		}
+		pcc_inode_unlock(inode);
+	}
+
+	if (!rc && !cached && dataset) {
+		rc = pcc_readonly_attach_async(file, inode, dataset,
+					       heat_admit);
+		if (!rc) {
+			/* the work item owns the reference now */
+			dataset = NULL;
+			GOTO(out_dataset_put, rc);
+		}
+	}
+out:
+	pcc_inode_lock(inode);
+	lli->lli_pcc_state &= ~PCC_STATE_FL_ATTACHING;
+	pcci = ll_i2pcci(inode);
+	/* Detached meanwhile by layout lock revocation */
+	if (cached && pcci && pcc_inode_has_layout(pcci))
+		rc = __pcc_file_open(inode, file, pcci);
+	pcc_inode_unlock(inode);
+out_dataset_put:
+	if (found)
+		pcc_dataset_put(found);
+	if (dataset)
+		pcc_dataset_put(dataset);
+	if (rc)
+		CDEBUG(D_CACHE, "%s: RO-PCC attach of "DFID" failed: rc = %d\n",
+		       sbi->ll_fsname, PFID(&lli->lli_fid), rc);
+	EXIT;
+}
+
 static int pcc_hsm_remove(struct inode *inode)
 {
 	struct hsm_user_request *hur;
@@ -2617,6 +3178,17 @@ int pcc_ioctl_detach(struct inode *inode, __u32 opt)
 
 		__pcc_layout_invalidate(pcci);
 		pcc_inode_put(pcci);
+	} else if (pcci->pcci_type == LU_PCC_READONLY) {
+		/* The data stays on OSTs, just drop the local copy */
+		__pcc_layout_invalidate(pcci);
+		if (opt == PCC_DETACH_OPT_UNCACHE) {
+			const struct cred *old_cred;
+
+			old_cred = override_creds(pcc_super_cred(inode->i_sb));
+			(void) pcc_inode_remove(inode, pcci->pcci_path.dentry);
+			revert_creds(old_cred);
+		}
+		pcc_inode_put(pcci);
 	}
 
 out_unlock:
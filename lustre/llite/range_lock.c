@@ -36,6 +36,7 @@
 #ifdef HAVE_SCHED_HEADERS
 #include <linux/sched/signal.h>
 #endif
+#include <obd_support.h>
 #include "range_lock.h"
 #include <uapi/linux/lustre/lustre_user.h>
 
@@ -49,9 +50,13 @@
  */
 void range_lock_tree_init(struct range_lock_tree *tree)
 {
-	tree->rlt_root = NULL;
-	tree->rlt_sequence = 0;
-	spin_lock_init(&tree->rlt_lock);
+	int i;
+
+	for (i = 0; i < RL_NR_SHARDS; i++) {
+		tree->rlt_shards[i].rls_root = NULL;
+		tree->rlt_shards[i].rls_sequence = 0;
+		spin_lock_init(&tree->rlt_shards[i].rls_lock);
+	}
 }
 
 /**
@@ -66,26 +71,88 @@ void range_lock_tree_init(struct range_lock_tree *tree)
  */
 int range_lock_init(struct range_lock *lock, __u64 start, __u64 end)
 {
-	int rc;
+	__u64 regions;
 
-	interval_init(&lock->rl_node);
+	start >>= PAGE_SHIFT;
 	if (end != LUSTRE_EOF)
 		end >>= PAGE_SHIFT;
-	rc = interval_set(&lock->rl_node, start >> PAGE_SHIFT, end);
-	if (rc)
-		return rc;
+	if (start > end)
+		return -ERANGE;
 
-	INIT_LIST_HEAD(&lock->rl_next_lock);
+	lock->rl_start = start;
+	lock->rl_end = end;
 	lock->rl_task = NULL;
-	lock->rl_lock_count = 0;
-	lock->rl_blocking_ranges = 0;
-	lock->rl_sequence = 0;
-	return rc;
+	atomic_set(&lock->rl_blocking_ranges, 0);
+	lock->rl_shared = 0;
+
+	regions = (end >> RL_REGION_SHIFT) - (start >> RL_REGION_SHIFT);
+	if (regions >= RL_NR_SHARDS - 1) {
+		lock->rl_shard = 0;
+		lock->rl_shard_count = RL_NR_SHARDS;
+	} else {
+		lock->rl_shard = (start >> RL_REGION_SHIFT) &
+				 (RL_NR_SHARDS - 1);
+		lock->rl_shard_count = regions + 1;
+	}
+	lock->rl_nodes = &lock->rl_node;
+	return 0;
 }
 
-static inline struct range_lock *next_lock(struct range_lock *lock)
+static inline bool range_lock_in_shard(const struct range_lock *lock, int shard)
 {
-	return list_entry(lock->rl_next_lock.next, typeof(*lock), rl_next_lock);
+	return ((shard - lock->rl_shard) & (RL_NR_SHARDS - 1)) <
+	       lock->rl_shard_count;
+}
+
+/**
+ * Check whether \a lock and \a other, found overlapped in shard \a shard,
+ * block each other there.
+ *
+ * Locks covering several shards meet in all the shards they share, the
+ * conflict is only accounted in the first of them.
+ */
+static bool range_lock_conflict(const struct range_lock *lock,
+				const struct range_lock *other, int shard)
+{
+	int i;
+
+	if (lock->rl_shared && other->rl_shared)
+		return false;
+
+	if (lock->rl_shard_count == 1 || other->rl_shard_count == 1)
+		return true;
+
+	for (i = 0; i < shard; i++) {
+		if (range_lock_in_shard(lock, i) &&
+		    range_lock_in_shard(other, i))
+			return false;
+	}
+	return true;
+}
+
+struct range_lock_arg {
+	struct range_lock_node	*rla_node;
+	int			 rla_shard;
+};
+
+static inline struct range_lock_node *next_lock(struct range_lock_node *node)
+{
+	return list_entry(node->rln_next_lock.next, typeof(*node),
+			  rln_next_lock);
+}
+
+/* drop \a node blocking \a iter, wake up \a iter if it is not blocked */
+static void range_unlock_one(struct range_lock_node *node,
+			     struct range_lock_node *iter, int shard)
+{
+	struct range_lock *lock = iter->rln_lock;
+
+	if (iter->rln_sequence <= node->rln_sequence ||
+	    !range_lock_conflict(node->rln_lock, lock, shard))
+		return;
+
+	if (atomic_dec_and_test(&lock->rl_blocking_ranges))
+		wake_up_process(lock->rl_task);
 }
 
 /**
@@ -101,23 +168,60 @@ static inline struct range_lock *next_lock(struct range_lock *lock)
  */
 static enum interval_iter range_unlock_cb(struct interval_node *node, void *arg)
 {
-	struct range_lock *lock = arg;
-	struct range_lock *overlap = node2rangelock(node);
-	struct range_lock *iter;
+	struct range_lock_arg *rla = arg;
+	struct range_lock_node *overlap = node2rangelock(node);
+	struct range_lock_node *iter;
 	ENTRY;
 
-	list_for_each_entry(iter, &overlap->rl_next_lock, rl_next_lock) {
-		if (iter->rl_sequence > lock->rl_sequence) {
-			--iter->rl_blocking_ranges;
-			LASSERT(iter->rl_blocking_ranges > 0);
+	list_for_each_entry(iter, &overlap->rln_next_lock, rln_next_lock)
+		range_unlock_one(rla->rla_node, iter, rla->rla_shard);
+	range_unlock_one(rla->rla_node, overlap, rla->rla_shard);
+
+	RETURN(INTERVAL_ITER_CONT);
+}
+
+/* delete the \a i-th node of \a lock from its shard */
+static void range_unlock_shard(struct range_lock_tree *tree,
+			       struct range_lock *lock, int i)
+{
+	struct range_lock_node *node = &lock->rl_nodes[i];
+	struct range_lock_arg rla = {
+		.rla_node	= node,
+		.rla_shard	= (lock->rl_shard + i) & (RL_NR_SHARDS - 1),
+	};
+	struct range_lock_shard *shard = &tree->rlt_shards[rla.rla_shard];
+
+	spin_lock(&shard->rls_lock);
+	if (!list_empty(&node->rln_next_lock)) {
+		struct range_lock_node *next;
+
+		if (interval_is_intree(&node->rln_node)) { /* first lock */
+			/* Insert the next same range lock into the tree */
+			next = next_lock(node);
+			next->rln_lock_count = node->rln_lock_count - 1;
+			interval_erase(&node->rln_node, &shard->rls_root);
+			interval_insert(&next->rln_node, &shard->rls_root);
+		} else {
+			/* find the first lock in tree */
+			list_for_each_entry(next, &node->rln_next_lock,
+					    rln_next_lock) {
+				if (!interval_is_intree(&next->rln_node))
+					continue;
+
+				LASSERT(next->rln_lock_count > 0);
+				next->rln_lock_count--;
+				break;
+			}
 		}
+		list_del_init(&node->rln_next_lock);
+	} else {
+		LASSERT(interval_is_intree(&node->rln_node));
+		interval_erase(&node->rln_node, &shard->rls_root);
 	}
-	if (overlap->rl_sequence > lock->rl_sequence) {
-		--overlap->rl_blocking_ranges;
-		if (overlap->rl_blocking_ranges == 0)
-			wake_up_process(overlap->rl_task);
-	}
-	RETURN(INTERVAL_ITER_CONT);
+
+	interval_search(shard->rls_root, &node->rln_node.in_extent,
+			range_unlock_cb, &rla);
+	spin_unlock(&shard->rls_lock);
 }
 
 /**
@@ -132,40 +236,17 @@ static enum interval_iter range_unlock_cb(struct interval_node *node, void *arg)
  */
 void range_unlock(struct range_lock_tree *tree, struct range_lock *lock)
 {
+	int i;
 	ENTRY;
 
-	spin_lock(&tree->rlt_lock);
-	if (!list_empty(&lock->rl_next_lock)) {
-		struct range_lock *next;
-
-		if (interval_is_intree(&lock->rl_node)) { /* first lock */
-			/* Insert the next same range lock into the tree */
-			next = next_lock(lock);
-			next->rl_lock_count = lock->rl_lock_count - 1;
-			interval_erase(&lock->rl_node, &tree->rlt_root);
-			interval_insert(&next->rl_node, &tree->rlt_root);
-		} else {
-			/* find the first lock in tree */
-			list_for_each_entry(next, &lock->rl_next_lock,
-					    rl_next_lock) {
-				if (!interval_is_intree(&next->rl_node))
-					continue;
+	for (i = 0; i < lock->rl_shard_count; i++)
+		range_unlock_shard(tree, lock, i);
 
-				LASSERT(next->rl_lock_count > 0);
-				next->rl_lock_count--;
-				break;
-			}
-		}
-		list_del_init(&lock->rl_next_lock);
-	} else {
-		LASSERT(interval_is_intree(&lock->rl_node));
-		interval_erase(&lock->rl_node, &tree->rlt_root);
+	if (lock->rl_nodes != &lock->rl_node) {
+		OBD_FREE_PTR_ARRAY(lock->rl_nodes, lock->rl_shard_count);
+		lock->rl_nodes = &lock->rl_node;
 	}
 
-	interval_search(tree->rlt_root, &lock->rl_node.in_extent,
-			range_unlock_cb, lock);
-	spin_unlock(&tree->rlt_lock);
-
 	EXIT;
 }
 
@@ -182,13 +263,59 @@ void range_unlock(struct range_lock_tree *tree, struct range_lock *lock)
  */
 static enum interval_iter range_lock_cb(struct interval_node *node, void *arg)
 {
-	struct range_lock *lock = (struct range_lock *)arg;
-	struct range_lock *overlap = node2rangelock(node);
+	struct range_lock_arg *rla = arg;
+	struct range_lock *lock = rla->rla_node->rln_lock;
+	struct range_lock_node *overlap = node2rangelock(node);
+	struct range_lock_node *iter;
+
+	list_for_each_entry(iter, &overlap->rln_next_lock, rln_next_lock) {
+		if (range_lock_conflict(lock, iter->rln_lock, rla->rla_shard))
+			atomic_inc(&lock->rl_blocking_ranges);
+	}
+	if (range_lock_conflict(lock, overlap->rln_lock, rla->rla_shard))
+		atomic_inc(&lock->rl_blocking_ranges);
 
-	lock->rl_blocking_ranges += overlap->rl_lock_count + 1;
 	RETURN(INTERVAL_ITER_CONT);
 }
 
+/* insert the \a i-th node of \a lock into its shard, which is locked */
+static void range_lock_shard(struct range_lock_tree *tree,
+			     struct range_lock *lock, int i)
+{
+	struct range_lock_node *node = &lock->rl_nodes[i];
+	struct range_lock_arg rla = {
+		.rla_node	= node,
+		.rla_shard	= (lock->rl_shard + i) & (RL_NR_SHARDS - 1),
+	};
+	struct range_lock_shard *shard = &tree->rlt_shards[rla.rla_shard];
+	struct interval_node *overlap;
+
+	interval_init(&node->rln_node);
+	interval_set(&node->rln_node, lock->rl_start, lock->rl_end);
+	node->rln_lock = lock;
+	INIT_LIST_HEAD(&node->rln_next_lock);
+	node->rln_lock_count = 0;
+
+	/*
+	 * We need to check for all conflicting intervals
+	 * already in the tree.
+	 */
+	interval_search(shard->rls_root, &node->rln_node.in_extent,
+			range_lock_cb, &rla);
+	/*
+	 * Insert to the tree if I am unique, otherwise link to the
+	 * rln_next_lock of the lock which has the same range as mine.
+	 */
+	overlap = interval_insert(&node->rln_node, &shard->rls_root);
+	if (overlap != NULL) {
+		struct range_lock_node *tmp = node2rangelock(overlap);
+
+		list_add_tail(&node->rln_next_lock, &tmp->rln_next_lock);
+		tmp->rln_lock_count++;
+	}
+	node->rln_sequence = ++shard->rls_sequence;
+}
+
 /**
  * Lock a region
  *
@@ -201,47 +328,59 @@ static enum interval_iter range_lock_cb(struct interval_node *node, void *arg)
  * If there exists overlapping range lock, the new lock will wait and
  * retry, if later it find that it is not the chosen one to wake up,
  * it wait again.
+ *
+ * A lock of a single region only takes the lock of its shard.  A lock
+ * covering several shards takes all of them in order while it is queued,
+ * so that it is queued after or before any other lock at once, and two
+ * locks can't wait for each other.
  */
 int range_lock(struct range_lock_tree *tree, struct range_lock *lock)
 {
-	struct interval_node *node;
+	int first;
+	int i;
 	int rc = 0;
 	ENTRY;
 
-	spin_lock(&tree->rlt_lock);
-	/*
-	 * We need to check for all conflicting intervals
-	 * already in the tree.
-	 */
-	interval_search(tree->rlt_root, &lock->rl_node.in_extent,
-			range_lock_cb, lock);
-	/*
-	 * Insert to the tree if I am unique, otherwise I've been linked to
-	 * the rl_next_lock of another lock which has the same range as mine
-	 * in range_lock_cb().
-	 */
-	node = interval_insert(&lock->rl_node, &tree->rlt_root);
-	if (node != NULL) {
-		struct range_lock *tmp = node2rangelock(node);
+	if (lock->rl_shard_count > 1) {
+		OBD_ALLOC_PTR_ARRAY(lock->rl_nodes, lock->rl_shard_count);
+		if (lock->rl_nodes == NULL) {
+			lock->rl_nodes = &lock->rl_node;
+			RETURN(-ENOMEM);
+		}
+	}
+	lock->rl_task = current;
 
-		list_add_tail(&lock->rl_next_lock, &tmp->rl_next_lock);
-		tmp->rl_lock_count++;
+	/* shards are locked in ascending order, from the one wrapped */
+	first = RL_NR_SHARDS - lock->rl_shard;
+	if (first >= lock->rl_shard_count)
+		first = 0;
+	for (i = 0; i < lock->rl_shard_count; i++) {
+		int n = (first + i) % lock->rl_shard_count;
+
+		spin_lock_nested(&tree->rlt_shards[(lock->rl_shard + n) &
+				 (RL_NR_SHARDS - 1)].rls_lock, i);
 	}
-	lock->rl_sequence = ++tree->rlt_sequence;
 
-	while (lock->rl_blocking_ranges > 0) {
-		lock->rl_task = current;
-		__set_current_state(TASK_INTERRUPTIBLE);
-		spin_unlock(&tree->rlt_lock);
-		schedule();
+	for (i = 0; i < lock->rl_shard_count; i++)
+		range_lock_shard(tree, lock, i);
+
+	for (i = 0; i < lock->rl_shard_count; i++)
+		spin_unlock(&tree->rlt_shards[(lock->rl_shard + i) &
+				(RL_NR_SHARDS - 1)].rls_lock);
+
+	for (;;) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (atomic_read(&lock->rl_blocking_ranges) == 0)
+			break;
 
 		if (signal_pending(current)) {
+			__set_current_state(TASK_RUNNING);
 			range_unlock(tree, lock);
 			GOTO(out, rc = -ERESTARTSYS);
 		}
-		spin_lock(&tree->rlt_lock);
+		schedule();
 	}
-	spin_unlock(&tree->rlt_lock);
+	__set_current_state(TASK_RUNNING);
 out:
 	RETURN(rc);
 }
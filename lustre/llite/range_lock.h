@@ -41,43 +41,87 @@
 
 #define RL_FMT "[%llu, %llu]"
 #define RL_PARA(range)				\
-	(range)->rl_node.in_extent.start,	\
-	(range)->rl_node.in_extent.end
+	(range)->rl_start,			\
+	(range)->rl_end
+
+/*
+ * The tree is split into shards, each with its own lock.  The file is cut
+ * in regions of (1 << RL_REGION_SHIFT) pages which are spread over the
+ * shards, so that locks of disjoint regions don't contend.
+ */
+#define RL_REGION_SHIFT		(20 - PAGE_SHIFT)
+/* all shards are locked at once by a wide range, see lockdep subclasses */
+#define RL_SHARD_BITS		3
+#define RL_NR_SHARDS		(1 << RL_SHARD_BITS)
+
+struct range_lock;
+
+/**
+ * Part of a range lock in one shard of the tree.
+ */
+struct range_lock_node {
+	struct interval_node	rln_node;
+	struct range_lock	*rln_lock;
+	/**
+	 * List of locks with the same range.
+	 */
+	struct list_head	rln_next_lock;
+	/**
+	 * Number of locks in the list rln_next_lock
+	 */
+	unsigned int		rln_lock_count;
+	/**
+	 * Sequence number of range lock in the shard. This number is used to
+	 * get to know the order the locks are queued; this is required for
+	 * range_unlock().
+	 */
+	__u64			rln_sequence;
+};
+
+static inline struct range_lock_node *
+node2rangelock(const struct interval_node *n)
+{
+	return container_of(n, struct range_lock_node, rln_node);
+}
 
 struct range_lock {
-	struct interval_node	rl_node;
+	/**
+	 * Covered region, in pages.
+	 */
+	__u64			rl_start;
+	__u64			rl_end;
 	/**
 	 * Process to enqueue this lock.
 	 */
 	struct task_struct	*rl_task;
 	/**
-	 * List of locks with the same range.
+	 * Number of ranges which are blocking acquisition of the lock
 	 */
-	struct list_head	rl_next_lock;
+	atomic_t		rl_blocking_ranges;
 	/**
-	 * Number of locks in the list rl_next_lock
+	 * Shared lock, only conflicts with exclusive locks.
 	 */
-	unsigned int		rl_lock_count;
+	unsigned int		rl_shared:1;
 	/**
-	 * Number of ranges which are blocking acquisition of the lock
+	 * First shard of the lock and number of shards it covers.
 	 */
-	unsigned int		rl_blocking_ranges;
+	unsigned int		rl_shard;
+	unsigned int		rl_shard_count;
 	/**
-	 * Sequence number of range lock. This number is used to get to know
-	 * the order the locks are queued; this is required for range_cancel().
+	 * Nodes in the shards, &rl_node if the lock covers one shard.
 	 */
-	__u64			rl_sequence;
+	struct range_lock_node	*rl_nodes;
+	struct range_lock_node	rl_node;
 };
 
-static inline struct range_lock *node2rangelock(const struct interval_node *n)
-{
-	return container_of(n, struct range_lock, rl_node);
-}
+struct range_lock_shard {
+	struct interval_node	*rls_root;
+	spinlock_t		 rls_lock;
+	__u64			 rls_sequence;
+};
 
 struct range_lock_tree {
-	struct interval_node	*rlt_root;
-	spinlock_t		 rlt_lock;
-	__u64			 rlt_sequence;
+	struct range_lock_shard	rlt_shards[RL_NR_SHARDS];
 };
 
 void range_lock_tree_init(struct range_lock_tree *tree);
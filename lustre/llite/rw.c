@@ -599,10 +599,13 @@ static void ll_readahead_handle_work(struct work_struct *wq)
 		work->lrw_end_idx = eof_index;
 		ria->ria_eof = true;
 	}
-	if (work->lrw_end_idx <= work->lrw_start_idx)
+	if (work->lrw_end_idx < work->lrw_start_idx)
 		GOTO(out_put_env, rc = 0);
 
 	ria->ria_end_idx = work->lrw_end_idx;
+	/* don't trim predicted extents to the optimal RPC size */
+	if (work->lrw_pattern)
+		ria->ria_end_idx_min = ria->ria_end_idx;
 	pages = ria->ria_end_idx - ria->ria_start_idx + 1;
 	ria->ria_reserved = ll_ra_count_get(sbi, ria,
 					    ria_page_count(ria), pages_min);
@@ -883,6 +886,15 @@ static void ras_stride_reset(struct ll_readahead_state *ras)
         RAS_CDEBUG(ras);
 }
 
+/* called with the ras_lock held or from places where it doesn't matter */
+static void ras_pattern_reset(struct ll_readahead_state *ras)
+{
+	ras->ras_pat_nr = 0;
+	ras->ras_pat_head = 0;
+	ras->ras_pat_period = 0;
+	ras->ras_pat_issued = 0;
+}
+
 void ll_readahead_init(struct inode *inode, struct ll_readahead_state *ras)
 {
 	spin_lock_init(&ras->ras_lock);
@@ -894,6 +906,9 @@ void ll_readahead_init(struct inode *inode, struct ll_readahead_state *ras)
 	ras->ras_range_max_end_idx = 0;
 	ras->ras_range_requests = 0;
 	ras->ras_last_range_pages = 0;
+	ras_pattern_reset(ras);
+	ras->ras_pat_last_pos = 0;
+	ras->ras_pat_count = 0;
 }
 
 /*
@@ -1024,8 +1039,17 @@ static void ras_increase_window(struct inode *inode,
 	} else {
 		pgoff_t window_pages;
 
-		window_pages = min(ras->ras_window_pages + ras->ras_rpc_pages,
-				   ra->ra_max_pages_per_file);
+		/* no need to ramp up the window of a hot file */
+		if (ll_file_is_hot(inode) &&
+		    ras->ras_window_pages < ra->ra_max_pages_per_file) {
+			window_pages = ra->ra_max_pages_per_file;
+			ll_stats_ops_tally(ll_i2sbi(inode),
+					   LPROC_LL_HEAT_READAHEAD, 1);
+		} else {
+			window_pages = min(ras->ras_window_pages +
+					   ras->ras_rpc_pages,
+					   ra->ra_max_pages_per_file);
+		}
 		if (window_pages < ras->ras_rpc_pages)
 			ras->ras_window_pages = window_pages;
 		else
@@ -1171,6 +1195,193 @@ static void ras_detect_read_pattern(struct ll_readahead_state *ras,
 	ras->ras_last_read_end_bytes = pos + count - 1;
 }
 
+/* Pages predicted to be read by the pattern detector */
+struct ras_pattern_extent {
+	pgoff_t	rpe_start_idx;
+	pgoff_t	rpe_end_idx;
+};
+
+/* Delta between read offsets \a back reads ago, 1 is the latest one */
+static inline loff_t ras_pattern_delta(struct ll_readahead_state *ras,
+				       unsigned int back)
+{
+	return ras->ras_pat_deltas[(ras->ras_pat_head + RAS_PATTERN_HISTORY -
+				    back) % RAS_PATTERN_HISTORY];
+}
+
+/*
+ * Find the shortest sequence of deltas which repeats over the whole history,
+ * at least twice, and return its length or 0 if there is none. Checking the
+ * whole history keeps the inner stride of a nested pattern from being taken
+ * for the pattern itself. Plain sequential reads are left to the read-ahead
+ * window.
+ */
+static unsigned int ras_pattern_detect(struct ll_readahead_state *ras)
+{
+	unsigned int period;
+	unsigned int i;
+
+	for (period = 1; period <= RAS_PATTERN_PERIOD_MAX &&
+	     period * 2 <= ras->ras_pat_nr; period++) {
+		for (i = 1; i + period <= ras->ras_pat_nr; i++) {
+			if (ras_pattern_delta(ras, i) !=
+			    ras_pattern_delta(ras, i + period))
+				break;
+		}
+		if (i + period <= ras->ras_pat_nr)
+			continue;
+
+		if (period == 1 &&
+		    (ras_pattern_delta(ras, 1) == ras->ras_pat_count ||
+		     ras_pattern_delta(ras, 1) == 0))
+			return 0;
+
+		return period;
+	}
+
+	return 0;
+}
+
+/*
+ * Feed the read of \a count bytes at \a pos to the pattern detector, which
+ * accounts whether it was predicted, and predicts the next reads once a
+ * repeating sequence of offset deltas is found. Up to RAS_PATTERN_DEPTH reads
+ * are kept prefetched ahead of the application, the extents which still need
+ * to be read are returned in \a ext.
+ *
+ * Simple forward strides are left to the stride read-ahead when it is
+ * active, because it reads ahead in the window rather than per read.
+ *
+ * \retval number of extents in \a ext
+ */
+static unsigned int ras_pattern_update(struct ll_sb_info *sbi,
+				       struct ll_readahead_state *ras,
+				       loff_t pos, size_t count,
+				       struct ras_pattern_extent *ext)
+{
+	unsigned long pages = ((count + PAGE_SIZE - 1) >> PAGE_SHIFT) + 1;
+	unsigned int period = ras->ras_pat_period;
+	unsigned int depth;
+	unsigned int nr = 0;
+	unsigned int i;
+
+	if (period) {
+		bool hit = pos == ras->ras_pat_next_pos &&
+			   count == ras->ras_pat_count;
+
+		if (period == 1)
+			ll_ra_stats_inc_sbi(sbi, hit ?
+					    RA_STAT_PATTERN_STRIDE_HIT :
+					    RA_STAT_PATTERN_STRIDE_MISS);
+		else
+			ll_ra_stats_inc_sbi(sbi, hit ?
+					    RA_STAT_PATTERN_NESTED_HIT :
+					    RA_STAT_PATTERN_NESTED_MISS);
+		if (hit && ras->ras_pat_issued > 0)
+			ras->ras_pat_issued--;
+		else
+			ras->ras_pat_issued = 0;
+	}
+
+	if (count != ras->ras_pat_count) {
+		ras_pattern_reset(ras);
+		ras->ras_pat_count = count;
+	} else {
+		ras->ras_pat_deltas[ras->ras_pat_head] =
+			pos - ras->ras_pat_last_pos;
+		ras->ras_pat_head = (ras->ras_pat_head + 1) %
+				    RAS_PATTERN_HISTORY;
+		if (ras->ras_pat_nr < RAS_PATTERN_HISTORY)
+			ras->ras_pat_nr++;
+	}
+	ras->ras_pat_last_pos = pos;
+
+	period = ras_pattern_detect(ras);
+	if (period == 1 && stride_io_mode(ras))
+		period = 0;
+	if (period != ras->ras_pat_period) {
+		ras->ras_pat_period = period;
+		ras->ras_pat_issued = 0;
+	}
+	if (!period)
+		return 0;
+
+	ras->ras_pat_next_pos = pos + ras_pattern_delta(ras, period);
+
+	depth = min_t(unsigned long, RAS_PATTERN_DEPTH,
+		      sbi->ll_ra_info.ra_max_pages_per_file / pages);
+	for (i = 1; i <= depth; i++) {
+		pgoff_t start_idx;
+		pgoff_t end_idx;
+
+		pos += ras_pattern_delta(ras, period - (i - 1) % period);
+		if (pos < 0)
+			break;
+		if (i <= ras->ras_pat_issued)
+			continue;
+
+		start_idx = pos >> PAGE_SHIFT;
+		end_idx = (pos + count - 1) >> PAGE_SHIFT;
+		/* merge with the previous extent if they touch */
+		if (nr > 0 && start_idx <= ext[nr - 1].rpe_end_idx + 1 &&
+		    end_idx + 1 >= ext[nr - 1].rpe_start_idx) {
+			ext[nr - 1].rpe_start_idx =
+				min(ext[nr - 1].rpe_start_idx, start_idx);
+			ext[nr - 1].rpe_end_idx =
+				max(ext[nr - 1].rpe_end_idx, end_idx);
+			continue;
+		}
+		ext[nr].rpe_start_idx = start_idx;
+		ext[nr].rpe_end_idx = end_idx;
+		nr++;
+	}
+	ras->ras_pat_issued = i - 1;
+
+	RAS_CDEBUG(ras);
+	CDEBUG(D_READA, "pattern period %u next %lld issued %u extents %u\n",
+	       ras->ras_pat_period, ras->ras_pat_next_pos,
+	       ras->ras_pat_issued, nr);
+
+	return nr;
+}
+
+/* Read the extents predicted by the pattern detector asynchronously */
+static void ras_pattern_prefetch(struct file *file,
+				 struct ras_pattern_extent *ext,
+				 unsigned int nr)
+{
+	struct inode *inode = file_inode(file);
+	struct ll_ra_info *ra = &ll_i2sbi(inode)->ll_ra_info;
+	struct ll_readahead_work *lrw;
+	unsigned int i;
+
+	for (i = 0; i < nr; i++) {
+		unsigned long pages = ext[i].rpe_end_idx -
+				      ext[i].rpe_start_idx + 1;
+
+		if (atomic_read(&ra->ra_async_inflight) >
+		    ra->ra_async_max_active)
+			break;
+
+		if (atomic_read(&ra->ra_cur_pages) + pages > ra->ra_max_pages)
+			break;
+
+		/* ll_readahead_work_free() free it */
+		OBD_ALLOC_PTR(lrw);
+		if (!lrw)
+			break;
+
+		atomic_inc(&ra->ra_async_inflight);
+		lrw->lrw_file = get_file(file);
+		lrw->lrw_start_idx = ext[i].rpe_start_idx;
+		lrw->lrw_end_idx = ext[i].rpe_end_idx;
+		lrw->lrw_pattern = true;
+		memcpy(lrw->lrw_jobid, ll_i2info(inode)->lli_jobid,
+		       sizeof(lrw->lrw_jobid));
+		ll_readahead_work_add(inode, lrw);
+	}
+}
+
 void ll_ras_enter(struct file *f, loff_t pos, size_t count)
 {
 	struct ll_file_data *fd = f->private_data;
@@ -1178,6 +1389,8 @@ void ll_ras_enter(struct file *f, loff_t pos, size_t count)
 	struct inode *inode = file_inode(f);
 	unsigned long index = pos >> PAGE_SHIFT;
 	struct ll_sb_info *sbi = ll_i2sbi(inode);
+	struct ras_pattern_extent ext[RAS_PATTERN_DEPTH];
+	unsigned int nr = 0;
 
 	spin_lock(&ras->ras_lock);
 	ras->ras_requests++;
@@ -1213,8 +1426,13 @@ void ll_ras_enter(struct file *f, loff_t pos, size_t count)
 		}
 	}
 	ras_detect_read_pattern(ras, sbi, pos, count, false);
+	if (ll_readahead_enabled(sbi))
+		nr = ras_pattern_update(sbi, ras, pos, count, ext);
 out_unlock:
 	spin_unlock(&ras->ras_lock);
+
+	if (nr > 0)
+		ras_pattern_prefetch(f, ext, nr);
 }
 
 static bool index_in_stride_window(struct ll_readahead_state *ras,
@@ -1830,8 +2048,8 @@ int ll_readpage(struct file *file, struct page *vmpage)
 	 * with lockless i/o, and buffered requires LDLM locking, so in
 	 * this case we must restart without lockless.
 	 */
-	if (file->f_flags & O_DIRECT &&
-	    lcc && lcc->lcc_type == LCC_RW &&
+	if (lcc && lcc->lcc_type == LCC_RW &&
+	    ll_iocb_direct(vvp_env_io(env)->vui_iocb) &&
 	    !io->ci_dio_lock) {
 		unlock_page(vmpage);
 		io->ci_dio_lock = 1;
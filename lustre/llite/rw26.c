@@ -316,12 +316,15 @@ struct ll_dio_pages {
 	struct cl_dio_aio	*ldp_aio;
 	/*
 	 * page array to be written. we don't support
-	 * partial pages except the last one.
+	 * partial pages except the first and the last one.
 	 */
 	struct page		**ldp_pages;
 	/** # of pages in the array. */
 	size_t			ldp_count;
-	/* the file offset of the first page. */
+	/*
+	 * the file offset of the data, if it isn't page aligned the data
+	 * starts at the same offset in the first page.
+	 */
 	loff_t			ldp_file_offset;
 };
 
@@ -343,7 +346,10 @@ ll_direct_rw_pages(const struct lu_env *env, struct cl_io *io, size_t size,
 
 	cl_2queue_init(queue);
 	for (i = 0; i < pv->ldp_count; i++) {
-		LASSERT(!(offset & (PAGE_SIZE - 1)));
+		/* only the first page may start in the middle */
+		size_t from = offset & ~PAGE_MASK;
+		size_t to = min_t(size_t, from + size, page_size);
+
 		page = cl_page_find(env, obj, cl_index(obj, offset),
 				    pv->ldp_pages[i], CPT_TRANSIENT);
 		if (IS_ERR(page)) {
@@ -373,13 +379,13 @@ ll_direct_rw_pages(const struct lu_env *env, struct cl_io *io, size_t size,
 		 * Set page clip to tell transfer formation engine
 		 * that page has to be sent even if it is beyond KMS.
 		 */
-		cl_page_clip(env, page, 0, min(size, page_size));
+		cl_page_clip(env, page, from, to);
 		++io_pages;
 
 		/* drop the reference count for cl_page_find */
 		cl_page_put(env, page);
-		offset += page_size;
-		size -= page_size;
+		offset += to - from;
+		size -= to - from;
 	}
 	if (rc == 0 && io_pages > 0) {
 		int iot = rw == READ ? CRT_READ : CRT_WRITE;
@@ -430,6 +436,487 @@ ll_direct_rw_pages(const struct lu_env *env, struct cl_io *io, size_t size,
 #define MAX_DIO_SIZE ((MAX_MALLOC / sizeof(struct brw_page) * PAGE_SIZE) & \
 		      ~((size_t)DT_MAX_BRW_SIZE - 1))
 
+#if defined(HAVE_DIO_ITER)
+/* Amount of data copied through bounce pages for each unaligned DIO round */
+#define LL_DIO_BOUNCE_SIZE	(4U << 20)
+/* Sync rounds kept in flight, so that copying overlaps with the RPCs */
+#define LL_DIO_BOUNCE_DEPTH	2
+
+/* part of the user buffer the data of an async read is copied to */
+struct ll_dio_uvec {
+	struct page		*ldu_page;
+	unsigned int		 ldu_off;
+	unsigned int		 ldu_len;
+};
+
+/* one round of direct IO through bounce pages */
+struct ll_dio_bounce {
+	/* anchor and cl_pages of the round */
+	struct cl_dio_aio	 ldb_aio;
+	struct list_head	 ldb_list;
+	struct ll_sb_info	*ldb_sbi;
+	struct page		**ldb_pages;
+	int			 ldb_npages;
+	/* the data starts at ldb_pos & ~PAGE_MASK in the first page */
+	loff_t			 ldb_pos;
+	size_t			 ldb_count;
+	/* async rounds hold a reference on the AIO, and are finished by
+	 * ll_dio_wq after their RPCs complete
+	 */
+	struct cl_dio_aio	*ldb_parent;
+	struct work_struct	 ldb_work;
+	/* pinned user buffer of an async read */
+	struct ll_dio_uvec	*ldb_uvecs;
+	int			 ldb_nuvecs;
+};
+
+static void ll_free_bounce_pages(struct page **pages, int npages)
+{
+	int i;
+
+	/* cl_pages hold their own reference until the transfer is done */
+	for (i = 0; i < npages; i++) {
+		if (!pages[i])
+			break;
+		put_page(pages[i]);
+	}
+	OBD_FREE_PTR_ARRAY_LARGE(pages, npages);
+}
+
+static struct page **ll_alloc_bounce_pages(int npages)
+{
+	struct page **pages;
+	int i;
+
+	OBD_ALLOC_PTR_ARRAY_LARGE(pages, npages);
+	if (!pages)
+		return NULL;
+
+	for (i = 0; i < npages; i++) {
+		pages[i] = alloc_page(GFP_NOFS);
+		if (!pages[i]) {
+			ll_free_bounce_pages(pages, npages);
+			return NULL;
+		}
+	}
+
+	return pages;
+}
+
+static bool ll_dio_bounce_try_reserve(struct ll_sb_info *sbi, int npages)
+{
+	int cur;
+
+	do {
+		cur = atomic_read(&sbi->ll_dio_bounce_pages);
+		/* a single round can always go, so no IO gets stuck */
+		if (cur > 0 && cur + npages > sbi->ll_dio_bounce_max)
+			return false;
+	} while (atomic_cmpxchg(&sbi->ll_dio_bounce_pages, cur,
+				cur + npages) != cur);
+
+	return true;
+}
+
+/*
+ * Reserve @npages bounce pages out of ll_dio_bounce_max. If @wait is false,
+ * return false instead of waiting for other rounds to complete.
+ */
+static bool ll_dio_bounce_reserve(struct ll_sb_info *sbi, int npages,
+				  bool wait)
+{
+	if (ll_dio_bounce_try_reserve(sbi, npages))
+		return true;
+
+	if (!wait)
+		return false;
+
+	wait_event_idle(sbi->ll_dio_bounce_waitq,
+			ll_dio_bounce_try_reserve(sbi, npages));
+	return true;
+}
+
+static void ll_dio_bounce_unreserve(struct ll_sb_info *sbi, int npages)
+{
+	atomic_sub(npages, &sbi->ll_dio_bounce_pages);
+	wake_up_all(&sbi->ll_dio_bounce_waitq);
+}
+
+static void ll_dio_bounce_end(const struct lu_env *env,
+			      struct cl_sync_io *anchor);
+static void ll_dio_bounce_work_fn(struct work_struct *work);
+
+/* the caller has reserved the bounce pages of the round */
+static struct ll_dio_bounce *ll_dio_bounce_alloc(struct ll_sb_info *sbi,
+						 struct kiocb *iocb,
+						 loff_t pos, size_t count,
+						 int npages)
+{
+	struct ll_dio_bounce *ldb;
+
+	OBD_ALLOC_PTR(ldb);
+	if (!ldb)
+		goto out_unreserve;
+
+	ldb->ldb_sbi = sbi;
+	ldb->ldb_pos = pos;
+	ldb->ldb_count = count;
+	ldb->ldb_npages = npages;
+	ldb->ldb_pages = ll_alloc_bounce_pages(npages);
+	if (!ldb->ldb_pages) {
+		OBD_FREE_PTR(ldb);
+		goto out_unreserve;
+	}
+
+	/* sync rounds are waited for and released by the submitter */
+	cl_sync_io_init_notify(&ldb->ldb_aio.cda_sync, 1, NULL,
+			       is_sync_kiocb(iocb) ? NULL : ll_dio_bounce_end);
+	cl_page_list_init(&ldb->ldb_aio.cda_pages);
+	ldb->ldb_aio.cda_iocb = iocb;
+	INIT_LIST_HEAD(&ldb->ldb_list);
+	INIT_WORK(&ldb->ldb_work, ll_dio_bounce_work_fn);
+
+	return ldb;
+
+out_unreserve:
+	ll_dio_bounce_unreserve(sbi, npages);
+	return NULL;
+}
+
+static void ll_dio_bounce_unpin(struct ll_dio_bounce *ldb)
+{
+	int i;
+
+	for (i = 0; i < ldb->ldb_nuvecs; i++)
+		put_page(ldb->ldb_uvecs[i].ldu_page);
+	OBD_FREE_PTR_ARRAY_LARGE(ldb->ldb_uvecs, ldb->ldb_nuvecs);
+	ldb->ldb_uvecs = NULL;
+	ldb->ldb_nuvecs = 0;
+}
+
+static void ll_dio_bounce_free(struct ll_dio_bounce *ldb)
+{
+	if (ldb->ldb_uvecs)
+		ll_dio_bounce_unpin(ldb);
+	ll_free_bounce_pages(ldb->ldb_pages, ldb->ldb_npages);
+	ll_dio_bounce_unreserve(ldb->ldb_sbi, ldb->ldb_npages);
+	OBD_FREE_PTR(ldb);
+}
+
+/* copy the data of @ldb between @iter and the bounce pages */
+static int ll_dio_bounce_copy(struct ll_dio_bounce *ldb, struct iov_iter *iter,
+			      int rw)
+{
+	size_t poff = ldb->ldb_pos & ~PAGE_MASK;
+	size_t left = ldb->ldb_count;
+	int i;
+
+	for (i = 0; left > 0; i++) {
+		size_t bytes = min_t(size_t, left, PAGE_SIZE - poff);
+		size_t copied;
+
+		if (rw == WRITE)
+			copied = copy_page_from_iter(ldb->ldb_pages[i], poff,
+						     bytes, iter);
+		else
+			copied = copy_page_to_iter(ldb->ldb_pages[i], poff,
+						   bytes, iter);
+		if (copied != bytes)
+			return -EFAULT;
+		left -= bytes;
+		poff = 0;
+	}
+
+	return 0;
+}
+
+/*
+ * Pin the part of the user buffer an async read of @ldb is copied to, the
+ * copy is done from ll_dio_wq, which can't access the submitter's memory.
+ */
+static int ll_dio_bounce_pin(struct ll_dio_bounce *ldb, struct iov_iter *iter)
+{
+	struct iov_iter tmp = *iter;
+	size_t left = ldb->ldb_count;
+	int nuvecs;
+
+	iov_iter_truncate(&tmp, left);
+	nuvecs = iov_iter_npages(&tmp, INT_MAX);
+	OBD_ALLOC_PTR_ARRAY_LARGE(ldb->ldb_uvecs, nuvecs);
+	if (!ldb->ldb_uvecs)
+		return -ENOMEM;
+
+	while (left > 0) {
+		struct page **pages;
+		size_t start;
+		ssize_t bytes;
+		int i;
+
+		bytes = iov_iter_get_pages_alloc(iter, &pages, left, &start);
+		if (bytes <= 0)
+			return bytes < 0 ? bytes : -EFAULT;
+
+		iov_iter_advance(iter, bytes);
+		left -= bytes;
+		for (i = 0; bytes > 0; i++) {
+			struct ll_dio_uvec *uv;
+
+			LASSERT(ldb->ldb_nuvecs < nuvecs);
+			uv = &ldb->ldb_uvecs[ldb->ldb_nuvecs++];
+			uv->ldu_page = pages[i];
+			uv->ldu_off = start;
+			uv->ldu_len = min_t(size_t, bytes, PAGE_SIZE - start);
+			bytes -= uv->ldu_len;
+			start = 0;
+		}
+		kvfree(pages);
+	}
+
+	return 0;
+}
+
+/* copy the data of an async read to the pinned user buffer */
+static void ll_dio_bounce_copy_out(struct ll_dio_bounce *ldb)
+{
+	size_t poff = ldb->ldb_pos & ~PAGE_MASK;
+	int i = 0;
+	int j;
+
+	for (j = 0; j < ldb->ldb_nuvecs; j++) {
+		struct ll_dio_uvec *uv = &ldb->ldb_uvecs[j];
+		unsigned int off = 0;
+		char *dst;
+
+		dst = kmap(uv->ldu_page);
+		while (off < uv->ldu_len) {
+			size_t bytes = min_t(size_t, uv->ldu_len - off,
+					     PAGE_SIZE - poff);
+
+			memcpy(dst + uv->ldu_off + off,
+			       kmap(ldb->ldb_pages[i]) + poff, bytes);
+			kunmap(ldb->ldb_pages[i]);
+			off += bytes;
+			poff += bytes;
+			if (poff == PAGE_SIZE) {
+				poff = 0;
+				i++;
+			}
+		}
+		kunmap(uv->ldu_page);
+		set_page_dirty_lock(uv->ldu_page);
+	}
+}
+
+/* release the transient cl_pages of a round, as cl_aio_end() does */
+static void ll_dio_bounce_release(const struct lu_env *env,
+				  struct ll_dio_bounce *ldb)
+{
+	struct cl_page_list *plist = &ldb->ldb_aio.cda_pages;
+
+	while (plist->pl_nr > 0) {
+		struct cl_page *page = cl_page_list_first(plist);
+
+		cl_page_get(page);
+		cl_page_list_del(env, plist, page);
+		cl_page_delete(env, page);
+		cl_page_put(env, page);
+	}
+}
+
+/*
+ * All RPCs of an async round are done. This is called under the anchor
+ * lock, so the rest is left to ll_dio_wq.
+ */
+static void ll_dio_bounce_end(const struct lu_env *env,
+			      struct cl_sync_io *anchor)
+{
+	struct ll_dio_bounce *ldb = container_of(anchor, struct ll_dio_bounce,
+						 ldb_aio.cda_sync);
+
+	ll_dio_bounce_release(env, ldb);
+	queue_work(ldb->ldb_sbi->ll_dio_wq, &ldb->ldb_work);
+}
+
+static void ll_dio_bounce_work_fn(struct work_struct *work)
+{
+	struct ll_dio_bounce *ldb = container_of(work, struct ll_dio_bounce,
+						 ldb_work);
+	struct cl_sync_io *anchor = &ldb->ldb_aio.cda_sync;
+	struct cl_dio_aio *parent = ldb->ldb_parent;
+	struct lu_env *env;
+	int rc;
+
+	/* cl_sync_io_note() may still hold the anchor lock */
+	spin_lock(&anchor->csi_waitq.lock);
+	rc = anchor->csi_sync_rc;
+	spin_unlock(&anchor->csi_waitq.lock);
+
+	if (rc == 0 && ldb->ldb_uvecs)
+		ll_dio_bounce_copy_out(ldb);
+	ll_dio_bounce_free(ldb);
+
+	/* this may complete the AIO, cl_aio_end() doesn't sleep */
+	env = cl_env_percpu_get();
+	cl_sync_io_note(env, &parent->cda_sync, rc);
+	cl_env_percpu_put(env);
+}
+
+/*
+ * Wait for the oldest sync round and free it. Read data is copied to @iter
+ * and the round is counted in @tot_bytes, unless @tot_bytes is NULL because
+ * an earlier round already failed.
+ */
+static int ll_dio_bounce_wait(const struct lu_env *env,
+			      struct ll_dio_bounce *ldb, struct iov_iter *iter,
+			      int rw, ssize_t *tot_bytes)
+{
+	int rc;
+
+	rc = cl_sync_io_wait(env, &ldb->ldb_aio.cda_sync, 0);
+	ll_dio_bounce_release(env, ldb);
+	if (rc == 0 && tot_bytes && rw == READ)
+		rc = ll_dio_bounce_copy(ldb, iter, READ);
+	if (rc == 0 && tot_bytes)
+		*tot_bytes += ldb->ldb_count;
+
+	list_del(&ldb->ldb_list);
+	ll_dio_bounce_free(ldb);
+
+	return rc;
+}
+
+/*
+ * Direct IO from/to a user buffer which isn't page aligned, or at a file
+ * offset which isn't page aligned. The data is copied through page aligned
+ * kernel pages at the same in-page offset as in the file, so only the head
+ * and tail pages of the IO are partial, and the bulk RPCs are built from
+ * those pages without going through the page cache.
+ *
+ * The IO is done in rounds of LL_DIO_BOUNCE_SIZE, only the first round may
+ * start and only the last one may end in the middle of a page. The bounce
+ * pages of all rounds in flight are limited by ll_dio_bounce_max.
+ *
+ * For sync IO LL_DIO_BOUNCE_DEPTH rounds are in flight at once, so the copy
+ * of one round overlaps with the RPCs of the other, and read data is copied
+ * out in order as the rounds complete. Async writes are copied at submission
+ * time. Async reads pin the user buffer instead, and the data is copied to
+ * it by ll_dio_wq before the round completes the AIO.
+ */
+static ssize_t ll_direct_IO_bounce(const struct lu_env *env, struct cl_io *io,
+				   struct iov_iter *iter, int rw,
+				   struct inode *inode, loff_t file_offset,
+				   struct cl_dio_aio *aio, ssize_t *tot_bytes)
+{
+	struct ll_sb_info *sbi = ll_i2sbi(inode);
+	struct kiocb *iocb = aio->cda_iocb;
+	bool sync = is_sync_kiocb(iocb);
+	struct ll_dio_bounce *ldb;
+	struct ll_dio_bounce *tmp;
+	LIST_HEAD(inflight);
+	size_t left = iov_iter_count(iter);
+	loff_t pos = file_offset;
+	int nr_inflight = 0;
+	ssize_t rc = 0;
+	int rc2;
+
+	ENTRY;
+
+	while (left > 0) {
+		struct ll_dio_pages pvec = { 0 };
+		size_t count;
+		int npages;
+
+		count = min_t(size_t, left,
+			      LL_DIO_BOUNCE_SIZE - (pos & ~PAGE_MASK));
+		if (rw == READ) {
+			if (pos >= i_size_read(inode))
+				break;
+
+			if (pos + count > i_size_read(inode))
+				count = i_size_read(inode) - pos;
+		}
+		npages = DIV_ROUND_UP((pos & ~PAGE_MASK) + count, PAGE_SIZE);
+
+		/* finish own sync rounds rather than wait for others while
+		 * holding their bounce pages
+		 */
+		while (!ll_dio_bounce_reserve(sbi, npages, nr_inflight == 0)) {
+			ldb = list_first_entry(&inflight, struct ll_dio_bounce,
+					       ldb_list);
+			rc = ll_dio_bounce_wait(env, ldb, iter, rw, tot_bytes);
+			nr_inflight--;
+			if (rc < 0)
+				GOTO(out, rc);
+		}
+
+		ldb = ll_dio_bounce_alloc(sbi, iocb, pos, count, npages);
+		if (!ldb)
+			GOTO(out, rc = -ENOMEM);
+
+		if (rw == WRITE)
+			rc = ll_dio_bounce_copy(ldb, iter, WRITE);
+		else if (!sync)
+			rc = ll_dio_bounce_pin(ldb, iter);
+		if (rc < 0) {
+			ll_dio_bounce_free(ldb);
+			GOTO(out, rc);
+		}
+
+		pvec.ldp_aio = &ldb->ldb_aio;
+		pvec.ldp_pages = ldb->ldb_pages;
+		pvec.ldp_count = ldb->ldb_npages;
+		pvec.ldp_file_offset = pos;
+
+		if (!sync) {
+			/* released by ll_dio_bounce_work_fn() */
+			ldb->ldb_parent = aio;
+			atomic_inc(&aio->cda_sync.csi_sync_nr);
+		}
+
+		rc = ll_direct_rw_pages(env, io, count, rw, inode, &pvec);
+
+		/* drop the extra reference, an error is kept in the anchor
+		 * and passed on when the round is finished
+		 */
+		cl_sync_io_note(env, &ldb->ldb_aio.cda_sync, rc);
+		if (!sync) {
+			if (rc < 0)
+				GOTO(out, rc);
+			*tot_bytes += count;
+		} else {
+			list_add_tail(&ldb->ldb_list, &inflight);
+			if (rc < 0)
+				GOTO(out, rc = 0);
+
+			if (++nr_inflight >= LL_DIO_BOUNCE_DEPTH) {
+				ldb = list_first_entry(&inflight,
+						       struct ll_dio_bounce,
+						       ldb_list);
+				rc = ll_dio_bounce_wait(env, ldb, iter, rw,
+							tot_bytes);
+				nr_inflight--;
+				if (rc < 0)
+					GOTO(out, rc);
+			}
+		}
+
+		left -= count;
+		pos += count;
+	}
+
+	EXIT;
+out:
+	list_for_each_entry_safe(ldb, tmp, &inflight, ldb_list) {
+		rc2 = ll_dio_bounce_wait(env, ldb, iter, rw,
+					 rc == 0 ? tot_bytes : NULL);
+		if (rc == 0)
+			rc = rc2;
+	}
+
+	return rc;
+}
+#endif /* HAVE_DIO_ITER */
+
 static ssize_t
 ll_direct_IO_impl(struct kiocb *iocb, struct iov_iter *iter, int rw)
 {
@@ -443,14 +930,26 @@ ll_direct_IO_impl(struct kiocb *iocb, struct iov_iter *iter, int rw)
 	ssize_t tot_bytes = 0, result = 0;
 	loff_t file_offset = iocb->ki_pos;
 	struct vvp_io *vio;
+	bool unaligned = false;
 
 	/* Check EOF by ourselves */
 	if (rw == READ && file_offset >= i_size_read(inode))
 		return 0;
 
-	/* FIXME: io smaller than PAGE_SIZE is broken on ia64 ??? */
-	if (file_offset & ~PAGE_MASK)
+	/*
+	 * An IO at a file offset which isn't page aligned has partial head
+	 * and tail pages, so it has to go through bounce pages. This can't
+	 * be done for encrypted files, which are encrypted in whole pages.
+	 */
+	if (file_offset & ~PAGE_MASK) {
+#if defined(HAVE_DIO_ITER)
+		if (IS_ENCRYPTED(inode))
+			RETURN(-EINVAL);
+		unaligned = true;
+#else
 		RETURN(-EINVAL);
+#endif
+	}
 
 	CDEBUG(D_VFSTRACE, "VFS Op:inode="DFID"(%p), size=%zd (max %lu), "
 	       "offset=%lld=%llx, pages %zd (max %lu)\n",
@@ -458,9 +957,16 @@ ll_direct_IO_impl(struct kiocb *iocb, struct iov_iter *iter, int rw)
 	       file_offset, file_offset, count >> PAGE_SHIFT,
 	       MAX_DIO_SIZE >> PAGE_SHIFT);
 
-	/* Check that all user buffers are aligned as well */
-	if (ll_iov_iter_alignment(iter) & ~PAGE_MASK)
+	/* Check that all user buffers are aligned as well, otherwise the data
+	 * has to go through bounce pages.
+	 */
+	if (ll_iov_iter_alignment(iter) & ~PAGE_MASK) {
+#if defined(HAVE_DIO_ITER)
+		unaligned = true;
+#else
 		RETURN(-EINVAL);
+#endif
+	}
 
 	lcc = ll_cl_find(file);
 	if (lcc == NULL)
@@ -476,6 +982,16 @@ ll_direct_IO_impl(struct kiocb *iocb, struct iov_iter *iter, int rw)
 	LASSERT(aio);
 	LASSERT(aio->cda_iocb == iocb);
 
+#if defined(HAVE_DIO_ITER)
+	if (unaligned) {
+		result = ll_direct_IO_bounce(env, io, iter, rw, inode,
+					     file_offset, aio, &tot_bytes);
+		ll_stats_ops_tally(ll_i2sbi(inode), LPROC_LL_DIO_BOUNCE,
+				   tot_bytes);
+		GOTO(out, result);
+	}
+#endif
+
 	while (iov_iter_count(iter)) {
 		struct ll_dio_pages pvec = { .ldp_aio = aio };
 		struct page **pages;
@@ -686,7 +1202,7 @@ static int ll_write_begin(struct file *file, struct address_space *mapping,
 	env = lcc->lcc_env;
 	io  = lcc->lcc_io;
 
-	if (file->f_flags & O_DIRECT) {
+	if (ll_iocb_direct(vvp_env_io(env)->vui_iocb)) {
 		/* direct IO failed because it couldn't clean up cached pages,
 		 * this causes a problem for mirror write because the cached
 		 * page may belong to another mirror, which will result in
@@ -358,6 +358,23 @@ static void vvp_io_fini(const struct lu_env *env, const struct cl_io_slice *ios)
 		GOTO(out, 0);
 	}
 
+	if (io->ci_need_pccro_clear) {
+		struct lu_extent ext = { .e_start = 0,
+					 .e_end = OBD_OBJECT_EOF };
+
+		io->ci_need_pccro_clear = 0;
+
+		CDEBUG(D_VFSTRACE, DFID" clear RO-PCC state, type %u\n",
+		       PFID(lu_object_fid(&obj->co_lu)), io->ci_type);
+
+		rc = ll_layout_write_intent(inode, LAYOUT_INTENT_PCCRO_CLEAR,
+					    &ext);
+		io->ci_result = rc;
+		if (!rc)
+			io->ci_need_restart = 1;
+		GOTO(out, rc);
+	}
+
 	/**
 	 * dynamic layout change needed, send layout intent
 	 * RPC.
@@ -571,8 +588,7 @@ static int vvp_io_rw_lock(const struct lu_env *env, struct cl_io *io,
 			io->ci_dio_lock = 1;
 
 		if (ll_file_nolock(vio->vui_fd->fd_file) ||
-		    (vio->vui_fd->fd_file->f_flags & O_DIRECT &&
-		     !io->ci_dio_lock))
+		    (ll_iocb_direct(vio->vui_iocb) && !io->ci_dio_lock))
 			ast_flags |= CEF_NEVER;
 	}
 
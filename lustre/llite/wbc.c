@@ -0,0 +1,769 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ * Metadata write-back cache
+ *
+ * A directory created by this client with write-back cache enabled is taken
+ * with an EX ibits lock on its FID (allocated by the client before the create
+ * is sent), so no other client can see or modify the directory until the lock
+ * is revoked.  No reference is held on the lock during the create RPC, so
+ * that the MDT can revoke it (e.g. to lock a remote directory under DNE), in
+ * which case the directory is simply not owned.  While the lock is held the
+ * directory is "owned":
+ *
+ * - mkdir and mknod in it are done locally: the FID is allocated by the
+ *   client, the inode is instantiated from the attributes the client knows
+ *   and the create RPC is queued to ll_wbc_wq.  The syscall returns without
+ *   waiting for the MDT.  A queued mkdir takes the EX lock on the new
+ *   directory before its create is sent, so whole trees are written back.
+ *   The lookup is skipped by the VFS for these, so a name not in the dcache
+ *   is looked up on the MDT first, unless the directory itself is not yet
+ *   there.  The dentries of queued creates are pinned, so the dcache and
+ *   the MDT together always know all names in the directory.
+ *
+ * - creates in it (both the queued ones and open(O_CREAT), symlink) are sent
+ *   with MDS_WBC_LOCKLESS and the handle of the EX lock, the MDT does not
+ *   take the parent PDO lock, and the lock is not cancelled by ELC, see
+ *   mdt_wbc_parent_locked().
+ *
+ * The inode of a queued create is marked LLIF_WBC_PENDING.  Operations that
+ * need the object on the MDT (open, setattr, xattr, unlink, rename, link)
+ * wait for the create to finish and get its error, if any.  Readdir and
+ * lookup of uncached names in the directory wait for all queued creates in
+ * it.  The attributes are reconciled with the MDT reply once the create is
+ * done, for example a default ACL of the parent may change the mode.
+ *
+ * The MDT checks quota and permissions only when the create is sent, after
+ * mkdir or mknod returned.  A failed create is dropped from the dcache and
+ * its error is kept in the parent directory, the next fsync or close of the
+ * directory returns it, like write errors of cached pages.
+ *
+ * When the EX lock is revoked (another client accesses the directory), the
+ * ownership is dropped and the lock is released by ll_wbc_flush_wq once the
+ * queued creates are sent, so the blocking callback thread does not wait for
+ * them.  A lock cancelled otherwise flushes the queued creates itself.
+ */
+
+#define DEBUG_SUBSYSTEM S_LLITE
+
+#include <linux/cred.h>
+#include <linux/fs_struct.h>
+#include <linux/workqueue.h>
+#include <lustre_dlm.h>
+#include "llite_internal.h"
+
+/* queued create */
+struct ll_wbc_work {
+	struct work_struct	 lww_work;
+	/* credentials of the creating process */
+	const struct cred	*lww_cred;
+	struct inode		*lww_dir;
+	struct inode		*lww_inode;
+	/* pinned until the create is on the MDT, see ll_wbc_lookup() */
+	struct dentry		*lww_dentry;
+	struct lu_fid		 lww_fid;
+	__u32			 lww_mdt;
+	__u32			 lww_opc;
+	umode_t			 lww_mode;
+	__u32			 lww_umask;
+	int			 lww_rdev;
+	s64			 lww_time;
+	int			 lww_namelen;
+	char			 lww_name[0];
+};
+
+/* release of a revoked EX lock */
+struct ll_wbc_flush_work {
+	struct work_struct	 lwf_work;
+	struct inode		*lwf_dir;
+	struct lustre_handle	 lwf_lockh;
+};
+
+/**
+ * Check whether creates in \a dir can be written back.
+ *
+ * The directory must be owned by this client, or be created by the
+ * write-back cache itself and not yet on the MDT.  Striped directories,
+ * encryption and security labels are not supported.
+ */
+bool ll_wbc_may_create(struct inode *dir)
+{
+	struct ll_inode_info *lli = ll_i2info(dir);
+	struct ll_sb_info *sbi = ll_i2sbi(dir);
+
+	if (!sbi->ll_wbc_enabled || !S_ISDIR(dir->i_mode))
+		return false;
+
+	if (!test_bit(LLIF_WBC_OWNED, &lli->lli_flags) &&
+	    !test_bit(LLIF_WBC_PENDING, &lli->lli_flags))
+		return false;
+
+	if (sbi->ll_flags & LL_SBI_FILE_SECCTX || IS_ENCRYPTED(dir))
+		return false;
+
+	return lli->lli_lsm_md == NULL && lli->lli_default_lsm_md == NULL;
+}
+
+/**
+ * Mark a create in \a dir to be done under the EX lock held on \a dir.
+ *
+ * The handle of the lock is packed only if the lock is still granted, it is
+ * fine to use a lock being revoked because it is released only after the
+ * queued creates are sent, see ll_wbc_lock_blocking().  If there is no lock
+ * the MDT takes the parent lock as usual.
+ */
+void ll_wbc_prep_create(struct inode *dir, struct md_op_data *op_data,
+			__u32 umask)
+{
+	struct ll_inode_info *lli = ll_i2info(dir);
+	struct lustre_handle lockh;
+	struct ldlm_lock *lock;
+
+	op_data->op_bias |= MDS_WBC_LOCKLESS;
+	op_data->op_umask = umask;
+	memset(&op_data->op_open_handle, 0, sizeof(op_data->op_open_handle));
+
+	spin_lock(&lli->lli_lock);
+	lockh = lli->lli_wbc_lockh;
+	spin_unlock(&lli->lli_lock);
+
+	if (!lustre_handle_is_used(&lockh))
+		return;
+
+	lock = ldlm_handle2lock(&lockh);
+	if (lock == NULL)
+		return;
+
+	if (lock->l_granted_mode == LCK_EX)
+		op_data->op_open_handle = lock->l_remote_handle;
+	LDLM_LOCK_PUT(lock);
+}
+
+/*
+ * Enqueue the EX lock owning the directory \a fid. The reference is dropped
+ * at once, the lock is kept because it is not in LRU, until it is revoked.
+ */
+static int ll_wbc_lock(struct ll_sb_info *sbi, const struct lu_fid *fid,
+		       struct lustre_handle *lockh)
+{
+	struct ldlm_enqueue_info einfo = {
+		.ei_type	= LDLM_IBITS,
+		.ei_mode	= LCK_EX,
+		.ei_cb_bl	= ll_md_blocking_ast,
+		.ei_cb_cp	= ldlm_completion_ast,
+	};
+	union ldlm_policy_data policy = {
+		.l_inodebits = { MDS_INODELOCK_LOOKUP | MDS_INODELOCK_UPDATE |
+				 MDS_INODELOCK_PERM },
+	};
+	struct md_op_data *op_data;
+	int rc;
+
+	OBD_ALLOC_PTR(op_data);
+	if (op_data == NULL)
+		return -ENOMEM;
+
+	op_data->op_fid1 = *fid;
+	/* the lock is dropped only when it is revoked, not by LRU */
+	rc = md_enqueue(sbi->ll_md_exp, &einfo, &policy, op_data, lockh,
+			LDLM_FL_NO_LRU);
+	OBD_FREE_PTR(op_data);
+	if (rc) {
+		memset(lockh, 0, sizeof(*lockh));
+		return rc;
+	}
+
+	ldlm_lock_decref(lockh, LCK_EX);
+	return 0;
+}
+
+/**
+ * Prepare a plain mkdir in a directory not owned by this client so that the
+ * new directory is owned.
+ *
+ * The FID of the new directory is allocated and the EX lock is enqueued on
+ * it before the create is sent, without a reference held.  If anything fails
+ * the mkdir is done as usual.
+ *
+ * \param[in] dir	parent directory
+ * \param[in] op_data	create op_data
+ * \param[out] lockh	EX lock handle, unused if the directory is not owned
+ *
+ * \retval 0		success
+ * \retval negative	FID allocation error
+ */
+int ll_wbc_mkdir_owned(struct inode *dir, struct md_op_data *op_data,
+		       struct lustre_handle *lockh)
+{
+	struct ll_sb_info *sbi = ll_i2sbi(dir);
+	int mdt;
+	int rc;
+
+	ENTRY;
+
+	memset(lockh, 0, sizeof(*lockh));
+	if (!sbi->ll_wbc_enabled || op_data->op_mea1 != NULL ||
+	    op_data->op_default_mea1 != NULL)
+		RETURN(0);
+
+	/* plain directory is created on the MDT of its parent */
+	mdt = ll_get_mdt_idx_by_fid(sbi, ll_inode2fid(dir));
+	if (mdt < 0)
+		RETURN(0);
+
+	op_data->op_mds = mdt;
+	rc = obd_fid_alloc(NULL, sbi->ll_md_exp, &op_data->op_fid2, op_data);
+	if (rc)
+		RETURN(rc);
+
+	rc = ll_wbc_lock(sbi, &op_data->op_fid2, lockh);
+	if (rc) {
+		CDEBUG(D_INODE, "%s: cannot lock new dir "DFID": rc = %d\n",
+		       sbi->ll_fsname, PFID(&op_data->op_fid2), rc);
+		fid_zero(&op_data->op_fid2);
+		RETURN(0);
+	}
+
+	op_data->op_flags |= MF_FID2_ALLOCATED;
+	RETURN(0);
+}
+
+/**
+ * Finish the ownership of directory \a inode after its create.
+ *
+ * The directory is owned only if the EX lock was not revoked during the
+ * create.
+ *
+ * \param[in] inode	new directory, NULL if the create failed
+ * \param[in,out] lockh	EX lock enqueued by ll_wbc_mkdir_owned(), the
+ *			handle is cleared
+ * \param[in] mdt	MDT index of the directory
+ */
+void ll_wbc_mkdir_done(struct inode *inode, struct lustre_handle *lockh,
+		       __u32 mdt)
+{
+	struct ll_inode_info *lli;
+	struct ldlm_lock *lock;
+	bool owned;
+
+	if (!lustre_handle_is_used(lockh))
+		return;
+
+	lock = ldlm_handle2lock(lockh);
+	if (lock == NULL)
+		goto out;
+
+	/* the create may be redirected to another MDT with a new FID */
+	owned = inode != NULL &&
+		fid_res_name_eq(ll_inode2fid(inode), &lock->l_resource->lr_name);
+	LDLM_LOCK_PUT(lock);
+
+	/* a lock being revoked can't be referenced */
+	if (!owned || ldlm_lock_addref_try(lockh, LCK_EX) != 0) {
+		CDEBUG(D_INODE, "new dir not owned, lock %#llx released\n",
+		       lockh->cookie);
+		ldlm_cli_cancel(lockh, LCF_ASYNC);
+		goto out;
+	}
+
+	lli = ll_i2info(inode);
+	md_set_lock_data(ll_i2sbi(inode)->ll_md_exp, lockh, inode, NULL);
+	spin_lock(&lli->lli_lock);
+	lli->lli_wbc_lockh = *lockh;
+	lli->lli_wbc_mdt = mdt;
+	set_bit(LLIF_WBC_OWNED, &lli->lli_flags);
+	spin_unlock(&lli->lli_lock);
+	ldlm_lock_decref(lockh, LCK_EX);
+
+	CDEBUG(D_INODE, "dir "DFID" owned with lock %#llx\n",
+	       PFID(ll_inode2fid(inode)), lockh->cookie);
+out:
+	memset(lockh, 0, sizeof(*lockh));
+}
+
+/* the create finished, wake up the waiters */
+static void ll_wbc_complete(struct inode *dir, struct inode *inode, int rc)
+{
+	struct ll_inode_info *plli = ll_i2info(dir);
+	struct ll_inode_info *lli = ll_i2info(inode);
+	struct ll_sb_info *sbi = ll_i2sbi(dir);
+
+	if (rc) {
+		CDEBUG(D_INODE, "%s: write-back create of "DFID" failed: "
+		       "rc = %d\n", sbi->ll_fsname, PFID(ll_inode2fid(inode)),
+		       rc);
+		lli->lli_wbc_rc = rc;
+		/* returned by fsync or close of the parent, see
+		 * ll_wbc_dir_rc() */
+		spin_lock(&plli->lli_lock);
+		if (plli->lli_wbc_dir_rc == 0)
+			plli->lli_wbc_dir_rc = rc;
+		spin_unlock(&plli->lli_lock);
+		clear_nlink(inode);
+		if (S_ISDIR(inode->i_mode))
+			drop_nlink(dir);
+		ll_prune_aliases(inode);
+	}
+
+	/* the pages cached for the directory don't have the new entry */
+	truncate_inode_pages(dir->i_mapping, 0);
+
+	clear_bit(LLIF_WBC_PENDING, &lli->lli_flags);
+	smp_mb__after_atomic();
+	atomic_dec(&plli->lli_wbc_pending);
+	atomic_dec(&sbi->ll_wbc_inflight);
+	wake_up_all(&sbi->ll_wbc_waitq);
+}
+
+static void ll_wbc_work_fn(struct work_struct *wk)
+{
+	struct ll_wbc_work *work = container_of(wk, struct ll_wbc_work,
+						lww_work);
+	struct inode *dir = work->lww_dir;
+	struct inode *inode = work->lww_inode;
+	struct ll_sb_info *sbi = ll_i2sbi(dir);
+	struct ptlrpc_request *req = NULL;
+	struct lustre_handle lockh = { 0 };
+	struct md_op_data *op_data;
+	const struct cred *old_cred;
+	int rc;
+
+	ENTRY;
+
+	old_cred = override_creds(work->lww_cred);
+
+	/* the parent may be queued itself */
+	rc = ll_wbc_wait(dir);
+	if (rc)
+		GOTO(out, rc);
+
+	if (S_ISDIR(work->lww_mode)) {
+		rc = ll_wbc_lock(sbi, &work->lww_fid, &lockh);
+		if (rc)
+			CDEBUG(D_INODE, "%s: cannot lock new dir "DFID
+			       ": rc = %d\n", sbi->ll_fsname,
+			       PFID(&work->lww_fid), rc);
+	}
+
+	op_data = ll_prep_md_op_data(NULL, dir, NULL, work->lww_name,
+				     work->lww_namelen, 0, work->lww_opc,
+				     NULL);
+	if (IS_ERR(op_data))
+		GOTO(out_lock, rc = PTR_ERR(op_data));
+
+	op_data->op_fid2 = work->lww_fid;
+	op_data->op_flags |= MF_FID2_ALLOCATED;
+	op_data->op_mds = work->lww_mdt;
+	op_data->op_mod_time = work->lww_time;
+	ll_wbc_prep_create(dir, op_data, work->lww_umask);
+
+	rc = md_create(sbi->ll_md_exp, op_data, NULL, 0, work->lww_mode,
+		       from_kuid(&init_user_ns, current_fsuid()),
+		       from_kgid(&init_user_ns, current_fsgid()),
+		       cfs_curproc_cap_pack(), work->lww_rdev, &req);
+	ll_finish_md_op_data(op_data);
+	if (rc)
+		GOTO(out_lock, rc);
+
+	ll_update_times(req, dir);
+	/* reconcile the local attributes with the MDT ones */
+	rc = ll_prep_inode(&inode, req, NULL, NULL);
+	ptlrpc_req_finished(req);
+
+	EXIT;
+out_lock:
+	if (rc == 0)
+		ll_wbc_mkdir_done(inode, &lockh, work->lww_mdt);
+	else
+		ll_wbc_mkdir_done(NULL, &lockh, 0);
+out:
+	revert_creds(old_cred);
+	ll_wbc_complete(dir, inode, rc);
+
+	put_cred(work->lww_cred);
+	dput(work->lww_dentry);
+	iput(inode);
+	iput(dir);
+	OBD_FREE(work, offsetof(struct ll_wbc_work,
+				lww_name[work->lww_namelen + 1]));
+}
+
+/*
+ * Take a slot for a queued create, the number of queued creates must not
+ * exceed ll_wbc_max_inflight, see LL_WBC_INFLIGHT_MAX
+ */
+static bool ll_wbc_inflight_get(struct ll_sb_info *sbi)
+{
+	int cur = atomic_read(&sbi->ll_wbc_inflight);
+	int old;
+
+	while (cur < sbi->ll_wbc_max_inflight) {
+		old = atomic_cmpxchg(&sbi->ll_wbc_inflight, cur, cur + 1);
+		if (old == cur)
+			return true;
+		cur = old;
+	}
+
+	return false;
+}
+
+/*
+ * Check that \a dchild, which is not in the dcache, doesn't exist on the MDT.
+ *
+ * The names created in \a dir but not yet on the MDT are all in the dcache,
+ * because queued creates pin their dentries, and a directory which is not
+ * on the MDT yet has no other names.
+ */
+static int ll_wbc_lookup(struct inode *dir, struct dentry *dchild)
+{
+	struct ptlrpc_request *req = NULL;
+	struct md_op_data *op_data;
+	int rc;
+
+	if (ll_wbc_pending(dir))
+		return 0;
+
+	op_data = ll_prep_md_op_data(NULL, dir, NULL, dchild->d_name.name,
+				     dchild->d_name.len, 0, LUSTRE_OPC_ANY,
+				     NULL);
+	if (IS_ERR(op_data))
+		return PTR_ERR(op_data);
+
+	op_data->op_valid = OBD_MD_FLID;
+	rc = md_getattr_name(ll_i2sbi(dir)->ll_md_exp, op_data, &req);
+	ll_finish_md_op_data(op_data);
+	ptlrpc_req_finished(req);
+	if (rc == 0)
+		return -EEXIST;
+
+	return rc == -ENOENT ? 0 : rc;
+}
+
+/**
+ * Create \a dchild in the write-back cached directory \a dir.
+ *
+ * The inode is instantiated locally and the create RPC is queued, the
+ * result of the create is returned by the operations on the new inode.
+ *
+ * \param[in] dir	parent directory, ll_wbc_may_create() is true
+ * \param[in] dchild	dentry of the new entry
+ * \param[in] mode	mode of the new inode, as sent to the MDT
+ * \param[in] rdev	device number of a special file
+ * \param[in] opc	LUSTRE_OPC_MKDIR or LUSTRE_OPC_MKNOD
+ *
+ * \retval 0		success
+ * \retval negative	error
+ */
+int ll_wbc_create(struct inode *dir, struct dentry *dchild, umode_t mode,
+		  int rdev, __u32 opc)
+{
+	struct ll_inode_info *plli = ll_i2info(dir);
+	struct ll_sb_info *sbi = ll_i2sbi(dir);
+	int namelen = dchild->d_name.len;
+	struct lustre_md md = { NULL };
+	struct md_op_data *op_data;
+	struct ll_wbc_work *work;
+	struct mdt_body *body;
+	struct inode *inode;
+	s64 now = ktime_get_real_seconds();
+	int rc;
+
+	ENTRY;
+
+	/* the VFS skips the lookup before mkdir and mknod, see ll_lookup_nd() */
+	if (d_unhashed(dchild)) {
+		rc = ll_wbc_lookup(dir, dchild);
+		if (rc)
+			RETURN(rc);
+	}
+
+	rc = wait_event_interruptible(sbi->ll_wbc_waitq,
+				      ll_wbc_inflight_get(sbi));
+	if (rc)
+		RETURN(rc);
+
+	rc = ll_d_init(dchild);
+	if (rc)
+		GOTO(out_put, rc);
+
+	OBD_ALLOC(work, offsetof(struct ll_wbc_work, lww_name[namelen + 1]));
+	if (work == NULL)
+		GOTO(out_put, rc = -ENOMEM);
+
+	OBD_ALLOC_PTR(op_data);
+	if (op_data == NULL)
+		GOTO(out_free, rc = -ENOMEM);
+
+	op_data->op_mds = plli->lli_wbc_mdt;
+	rc = obd_fid_alloc(NULL, sbi->ll_md_exp, &work->lww_fid, op_data);
+	OBD_FREE_PTR(op_data);
+	if (rc)
+		GOTO(out_free, rc);
+
+	OBD_ALLOC_PTR(body);
+	if (body == NULL)
+		GOTO(out_free, rc = -ENOMEM);
+
+	if (dir->i_mode & S_ISGID) {
+		body->mbo_gid = from_kgid(&init_user_ns, dir->i_gid);
+		if (S_ISDIR(mode))
+			mode |= S_ISGID;
+	} else {
+		body->mbo_gid = from_kgid(&init_user_ns, current_fsgid());
+	}
+	body->mbo_fid1 = work->lww_fid;
+	/* the MDT applies the umask unless the parent has a default ACL,
+	 * the mode is reconciled when the create is done */
+	body->mbo_mode = mode & ~current_umask();
+	body->mbo_uid = from_kuid(&init_user_ns, current_fsuid());
+	body->mbo_nlink = S_ISDIR(mode) ? 2 : 1;
+	body->mbo_rdev = rdev;
+	body->mbo_atime = now;
+	body->mbo_mtime = now;
+	body->mbo_ctime = now;
+	body->mbo_valid = OBD_MD_FLID | OBD_MD_FLTYPE | OBD_MD_FLMODE |
+			  OBD_MD_FLUID | OBD_MD_FLGID | OBD_MD_FLNLINK |
+			  OBD_MD_FLRDEV | OBD_MD_FLATIME | OBD_MD_FLMTIME |
+			  OBD_MD_FLCTIME | OBD_MD_FLSIZE | OBD_MD_FLBLOCKS;
+	md.body = body;
+
+	inode = ll_iget(dir->i_sb, cl_fid_build_ino(&work->lww_fid,
+						    ll_need_32bit_api(sbi)),
+			&md);
+	OBD_FREE_PTR(body);
+	if (IS_ERR(inode))
+		GOTO(out_free, rc = PTR_ERR(inode));
+
+	set_bit(LLIF_WBC_PENDING, &ll_i2info(inode)->lli_flags);
+	if (S_ISDIR(mode))
+		ll_i2info(inode)->lli_wbc_mdt = plli->lli_wbc_mdt;
+
+	work->lww_cred = get_current_cred();
+	work->lww_dir = igrab(dir);
+	work->lww_inode = igrab(inode);
+	work->lww_mdt = plli->lli_wbc_mdt;
+	work->lww_opc = opc;
+	work->lww_mode = mode;
+	work->lww_umask = current_umask();
+	work->lww_rdev = rdev;
+	work->lww_time = now;
+	work->lww_namelen = namelen;
+	memcpy(work->lww_name, dchild->d_name.name, namelen);
+	work->lww_name[namelen] = '\0';
+	INIT_WORK(&work->lww_work, ll_wbc_work_fn);
+
+	if (d_unhashed(dchild))
+		d_add(dchild, inode);
+	else
+		d_instantiate(dchild, inode);
+	d_lustre_revalidate(dchild);
+	work->lww_dentry = dget(dchild);
+
+	/* the MDT updates the parent the same way */
+	dir->i_mtime.tv_sec = now;
+	dir->i_ctime.tv_sec = now;
+	if (S_ISDIR(mode))
+		inc_nlink(dir);
+
+	atomic_inc(&plli->lli_wbc_pending);
+	queue_work(sbi->ll_wbc_wq, &work->lww_work);
+	ll_stats_ops_tally(sbi, LPROC_LL_WBC_CREATE, 1);
+
+	RETURN(0);
+
+out_free:
+	OBD_FREE(work, offsetof(struct ll_wbc_work, lww_name[namelen + 1]));
+out_put:
+	atomic_dec(&sbi->ll_wbc_inflight);
+	wake_up_all(&sbi->ll_wbc_waitq);
+	return rc;
+}
+
+/* wait for the create of \a inode and return its result */
+int __ll_wbc_wait(struct inode *inode)
+{
+	struct ll_inode_info *lli = ll_i2info(inode);
+
+	wait_event_idle(ll_i2sbi(inode)->ll_wbc_waitq,
+			!test_bit(LLIF_WBC_PENDING, &lli->lli_flags));
+
+	return lli->lli_wbc_rc;
+}
+
+/* wait for all queued creates in \a dir */
+void ll_wbc_flush(struct inode *dir)
+{
+	struct ll_inode_info *lli = ll_i2info(dir);
+
+	if (!S_ISDIR(dir->i_mode) || atomic_read(&lli->lli_wbc_pending) == 0)
+		return;
+
+	wait_event_idle(ll_i2sbi(dir)->ll_wbc_waitq,
+			atomic_read(&lli->lli_wbc_pending) == 0);
+}
+
+/**
+ * Return the first error of the creates queued in \a dir since the last
+ * call, the error is cleared.
+ *
+ * The creates still queued are not waited for, the caller flushes them
+ * first if needed.
+ */
+int ll_wbc_dir_rc(struct inode *dir)
+{
+	struct ll_inode_info *lli = ll_i2info(dir);
+	int rc;
+
+	if (!S_ISDIR(dir->i_mode))
+		return 0;
+
+	spin_lock(&lli->lli_lock);
+	rc = lli->lli_wbc_dir_rc;
+	lli->lli_wbc_dir_rc = 0;
+	spin_unlock(&lli->lli_lock);
+
+	return rc;
+}
+
+static void ll_wbc_flush_work_fn(struct work_struct *wk)
+{
+	struct ll_wbc_flush_work *work = container_of(wk,
+						      struct ll_wbc_flush_work,
+						      lwf_work);
+	struct inode *dir = work->lwf_dir;
+
+	ll_wbc_flush(dir);
+	ldlm_cli_cancel(&work->lwf_lockh, LCF_ASYNC);
+
+	iput(dir);
+	OBD_FREE_PTR(work);
+}
+
+/**
+ * The EX lock \a lock is revoked.
+ *
+ * If it owns a directory, no more creates are queued in it.  If creates are
+ * already queued, the lock is cancelled by ll_wbc_flush_wq once they are
+ * sent, so that they are done under the lock, and the blocking callback
+ * thread does not wait for the MDT.
+ *
+ * \retval true		the lock is cancelled by ll_wbc_flush_wq
+ * \retval false	the lock is to be cancelled by the caller
+ */
+bool ll_wbc_lock_blocking(struct ldlm_lock *lock)
+{
+	struct ll_wbc_flush_work *work;
+	struct ll_inode_info *lli;
+	struct lustre_handle lockh;
+	struct inode *dir;
+	bool owned;
+
+	dir = ll_inode_from_resource_lock(lock);
+	if (dir == NULL)
+		return false;
+
+	if (!S_ISDIR(dir->i_mode))
+		goto out_put;
+
+	lli = ll_i2info(dir);
+	ldlm_lock2handle(lock, &lockh);
+	spin_lock(&lli->lli_lock);
+	owned = lustre_handle_equal(&lli->lli_wbc_lockh, &lockh);
+	if (owned)
+		clear_bit(LLIF_WBC_OWNED, &lli->lli_flags);
+	spin_unlock(&lli->lli_lock);
+
+	if (!owned || atomic_read(&lli->lli_wbc_pending) == 0)
+		goto out_put;
+
+	/* the cancel flushes the queued creates itself */
+	OBD_ALLOC_PTR(work);
+	if (work == NULL)
+		goto out_put;
+
+	LDLM_DEBUG(lock, "flush write-back cache of "DFID,
+		   PFID(ll_inode2fid(dir)));
+	work->lwf_dir = dir;
+	work->lwf_lockh = lockh;
+	INIT_WORK(&work->lwf_work, ll_wbc_flush_work_fn);
+	queue_work(ll_i2sbi(dir)->ll_wbc_flush_wq, &work->lwf_work);
+
+	return true;
+
+out_put:
+	iput(dir);
+	return false;
+}
+
+/**
+ * The EX lock of directory \a dir is being cancelled.
+ *
+ * No more creates are queued in the directory.  The queued ones are normally
+ * sent already, see ll_wbc_lock_blocking(), otherwise they are sent before
+ * the lock is released so that they are done under the lock.
+ */
+void ll_wbc_lock_cancel(struct inode *dir, struct ldlm_lock *lock)
+{
+	struct ll_inode_info *lli = ll_i2info(dir);
+	struct lustre_handle lockh;
+	bool owned;
+
+	ldlm_lock2handle(lock, &lockh);
+	spin_lock(&lli->lli_lock);
+	owned = lustre_handle_equal(&lli->lli_wbc_lockh, &lockh);
+	if (owned)
+		clear_bit(LLIF_WBC_OWNED, &lli->lli_flags);
+	spin_unlock(&lli->lli_lock);
+
+	if (!owned)
+		return;
+
+	LDLM_DEBUG(lock, "flush write-back cache of "DFID,
+		   PFID(ll_inode2fid(dir)));
+	ll_wbc_flush(dir);
+
+	spin_lock(&lli->lli_lock);
+	memset(&lli->lli_wbc_lockh, 0, sizeof(lli->lli_wbc_lockh));
+	spin_unlock(&lli->lli_lock);
+
+	ll_stats_ops_tally(ll_i2sbi(dir), LPROC_LL_WBC_FLUSH, 1);
+}
+
+/* release the ownership of \a inode being cleared */
+void ll_wbc_inode_fini(struct inode *inode)
+{
+	struct ll_inode_info *lli = ll_i2info(inode);
+	struct lustre_handle lockh;
+
+	if (!S_ISDIR(inode->i_mode))
+		return;
+
+	LASSERT(atomic_read(&lli->lli_wbc_pending) == 0);
+	lockh = lli->lli_wbc_lockh;
+	if (!lustre_handle_is_used(&lockh))
+		return;
+
+	/* the lock is not in LRU and would be kept until revoked */
+	memset(&lli->lli_wbc_lockh, 0, sizeof(lli->lli_wbc_lockh));
+	clear_bit(LLIF_WBC_OWNED, &lli->lli_flags);
+	ldlm_cli_cancel(&lockh, LCF_ASYNC);
+}
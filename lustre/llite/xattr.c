@@ -128,6 +128,10 @@ static int ll_xattr_set_common(const struct xattr_handler *handler,
 	    !inode_owner_or_capable(inode))
 		RETURN(-EPERM);
 
+	rc = ll_wbc_wait(inode);
+	if (rc)
+		RETURN(rc);
+
 	/* b10667: ignore lustre special xattr for now */
 	if (!strcmp(name, "hsm") ||
 	    ((handler->flags == XATTR_TRUSTED_T && !strcmp(name, "lov")) ||
@@ -370,6 +374,10 @@ int ll_xattr_list(struct inode *inode, const char *name, int type, void *buffer,
 	int rc;
 	ENTRY;
 
+	rc = ll_wbc_wait(inode);
+	if (rc)
+		RETURN(rc);
+
 	if (sbi->ll_xattr_cache_enabled && type != XATTR_ACL_ACCESS_T &&
 	    (type != XATTR_SECURITY_T || strcmp(name, "security.selinux"))) {
 		rc = ll_xattr_cache_get(inode, name, buffer, size, valid);
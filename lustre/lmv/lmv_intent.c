@@ -348,6 +348,7 @@ retry:
 	} else {
 		LASSERT(fid_is_sane(&op_data->op_fid1));
 		LASSERT(it->it_flags & MDS_OPEN_PCC ||
+			op_data->op_flags & MF_FID2_ALLOCATED ||
 			fid_is_zero(&op_data->op_fid2));
 		LASSERT(op_data->op_name != NULL);
 
@@ -359,7 +360,8 @@ retry:
 	/* If it is ready to open the file by FID, do not need
 	 * allocate FID at all, otherwise it will confuse MDT */
 	if ((it->it_op & IT_CREAT) && !(it->it_flags & MDS_OPEN_BY_FID ||
-					it->it_flags & MDS_OPEN_PCC)) {
+					it->it_flags & MDS_OPEN_PCC ||
+					op_data->op_flags & MF_FID2_ALLOCATED)) {
 		/*
 		 * For lookup(IT_CREATE) cases allocate new fid and setup FLD
 		 * for it.
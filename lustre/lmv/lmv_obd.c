@@ -1836,16 +1836,21 @@ int lmv_create(struct obd_export *exp, struct md_op_data *op_data,
 	}
 
 retry:
-	rc = lmv_fid_alloc(NULL, exp, &op_data->op_fid2, op_data);
-	if (rc)
-		RETURN(rc);
+	/* FID is already allocated by the metadata write-back cache */
+	if (!(op_data->op_flags & MF_FID2_ALLOCATED)) {
+		rc = lmv_fid_alloc(NULL, exp, &op_data->op_fid2, op_data);
+		if (rc)
+			RETURN(rc);
+	}
 
 	CDEBUG(D_INODE, "CREATE name '%.*s' "DFID" on "DFID" -> mds #%x\n",
 		(int)op_data->op_namelen, op_data->op_name,
 		PFID(&op_data->op_fid2), PFID(&op_data->op_fid1),
 		op_data->op_mds);
 
-	op_data->op_flags |= MF_MDC_CANCEL_FID1;
+	/* a lockless create must keep the EX lock held on the parent */
+	if (!(op_data->op_bias & MDS_WBC_LOCKLESS))
+		op_data->op_flags |= MF_MDC_CANCEL_FID1;
 	rc = md_create(tgt->ltd_exp, op_data, data, datalen, mode, uid, gid,
 		       cap_effective, rdev, request);
 	if (rc == 0) {
@@ -1876,6 +1881,7 @@ retry:
 		RETURN(PTR_ERR(tgt));
 
 	op_data->op_mds = tgt->ltd_index;
+	op_data->op_flags &= ~MF_FID2_ALLOCATED;
 	goto retry;
 }
 
@@ -217,7 +217,8 @@ struct lod_object {
 			__u32		ldo_is_composite:1,
 					ldo_flr_state:2,
 					ldo_comp_cached:1,
-					ldo_is_foreign:1;
+					ldo_is_foreign:1,
+					ldo_is_pccro:1;
 		};
 		/* directory stripe (LMV) */
 		struct {
@@ -559,6 +559,7 @@ void lod_free_comp_entries(struct lod_object *lo)
 	lo->ldo_comp_entries = NULL;
 	lo->ldo_comp_cnt = 0;
 	lo->ldo_is_composite = 0;
+	lo->ldo_is_pccro = 0;
 }
 
 int lod_alloc_comp_entries(struct lod_object *lo,
@@ -842,7 +843,8 @@ int lod_generate_lovea(const struct lu_env *env, struct lod_object *lo,
 	lcm->lcm_magic = cpu_to_le32(LOV_MAGIC_COMP_V1);
 	lcm->lcm_entry_count = cpu_to_le16(comp_cnt);
 	lcm->lcm_mirror_count = cpu_to_le16(mirror_cnt - 1);
-	lcm->lcm_flags = cpu_to_le16(lo->ldo_flr_state);
+	lcm->lcm_flags = cpu_to_le16(lo->ldo_flr_state |
+				     (lo->ldo_is_pccro ? LCM_FL_PCC_RDONLY : 0));
 
 	offset = sizeof(*lcm) + sizeof(*lcme) * comp_cnt;
 	LASSERT(offset % sizeof(__u64) == 0);
@@ -1140,6 +1142,8 @@ int lod_parse_striping(const struct lu_env *env, struct lod_object *lo,
 		lo->ldo_is_composite = 1;
 		lo->ldo_flr_state = le16_to_cpu(comp_v1->lcm_flags) &
 					LCM_FL_FLR_MASK;
+		lo->ldo_is_pccro = !!(le16_to_cpu(comp_v1->lcm_flags) &
+				      LCM_FL_PCC_RDONLY);
 		mirror_cnt = le16_to_cpu(comp_v1->lcm_mirror_count) + 1;
 	} else if (magic == LOV_MAGIC_FOREIGN) {
 		size_t length;
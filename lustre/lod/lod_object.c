@@ -8281,6 +8281,76 @@ static mlc_handler dir_mlc_ops[MD_LAYOUT_MAX] = {
 	[MD_LAYOUT_SHRINK] = lod_dir_layout_shrink,
 };
 
+/**
+ * Set or clear LCM_FL_PCC_RDONLY in the layout of a regular file.
+ *
+ * A plain layout is converted to a composite one with a single component to
+ * carry the flag. The layout generation is increased in either case.
+ *
+ * \retval -EALREADY	the file is in the requested state already
+ */
+static int lod_declare_update_pccro(const struct lu_env *env,
+				    struct lod_object *lo,
+				    struct md_layout_change *mlc,
+				    struct thandle *th)
+{
+	struct lod_thread_info *info = lod_env_info(env);
+	struct lu_buf *buf = &info->lti_buf;
+	struct lov_comp_md_v1 *lcm;
+	bool set = mlc->mlc_intent->li_opc == LAYOUT_INTENT_PCCRO_SET;
+	__u16 flags;
+	int rc;
+
+	ENTRY;
+
+	if (lo->ldo_is_foreign)
+		RETURN(-EINVAL);
+
+	if (!!lo->ldo_is_pccro == set)
+		RETURN(-EALREADY);
+
+	rc = lod_get_lov_ea(env, lo);
+	if (rc <= 0)
+		RETURN(rc ? : -ENODATA);
+
+	lcm = info->lti_ea_store;
+	switch (le32_to_cpu(lcm->lcm_magic)) {
+	case LOV_MAGIC_V1:
+	case LOV_MAGIC_V3:
+		rc = lod_layout_convert(info);
+		if (rc)
+			RETURN(rc);
+		lcm = info->lti_ea_store;
+		lcm->lcm_entries[0].lcme_id = cpu_to_le32(pflr_id(0, 1));
+		break;
+	case LOV_MAGIC_COMP_V1:
+	case LOV_MAGIC_SEL:
+		break;
+	default:
+		RETURN(-EINVAL);
+	}
+
+	flags = le16_to_cpu(lcm->lcm_flags);
+	if (set)
+		flags |= LCM_FL_PCC_RDONLY;
+	else
+		flags &= ~LCM_FL_PCC_RDONLY;
+	lcm->lcm_flags = cpu_to_le16(flags);
+
+	lod_obj_inc_layout_gen(lo);
+	lcm->lcm_layout_gen = cpu_to_le32(lo->ldo_layout_gen);
+
+	buf->lb_buf = lcm;
+	buf->lb_len = le32_to_cpu(lcm->lcm_size);
+	rc = lod_striping_reload(env, lo, buf);
+	if (rc)
+		RETURN(rc);
+
+	rc = lod_sub_declare_xattr_set(env, dt_object_child(&lo->ldo_obj), buf,
+				       XATTR_NAME_LOV, LU_XATTR_REPLACE, th);
+	RETURN(rc);
+}
+
 static int lod_declare_layout_change(const struct lu_env *env,
 		struct dt_object *dt, struct md_layout_change *mlc,
 		struct thandle *th)
@@ -8307,6 +8377,11 @@ static int lod_declare_layout_change(const struct lu_env *env,
 
 	LASSERT(lo->ldo_comp_cnt > 0);
 
+	if (mlc->mlc_opc == MD_LAYOUT_PCCRO) {
+		rc = lod_declare_update_pccro(env, lo, mlc, th);
+		GOTO(out, rc);
+	}
+
 	rc = lod_layout_data_init(info, lo->ldo_comp_cnt);
 	if (rc)
 		GOTO(out, rc);
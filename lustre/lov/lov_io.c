@@ -579,6 +579,15 @@ static int lov_io_slice_init(struct lov_io *lio,
 	if (result)
 		GOTO(out, result);
 
+	/* the RO-PCC copies have to be invalidated before any modification */
+	if (obj->u.composite.lo_flags & LCM_FL_PCC_RDONLY &&
+	    io->ci_designated_mirror == 0 &&
+	    (io->ci_type == CIT_WRITE || cl_io_is_mkwrite(io) ||
+	     cl_io_is_fallocate(io) || cl_io_is_trunc(io))) {
+		io->ci_need_pccro_clear = 1;
+		GOTO(out, result = 1);
+	}
+
 	/* check if it needs to instantiate layout */
 	if (!(io->ci_type == CIT_WRITE || cl_io_is_mkwrite(io) ||
 	      cl_io_is_fallocate(io) ||
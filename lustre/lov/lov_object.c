@@ -2148,8 +2148,11 @@ static int lov_object_layout_get(const struct lu_env *env,
 	struct lov_stripe_md *lsm = lov_lsm_addref(lov);
 	struct lu_buf *buf = &cl->cl_buf;
 	ssize_t rc;
+	int i;
 	ENTRY;
 
+	cl->cl_stripe_size = 0;
+	cl->cl_stripe_count = 0;
 	if (lsm == NULL) {
 		cl->cl_size = 0;
 		cl->cl_layout_gen = CL_LAYOUT_GEN_EMPTY;
@@ -2160,8 +2163,22 @@ static int lov_object_layout_get(const struct lu_env *env,
 	cl->cl_size = lov_comp_md_size(lsm);
 	cl->cl_layout_gen = lsm->lsm_layout_gen;
 	cl->cl_is_released = lsm->lsm_is_released;
+	cl->cl_is_pcc_rdonly = !!(lsm->lsm_flags & LCM_FL_PCC_RDONLY);
 	cl->cl_is_composite = lsm_is_composite(lsm->lsm_magic);
 
+	for (i = 0; lsm->lsm_magic != LOV_MAGIC_FOREIGN &&
+		    i < lsm->lsm_entry_count; i++) {
+		struct lov_stripe_md_entry *lse = lsm->lsm_entries[i];
+
+		if (lsme_is_foreign(lse) || !lsme_inited(lse))
+			continue;
+
+		if (lse->lsme_stripe_count > cl->cl_stripe_count) {
+			cl->cl_stripe_count = lse->lsme_stripe_count;
+			cl->cl_stripe_size = lse->lsme_stripe_size;
+		}
+	}
+
 	rc = lov_lsm_pack(lsm, buf->lb_buf, buf->lb_len);
 	lov_lsm_put(lsm);
 
@@ -221,7 +221,12 @@ void mdc_create_pack(struct ptlrpc_request *req, struct md_op_data *op_data,
 		flags |= MDS_OPEN_VOLATILE;
 	set_mrc_cr_flags(rec, flags);
 	rec->cr_bias     = op_data->op_bias;
-	rec->cr_umask    = current_umask();
+	if (op_data->op_bias & MDS_WBC_LOCKLESS) {
+		rec->cr_umask = op_data->op_umask;
+		rec->cr_open_handle_old = op_data->op_open_handle;
+	} else {
+		rec->cr_umask = current_umask();
+	}
 
 	mdc_pack_name(req, &RMF_NAME, op_data->op_name, op_data->op_namelen);
 	if (data) {
@@ -303,6 +308,8 @@ void mdc_open_pack(struct ptlrpc_request *req, struct md_op_data *op_data,
 		rec->cr_suppgid2   = op_data->op_suppgids[1];
 		rec->cr_bias       = op_data->op_bias;
 		rec->cr_open_handle_old = op_data->op_open_handle;
+		if (op_data->op_bias & MDS_WBC_LOCKLESS)
+			rec->cr_umask = op_data->op_umask;
 
 		if (op_data->op_name) {
 			mdc_pack_name(req, &RMF_NAME, op_data->op_name,
@@ -290,14 +290,17 @@ mdc_intent_open_pack(struct obd_export *exp, struct lookup_intent *it,
 						MDS_INODELOCK_OPEN);
 	}
 
-	/* If CREATE, cancel parent's UPDATE lock. */
+	/* If CREATE, cancel parent's UPDATE lock, unless the create is done
+	 * under the EX lock the client holds on the parent itself.
+	 */
 	if (it->it_op & IT_CREAT)
 		mode = LCK_EX;
 	else
 		mode = LCK_CR;
-	count += mdc_resource_get_unused(exp, &op_data->op_fid1,
-					 &cancels, mode,
-					 MDS_INODELOCK_UPDATE);
+	if (!(op_data->op_bias & MDS_WBC_LOCKLESS))
+		count += mdc_resource_get_unused(exp, &op_data->op_fid1,
+						 &cancels, mode,
+						 MDS_INODELOCK_UPDATE);
 
 	req = ptlrpc_request_alloc(class_exp2cliimp(exp),
 				   &RQF_LDLM_INTENT_OPEN);
@@ -959,10 +962,14 @@ static int mdc_enqueue_base(struct obd_export *exp,
 resend:
 	flags = saved_flags;
 	if (it == NULL) {
-		/* The only way right now is FLOCK. */
-		LASSERTF(einfo->ei_type == LDLM_FLOCK, "lock type %d\n",
+		/* Without intent only FLOCK and plain IBITS locks, the latter
+		 * taken by the metadata write-back cache, are enqueued.
+		 */
+		LASSERTF(einfo->ei_type == LDLM_FLOCK ||
+			 einfo->ei_type == LDLM_IBITS, "lock type %d\n",
 			 einfo->ei_type);
-		res_id.name[3] = LDLM_FLOCK;
+		if (einfo->ei_type == LDLM_FLOCK)
+			res_id.name[3] = LDLM_FLOCK;
 		req = ldlm_enqueue_pack(exp, 0);
 	} else if (it->it_op & IT_OPEN) {
 		req = mdc_intent_open_pack(exp, it, op_data, acl_bufsize);
@@ -1263,7 +1270,7 @@ int mdc_revalidate_lock(struct obd_export *exp, struct lookup_intent *it,
 
 		mode = mdc_lock_match(exp, LDLM_FL_BLOCK_GRANTED, fid,
 				      LDLM_IBITS, &policy,
-				      LCK_CR | LCK_CW | LCK_PR | LCK_PW,
+				      LCK_CR | LCK_CW | LCK_PR | LCK_PW | LCK_EX,
 				      &lockh);
 	}
 
@@ -2708,6 +2708,42 @@ mdd_layout_instantiate_component(const struct lu_env *env,
 	RETURN(rc);
 }
 
+/**
+ * Set or clear the RO-PCC state of a file, see LCM_FL_PCC_RDONLY.
+ *
+ * The state is kept apart from the FLR state. A plain layout is converted to
+ * a composite one to carry it. The layout generation is increased, so the
+ * layout locks of all clients are revoked and their RO-PCC copies dropped.
+ */
+static int
+mdd_layout_update_pccro(const struct lu_env *env, struct mdd_object *obj,
+			struct md_layout_change *mlc, struct thandle *handle)
+{
+	struct mdd_device *mdd = mdd_obj2mdd_dev(obj);
+	int rc;
+
+	ENTRY;
+
+	rc = mdd_declare_layout_change(env, mdd, obj, mlc, handle);
+	/* the file is in the requested state already */
+	if (rc)
+		RETURN(rc == -EALREADY ? 0 : rc);
+
+	rc = mdd_trans_start(env, mdd, handle);
+	if (rc)
+		RETURN(rc);
+
+	mdd_write_lock(env, obj, DT_TGT_CHILD);
+	rc = mdo_layout_change(env, obj, mlc, handle);
+	mdd_write_unlock(env, obj);
+	if (rc)
+		RETURN(rc);
+
+	rc = mdd_changelog_data_store(env, mdd, CL_LAYOUT, 0, obj, handle,
+				      NULL);
+	RETURN(rc);
+}
+
 /**
  * Change the FLR layout from RDONLY to WRITE_PENDING.
  *
@@ -2987,6 +3023,7 @@ mdd_layout_change(const struct lu_env *env, struct md_object *o,
 	case MD_LAYOUT_WRITE:
 	case MD_LAYOUT_RESYNC:
 	case MD_LAYOUT_RESYNC_DONE:
+	case MD_LAYOUT_PCCRO:
 		break;
 	default:
 		RETURN(-ENOTSUPP);
@@ -2996,6 +3033,11 @@ mdd_layout_change(const struct lu_env *env, struct md_object *o,
 	if (IS_ERR(handle))
 		RETURN(PTR_ERR(handle));
 
+	if (mlc->mlc_opc == MD_LAYOUT_PCCRO) {
+		rc = mdd_layout_update_pccro(env, obj, mlc, handle);
+		GOTO(out, rc);
+	}
+
 	rc = mdd_stripe_get(env, obj, buf, XATTR_NAME_LOV);
 	if (rc < 0) {
 		if (rc == -ENODATA)
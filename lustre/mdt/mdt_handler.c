@@ -1650,6 +1650,8 @@ int mdt_layout_change(struct mdt_thread_info *info, struct mdt_object *obj,
 		      struct mdt_lock_handle *lhc,
 		      struct md_layout_change *layout)
 {
+	bool pccro_set = layout->mlc_opc == MD_LAYOUT_PCCRO &&
+			 layout->mlc_intent->li_opc == LAYOUT_INTENT_PCCRO_SET;
 	int rc;
 
 	ENTRY;
@@ -1660,14 +1662,26 @@ int mdt_layout_change(struct mdt_thread_info *info, struct mdt_object *obj,
 	if (!S_ISREG(lu_object_attr(&obj->mot_obj)))
 		RETURN(-EINVAL);
 
+	/* any reader may mark the file to be cached by RO-PCC */
 	rc = mo_permission(info->mti_env, NULL, mdt_object_child(obj), NULL,
-			   MAY_WRITE);
+			   pccro_set ? MAY_READ : MAY_WRITE);
 	if (rc)
 		RETURN(rc);
 
+	/* No file opened for write is marked, and no open for write runs
+	 * meanwhile, as opens by clients unaware of RO-PCC clear it, see
+	 * mdt_open_pccro_revoke(). */
+	if (pccro_set) {
+		if (!down_write_trylock(&obj->mot_open_sem))
+			RETURN(-EBUSY);
+
+		if (mdt_write_read(obj) > 0)
+			GOTO(out_sem, rc = -EBUSY);
+	}
+
 	rc = mdt_check_resent_lock(info, obj, lhc);
 	if (rc < 0)
-		RETURN(rc);
+		GOTO(out_sem, rc);
 
 	if (rc > 0) {
 		/* not resent */
@@ -1681,7 +1695,7 @@ int mdt_layout_change(struct mdt_thread_info *info, struct mdt_object *obj,
 		mdt_lock_reg_init(lhc, LCK_EX);
 		rc = mdt_reint_object_lock(info, obj, lhc, lockpart, false);
 		if (rc)
-			RETURN(rc);
+			GOTO(out_sem, rc);
 	}
 
 	mutex_lock(&obj->mot_som_mutex);
@@ -1691,7 +1705,12 @@ int mdt_layout_change(struct mdt_thread_info *info, struct mdt_object *obj,
 	if (rc)
 		mdt_object_unlock(info, obj, lhc, 1);
 
-	RETURN(rc);
+	EXIT;
+out_sem:
+	if (pccro_set)
+		up_write(&obj->mot_open_sem);
+
+	return rc;
 }
 
 /**
@@ -4335,6 +4354,15 @@ static int mdt_intent_layout(enum ldlm_intent_flags it_opc,
 		layout.mlc_opc = MD_LAYOUT_WRITE;
 		layout.mlc_intent = intent;
 		break;
+	case LAYOUT_INTENT_PCCRO_SET:
+		/* the clients unaware of RO-PCC don't ask for it */
+		if (!exp_connect_pccro(info->mti_exp))
+			RETURN(-EOPNOTSUPP);
+		/* fallthrough */
+	case LAYOUT_INTENT_PCCRO_CLEAR:
+		layout.mlc_opc = MD_LAYOUT_PCCRO;
+		layout.mlc_intent = intent;
+		break;
 	case LAYOUT_INTENT_ACCESS:
 		break;
 	case LAYOUT_INTENT_READ:
@@ -4359,7 +4387,8 @@ static int mdt_intent_layout(enum ldlm_intent_flags it_opc,
 		 * size but the maximum one. That buffer will be shrinked
 		 * to the actual size in req_capsule_shrink() before reply.
 		 */
-		if (layout.mlc_opc == MD_LAYOUT_WRITE) {
+		if (layout.mlc_opc == MD_LAYOUT_WRITE ||
+		    layout.mlc_opc == MD_LAYOUT_PCCRO) {
 			layout_size = info->mti_mdt->mdt_max_mdsize;
 		} else {
 			layout_size = mdt_attr_get_eabuf_size(info, obj);
@@ -423,6 +423,7 @@ struct mdt_reint_record {
 
 enum mdt_reint_flag {
 	MRF_OPEN_TRUNC = BIT(0),
+	MRF_WBC_LOCKLESS = BIT(1),
 };
 
 /*
@@ -840,6 +841,8 @@ void mdt_reint_striped_unlock(struct mdt_thread_info *info,
 			      struct mdt_object *o,
 			      struct mdt_lock_handle *lh,
 			      struct ldlm_enqueue_info *einfo, int decref);
+bool mdt_wbc_parent_locked(struct mdt_thread_info *info,
+			   struct mdt_object *parent);
 
 enum mdt_name_flags {
 	MNF_FIX_ANON = 1,
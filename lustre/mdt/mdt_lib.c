@@ -1293,6 +1293,11 @@ static int mdt_create_unpack(struct mdt_thread_info *info)
         memset(&sp->u, 0, sizeof(sp->u));
         sp->sp_cr_flags = get_mrc_cr_flags(rec);
 
+	if (rec->cr_bias & MDS_WBC_LOCKLESS) {
+		rr->rr_open_handle = &rec->cr_open_handle_old;
+		rr->rr_flags |= MRF_WBC_LOCKLESS;
+	}
+
 	rc = mdt_name_unpack(pill, &RMF_NAME, &rr->rr_name, 0);
 	if (rc < 0)
 		RETURN(rc);
@@ -1612,6 +1617,8 @@ static int mdt_open_unpack(struct mdt_thread_info *info)
 	rr->rr_fid1   = &rec->cr_fid1;
 	rr->rr_fid2   = &rec->cr_fid2;
 	rr->rr_open_handle = &rec->cr_open_handle_old;
+	if (rec->cr_bias & MDS_WBC_LOCKLESS)
+		rr->rr_flags |= MRF_WBC_LOCKLESS;
 	attr->la_mode = rec->cr_mode;
 	attr->la_rdev  = rec->cr_rdev;
 	attr->la_uid   = rec->cr_fsuid;
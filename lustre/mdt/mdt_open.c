@@ -795,6 +795,58 @@ static int mdt_open_by_fid(struct mdt_thread_info *info, struct ldlm_reply *rep)
 	RETURN(rc);
 }
 
+/*
+ * A client unaware of RO-PCC neither respects LCM_FL_PCC_RDONLY nor clears it
+ * before writing, so clear it on its behalf when it opens the file for write.
+ * The caller holds mot_open_sem, so it is not set again meanwhile, see
+ * mdt_layout_change().
+ */
+static int mdt_open_pccro_revoke(struct mdt_thread_info *info,
+				 struct mdt_object *obj)
+{
+	struct md_attr *ma = &info->mti_attr;
+	struct mdt_lock_handle *lh = &info->mti_lh[MDT_LH_LOCAL];
+	struct lov_comp_md_v1 *comp_v1;
+	struct layout_intent intent = {
+		.li_opc = LAYOUT_INTENT_PCCRO_CLEAR,
+	};
+	struct md_layout_change layout = {
+		.mlc_opc = MD_LAYOUT_PCCRO,
+		.mlc_intent = &intent,
+	};
+	int rc;
+
+	ENTRY;
+
+	if (!(ma->ma_valid & MA_LOV) || ma->ma_lmm == NULL)
+		RETURN(0);
+
+	comp_v1 = (struct lov_comp_md_v1 *)ma->ma_lmm;
+	if (le32_to_cpu(comp_v1->lcm_magic) != LOV_MAGIC_COMP_V1 ||
+	    !(le16_to_cpu(comp_v1->lcm_flags) & LCM_FL_PCC_RDONLY))
+		RETURN(0);
+
+	/* revoke the layout locks of the RO-PCC clients */
+	mdt_lock_handle_init(lh);
+	mdt_lock_reg_init(lh, LCK_EX);
+	rc = mdt_object_lock(info, obj, lh, MDS_INODELOCK_LAYOUT);
+	if (rc)
+		RETURN(rc);
+
+	mutex_lock(&obj->mot_som_mutex);
+	rc = mo_layout_change(info->mti_env, mdt_object_child(obj), &layout);
+	mutex_unlock(&obj->mot_som_mutex);
+
+	mdt_object_unlock(info, obj, lh, 1);
+	/* MDT_LH_LOCAL is checked again by mdt_object_open_unlock() */
+	mdt_lock_handle_init(lh);
+
+	CDEBUG(D_INODE, "%s: clear RO-PCC of "DFID" for writer: rc = %d\n",
+	       mdt_obd_name(info->mti_mdt), PFID(mdt_object_fid(obj)), rc);
+
+	RETURN(rc);
+}
+
 /* lock object for open */
 static int mdt_object_open_lock(struct mdt_thread_info *info,
 				struct mdt_object *obj,
@@ -908,6 +960,14 @@ static int mdt_object_open_lock(struct mdt_thread_info *info,
 			atomic_read(&obj->mot_lease_count), lm);
 	}
 
+	if (open_flags & MDS_FMODE_WRITE && !create_layout &&
+	    S_ISREG(lu_object_attr(&obj->mot_obj)) &&
+	    !exp_connect_pccro(info->mti_exp)) {
+		rc = mdt_open_pccro_revoke(info, obj);
+		if (rc)
+			GOTO(out, rc);
+	}
+
 	mdt_lock_reg_init(lhc, lm);
 
 	/* Return lookup lock to validate inode at the client side.
@@ -1403,14 +1463,23 @@ int mdt_reint_open(struct mdt_thread_info *info, struct mdt_lock_handle *lhc)
 	}
 
 	OBD_RACE(OBD_FAIL_MDS_REINT_OPEN);
+	/* the client owns the parent with an EX lock, see
+	 * mdt_wbc_parent_locked() */
+	if ((open_flags & MDS_OPEN_CREAT) &&
+	    mdt_wbc_parent_locked(info, parent))
+		lock_mode = LCK_MINMODE;
 again_pw:
 	lh = &info->mti_lh[MDT_LH_PARENT];
-	mdt_lock_pdo_init(lh, lock_mode, &rr->rr_name);
-
-	result = mdt_object_lock(info, parent, lh, MDS_INODELOCK_UPDATE);
-	if (result != 0) {
-		mdt_object_put(info->mti_env, parent);
-		GOTO(out, result);
+	mdt_lock_pdo_init(lh, lock_mode == LCK_MINMODE ? LCK_PW : lock_mode,
+			  &rr->rr_name);
+
+	if (lock_mode != LCK_MINMODE) {
+		result = mdt_object_lock(info, parent, lh,
+					 MDS_INODELOCK_UPDATE);
+		if (result != 0) {
+			mdt_object_put(info->mti_env, parent);
+			GOTO(out, result);
+		}
 	}
 	fid_zero(child_fid);
 
@@ -489,6 +489,7 @@ static int mdt_create(struct mdt_thread_info *info)
 	struct mdt_reint_record *rr = &info->mti_rr;
 	struct md_op_spec *spec = &info->mti_spec;
 	bool restripe = false;
+	bool lockless;
 	int rc;
 
 	ENTRY;
@@ -568,11 +569,14 @@ static int mdt_create(struct mdt_thread_info *info)
 
 	OBD_RACE(OBD_FAIL_MDS_CREATE_RACE);
 
+	lockless = mdt_wbc_parent_locked(info, parent);
 	lh = &info->mti_lh[MDT_LH_PARENT];
 	mdt_lock_pdo_init(lh, LCK_PW, &rr->rr_name);
-	rc = mdt_object_lock(info, parent, lh, MDS_INODELOCK_UPDATE);
-	if (rc)
-		GOTO(put_parent, rc);
+	if (!lockless) {
+		rc = mdt_object_lock(info, parent, lh, MDS_INODELOCK_UPDATE);
+		if (rc)
+			GOTO(put_parent, rc);
+	}
 
 	if (!mdt_object_remote(parent)) {
 		rc = mdt_version_get_check_save(info, parent, 0);
@@ -633,7 +637,7 @@ static int mdt_create(struct mdt_thread_info *info)
 			GOTO(put_child, rc);
 
 		cos_incompat = rc;
-		if (cos_incompat) {
+		if (cos_incompat && !lockless) {
 			if (!mdt_object_remote(parent)) {
 				mdt_object_unlock(info, parent, lh, 1);
 				mdt_lock_pdo_init(lh, LCK_PW, &rr->rr_name);
@@ -671,6 +675,58 @@ put_parent:
 	return rc;
 }
 
+/**
+ * Check whether a create may skip the parent PDO lock.
+ *
+ * A client which holds an EX UPDATE lock on \a parent has exclusive
+ * ownership of the directory and may pipeline creates in it with
+ * MDS_WBC_LOCKLESS, passing the handle of that lock in the request.  The
+ * handle is verified to belong to the requesting export and to cover the
+ * parent, otherwise the regular locking is done.  Replayed requests always
+ * take the lock because the client lock may not have been reconstructed yet.
+ *
+ * \param[in] info	thread info object
+ * \param[in] parent	parent directory of the create
+ *
+ * \retval true	parent is protected by the client EX lock
+ * \retval false	parent lock must be taken
+ */
+bool mdt_wbc_parent_locked(struct mdt_thread_info *info,
+			   struct mdt_object *parent)
+{
+	struct mdt_reint_record *rr = &info->mti_rr;
+	struct ptlrpc_request *req = mdt_info_req(info);
+	struct ldlm_lock *lock;
+	bool locked = false;
+
+	if (!(rr->rr_flags & MRF_WBC_LOCKLESS) || rr->rr_open_handle == NULL ||
+	    !lustre_handle_is_used(rr->rr_open_handle))
+		return false;
+
+	if (req_is_replay(req) || mdt_object_remote(parent))
+		return false;
+
+	lock = ldlm_handle2lock(rr->rr_open_handle);
+	if (lock == NULL)
+		return false;
+
+	lock_res_and_lock(lock);
+	if (lock->l_export == req->rq_export &&
+	    lock->l_granted_mode == LCK_EX &&
+	    fid_res_name_eq(mdt_object_fid(parent),
+			    &lock->l_resource->lr_name) &&
+	    lock->l_policy_data.l_inodebits.bits & MDS_INODELOCK_UPDATE)
+		locked = true;
+	unlock_res_and_lock(lock);
+	LDLM_LOCK_PUT(lock);
+
+	CDEBUG(D_INODE, "%s: create in "DFID" %s client EX lock\n",
+	       mdt_obd_name(info->mti_mdt), PFID(mdt_object_fid(parent)),
+	       locked ? "under" : "ignoring");
+
+	return locked;
+}
+
 static int mdt_attr_set(struct mdt_thread_info *info, struct mdt_object *mo,
 			struct md_attr *ma)
 {
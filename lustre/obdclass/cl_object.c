@@ -77,6 +77,7 @@ int cl_object_header_init(struct cl_object_header *h)
 		spin_lock_init(&h->coh_attr_guard);
 		lockdep_set_class(&h->coh_attr_guard, &cl_attr_guard_class);
 		h->coh_page_bufsize = 0;
+		h->coh_hot_expire = 0;
 	}
 	RETURN(result);
 }
@@ -637,6 +637,30 @@ static const char *obd_connect_names[] = {
 	"getattr_pfid",		/* 0x20000 */
 	"lseek",		/* 0x40000 */
 	"dom_lvb",		/* 0x80000 */
+	"rep_mbits",		/* 0x100000 */
+	"mode_convert",		/* 0x200000 */
+	"batch_rpcs",		/* 0x400000 */
+	"pcc_ro",		/* 0x800000 */
+	"mne_nid_type",		/* 0x1000000 */
+	"lock_contend",		/* 0x2000000 */
+	"atomic_open_lock",	/* 0x4000000 */
+	"name_encryption",	/* 0x8000000 */
+	"mkdir_replay",		/* 0x10000000 */
+	"dmv_imp_inherit",	/* 0x20000000 */
+	"encryption_fid2path",	/* 0x40000000 */
+	"replay_create",		/* 0x80000000 */
+	"large_nid",		/* 0x100000000 */
+	"compressed_file",	/* 0x200000000 */
+	"unaligned_dio",		/* 0x400000000 */
+	"conn_policy",		/* 0x800000000 */
+	"sparse_read",		/* 0x1000000000 */
+	"mirror_id_fix",		/* 0x2000000000 */
+	"update_layout",		/* 0x4000000000 */
+	"readdir_open",		/* 0x8000000000 */
+	"flr_ec",		/* 0x10000000000 */
+	"md_wbc",		/* 0x20000000000 */
+	"brw_multi",		/* 0x40000000000 */
+	"batch_bl_ast",		/* 0x80000000000 */
 	NULL
 };
 
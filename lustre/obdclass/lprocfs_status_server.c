@@ -173,6 +173,7 @@ lprocfs_exp_print_export_seq(struct obd_export *exp, void *cb_data)
 	struct seq_file		*m = cb_data;
 	struct obd_device	*obd;
 	struct obd_connect_data	*ocd;
+	int			 i;
 
 	LASSERT(exp != NULL);
 	if (exp->exp_nid_stats == NULL)
@@ -206,6 +207,14 @@ lprocfs_exp_print_export_seq(struct obd_export *exp, void *cb_data)
 			fed->fed_ted.ted_dirty);
 		seq_printf(m, "       pending: %ld\n",
 			fed->fed_ted.ted_pending);
+		seq_printf(m, "       write_rate: %llu\n",
+			fed->fed_ted.ted_write_rate.twr_rate);
+		/* share of the grant kept dirty, in 10% steps */
+		seq_printf(m, "       dirty_pct_hist: [ ");
+		for (i = 0; i <= 10; i++)
+			seq_printf(m, "%s%lu", i ? ", " : "",
+				   fed->fed_ted.ted_grant_eff.oh_buckets[i]);
+		seq_printf(m, " ]\n");
 	}
 
 out:
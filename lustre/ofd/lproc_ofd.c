@@ -996,6 +996,7 @@ LUSTRE_RW_ATTR(job_cleanup_interval);
 LUSTRE_RO_ATTR(tot_dirty);
 LUSTRE_RO_ATTR(tot_granted);
 LUSTRE_RO_ATTR(tot_pending);
+LUSTRE_RO_ATTR(grant_write_rate);
 LUSTRE_RW_ATTR(grant_compat_disable);
 LUSTRE_RO_ATTR(instance);
 
@@ -1068,6 +1069,7 @@ static struct attribute *ofd_attrs[] = {
 	&lustre_attr_tot_dirty.attr,
 	&lustre_attr_tot_granted.attr,
 	&lustre_attr_tot_pending.attr,
+	&lustre_attr_grant_write_rate.attr,
 	&lustre_attr_grant_compat_disable.attr,
 	&lustre_attr_instance.attr,
 	&lustre_attr_recovery_time_hard.attr,
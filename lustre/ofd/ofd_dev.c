@@ -2495,6 +2495,8 @@ static int ofd_rw_hpreq_lock_match(struct ptlrpc_request *req,
 	enum ldlm_mode  mode;
 	struct ldlm_extent ext;
 	__u32 opc = lustre_msg_get_opc(req->rq_reqmsg);
+	int objcount;
+	int i;
 
 	ENTRY;
 
@@ -2504,14 +2506,6 @@ static int ofd_rw_hpreq_lock_match(struct ptlrpc_request *req,
 	rnb = req_capsule_client_get(&req->rq_pill, &RMF_NIOBUF_REMOTE);
 	LASSERT(rnb != NULL);
 
-	ext.start = rnb->rnb_offset;
-	rnb += ioo->ioo_bufcnt - 1;
-	ext.end = rnb->rnb_offset + rnb->rnb_len - 1;
-
-	LASSERT(lock->l_resource != NULL);
-	if (!ostid_res_name_eq(&ioo->ioo_oid, &lock->l_resource->lr_name))
-		RETURN(0);
-
 	/* a bulk write can only hold a reference on a PW extent lock
 	 * or GROUP lock.
 	 */
@@ -2524,7 +2518,25 @@ static int ofd_rw_hpreq_lock_match(struct ptlrpc_request *req,
 	if (!(lock->l_granted_mode & mode))
 		RETURN(0);
 
-	RETURN(ldlm_extent_overlap(&lock->l_policy_data.l_extent, &ext));
+	LASSERT(lock->l_resource != NULL);
+
+	/* a multi-object write matches the locks of all its objects */
+	objcount = req_capsule_get_size(&req->rq_pill, &RMF_OBD_IOOBJ,
+					RCL_CLIENT) / sizeof(*ioo);
+	for (i = 0; i < objcount; rnb += ioo[i].ioo_bufcnt, i++) {
+		if (!ostid_res_name_eq(&ioo[i].ioo_oid,
+				       &lock->l_resource->lr_name))
+			continue;
+
+		ext.start = rnb[0].rnb_offset;
+		ext.end = rnb[ioo[i].ioo_bufcnt - 1].rnb_offset +
+			  rnb[ioo[i].ioo_bufcnt - 1].rnb_len - 1;
+
+		RETURN(ldlm_extent_overlap(&lock->l_policy_data.l_extent,
+					   &ext));
+	}
+
+	RETURN(0);
 }
 
 /**
@@ -2546,7 +2558,10 @@ static int ofd_rw_hpreq_check(struct ptlrpc_request *req)
 	struct obd_ioobj	*ioo;
 	struct niobuf_remote	*rnb;
 	int opc;
-	struct ldlm_prolong_args pa = { 0 };
+	int objcount;
+	int blocks = 0;
+	bool stale = false;
+	int i;
 
 	ENTRY;
 
@@ -2568,28 +2583,51 @@ static int ofd_rw_hpreq_check(struct ptlrpc_request *req)
 	LASSERT(rnb != NULL);
 	LASSERT(!(rnb->rnb_flags & OBD_BRW_SRVLOCK));
 
-	pa.lpa_mode = LCK_PW | LCK_GROUP;
-	if (opc == OST_READ)
-		pa.lpa_mode |= LCK_PR;
-
-	pa.lpa_extent.start = rnb->rnb_offset;
-	rnb += ioo->ioo_bufcnt - 1;
-	pa.lpa_extent.end = rnb->rnb_offset + rnb->rnb_len - 1;
-
-	DEBUG_REQ(D_RPCTRACE, req,
-		  "%s %s: refresh rw locks for "DFID" (%llu->%llu)",
-		  tgt_name(tsi->tsi_tgt), current->comm, PFID(&tsi->tsi_fid),
-		  pa.lpa_extent.start, pa.lpa_extent.end);
+	/* every object of a multi-object write must be covered by a lock,
+	 * and the request blocks the locks of all of them */
+	objcount = req_capsule_get_size(&req->rq_pill, &RMF_OBD_IOOBJ,
+					RCL_CLIENT) / sizeof(*ioo);
+	for (i = 0; i < objcount; rnb += ioo[i].ioo_bufcnt, i++) {
+		struct ldlm_prolong_args pa = { 0 };
+
+		pa.lpa_mode = LCK_PW | LCK_GROUP;
+		if (opc == OST_READ)
+			pa.lpa_mode |= LCK_PR;
+
+		pa.lpa_extent.start = rnb[0].rnb_offset;
+		pa.lpa_extent.end = rnb[ioo[i].ioo_bufcnt - 1].rnb_offset +
+				    rnb[ioo[i].ioo_bufcnt - 1].rnb_len - 1;
+
+		DEBUG_REQ(D_RPCTRACE, req,
+			  "%s %s: refresh rw locks for "DOSTID" (%llu->%llu)",
+			  tgt_name(tsi->tsi_tgt), current->comm,
+			  POSTID(&ioo[i].ioo_oid), pa.lpa_extent.start,
+			  pa.lpa_extent.end);
+
+		if (i == 0) {
+			ofd_prolong_extent_locks(tsi, &pa);
+		} else {
+			/* the lock handle of the ost_body is for the first
+			 * object only */
+			pa.lpa_timeout = prolong_timeout(req);
+			pa.lpa_export = tsi->tsi_exp;
+			ost_fid_build_resid(&ioo[i].ioo_oid.oi_fid,
+					    &pa.lpa_resid);
+			ldlm_resource_prolong(&pa);
+		}
 
-	ofd_prolong_extent_locks(tsi, &pa);
+		blocks += pa.lpa_blocks_cnt;
+		if (pa.lpa_locks_cnt == 0)
+			stale = true;
+	}
 
 	CDEBUG(D_DLMTRACE, "%s: refreshed %u locks timeout for req %p\n",
-	       tgt_name(tsi->tsi_tgt), pa.lpa_blocks_cnt, req);
+	       tgt_name(tsi->tsi_tgt), blocks, req);
 
-	if (pa.lpa_blocks_cnt > 0)
+	if (blocks > 0)
 		RETURN(1);
 
-	RETURN(pa.lpa_locks_cnt > 0 ? 0 : -ESTALE);
+	RETURN(stale ? -ESTALE : 0);
 }
 
 /**
@@ -269,7 +269,6 @@ struct ofd_thread_info {
 	struct ldlm_res_id		 fti_resid;
 	struct filter_fid		 fti_mds_fid;
 	struct ost_id			 fti_ostid;
-	struct ofd_object		*fti_obj;
 	union {
 		char			 name[64]; /* for ofd_init0() */
 		struct obd_statfs	 osfs;    /* for obdofd_statfs() */
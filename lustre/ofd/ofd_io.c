@@ -582,8 +582,6 @@ static int ofd_preprw_read(const struct lu_env *env, struct obd_export *exp,
 		RETURN(PTR_ERR(fo));
 	LASSERT(fo != NULL);
 
-	ofd_info(env)->fti_obj = fo;
-
 	if (oa->o_valid & OBD_MD_FLATIME)
 		ofd_handle_atime(env, ofd, fo, oa->o_atime);
 
@@ -760,8 +758,6 @@ static int ofd_preprw_write(const struct lu_env *env, struct obd_export *exp,
 		GOTO(out, rc = PTR_ERR(fo));
 	LASSERT(fo != NULL);
 
-	ofd_info(env)->fti_obj = fo;
-
 	ofd_read_lock(env, fo);
 	if (!ofd_object_exists(fo)) {
 		CERROR("%s: BRW to missing obj "DOSTID"\n",
@@ -974,13 +970,18 @@ ofd_commitrw_read(const struct lu_env *env, struct ofd_device *ofd,
 
 	LASSERT(niocount > 0);
 
-	fo = ofd_info(env)->fti_obj;
+	/* the object is still referenced by ofd_preprw_read() */
+	fo = ofd_object_find(env, ofd, fid);
+	if (IS_ERR(fo))
+		RETURN(PTR_ERR(fo));
 	LASSERT(fo != NULL);
 	LASSERT(ofd_object_exists(fo));
 	dt_bufs_put(env, ofd_object_child(fo), lnb, niocount);
 
 	ofd_read_unlock(env, fo);
 	ofd_object_put(env, fo);
+	/* second put is pair to object_get in ofd_preprw_read */
+	ofd_object_put(env, fo);
 
 	RETURN(0);
 }
@@ -1225,7 +1226,15 @@ ofd_commitrw_write(const struct lu_env *env, struct obd_export *exp,
 
 	LASSERT(objcount == 1);
 
-	fo = ofd_info(env)->fti_obj;
+	/* find the object by its FID, the objects of a multi-object write
+	 * are all prepared before the first one is committed.  It is still
+	 * referenced by ofd_preprw_write() */
+	fo = ofd_object_find(env, ofd, fid);
+	if (IS_ERR(fo)) {
+		if (granted > 0)
+			tgt_grant_commit(exp, granted, old_rc);
+		RETURN(PTR_ERR(fo));
+	}
 	LASSERT(fo != NULL);
 
 	o = ofd_object_child(fo);
@@ -1386,6 +1395,8 @@ out_stop:
 out:
 	dt_bufs_put(env, o, lnb, niocount);
 	ofd_object_put(env, fo);
+	/* second put is pair to object_get in ofd_preprw_write */
+	ofd_object_put(env, fo);
 	if (granted > 0)
 		tgt_grant_commit(exp, granted, old_rc);
 	RETURN(rc);
@@ -186,11 +186,13 @@ static int osc_cached_mb_seq_show(struct seq_file *m, void *v)
 
 	seq_printf(m, "used_mb: %ld\n"
 		   "busy_cnt: %ld\n"
-		   "reclaim: %llu\n",
+		   "reclaim: %llu\n"
+		   "hot_kept: %ld\n",
 		   (atomic_long_read(&cli->cl_lru_in_list) +
 		    atomic_long_read(&cli->cl_lru_busy)) >> shift,
 		    atomic_long_read(&cli->cl_lru_busy),
-		   cli->cl_lru_reclaim);
+		   cli->cl_lru_reclaim,
+		   atomic_long_read(&cli->cl_lru_hot_kept));
 
 	return 0;
 }
@@ -480,6 +482,39 @@ static ssize_t resend_count_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(resend_count);
 
+static ssize_t brw_multi_objects_show(struct kobject *kobj,
+				      struct attribute *attr,
+				      char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+
+	return sprintf(buf, "%u\n", obd->u.cli.cl_brw_multi_objs);
+}
+
+static ssize_t brw_multi_objects_store(struct kobject *kobj,
+				       struct attribute *attr,
+				       const char *buffer,
+				       size_t count)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 10, &val);
+	if (rc)
+		return rc;
+
+	if (val < 1 || val > OSC_MAX_BRW_MULTI_OBJS)
+		return -ERANGE;
+
+	obd->u.cli.cl_brw_multi_objs = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(brw_multi_objects);
+
 static ssize_t checksum_dump_show(struct kobject *kobj,
 				  struct attribute *attr,
 				  char *buf)
@@ -928,6 +963,7 @@ int lprocfs_osc_attach_seqstat(struct obd_device *obd)
 
 static struct attribute *osc_attrs[] = {
 	&lustre_attr_active.attr,
+	&lustre_attr_brw_multi_objects.attr,
 	&lustre_attr_checksums.attr,
 	&lustre_attr_checksum_dump.attr,
 	&lustre_attr_contention_seconds.attr,
@@ -1526,6 +1526,143 @@ out:
 	return rc;
 }
 
+/*
+ * Pages added to the active extent of an IO are accounted on dirty page and
+ * grant credits, which the osc_io takes from client_obd in batches of
+ * OSC_IO_CREDIT_PAGES pages. This takes cl_loi_list_lock once per batch
+ * instead of once per page, so writers of different objects on the same OST
+ * don't contend on it page by page. The credits held by an IO are counted in
+ * cl_dirty_pages and cl_reserved_grant. They are settled before the active
+ * extent is released, because the grant used by the extent must be moved to
+ * cl_dirty_grant before the extent can be written out.
+ */
+#define OSC_IO_CREDIT_PAGES	32
+
+/* client_obd_list_lock held by caller */
+static void osc_io_credit_put_nolock(struct client_obd *cli,
+				     struct osc_io *oio)
+{
+	assert_spin_locked(&cli->cl_loi_list_lock);
+
+	cli->cl_reserved_grant -= oio->oi_grant_credits + oio->oi_grant_used;
+	cli->cl_avail_grant += oio->oi_grant_credits;
+	cli->cl_dirty_grant += oio->oi_grant_used;
+	cli->cl_dirty_pages -= oio->oi_dirty_credits;
+	atomic_long_sub(oio->oi_dirty_credits, &obd_dirty_pages);
+	if (oio->oi_dirty_credits > 0 || oio->oi_grant_credits > 0)
+		osc_wake_cache_waiters(cli);
+
+	oio->oi_dirty_credits = 0;
+	oio->oi_grant_credits = 0;
+	oio->oi_grant_used = 0;
+}
+
+void osc_io_credit_put(struct client_obd *cli, struct osc_io *oio)
+{
+	if (oio->oi_dirty_credits == 0 && oio->oi_grant_credits == 0 &&
+	    oio->oi_grant_used == 0)
+		return;
+
+	spin_lock(&cli->cl_loi_list_lock);
+	osc_io_credit_put_nolock(cli, oio);
+	spin_unlock(&cli->cl_loi_list_lock);
+}
+
+/* client_obd_list_lock held by caller */
+static void osc_io_credit_get_nolock(struct client_obd *cli,
+				     struct osc_io *oio)
+{
+	unsigned long chunksize = 1UL << cli->cl_chunkbits;
+	unsigned long pages = OSC_IO_CREDIT_PAGES;
+	unsigned long grants;
+
+	osc_io_credit_put_nolock(cli, oio);
+
+	if (cli->cl_dirty_pages >= cli->cl_dirty_max_pages)
+		return;
+
+	pages = min(pages, cli->cl_dirty_max_pages - cli->cl_dirty_pages);
+	if (atomic_long_add_return(pages, &obd_dirty_pages) >
+	    obd_max_dirty_pages) {
+		atomic_long_sub(pages, &obd_dirty_pages);
+		return;
+	}
+
+	/* enough grant to extend the active extent over all these pages */
+	grants = round_up(pages << PAGE_SHIFT, chunksize);
+	grants = min(grants, round_down(cli->cl_avail_grant, chunksize));
+
+	cli->cl_avail_grant -= grants;
+	cli->cl_reserved_grant += grants;
+	cli->cl_dirty_pages += pages;
+	oio->oi_dirty_credits = pages;
+	oio->oi_grant_credits = grants;
+	osc_update_next_shrink(cli);
+}
+
+/**
+ * Account \a oap, which is added to the active extent \a ext of \a oio, on
+ * the credits of the IO. The extent is expanded to cover \a index if needed.
+ *
+ * \retval 1 the page was accounted
+ * \retval 0 not enough credits, the page must go through
+ *	     osc_enter_cache_try()
+ * \retval negative errno the extent can not be expanded
+ */
+static int osc_io_credit_enter(struct client_obd *cli, struct osc_io *oio,
+			       struct osc_async_page *oap,
+			       struct osc_extent *ext, pgoff_t index)
+{
+	unsigned int chunksize = 1 << cli->cl_chunkbits;
+	bool expand = ext->oe_end < index;
+	unsigned int grants;
+	int rc;
+
+	if (oio->oi_dirty_credits == 0 ||
+	    (expand && oio->oi_grant_credits < chunksize)) {
+		spin_lock(&cli->cl_loi_list_lock);
+		osc_io_credit_get_nolock(cli, oio);
+		spin_unlock(&cli->cl_loi_list_lock);
+
+		if (oio->oi_dirty_credits == 0 ||
+		    (expand && oio->oi_grant_credits < chunksize))
+			return 0;
+	}
+
+	if (expand) {
+		grants = oio->oi_grant_credits;
+		rc = osc_extent_expand(ext, index, &grants);
+		if (rc < 0)
+			return rc;
+
+		OSC_EXTENT_DUMP(D_CACHE, ext, "expanded for %lu.\n", index);
+		oio->oi_grant_used += oio->oi_grant_credits - grants;
+		oio->oi_grant_credits = grants;
+	}
+
+	LASSERT(!(oap->oap_brw_page.flag & OBD_BRW_FROM_GRANT));
+	oap->oap_brw_page.flag |= OBD_BRW_FROM_GRANT;
+	oio->oi_dirty_credits--;
+
+	return 1;
+}
+
+/**
+ * Release the active extent of \a oio, after updating KMS for the pages
+ * committed to it and settling the credits the IO took for it.
+ */
+void osc_io_release_active(const struct lu_env *env, struct osc_io *oio)
+{
+	struct osc_extent *ext = oio->oi_active;
+
+	/* the extent can be written once released, its pages must be
+	 * covered by KMS by then, see osc_refresh_count() */
+	osc_io_touch(env, osc2cl(ext->oe_obj), oio);
+	osc_io_credit_put(osc_cli(ext->oe_obj), oio);
+	oio->oi_active = NULL;
+	osc_extent_release(env, ext);
+}
+
 /* Following two inlines exist to pass code fragments
  * to wait_event_idle_exclusive_timeout_cmd().  Passing
  * code fragments as macro args can look confusing, so
@@ -1923,39 +2060,35 @@ static int try_to_add_extent_for_io(struct client_obd *cli,
  * 4. If urgent list is not empty, goto 2;
  * 5. Traverse the extent tree from the 1st extent;
  * 6. Above steps exit if there is no space in this RPC.
+ *
+ * The extents are added to @data, which may already hold the extents of
+ * other objects, see osc_add_write_peers().
  */
 static unsigned int get_write_extents(struct osc_object *obj,
-				      struct list_head *rpclist)
+				      struct extent_rpc_data *data)
 {
 	struct client_obd *cli = osc_cli(obj);
 	struct osc_extent *ext;
-	struct extent_rpc_data data = {
-		.erd_rpc_list	= rpclist,
-		.erd_page_count	= 0,
-		.erd_max_pages	= cli->cl_max_pages_per_rpc,
-		.erd_max_chunks	= osc_max_write_chunks(cli),
-		.erd_max_extents = 256,
-	};
 
 	assert_osc_object_is_locked(obj);
 	while (!list_empty(&obj->oo_hp_exts)) {
 		ext = list_entry(obj->oo_hp_exts.next, struct osc_extent,
 				 oe_link);
-		if (!try_to_add_extent_for_io(cli, ext, &data))
-			return data.erd_page_count;
-		EASSERT(ext->oe_nr_pages <= data.erd_max_pages, ext);
+		if (!try_to_add_extent_for_io(cli, ext, data))
+			return data->erd_page_count;
+		EASSERT(ext->oe_nr_pages <= data->erd_max_pages, ext);
 	}
-	if (data.erd_page_count == data.erd_max_pages)
-		return data.erd_page_count;
+	if (data->erd_page_count == data->erd_max_pages)
+		return data->erd_page_count;
 
 	while (!list_empty(&obj->oo_urgent_exts)) {
 		ext = list_entry(obj->oo_urgent_exts.next,
 				 struct osc_extent, oe_link);
-		if (!try_to_add_extent_for_io(cli, ext, &data))
-			return data.erd_page_count;
+		if (!try_to_add_extent_for_io(cli, ext, data))
+			return data->erd_page_count;
 	}
-	if (data.erd_page_count == data.erd_max_pages)
-		return data.erd_page_count;
+	if (data->erd_page_count == data->erd_max_pages)
+		return data->erd_page_count;
 
 	/* One key difference between full extents and other extents: full
 	 * extents can usually only be added if the rpclist was empty, so if we
@@ -1965,11 +2098,11 @@ static unsigned int get_write_extents(struct osc_object *obj,
 	while (!list_empty(&obj->oo_full_exts)) {
 		ext = list_entry(obj->oo_full_exts.next,
 				 struct osc_extent, oe_link);
-		if (!try_to_add_extent_for_io(cli, ext, &data))
+		if (!try_to_add_extent_for_io(cli, ext, data))
 			break;
 	}
-	if (data.erd_page_count == data.erd_max_pages)
-		return data.erd_page_count;
+	if (data->erd_page_count == data->erd_max_pages)
+		return data->erd_page_count;
 
 	for (ext = first_extent(obj);
 	     ext;
@@ -1979,10 +2112,89 @@ static unsigned int get_write_extents(struct osc_object *obj,
 		    (!list_empty(&ext->oe_link) && ext->oe_owner))
 			continue;
 
-		if (!try_to_add_extent_for_io(cli, ext, &data))
-			return data.erd_page_count;
+		if (!try_to_add_extent_for_io(cli, ext, data))
+			return data->erd_page_count;
+	}
+	return data->erd_page_count;
+}
+
+/**
+ * Add the writes of other objects ready to send an RPC to the write RPC
+ * of @osc being built in @data, as long as it has room for them.  This packs
+ * the small writes of many files, e.g. flushed at close, in one RPC.
+ *
+ * The objects are taken from the head of cl_loi_ready_list and their
+ * extents are collected under their own lock, @osc must not be locked.
+ */
+static void osc_add_write_peers(const struct lu_env *env,
+				struct client_obd *cli, struct osc_object *osc,
+				struct extent_rpc_data *data)
+{
+	struct osc_extent *ext;
+	struct osc_extent *tmp;
+	unsigned int nr_objs = 1;
+	int rc;
+
+	while (nr_objs < cli->cl_brw_multi_objs &&
+	       data->erd_page_count < data->erd_max_pages) {
+		struct osc_object *peer = NULL;
+		unsigned int page_count = data->erd_page_count;
+
+		spin_lock(&cli->cl_loi_list_lock);
+		if (!list_empty(&cli->cl_loi_ready_list)) {
+			peer = list_entry(cli->cl_loi_ready_list.next,
+					  struct osc_object, oo_ready_item);
+			if (peer == osc ||
+			    atomic_read(&peer->oo_nr_writes) == 0 ||
+			    atomic_read(&peer->oo_nr_writes) >
+			    data->erd_max_pages - page_count) {
+				peer = NULL;
+			} else {
+				list_del_init(&peer->oo_ready_item);
+				cl_object_get(osc2cl(peer));
+			}
+		}
+		spin_unlock(&cli->cl_loi_list_lock);
+		if (peer == NULL)
+			break;
+
+		osc_object_lock(peer);
+		if (osc_makes_rpc(cli, peer, OBD_BRW_WRITE))
+			get_write_extents(peer, data);
+		page_count = data->erd_page_count - page_count;
+		if (page_count > 0) {
+			osc_update_pending(peer, OBD_BRW_WRITE, -page_count);
+			list_for_each_entry(ext, data->erd_rpc_list, oe_link) {
+				if (ext->oe_obj != peer)
+					continue;
+				if (ext->oe_state == OES_CACHE)
+					osc_extent_state_set(ext, OES_LOCKING);
+				else if (ext->oe_state == OES_LOCK_DONE)
+					osc_extent_state_set(ext, OES_RPC);
+			}
+		}
+		osc_object_unlock(peer);
+
+		list_for_each_entry_safe(ext, tmp, data->erd_rpc_list,
+					 oe_link) {
+			if (ext->oe_obj != peer ||
+			    ext->oe_state != OES_LOCKING)
+				continue;
+			rc = osc_extent_make_ready(env, ext);
+			if (unlikely(rc < 0)) {
+				list_del_init(&ext->oe_link);
+				osc_extent_finish(env, ext, 0, rc);
+			}
+		}
+
+		osc_list_maint(cli, peer);
+		cl_object_put(env, osc2cl(peer));
+
+		/* nothing of the object could share the RPC */
+		if (page_count == 0)
+			break;
+		nr_objs++;
 	}
-	return data.erd_page_count;
 }
 
 static int
@@ -1994,6 +2206,13 @@ __must_hold(osc)
 	struct osc_extent *ext;
 	struct osc_extent *tmp;
 	struct osc_extent *first = NULL;
+	struct extent_rpc_data data = {
+		.erd_rpc_list	= &rpclist,
+		.erd_page_count	= 0,
+		.erd_max_pages	= cli->cl_max_pages_per_rpc,
+		.erd_max_chunks	= osc_max_write_chunks(cli),
+		.erd_max_extents = 256,
+	};
 	unsigned int page_count = 0;
 	int srvlock = 0;
 	int rc = 0;
@@ -2001,7 +2220,7 @@ __must_hold(osc)
 
 	assert_osc_object_is_locked(osc);
 
-	page_count = get_write_extents(osc, &rpclist);
+	page_count = get_write_extents(osc, &data);
 	LASSERT(equi(page_count == 0, list_empty(&rpclist)));
 
 	if (list_empty(&rpclist))
@@ -2039,6 +2258,13 @@ __must_hold(osc)
 		}
 	}
 
+	/* fill the RPC with the writes of other objects, the server locks
+	 * only one object for a lockless write */
+	if (first != NULL && !srvlock && !first->oe_dio &&
+	    cli->cl_brw_multi_objs > 1 && cli->cl_import != NULL &&
+	    imp_connect_brw_multi(cli->cl_import))
+		osc_add_write_peers(env, cli, osc, &data);
+
 	if (!list_empty(&rpclist)) {
 		LASSERT(page_count > 0);
 		rc = osc_build_rpc(env, cli, &rpclist, OBD_BRW_WRITE);
@@ -2349,35 +2575,44 @@ int osc_queue_async_io(const struct lu_env *env, struct cl_io *io,
 		if (ext->oe_end >= index)
 			grants = 0;
 
-		/* it doesn't need any grant to dirty this page */
-		spin_lock(&cli->cl_loi_list_lock);
-		rc = osc_enter_cache_try(cli, oap, grants);
-		if (rc == 0) { /* try failed */
+		rc = osc_io_credit_enter(cli, oio, oap, ext, index);
+		if (rc > 0) {
+			grants = 0;
+		} else if (rc < 0) {
 			grants = 0;
 			need_release = 1;
-		} else if (ext->oe_end < index) {
-			tmp = grants;
-			/* try to expand this extent */
-			rc = osc_extent_expand(ext, index, &tmp);
-			if (rc < 0) {
-				need_release = 1;
-				/* don't free reserved grant */
-			} else {
-				OSC_EXTENT_DUMP(D_CACHE, ext,
-						"expanded for %lu.\n", index);
-				osc_unreserve_grant_nolock(cli, grants, tmp);
+		} else {
+			/* it doesn't need any grant to dirty this page */
+			spin_lock(&cli->cl_loi_list_lock);
+			rc = osc_enter_cache_try(cli, oap, grants);
+			if (rc == 0) { /* try failed */
 				grants = 0;
+				need_release = 1;
+			} else if (ext->oe_end < index) {
+				tmp = grants;
+				/* try to expand this extent */
+				rc = osc_extent_expand(ext, index, &tmp);
+				if (rc < 0) {
+					need_release = 1;
+					/* don't free reserved grant */
+				} else {
+					OSC_EXTENT_DUMP(D_CACHE, ext,
+							"expanded for %lu.\n",
+							index);
+					osc_unreserve_grant_nolock(cli, grants,
+								   tmp);
+					grants = 0;
+				}
 			}
+			spin_unlock(&cli->cl_loi_list_lock);
 		}
-		spin_unlock(&cli->cl_loi_list_lock);
 		rc = 0;
 	} else if (ext != NULL) {
 		/* index is located outside of active extent */
 		need_release = 1;
 	}
 	if (need_release) {
-		osc_extent_release(env, ext);
-		oio->oi_active = NULL;
+		osc_io_release_active(env, oio);
 		ext = NULL;
 	}
 
@@ -49,6 +49,8 @@ int lru_queue_work(const struct lu_env *env, void *data);
 int osc_extent_finish(const struct lu_env *env, struct osc_extent *ext,
 		      int sent, int rc);
 int osc_extent_release(const struct lu_env *env, struct osc_extent *ext);
+void osc_io_credit_put(struct client_obd *cli, struct osc_io *oio);
+void osc_io_release_active(const struct lu_env *env, struct osc_io *oio);
 int osc_lock_discard_pages(const struct lu_env *env, struct osc_object *osc,
 			   pgoff_t start, pgoff_t end, bool discard);
 
@@ -163,6 +165,8 @@ void osc_dec_unstable_pages(struct ptlrpc_request *req);
 bool osc_over_unstable_soft_limit(struct client_obd *cli);
 void osc_page_touch_at(const struct lu_env *env, struct cl_object *obj,
 		       pgoff_t idx, size_t to);
+void osc_io_touch(const struct lu_env *env, struct cl_object *obj,
+		  struct osc_io *oio);
 
 struct ldlm_lock *osc_obj_dlmlock_at_pgoff(const struct lu_env *env,
 					   struct osc_object *obj,
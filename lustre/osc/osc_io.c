@@ -284,6 +284,23 @@ void osc_page_touch_at(const struct lu_env *env, struct cl_object *obj,
 	EXIT;
 }
 
+/**
+ * Update KMS and times for the run of pages committed by \a oio so far.
+ *
+ * osc_io_commit_async() is given a contiguous run of pages, so only the last
+ * page added to the active extent matters and the object attributes are
+ * locked once per run instead of once per page.
+ */
+void osc_io_touch(const struct lu_env *env, struct cl_object *obj,
+		  struct osc_io *oio)
+{
+	if (oio->oi_touch_to == 0)
+		return;
+
+	osc_page_touch_at(env, obj, oio->oi_touch_index, oio->oi_touch_to);
+	oio->oi_touch_to = 0;
+}
+
 int osc_io_commit_async(const struct lu_env *env,
 			const struct cl_io_slice *ios,
 			struct cl_page_list *qin, int from, int to,
@@ -339,10 +356,15 @@ int osc_io_commit_async(const struct lu_env *env,
 			result = osc_page_cache_add(env, opg, io, cb);
 			if (result != 0)
 				break;
-		}
 
-		osc_page_touch_at(env, osc2cl(osc), osc_index(opg),
-				  page == last_page ? to : PAGE_SIZE);
+			/* the page can't be written before the active extent
+			 * is released, see osc_io_release_active() */
+			oio->oi_touch_index = osc_index(opg);
+			oio->oi_touch_to = page == last_page ? to : PAGE_SIZE;
+		} else {
+			osc_page_touch_at(env, osc2cl(osc), osc_index(opg),
+					  page == last_page ? to : PAGE_SIZE);
+		}
 
 		cl_page_list_del(env, qin, page);
 
@@ -357,16 +379,17 @@ int osc_io_commit_async(const struct lu_env *env,
 	if (pagevec_count(pvec) != 0)
 		(*cb)(env, io, pvec);
 
+	/* the inode size is merged from KMS once this returns */
+	osc_io_touch(env, osc2cl(osc), oio);
+
 	/* Can't access these pages any more. Page can be in transfer and
 	 * complete at any time. */
 
 	/* for sync write, kernel will wait for this page to be flushed before
 	 * osc_io_end() is called, so release it earlier.
 	 * for mkwrite(), it's known there is no further pages. */
-	if (cl_io_is_sync_write(io) && oio->oi_active != NULL) {
-		osc_extent_release(env, oio->oi_active);
-		oio->oi_active = NULL;
-	}
+	if (cl_io_is_sync_write(io) && oio->oi_active != NULL)
+		osc_io_release_active(env, oio);
 
 	CDEBUG(D_INFO, "%d %d\n", qin->pl_nr, result);
 	RETURN(result);
@@ -458,6 +481,7 @@ void osc_io_rw_iter_fini(const struct lu_env *env,
 		osc_lru_unreserve(osc_cli(osc), oio->oi_lru_reserved);
 		oio->oi_lru_reserved = 0;
 	}
+	osc_io_credit_put(osc_cli(osc), oio);
 	oio->oi_write_osclock = NULL;
 
 	osc_io_iter_fini(env, ios);
@@ -1047,10 +1071,9 @@ void osc_io_end(const struct lu_env *env, const struct cl_io_slice *slice)
 {
 	struct osc_io *oio = cl2osc_io(env, slice);
 
-	if (oio->oi_active) {
-		osc_extent_release(env, oio->oi_active);
-		oio->oi_active = NULL;
-	}
+	if (oio->oi_active)
+		osc_io_release_active(env, oio);
+	osc_io_credit_put(osc_cli(cl2osc(slice->cis_obj)), oio);
 }
 EXPORT_SYMBOL(osc_io_end);
 
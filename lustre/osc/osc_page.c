@@ -420,27 +420,38 @@ int lru_queue_work(const struct lu_env *env, void *data)
 void osc_lru_add_batch(struct client_obd *cli, struct list_head *plist)
 {
 	LIST_HEAD(lru);
+	struct cl_lru_list *cll;
 	struct osc_async_page *oap;
 	long npages = 0;
+	int cpt;
 
+	cpt = cfs_cpt_current(cfs_cpt_tab, 1);
 	list_for_each_entry(oap, plist, oap_pending_item) {
 		struct osc_page *opg = oap2osc_page(oap);
 
 		if (!opg->ops_in_lru)
 			continue;
 
+		/* the page stayed in LRU while it was transferred again */
+		if (!list_empty(&opg->ops_lru)) {
+			opg->ops_lru_ref = true;
+			continue;
+		}
+
 		++npages;
-		LASSERT(list_empty(&opg->ops_lru));
+		opg->ops_lru_cpt = cpt;
 		list_add(&opg->ops_lru, &lru);
 	}
 
 	if (npages > 0) {
-		spin_lock(&cli->cl_lru_list_lock);
-		list_splice_tail(&lru, &cli->cl_lru_list);
+		cll = cli->cl_lru_lists[cpt];
+		spin_lock(&cll->cll_lock);
+		list_splice_tail(&lru, &cll->cll_pages);
+		spin_unlock(&cll->cll_lock);
+
 		atomic_long_sub(npages, &cli->cl_lru_busy);
 		atomic_long_add(npages, &cli->cl_lru_in_list);
 		cli->cl_lru_last_used = ktime_get_real_seconds();
-		spin_unlock(&cli->cl_lru_list_lock);
 
 		if (waitqueue_active(&osc_lru_waitq))
 			(void)ptlrpcd_queue_work(cli->cl_lru_work);
@@ -461,14 +472,16 @@ static void __osc_lru_del(struct client_obd *cli, struct osc_page *opg)
 static void osc_lru_del(struct client_obd *cli, struct osc_page *opg)
 {
 	if (opg->ops_in_lru) {
-		spin_lock(&cli->cl_lru_list_lock);
+		struct cl_lru_list *cll = cli->cl_lru_lists[opg->ops_lru_cpt];
+
+		spin_lock(&cll->cll_lock);
 		if (!list_empty(&opg->ops_lru)) {
 			__osc_lru_del(cli, opg);
 		} else {
 			LASSERT(atomic_long_read(&cli->cl_lru_busy) > 0);
 			atomic_long_dec(&cli->cl_lru_busy);
 		}
-		spin_unlock(&cli->cl_lru_list_lock);
+		spin_unlock(&cll->cll_lock);
 
 		atomic_long_inc(cli->cl_lru_left);
 		/* this is a great place to release more LRU pages if
@@ -485,22 +498,18 @@ static void osc_lru_del(struct client_obd *cli, struct osc_page *opg)
 }
 
 /**
- * Delete page from LRU list for redirty.
+ * Page is used again for redirty.
+ *
+ * The page is left in LRU and only marked as referenced, so this doesn't
+ * take any lock.  The shrinker doesn't free it while it is busy, and gives
+ * it another pass once it is referenced, see osc_lru_shrink().
  */
 static void osc_lru_use(struct client_obd *cli, struct osc_page *opg)
 {
 	/* If page is being transferred for the first time,
 	 * ops_lru should be empty */
-	if (opg->ops_in_lru) {
-		if (list_empty(&opg->ops_lru))
-			return;
-		spin_lock(&cli->cl_lru_list_lock);
-		if (!list_empty(&opg->ops_lru)) {
-			__osc_lru_del(cli, opg);
-			atomic_long_inc(&cli->cl_lru_busy);
-		}
-		spin_unlock(&cli->cl_lru_list_lock);
-	}
+	if (opg->ops_in_lru && !list_empty(&opg->ops_lru))
+		opg->ops_lru_ref = true;
 }
 
 static void discard_pagevec(const struct lu_env *env, struct cl_io *io,
@@ -548,6 +557,10 @@ static inline bool lru_page_busy(struct client_obd *cli, struct cl_page *page)
 
 /**
  * Drop @target of pages from LRU at most.
+ *
+ * The LRU lists of all CPU partitions are drained in turn, starting from a
+ * different one on each call.  A page referenced since it was added to LRU
+ * is moved to the tail of its list instead of being freed.
  */
 long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 		   long target, bool force)
@@ -555,10 +568,16 @@ long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 	struct cl_io *io;
 	struct cl_object *clobj = NULL;
 	struct cl_page **pvec;
+	struct cl_lru_list *cll;
 	struct osc_page *opg;
+	time64_t now = ktime_get_real_seconds();
 	long count = 0;
+	long hot_kept = 0;
 	int maxscan = 0;
 	int index = 0;
+	int ncpt;
+	int cpt;
+	int i;
 	int rc = 0;
 	ENTRY;
 
@@ -578,96 +597,123 @@ long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 		}
 	} else {
 		atomic_inc(&cli->cl_lru_shrinkers);
+		cli->cl_lru_reclaim++;
 	}
 
 	pvec = (struct cl_page **)osc_env_info(env)->oti_pvec;
 	io = osc_env_thread_io(env);
 
-	spin_lock(&cli->cl_lru_list_lock);
-	if (force)
-		cli->cl_lru_reclaim++;
 	maxscan = min(target << 1, atomic_long_read(&cli->cl_lru_in_list));
-	while (!list_empty(&cli->cl_lru_list)) {
-		struct cl_page *page;
-		bool will_free = false;
-
-		if (!force && atomic_read(&cli->cl_lru_shrinkers) > 1)
-			break;
+	ncpt = cfs_percpt_number(cli->cl_lru_lists);
+	cpt = atomic_inc_return(&cli->cl_lru_shrink_cpt);
+	for (i = 0; i < ncpt; i++) {
+		cll = cli->cl_lru_lists[(cpt + i) % ncpt];
 
-		if (--maxscan < 0)
-			break;
+		spin_lock(&cll->cll_lock);
+		while (!list_empty(&cll->cll_pages)) {
+			struct cl_page *page;
+			bool will_free = false;
 
-		opg = list_entry(cli->cl_lru_list.next, struct osc_page,
-				 ops_lru);
-		page = opg->ops_cl.cpl_page;
-		if (lru_page_busy(cli, page)) {
-			list_move_tail(&opg->ops_lru, &cli->cl_lru_list);
-			continue;
-		}
+			if (!force && atomic_read(&cli->cl_lru_shrinkers) > 1)
+				break;
 
-		LASSERT(page->cp_obj != NULL);
-		if (clobj != page->cp_obj) {
-			struct cl_object *tmp = page->cp_obj;
+			if (--maxscan < 0)
+				break;
 
-			cl_object_get(tmp);
-			spin_unlock(&cli->cl_lru_list_lock);
+			opg = list_entry(cll->cll_pages.next, struct osc_page,
+					 ops_lru);
+			page = opg->ops_cl.cpl_page;
+			if (lru_page_busy(cli, page)) {
+				list_move_tail(&opg->ops_lru, &cll->cll_pages);
+				continue;
+			}
 
-			if (clobj != NULL) {
-				discard_pagevec(env, io, pvec, index);
-				index = 0;
+			/* second chance for a page used again */
+			if (opg->ops_lru_ref) {
+				opg->ops_lru_ref = false;
+				list_move_tail(&opg->ops_lru, &cll->cll_pages);
+				continue;
+			}
 
-				cl_io_fini(env, io);
-				cl_object_put(env, clobj);
-				clobj = NULL;
+			LASSERT(page->cp_obj != NULL);
+			/* keep the pages of a hot file as long as the rest
+			 * of the scan can still reach the target */
+			if (cl_object_header(page->cp_obj)->coh_hot_expire >
+			    now && maxscan > target - count) {
+				hot_kept++;
+				list_move_tail(&opg->ops_lru, &cll->cll_pages);
+				continue;
 			}
 
-			clobj = tmp;
-			io->ci_obj = clobj;
-			io->ci_ignore_layout = 1;
-			rc = cl_io_init(env, io, CIT_MISC, clobj);
+			if (clobj != page->cp_obj) {
+				struct cl_object *tmp = page->cp_obj;
 
-			spin_lock(&cli->cl_lru_list_lock);
+				cl_object_get(tmp);
+				spin_unlock(&cll->cll_lock);
 
-			if (rc != 0)
-				break;
+				if (clobj != NULL) {
+					discard_pagevec(env, io, pvec, index);
+					index = 0;
 
-			++maxscan;
-			continue;
-		}
+					cl_io_fini(env, io);
+					cl_object_put(env, clobj);
+					clobj = NULL;
+				}
+
+				clobj = tmp;
+				io->ci_obj = clobj;
+				io->ci_ignore_layout = 1;
+				rc = cl_io_init(env, io, CIT_MISC, clobj);
 
-		if (cl_page_own_try(env, io, page) == 0) {
-			if (!lru_page_busy(cli, page)) {
-				/* remove it from lru list earlier to avoid
-				 * lock contention */
-				__osc_lru_del(cli, opg);
-				opg->ops_in_lru = 0; /* will be discarded */
-
-				cl_page_get(page);
-				will_free = true;
-			} else {
-				cl_page_disown(env, io, page);
+				spin_lock(&cll->cll_lock);
+
+				if (rc != 0)
+					break;
+
+				++maxscan;
+				continue;
 			}
-		}
 
-		if (!will_free) {
-			list_move_tail(&opg->ops_lru, &cli->cl_lru_list);
-			continue;
-		}
+			if (cl_page_own_try(env, io, page) == 0) {
+				if (!lru_page_busy(cli, page)) {
+					/* remove it from lru list earlier to
+					 * avoid lock contention */
+					__osc_lru_del(cli, opg);
+					/* will be discarded */
+					opg->ops_in_lru = 0;
+
+					cl_page_get(page);
+					will_free = true;
+				} else {
+					cl_page_disown(env, io, page);
+				}
+			}
 
-		/* Don't discard and free the page with cl_lru_list held */
-		pvec[index++] = page;
-		if (unlikely(index == OTI_PVEC_SIZE)) {
-			spin_unlock(&cli->cl_lru_list_lock);
-			discard_pagevec(env, io, pvec, index);
-			index = 0;
+			if (!will_free) {
+				list_move_tail(&opg->ops_lru, &cll->cll_pages);
+				continue;
+			}
 
-			spin_lock(&cli->cl_lru_list_lock);
+			/* Don't discard and free the page with the LRU list
+			 * lock held */
+			pvec[index++] = page;
+			if (unlikely(index == OTI_PVEC_SIZE)) {
+				spin_unlock(&cll->cll_lock);
+				discard_pagevec(env, io, pvec, index);
+				index = 0;
+
+				spin_lock(&cll->cll_lock);
+			}
+
+			if (++count >= target)
+				break;
 		}
+		spin_unlock(&cll->cll_lock);
 
-		if (++count >= target)
+		if (rc != 0 || maxscan < 0 || count >= target ||
+		    (!force && atomic_read(&cli->cl_lru_shrinkers) > 1))
 			break;
 	}
-	spin_unlock(&cli->cl_lru_list_lock);
 
 	if (clobj != NULL) {
 		discard_pagevec(env, io, pvec, index);
@@ -676,6 +722,8 @@ long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 		cl_object_put(env, clobj);
 	}
 
+	if (hot_kept > 0)
+		atomic_long_add(hot_kept, &cli->cl_lru_hot_kept);
 	atomic_dec(&cli->cl_lru_shrinkers);
 	if (count > 0) {
 		atomic_long_add(count, cli->cl_lru_left);
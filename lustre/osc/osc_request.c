@@ -62,6 +62,15 @@ module_param(osc_reqpool_mem_max, uint, 0444);
 static int osc_idle_timeout = 20;
 module_param(osc_idle_timeout, uint, 0644);
 
+/* min pages per worker to encrypt or checksum a bulk in parallel, 0 is off */
+static unsigned int osc_brw_split_pages = 32;
+module_param(osc_brw_split_pages, uint, 0644);
+MODULE_PARM_DESC(osc_brw_split_pages,
+		 "min pages per worker to process a bulk in parallel");
+
+/* per-CPT workers processing the pages of a bulk, see osc_brw_pages_run() */
+static struct workqueue_struct **osc_brw_wqs;
+
 #define osc_grant_args osc_brw_async_args
 
 struct osc_setattr_args {
@@ -86,6 +95,7 @@ struct osc_ladvise_args {
 static void osc_release_ppga(struct brw_page **ppga, size_t count);
 static int brw_interpret(const struct lu_env *env, struct ptlrpc_request *req,
 			 void *data, int rc);
+static void osc_grant_reclaim(struct client_obd *cli);
 
 void osc_pack_req_body(struct ptlrpc_request *req, struct obdo *oa)
 {
@@ -784,6 +794,9 @@ static void osc_update_grant(struct client_obd *cli, struct ost_body *body)
 		CDEBUG(D_CACHE, "got %llu extra grant\n", body->oa.o_grant);
                 __osc_update_grant(cli, body->oa.o_grant);
         }
+	if ((body->oa.o_valid & OBD_MD_FLFLAGS) &&
+	    (body->oa.o_flags & OBD_FL_GRANT_RECLAIM))
+		osc_grant_reclaim(cli);
 }
 
 /**
@@ -843,8 +856,14 @@ static int osc_shrink_grant(struct client_obd *cli)
 			     (cli->cl_max_pages_per_rpc << PAGE_SHIFT);
 
 	spin_lock(&cli->cl_loi_list_lock);
-	if (cli->cl_avail_grant <= target_bytes)
+	/* A client which has not written for a whole shrink interval, or
+	 * which the server asked to give grant back because it is short of
+	 * space, goes straight to a single RPC worth of grant. */
+	if (cli->cl_avail_grant <= target_bytes || cli->cl_grant_reclaim ||
+	    ktime_get_seconds() - cli->cl_last_write_rpc >
+	    cli->cl_grant_shrink_interval)
 		target_bytes = cli->cl_max_pages_per_rpc << PAGE_SHIFT;
+	cli->cl_grant_reclaim = false;
 	spin_unlock(&cli->cl_loi_list_lock);
 
 	return osc_shrink_grant_to_target(cli, target_bytes);
@@ -910,6 +929,7 @@ static int osc_should_shrink_grant(struct client_obd *client)
 
 	if (!OCD_HAS_FLAG(&client->cl_import->imp_connect_data, GRANT_SHRINK) ||
 	    client->cl_import->imp_grant_shrink_disabled) {
+		client->cl_grant_reclaim = false;
 		osc_update_next_shrink(client);
 		return 0;
 	}
@@ -923,8 +943,10 @@ static int osc_should_shrink_grant(struct client_obd *client)
 		if (client->cl_import->imp_state == LUSTRE_IMP_FULL &&
 		    client->cl_avail_grant > brw_size)
 			return 1;
-		else
-			osc_update_next_shrink(client);
+
+		/* nothing to give back, let the server ask again */
+		client->cl_grant_reclaim = false;
+		osc_update_next_shrink(client);
 	}
         return 0;
 }
@@ -979,6 +1001,28 @@ void osc_schedule_grant_work(void)
 	schedule_work(&work.work);
 }
 
+/**
+ * Handle a server request to release the grant this client does not need
+ * for its recent writes: shrink now rather than at the next interval.
+ */
+static void osc_grant_reclaim(struct client_obd *cli)
+{
+	bool kick;
+
+	spin_lock(&cli->cl_loi_list_lock);
+	kick = !cli->cl_grant_reclaim;
+	cli->cl_grant_reclaim = true;
+	spin_unlock(&cli->cl_loi_list_lock);
+	if (!kick)
+		return;
+
+	CDEBUG(D_CACHE, "%s: server reclaims grant %lu\n", cli_name(cli),
+	       cli->cl_avail_grant);
+	cli->cl_next_shrink_grant = ktime_get_seconds();
+	if (client_gtd.gtd_stopped == 0)
+		mod_delayed_work(system_wq, &work, 0);
+}
+
 /**
  * Start grant thread for returing grant to server for idle clients.
  */
@@ -1180,13 +1224,285 @@ static inline int can_merge_pages(struct brw_page *p1, struct brw_page *p2)
         return (p1->off + p1->count == p2->off);
 }
 
+/* A page processing function run in parallel on the pages of a bulk */
+typedef int (*osc_brw_page_fn_t)(void *data, unsigned int arg,
+				 struct brw_page *pg, u32 idx);
+
+struct osc_brw_task {
+	struct work_struct	 obt_work;
+	struct completion	 obt_done;
+	void			*obt_data;
+	struct brw_page		**obt_pga;
+	u32			 obt_first;
+	u32			 obt_count;
+	osc_brw_page_fn_t	 obt_fn;
+	unsigned int		 obt_arg;
+	int			 obt_rc;
+};
+
+/* run the page function on the pages of the task until the first error */
+static void osc_brw_task_run(struct osc_brw_task *obt)
+{
+	u32 i;
+
+	for (i = 0; i < obt->obt_count; i++) {
+		obt->obt_rc = obt->obt_fn(obt->obt_data, obt->obt_arg,
+					  obt->obt_pga[i], obt->obt_first + i);
+		if (obt->obt_rc)
+			break;
+	}
+}
+
+static void osc_brw_task_fn(struct work_struct *work)
+{
+	struct osc_brw_task *obt = container_of(work, struct osc_brw_task,
+						obt_work);
+
+	osc_brw_task_run(obt);
+	complete(&obt->obt_done);
+}
+
+/**
+ * Number of chunks osc_brw_pages_run() cuts \a page_count pages in on CPT
+ * \a cpt, each of \a chunk pages but the last.  1 means the pages are
+ * processed by the caller alone.
+ */
+static int osc_brw_pages_split(int cpt, u32 page_count, u32 *chunk)
+{
+	unsigned int split = osc_brw_split_pages;
+	int nr;
+
+	*chunk = page_count;
+	if (osc_brw_wqs == NULL)
+		return 1;
+
+	nr = split > 0 ? page_count / split : 0;
+	nr = min(nr, cfs_cpt_weight(cfs_cpt_tab, cpt));
+	if (nr <= 1)
+		return 1;
+
+	*chunk = DIV_ROUND_UP(page_count, nr);
+	return DIV_ROUND_UP(page_count, *chunk);
+}
+
+/**
+ * Run \a fn on each of the \a page_count pages of \a pga, it gets \a data,
+ * \a arg and the index of the page in \a pga.
+ *
+ * The page array is cut in chunks of at least osc_brw_split_pages pages
+ * which are processed by the workers of the CPT of the caller, the caller
+ * doing the first chunk itself.  This way the encryption or the checksum of
+ * one large RPC uses all the cores of a CPT instead of one.  The page
+ * function must leave a page it fails on untouched, because the other chunks
+ * go on.
+ *
+ * \retval 0		success
+ * \retval negative	error of the first failing chunk
+ */
+static int osc_brw_pages_run(void *data, struct brw_page **pga,
+			     u32 page_count, osc_brw_page_fn_t fn,
+			     unsigned int arg)
+{
+	struct osc_brw_task single = {
+		.obt_data = data,
+		.obt_pga = pga,
+		.obt_count = page_count,
+		.obt_fn = fn,
+		.obt_arg = arg,
+	};
+	struct osc_brw_task *tasks;
+	u32 chunk;
+	int cpt = cfs_cpt_current(cfs_cpt_tab, 1);
+	int nr;
+	int rc = 0;
+	int i;
+
+	nr = osc_brw_pages_split(cpt, page_count, &chunk);
+	if (nr > 1)
+		OBD_ALLOC_PTR_ARRAY(tasks, nr);
+	else
+		tasks = NULL;
+
+	if (tasks == NULL) {
+		osc_brw_task_run(&single);
+		return single.obt_rc;
+	}
+
+	for (i = 0; i < nr; i++) {
+		struct osc_brw_task *obt = &tasks[i];
+
+		obt->obt_data = data;
+		obt->obt_pga = pga + i * chunk;
+		obt->obt_first = i * chunk;
+		obt->obt_count = min(chunk, page_count - i * chunk);
+		obt->obt_fn = fn;
+		obt->obt_arg = arg;
+		if (i == 0)
+			continue;
+
+		INIT_WORK(&obt->obt_work, osc_brw_task_fn);
+		init_completion(&obt->obt_done);
+		queue_work(osc_brw_wqs[cpt], &obt->obt_work);
+	}
+
+	osc_brw_task_run(&tasks[0]);
+	rc = tasks[0].obt_rc;
+	for (i = 1; i < nr; i++) {
+		wait_for_completion(&tasks[i].obt_done);
+		if (rc == 0)
+			rc = tasks[i].obt_rc;
+	}
+	OBD_FREE_PTR_ARRAY(tasks, nr);
+
+	return rc;
+}
+
 #if IS_ENABLED(CONFIG_CRC_T10DIF)
+/* guard tags of the pages of a bulk, generated in parallel */
+struct osc_t10pi_guards {
+	const char	*otg_obd_name;
+	obd_dif_csum_fn	*otg_fn;
+	int		 otg_sector_size;
+	/* guard slots per page */
+	int		 otg_stride;
+	/* checksummed bytes of the last page */
+	unsigned int	 otg_last_count;
+	u32		 otg_last;
+	__u16		*otg_guards;
+	__u16		*otg_used;
+};
+
+/* most guard tags of a bulk, with the smallest sector size */
+#define OSC_T10PI_MAX_GUARDS	(PTLRPC_MAX_BRW_SIZE / 512)
+
+/*
+ * Guard tag buffers of a CPT for the largest bulk, allocated at first use,
+ * so that generating the guard tags of a bulk in parallel does not allocate
+ * anything.  A bulk finding the buffers of its CPT busy is done serially,
+ * the workers of the CPT being busy with the other one anyway.
+ */
+struct osc_t10pi_buf {
+	struct mutex	 otb_mutex;
+	__u16		*otb_guards;
+	__u16		*otb_used;
+};
+
+static struct osc_t10pi_buf *osc_t10pi_bufs;
+
+static void osc_t10pi_bufs_fini(void)
+{
+	int i;
+
+	if (osc_t10pi_bufs == NULL)
+		return;
+
+	for (i = 0; i < cfs_cpt_number(cfs_cpt_tab); i++) {
+		struct osc_t10pi_buf *otb = &osc_t10pi_bufs[i];
+
+		if (otb->otb_guards != NULL)
+			OBD_FREE_PTR_ARRAY_LARGE(otb->otb_guards,
+						 OSC_T10PI_MAX_GUARDS);
+		if (otb->otb_used != NULL)
+			OBD_FREE_PTR_ARRAY_LARGE(otb->otb_used,
+						 PTLRPC_MAX_BRW_PAGES);
+	}
+	OBD_FREE_PTR_ARRAY(osc_t10pi_bufs, cfs_cpt_number(cfs_cpt_tab));
+	osc_t10pi_bufs = NULL;
+}
+
+static int osc_t10pi_bufs_init(void)
+{
+	int i;
+
+	OBD_ALLOC_PTR_ARRAY(osc_t10pi_bufs, cfs_cpt_number(cfs_cpt_tab));
+	if (osc_t10pi_bufs == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < cfs_cpt_number(cfs_cpt_tab); i++)
+		mutex_init(&osc_t10pi_bufs[i].otb_mutex);
+
+	return 0;
+}
+
+/**
+ * Take the guard tag buffers of CPT \a cpt for the \a npages pages of a
+ * bulk with \a stride guard tags per page.
+ *
+ * \retval buffers to release with osc_t10pi_buf_put()
+ * \retval NULL if they are busy or can't be allocated
+ */
+static struct osc_t10pi_buf *osc_t10pi_buf_get(int cpt, u32 npages,
+						int stride)
+{
+	struct osc_t10pi_buf *otb;
+
+	if (osc_t10pi_bufs == NULL || npages > PTLRPC_MAX_BRW_PAGES ||
+	    npages * stride > OSC_T10PI_MAX_GUARDS)
+		return NULL;
+
+	otb = &osc_t10pi_bufs[cpt];
+	if (!mutex_trylock(&otb->otb_mutex))
+		return NULL;
+
+	if (otb->otb_guards == NULL)
+		OBD_ALLOC_PTR_ARRAY_LARGE(otb->otb_guards,
+					  OSC_T10PI_MAX_GUARDS);
+	if (otb->otb_used == NULL)
+		OBD_ALLOC_PTR_ARRAY_LARGE(otb->otb_used, PTLRPC_MAX_BRW_PAGES);
+	if (otb->otb_guards == NULL || otb->otb_used == NULL) {
+		mutex_unlock(&otb->otb_mutex);
+		return NULL;
+	}
+
+	return otb;
+}
+
+static inline void osc_t10pi_buf_put(struct osc_t10pi_buf *otb)
+{
+	mutex_unlock(&otb->otb_mutex);
+}
+
+/* generate the guard tags of page \a idx of the bulk in its slots */
+static int osc_brw_dif_page(void *data, unsigned int arg,
+			    struct brw_page *pg, u32 idx)
+{
+	struct osc_t10pi_guards *otg = data;
+	unsigned int count = idx == otg->otg_last ? otg->otg_last_count :
+						   pg->count;
+	int used;
+	int rc;
+
+	rc = obd_page_dif_generate_buffer(otg->otg_obd_name, pg->pg,
+					  pg->off & ~PAGE_MASK, count,
+					  otg->otg_guards +
+					  idx * otg->otg_stride,
+					  otg->otg_stride, &used,
+					  otg->otg_sector_size, otg->otg_fn);
+	if (rc == 0)
+		otg->otg_used[idx] = used;
+
+	return rc;
+}
+
+/*
+ * When the bulk is large enough to be split, the guard tags of the pages,
+ * which are most of the work, are generated in parallel by
+ * osc_brw_pages_run(), then hashed in order into the RPC checksum, which is
+ * the same as when they are generated one page at a time.
+ */
 static int osc_checksum_bulk_t10pi(const char *obd_name, int nob,
 				   size_t pg_count, struct brw_page **pga,
 				   int opc, obd_dif_csum_fn *fn,
 				   int sector_size,
 				   u32 *check_sum)
 {
+	struct osc_t10pi_guards otg = {
+		.otg_obd_name = obd_name,
+		.otg_fn = fn,
+		.otg_sector_size = sector_size,
+		.otg_stride = DIV_ROUND_UP(PAGE_SIZE, sector_size),
+	};
+	struct osc_t10pi_buf *otb = NULL;
 	struct ahash_request *req;
 	/* Used Adler as the default checksum type on top of DIF tags */
 	unsigned char cfs_alg = cksum_obd2cfs(OBD_CKSUM_T10_TOP);
@@ -1196,77 +1512,106 @@ static int osc_checksum_bulk_t10pi(const char *obd_name, int nob,
 	unsigned int bufsize;
 	int guard_number;
 	int used_number = 0;
-	int used;
+	int cpt = cfs_cpt_current(cfs_cpt_tab, 1);
+	u32 npages = 0;
+	u32 chunk;
 	u32 cksum;
 	int rc = 0;
-	int i = 0;
+	u32 i;
 
 	LASSERT(pg_count > 0);
 
+	/* pages covered by the checksum, the last one maybe partly */
+	while (nob > 0 && npages < pg_count) {
+		otg.otg_last_count = min_t(unsigned int, pga[npages]->count,
+					   nob);
+		nob -= pga[npages]->count;
+		npages++;
+	}
+	if (npages == 0)
+		npages = 1;
+	otg.otg_last = npages - 1;
+
+	/* corrupt the data before we compute the checksum, to
+	 * simulate an OST->client data error */
+	if (unlikely(opc == OST_READ &&
+		     OBD_FAIL_CHECK(OBD_FAIL_OSC_CHECKSUM_RECEIVE))) {
+		unsigned char *ptr = kmap(pga[0]->pg);
+		int off = pga[0]->off & ~PAGE_MASK;
+
+		memcpy(ptr + off, "bad1", min_t(unsigned int, 4,
+						otg.otg_last ? pga[0]->count :
+						otg.otg_last_count));
+		kunmap(pga[0]->pg);
+	}
+
 	__page = alloc_page(GFP_KERNEL);
 	if (__page == NULL)
 		return -ENOMEM;
 
+	if (osc_brw_pages_split(cpt, npages, &chunk) > 1)
+		otb = osc_t10pi_buf_get(cpt, npages, otg.otg_stride);
+	if (otb != NULL) {
+		otg.otg_guards = otb->otb_guards;
+		otg.otg_used = otb->otb_used;
+		rc = osc_brw_pages_run(&otg, pga, npages, osc_brw_dif_page, 0);
+		if (rc)
+			GOTO(out_free, rc);
+	}
+
 	req = cfs_crypto_hash_init(cfs_alg, NULL, 0);
 	if (IS_ERR(req)) {
 		rc = PTR_ERR(req);
 		CERROR("%s: unable to initialize checksum hash %s: rc = %d\n",
 		       obd_name, cfs_crypto_hash_name(cfs_alg), rc);
-		GOTO(out, rc);
+		GOTO(out_free, rc);
 	}
 
 	buffer = kmap(__page);
 	guard_start = (__u16 *)buffer;
 	guard_number = PAGE_SIZE / sizeof(*guard_start);
-	while (nob > 0 && pg_count > 0) {
-		unsigned int count = pga[i]->count > nob ? nob : pga[i]->count;
-
-		/* corrupt the data before we compute the checksum, to
-		 * simulate an OST->client data error */
-		if (unlikely(i == 0 && opc == OST_READ &&
-			     OBD_FAIL_CHECK(OBD_FAIL_OSC_CHECKSUM_RECEIVE))) {
-			unsigned char *ptr = kmap(pga[i]->pg);
-			int off = pga[i]->off & ~PAGE_MASK;
-
-			memcpy(ptr + off, "bad1", min_t(typeof(nob), 4, nob));
-			kunmap(pga[i]->pg);
-		}
+	for (i = 0; i < npages; i++) {
+		int used;
 
 		/*
 		 * The left guard number should be able to hold checksums of a
 		 * whole page
 		 */
-		rc = obd_page_dif_generate_buffer(obd_name, pga[i]->pg,
-						  pga[i]->off & ~PAGE_MASK,
-						  count,
-						  guard_start + used_number,
-						  guard_number - used_number,
-						  &used, sector_size,
-						  fn);
-		if (rc)
-			break;
-
-		used_number += used;
-		if (used_number == guard_number) {
+		if (otg.otg_stride > guard_number - used_number) {
 			cfs_crypto_hash_update_page(req, __page, 0,
 				used_number * sizeof(*guard_start));
 			used_number = 0;
 		}
 
-		nob -= pga[i]->count;
-		pg_count--;
-		i++;
+		if (otb != NULL) {
+			used = otg.otg_used[i];
+			memcpy(guard_start + used_number,
+			       otg.otg_guards + i * otg.otg_stride,
+			       used * sizeof(*guard_start));
+		} else {
+			rc = obd_page_dif_generate_buffer(obd_name, pga[i]->pg,
+						pga[i]->off & ~PAGE_MASK,
+						i == otg.otg_last ?
+						otg.otg_last_count :
+						pga[i]->count,
+						guard_start + used_number,
+						guard_number - used_number,
+						&used, sector_size, fn);
+			if (rc)
+				break;
+		}
+		used_number += used;
 	}
 	kunmap(__page);
-	if (rc)
-		GOTO(out, rc);
 
-	if (used_number != 0)
+	if (rc == 0 && used_number != 0)
 		cfs_crypto_hash_update_page(req, __page, 0,
 			used_number * sizeof(*guard_start));
 
 	bufsize = sizeof(cksum);
 	cfs_crypto_hash_final(req, (unsigned char *)&cksum, &bufsize);
+	if (rc)
+		GOTO(out_free, rc);
 
 	/* For sending we only compute the wrong checksum instead
 	 * of corrupting the data so it is still correct on a redo */
@@ -1274,11 +1619,22 @@ static int osc_checksum_bulk_t10pi(const char *obd_name, int nob,
 		cksum++;
 
 	*check_sum = cksum;
-out:
+out_free:
+	if (otb != NULL)
+		osc_t10pi_buf_put(otb);
 	__free_page(__page);
 	return rc;
 }
 #else /* !CONFIG_CRC_T10DIF */
+static inline int osc_t10pi_bufs_init(void)
+{
+	return 0;
+}
+
+static inline void osc_t10pi_bufs_fini(void)
+{
+}
+
 #define obd_dif_ip_fn NULL
 #define obd_dif_crc_fn NULL
 #define osc_checksum_bulk_t10pi(name, nob, pgc, pga, opc, fn, ssize, csum)  \
@@ -1362,6 +1718,173 @@ static int osc_checksum_bulk_rw(const char *obd_name,
 	RETURN(rc);
 }
 
+static void osc_brw_wqs_fini(void)
+{
+	int i;
+
+	if (osc_brw_wqs == NULL)
+		return;
+
+	for (i = 0; i < cfs_cpt_number(cfs_cpt_tab); i++)
+		if (!IS_ERR_OR_NULL(osc_brw_wqs[i]))
+			destroy_workqueue(osc_brw_wqs[i]);
+	OBD_FREE_PTR_ARRAY(osc_brw_wqs, cfs_cpt_number(cfs_cpt_tab));
+	osc_brw_wqs = NULL;
+	osc_t10pi_bufs_fini();
+}
+
+static int osc_brw_wqs_init(void)
+{
+	char name[24];
+	int i;
+
+	OBD_ALLOC_PTR_ARRAY(osc_brw_wqs, cfs_cpt_number(cfs_cpt_tab));
+	if (osc_brw_wqs == NULL)
+		return -ENOMEM;
+
+	if (osc_t10pi_bufs_init() != 0) {
+		osc_brw_wqs_fini();
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < cfs_cpt_number(cfs_cpt_tab); i++) {
+		snprintf(name, sizeof(name), "osc_brw_%02d", i);
+		/* used for writeback, must make progress under memory
+		 * pressure */
+		osc_brw_wqs[i] = cfs_cpt_bind_workqueue(name, cfs_cpt_tab,
+						WQ_MEM_RECLAIM, i,
+						cfs_cpt_weight(cfs_cpt_tab, i));
+		if (IS_ERR(osc_brw_wqs[i])) {
+			int rc = PTR_ERR(osc_brw_wqs[i]);
+
+			osc_brw_wqs_fini();
+			return rc;
+		}
+	}
+
+	return 0;
+}
+
+/* encrypt \a pg into a bounce page, \a directio is set for direct IO pages */
+static int osc_brw_encrypt_page(void *data, unsigned int directio,
+				struct brw_page *pg, u32 idx)
+{
+	struct inode *inode = data;
+	struct page *data_page = NULL;
+	bool retried = false;
+	bool lockedbymyself;
+	u32 nunits = (pg->off & ~PAGE_MASK) + pg->count;
+	struct address_space *map_orig = NULL;
+	pgoff_t index_orig;
+	int rc;
+
+retry_encrypt:
+	if (nunits & ~LUSTRE_ENCRYPTION_MASK)
+		nunits = (nunits & LUSTRE_ENCRYPTION_MASK) +
+			LUSTRE_ENCRYPTION_UNIT_SIZE;
+	/* The page can already be locked when we arrive here.
+	 * This is possible when cl_page_assume/vvp_page_assume
+	 * is stuck on wait_on_page_writeback with page lock
+	 * held. In this case there is no risk for the lock to
+	 * be released while we are doing our encryption
+	 * processing, because writeback against that page will
+	 * end in vvp_page_completion_write/cl_page_completion,
+	 * which means only once the page is fully processed.
+	 */
+	lockedbymyself = trylock_page(pg->pg);
+	if (directio) {
+		map_orig = pg->pg->mapping;
+		pg->pg->mapping = inode->i_mapping;
+		index_orig = pg->pg->index;
+		pg->pg->index = pg->off >> PAGE_SHIFT;
+	}
+	data_page = llcrypt_encrypt_pagecache_blocks(pg->pg, nunits, 0,
+						     GFP_NOFS);
+	if (directio) {
+		pg->pg->mapping = map_orig;
+		pg->pg->index = index_orig;
+	}
+	if (lockedbymyself)
+		unlock_page(pg->pg);
+	if (IS_ERR(data_page)) {
+		rc = PTR_ERR(data_page);
+		if (rc == -ENOMEM && !retried) {
+			retried = true;
+			goto retry_encrypt;
+		}
+		return rc;
+	}
+	/* Set PageChecked flag on bounce page for
+	 * disambiguation in osc_release_bounce_pages().
+	 */
+	SetPageChecked(data_page);
+	pg->pg = data_page;
+	/* len is forced to nunits, and relative offset to 0
+	 * so store the old, clear text info
+	 */
+	pg->bp_count_diff = nunits - pg->count;
+	pg->count = nunits;
+	pg->bp_off_diff = pg->off & ~PAGE_MASK;
+	pg->off = pg->off & PAGE_MASK;
+
+	return 0;
+}
+
+/* decrypt \a pg in place, \a blockbits is set for direct IO pages */
+static int osc_brw_decrypt_page(void *data, unsigned int blockbits,
+				struct brw_page *pg, u32 idx)
+{
+	struct inode *inode = data;
+	unsigned int offs = 0;
+	int rc = 0;
+
+	while (offs < PAGE_SIZE) {
+		/* do not decrypt if page is all 0s */
+		if (memchr_inv(page_address(pg->pg) + offs, 0,
+			       LUSTRE_ENCRYPTION_UNIT_SIZE) == NULL) {
+			/* if page is empty forward info to upper layers
+			 * (ll_io_zero_page) by clearing PagePrivate2
+			 */
+			if (!offs)
+				ClearPagePrivate2(pg->pg);
+			break;
+		}
+
+		if (blockbits) {
+			/* This is direct IO case. Directly call
+			 * decrypt function that takes inode as
+			 * input parameter. Page does not need
+			 * to be locked.
+			 */
+			unsigned int blocksize = 1 << blockbits;
+			u64 lblk_num = ((u64)(pg->off >> PAGE_SHIFT) <<
+					(PAGE_SHIFT - blockbits)) +
+				       (offs >> blockbits);
+			unsigned int i;
+
+			for (i = offs; i < offs + LUSTRE_ENCRYPTION_UNIT_SIZE;
+			     i += blocksize, lblk_num++) {
+				rc = llcrypt_decrypt_block_inplace(inode,
+								   pg->pg,
+								   blocksize,
+								   i, lblk_num);
+				if (rc)
+					break;
+			}
+		} else {
+			rc = llcrypt_decrypt_pagecache_blocks(pg->pg,
+						LUSTRE_ENCRYPTION_UNIT_SIZE,
+						offs);
+		}
+		if (rc)
+			return rc;
+
+		offs += LUSTRE_ENCRYPTION_UNIT_SIZE;
+	}
+
+	return 0;
+}
+
 static inline void osc_release_bounce_pages(struct brw_page **pga,
 					    u32 page_count)
 {
@@ -1370,7 +1893,7 @@ static inline void osc_release_bounce_pages(struct brw_page **pga,
 
 	for (i = 0; i < page_count; i++) {
 		/* Bounce pages allocated by a call to
-		 * llcrypt_encrypt_pagecache_blocks() in osc_brw_prep_request()
+		 * llcrypt_encrypt_pagecache_blocks() in osc_brw_encrypt_page()
 		 * are identified thanks to the PageChecked flag.
 		 */
 		if (PageChecked(pga[i]->pg))
@@ -1381,9 +1904,18 @@ static inline void osc_release_bounce_pages(struct brw_page **pga,
 #endif
 }
 
+/**
+ * Build a BRW request for the pages \a pga.
+ *
+ * A write may carry the pages of several objects, described by \a objs,
+ * with \a oa being the obdo of the first of them.  The pages of each object
+ * follow each other in \a pga and are never merged in one niobuf with the
+ * pages of another object.  \a objs is NULL for a request of one object.
+ */
 static int
 osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
 		     u32 page_count, struct brw_page **pga,
+		     struct osc_brw_obj *objs, u32 obj_count,
 		     struct ptlrpc_request **reqp, int resend)
 {
 	struct ptlrpc_request *req;
@@ -1391,7 +1923,10 @@ osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
 	struct ost_body *body;
 	struct obd_ioobj *ioobj;
 	struct niobuf_remote *niobuf;
-	int niocount, i, requested_nob, opc, rc, short_io_size = 0;
+	struct niobuf_remote *obj_niobuf;
+	struct obdo *obdos = NULL;
+	u32 seg_start, seg_end;
+	int niocount, i, k, requested_nob, opc, rc, short_io_size = 0;
 	struct osc_brw_async_args *aa;
 	struct req_capsule *pill;
 	struct brw_page *pg_prev;
@@ -1419,10 +1954,13 @@ osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
 	if (OBD_FAIL_CHECK(OBD_FAIL_OSC_BRW_PREP_REQ2))
 		RETURN(-EINVAL); /* Fatal */
 
+	LASSERT(ergo(obj_count > 1, (cmd & OBD_BRW_WRITE) != 0));
 	if ((cmd & OBD_BRW_WRITE) != 0) {
 		opc = OST_WRITE;
 		req = ptlrpc_request_alloc_pool(cli->cl_import,
 						osc_rq_pool,
+						obj_count > 1 ?
+						&RQF_OST_BRW_WRITE_MULTI :
 						&RQF_OST_BRW_WRITE);
 	} else {
 		opc = OST_READ;
@@ -1432,75 +1970,18 @@ osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
                 RETURN(-ENOMEM);
 
 	if (opc == OST_WRITE && inode && IS_ENCRYPTED(inode)) {
-		for (i = 0; i < page_count; i++) {
-			struct brw_page *pg = pga[i];
-			struct page *data_page = NULL;
-			bool retried = false;
-			bool lockedbymyself;
-			u32 nunits = (pg->off & ~PAGE_MASK) + pg->count;
-			struct address_space *map_orig = NULL;
-			pgoff_t index_orig;
+		struct osc_async_page *oap;
 
-retry_encrypt:
-			if (nunits & ~LUSTRE_ENCRYPTION_MASK)
-				nunits = (nunits & LUSTRE_ENCRYPTION_MASK) +
-					LUSTRE_ENCRYPTION_UNIT_SIZE;
-			/* The page can already be locked when we arrive here.
-			 * This is possible when cl_page_assume/vvp_page_assume
-			 * is stuck on wait_on_page_writeback with page lock
-			 * held. In this case there is no risk for the lock to
-			 * be released while we are doing our encryption
-			 * processing, because writeback against that page will
-			 * end in vvp_page_completion_write/cl_page_completion,
-			 * which means only once the page is fully processed.
-			 */
-			lockedbymyself = trylock_page(pg->pg);
-			if (directio) {
-				map_orig = pg->pg->mapping;
-				pg->pg->mapping = inode->i_mapping;
-				index_orig = pg->pg->index;
-				pg->pg->index = pg->off >> PAGE_SHIFT;
-			}
-			data_page =
-				llcrypt_encrypt_pagecache_blocks(pg->pg,
-								 nunits, 0,
-								 GFP_NOFS);
-			if (directio) {
-				pg->pg->mapping = map_orig;
-				pg->pg->index = index_orig;
-			}
-			if (lockedbymyself)
-				unlock_page(pg->pg);
-			if (IS_ERR(data_page)) {
-				rc = PTR_ERR(data_page);
-				if (rc == -ENOMEM && !retried) {
-					retried = true;
-					rc = 0;
-					goto retry_encrypt;
-				}
-				ptlrpc_request_free(req);
-				RETURN(rc);
-			}
-			/* Set PageChecked flag on bounce page for
-			 * disambiguation in osc_release_bounce_pages().
-			 */
-			SetPageChecked(data_page);
-			pg->pg = data_page;
-			/* there should be no gap in the middle of page array */
-			if (i == page_count - 1) {
-				struct osc_async_page *oap = brw_page2oap(pg);
-
-				oa->o_size = oap->oap_count +
-					oap->oap_obj_off + oap->oap_page_off;
-			}
-			/* len is forced to nunits, and relative offset to 0
-			 * so store the old, clear text info
-			 */
-			pg->bp_count_diff = nunits - pg->count;
-			pg->count = nunits;
-			pg->bp_off_diff = pg->off & ~PAGE_MASK;
-			pg->off = pg->off & PAGE_MASK;
+		rc = osc_brw_pages_run(inode, pga, page_count,
+				       osc_brw_encrypt_page, directio);
+		if (rc) {
+			ptlrpc_request_free(req);
+			RETURN(rc);
 		}
+		/* there should be no gap in the middle of page array */
+		oap = brw_page2oap(pga[page_count - 1]);
+		oa->o_size = oap->oap_count + oap->oap_obj_off +
+			     oap->oap_page_off;
 	} else if (opc == OST_READ && inode && IS_ENCRYPTED(inode)) {
 		for (i = 0; i < page_count; i++) {
 			struct brw_page *pg = pga[i];
@@ -1521,16 +2002,26 @@ retry_encrypt:
 		}
 	}
 
-        for (niocount = i = 1; i < page_count; i++) {
-                if (!can_merge_pages(pga[i - 1], pga[i]))
-                        niocount++;
-        }
+	seg_end = objs != NULL ? objs[0].obo_page_count : page_count;
+	for (niocount = i = 1, k = 0; i < page_count; i++) {
+		/* the first page of an object starts a new niobuf */
+		if (i == seg_end) {
+			seg_end += objs[++k].obo_page_count;
+			niocount++;
+		} else if (!can_merge_pages(pga[i - 1], pga[i])) {
+			niocount++;
+		}
+	}
+	LASSERT(seg_end == page_count);
 
-        pill = &req->rq_pill;
-        req_capsule_set_size(pill, &RMF_OBD_IOOBJ, RCL_CLIENT,
-                             sizeof(*ioobj));
-        req_capsule_set_size(pill, &RMF_NIOBUF_REMOTE, RCL_CLIENT,
-                             niocount * sizeof(*niobuf));
+	pill = &req->rq_pill;
+	req_capsule_set_size(pill, &RMF_OBD_IOOBJ, RCL_CLIENT,
+			     obj_count * sizeof(*ioobj));
+	req_capsule_set_size(pill, &RMF_NIOBUF_REMOTE, RCL_CLIENT,
+			     niocount * sizeof(*niobuf));
+	if (obj_count > 1)
+		req_capsule_set_size(pill, &RMF_OBDO_ARRAY, RCL_CLIENT,
+				     obj_count * sizeof(*obdos));
 
 	for (i = 0; i < page_count; i++) {
 		short_io_size += pga[i]->count;
@@ -1596,17 +2087,41 @@ no_bulk:
 	body->oa.o_uid = oa->o_uid;
 	body->oa.o_gid = oa->o_gid;
 
-	obdo_to_ioobj(oa, ioobj);
-	ioobj->ioo_bufcnt = niocount;
-	/* The high bits of ioo_max_brw tells server _maximum_ number of bulks
-	 * that might be send for this request.  The actual number is decided
-	 * when the RPC is finally sent in ptlrpc_register_bulk(). It sends
-	 * "max - 1" for old client compatibility sending "0", and also so the
-	 * the actual maximum is a power-of-two number, not one less. LU-1431 */
-	if (desc != NULL)
-		ioobj_max_brw_set(ioobj, desc->bd_md_max_brw);
-	else /* short io */
-		ioobj_max_brw_set(ioobj, 0);
+	if (obj_count > 1) {
+		obdos = req_capsule_client_get(pill, &RMF_OBDO_ARRAY);
+		LASSERT(obdos != NULL);
+	}
+
+	for (k = 0; k < obj_count; k++) {
+		struct obdo *obj_oa = objs != NULL ? objs[k].obo_oa : oa;
+
+		obdo_to_ioobj(obj_oa, &ioobj[k]);
+		/* The high bits of ioo_max_brw tells server _maximum_ number
+		 * of bulks that might be send for this request.  The actual
+		 * number is decided when the RPC is finally sent in
+		 * ptlrpc_register_bulk(). It sends "max - 1" for old client
+		 * compatibility sending "0", and also so the the actual
+		 * maximum is a power-of-two number, not one less. LU-1431 */
+		if (desc != NULL)
+			ioobj_max_brw_set(&ioobj[k], desc->bd_md_max_brw);
+		else /* short io */
+			ioobj_max_brw_set(&ioobj[k], 0);
+
+		if (obdos == NULL)
+			continue;
+
+		lustre_set_wire_obdo(&req->rq_import->imp_connect_data,
+				     &obdos[k], obj_oa);
+		obdos[k].o_uid = obj_oa->o_uid;
+		obdos[k].o_gid = obj_oa->o_gid;
+		if (resend) {
+			if ((obdos[k].o_valid & OBD_MD_FLFLAGS) == 0) {
+				obdos[k].o_valid |= OBD_MD_FLFLAGS;
+				obdos[k].o_flags = 0;
+			}
+			obdos[k].o_flags |= OBD_FL_RECOV_RESEND;
+		}
+	}
 
 	if (short_io_size != 0) {
 		if ((body->oa.o_valid & OBD_MD_FLFLAGS) == 0) {
@@ -1625,20 +2140,31 @@ no_bulk:
 
 	LASSERT(page_count > 0);
 	pg_prev = pga[0];
-        for (requested_nob = i = 0; i < page_count; i++, niobuf++) {
-                struct brw_page *pg = pga[i];
+	obj_niobuf = niobuf;
+	seg_start = 0;
+	seg_end = objs != NULL ? objs[0].obo_page_count : page_count;
+	for (requested_nob = i = k = 0; i < page_count; i++, niobuf++) {
+		struct brw_page *pg = pga[i];
 		int poff = pg->off & ~PAGE_MASK;
 
+		/* the pages of the next object start here */
+		if (i == seg_end) {
+			ioobj[k].ioo_bufcnt = niobuf - obj_niobuf;
+			obj_niobuf = niobuf;
+			seg_start = seg_end;
+			seg_end += objs[++k].obo_page_count;
+		}
+
                 LASSERT(pg->count > 0);
                 /* make sure there is no gap in the middle of page array */
-		LASSERTF(page_count == 1 ||
-			 (ergo(i == 0, poff + pg->count == PAGE_SIZE) &&
-			  ergo(i > 0 && i < page_count - 1,
+		LASSERTF(seg_end - seg_start == 1 ||
+			 (ergo(i == seg_start, poff + pg->count == PAGE_SIZE) &&
+			  ergo(i > seg_start && i < seg_end - 1,
 			       poff == 0 && pg->count == PAGE_SIZE)   &&
-			  ergo(i == page_count - 1, poff == 0)),
+			  ergo(i == seg_end - 1, poff == 0)),
 			 "i: %d/%d pg: %p off: %llu, count: %u\n",
 			 i, page_count, pg, pg->off, pg->count);
-                LASSERTF(i == 0 || pg->off > pg_prev->off,
+		LASSERTF(i == seg_start || pg->off > pg_prev->off,
 			 "i %d p_c %u pg %p [pri %lu ind %lu] off %llu"
 			 " prev_pg %p [pri %lu ind %lu] off %llu\n",
                          i, page_count,
@@ -1661,7 +2187,7 @@ no_bulk:
 		}
 		requested_nob += pg->count;
 
-                if (i > 0 && can_merge_pages(pg_prev, pg)) {
+		if (i > seg_start && can_merge_pages(pg_prev, pg)) {
                         niobuf--;
 			niobuf->rnb_len += pg->count;
 		} else {
@@ -1671,6 +2197,8 @@ no_bulk:
                 }
                 pg_prev = pg;
         }
+	ioobj[k].ioo_bufcnt = niobuf - obj_niobuf;
+	LASSERT(k == obj_count - 1);
 
         LASSERTF((void *)(niobuf - niocount) ==
                 req_capsule_client_get(&req->rq_pill, &RMF_NIOBUF_REMOTE),
@@ -1754,6 +2282,8 @@ no_bulk:
 	aa->aa_resends = 0;
 	aa->aa_ppga = pga;
 	aa->aa_cli = cli;
+	aa->aa_objs = objs;
+	aa->aa_obj_count = obj_count;
 	INIT_LIST_HEAD(&aa->aa_oaps);
 
 	*reqp = req;
@@ -1928,7 +2458,7 @@ static int osc_brw_fini_request(struct ptlrpc_request *req, int rc)
 	struct ost_body *body;
 	u32 client_cksum = 0;
 	struct inode *inode;
-	unsigned int blockbits = 0, blocksize = 0;
+	unsigned int blockbits = 0;
 
 	ENTRY;
 
@@ -2113,6 +2643,8 @@ static int osc_brw_fini_request(struct ptlrpc_request *req, int rc)
 			CERROR("%s: checksum %u requested from %s but not sent\n",
 			       obd_name, cksum_missed,
 			       libcfs_nid2str(peer->nid));
+		/* the data is still good, it must be decrypted */
+		rc = 0;
 	} else {
 		rc = 0;
 	}
@@ -2126,71 +2658,19 @@ static int osc_brw_fini_request(struct ptlrpc_request *req, int rc)
 		struct osc_async_page *oap = brw_page2oap(aa->aa_ppga[0]);
 
 		inode = oap2cl_page(oap)->cp_inode;
-		if (inode) {
+		if (inode)
 			blockbits = inode->i_blkbits;
-			blocksize = 1 << blockbits;
-		}
 	}
 	if (inode && IS_ENCRYPTED(inode)) {
-		int idx;
-
 		if (!llcrypt_has_encryption_key(inode)) {
 			CDEBUG(D_SEC, "no enc key for ino %lu\n", inode->i_ino);
 			GOTO(out, rc);
 		}
-		for (idx = 0; idx < aa->aa_page_count; idx++) {
-			struct brw_page *pg = aa->aa_ppga[idx];
-			unsigned int offs = 0;
-
-			while (offs < PAGE_SIZE) {
-				/* do not decrypt if page is all 0s */
-				if (memchr_inv(page_address(pg->pg) + offs, 0,
-					 LUSTRE_ENCRYPTION_UNIT_SIZE) == NULL) {
-					/* if page is empty forward info to
-					 * upper layers (ll_io_zero_page) by
-					 * clearing PagePrivate2
-					 */
-					if (!offs)
-						ClearPagePrivate2(pg->pg);
-					break;
-				}
-
-				if (blockbits) {
-					/* This is direct IO case. Directly call
-					 * decrypt function that takes inode as
-					 * input parameter. Page does not need
-					 * to be locked.
-					 */
-					u64 lblk_num =
-						((u64)(pg->off >> PAGE_SHIFT) <<
-						     (PAGE_SHIFT - blockbits)) +
-						       (offs >> blockbits);
-					unsigned int i;
-
-					for (i = offs;
-					     i < offs +
-						    LUSTRE_ENCRYPTION_UNIT_SIZE;
-					     i += blocksize, lblk_num++) {
-						rc =
-						  llcrypt_decrypt_block_inplace(
-							  inode, pg->pg,
-							  blocksize, i,
-							  lblk_num);
-						if (rc)
-							break;
-					}
-				} else {
-					rc = llcrypt_decrypt_pagecache_blocks(
-						pg->pg,
-						LUSTRE_ENCRYPTION_UNIT_SIZE,
-						offs);
-				}
-				if (rc)
-					GOTO(out, rc);
-
-				offs += LUSTRE_ENCRYPTION_UNIT_SIZE;
-			}
-		}
+		/* no need to decrypt data which is read again */
+		if (rc == 0)
+			rc = osc_brw_pages_run(inode, aa->aa_ppga,
+					       aa->aa_page_count,
+					       osc_brw_decrypt_page, blockbits);
 	}
 
 out:
@@ -2216,7 +2696,8 @@ static int osc_brw_redo_request(struct ptlrpc_request *request,
 	rc = osc_brw_prep_request(lustre_msg_get_opc(request->rq_reqmsg) ==
 				OST_WRITE ? OBD_BRW_WRITE : OBD_BRW_READ,
 				  aa->aa_cli, aa->aa_oa, aa->aa_page_count,
-				  aa->aa_ppga, &new_req, 1);
+				  aa->aa_ppga, aa->aa_objs, aa->aa_obj_count,
+				  &new_req, 1);
         if (rc)
                 RETURN(rc);
 
@@ -2306,6 +2787,74 @@ static void osc_release_ppga(struct brw_page **ppga, size_t count)
 	OBD_FREE_PTR_ARRAY(ppga, count);
 }
 
+/**
+ * Update the attributes of the object of \a last from \a oa once a BRW of
+ * its pages is done, \a last being the last page of the object in the RPC.
+ */
+static void osc_brw_update_attr(const struct lu_env *env,
+				struct ptlrpc_request *req, struct obdo *oa,
+				struct osc_async_page *last)
+{
+	struct cl_attr *attr = &osc_env_info(env)->oti_attr;
+	unsigned long valid = 0;
+	struct cl_object *obj = osc2cl(last->oap_obj);
+
+	cl_object_attr_lock(obj);
+	if (oa->o_valid & OBD_MD_FLBLOCKS) {
+		attr->cat_blocks = oa->o_blocks;
+		valid |= CAT_BLOCKS;
+	}
+	if (oa->o_valid & OBD_MD_FLMTIME) {
+		attr->cat_mtime = oa->o_mtime;
+		valid |= CAT_MTIME;
+	}
+	if (oa->o_valid & OBD_MD_FLATIME) {
+		attr->cat_atime = oa->o_atime;
+		valid |= CAT_ATIME;
+	}
+	if (oa->o_valid & OBD_MD_FLCTIME) {
+		attr->cat_ctime = oa->o_ctime;
+		valid |= CAT_CTIME;
+	}
+
+	if (lustre_msg_get_opc(req->rq_reqmsg) == OST_WRITE) {
+		struct lov_oinfo *loi = cl2osc(obj)->oo_oinfo;
+		loff_t last_off = last->oap_count + last->oap_obj_off +
+			last->oap_page_off;
+
+		/* Change file size if this is an out of quota or
+		 * direct IO write and it extends the file size */
+		if (loi->loi_lvb.lvb_size < last_off) {
+			attr->cat_size = last_off;
+			valid |= CAT_SIZE;
+		}
+		/* Extend KMS if it's not a lockless write */
+		if (loi->loi_kms < last_off &&
+		    oap2osc_page(last)->ops_srvlock == 0) {
+			attr->cat_kms = last_off;
+			valid |= CAT_KMS;
+		}
+	}
+
+	if (valid != 0)
+		cl_object_attr_update(env, obj, attr, valid);
+	cl_object_attr_unlock(obj);
+}
+
+/* free the obdos of the objects of a write RPC but the first one, which is
+ * the aa_oa of the request */
+static void osc_release_brw_objs(struct osc_brw_obj *objs, u32 count)
+{
+	u32 k;
+
+	if (objs == NULL)
+		return;
+
+	for (k = 1; k < count; k++)
+		OBD_SLAB_FREE_PTR(objs[k].obo_oa, osc_obdo_kmem);
+	OBD_FREE_PTR_ARRAY(objs, count);
+}
+
 static int brw_interpret(const struct lu_env *env,
 			 struct ptlrpc_request *req, void *args, int rc)
 {
@@ -2351,56 +2900,23 @@ static int brw_interpret(const struct lu_env *env,
 	}
 
 	if (rc == 0) {
-		struct obdo *oa = aa->aa_oa;
-		struct cl_attr *attr = &osc_env_info(env)->oti_attr;
-		unsigned long valid = 0;
-		struct cl_object *obj;
-		struct osc_async_page *last;
-
-		last = brw_page2oap(aa->aa_ppga[aa->aa_page_count - 1]);
-		obj = osc2cl(last->oap_obj);
-
-		cl_object_attr_lock(obj);
-		if (oa->o_valid & OBD_MD_FLBLOCKS) {
-			attr->cat_blocks = oa->o_blocks;
-			valid |= CAT_BLOCKS;
-		}
-		if (oa->o_valid & OBD_MD_FLMTIME) {
-			attr->cat_mtime = oa->o_mtime;
-			valid |= CAT_MTIME;
-		}
-		if (oa->o_valid & OBD_MD_FLATIME) {
-			attr->cat_atime = oa->o_atime;
-			valid |= CAT_ATIME;
+		u32 nr = 0;
+		u32 k;
+
+		/* the last page of each object of the RPC */
+		for (k = 0; k < aa->aa_obj_count; k++) {
+			struct obdo *oa = aa->aa_objs != NULL ?
+					  aa->aa_objs[k].obo_oa : aa->aa_oa;
+
+			nr += aa->aa_objs != NULL ?
+			      aa->aa_objs[k].obo_page_count :
+			      aa->aa_page_count;
+			osc_brw_update_attr(env, req, oa,
+					    brw_page2oap(aa->aa_ppga[nr - 1]));
 		}
-		if (oa->o_valid & OBD_MD_FLCTIME) {
-			attr->cat_ctime = oa->o_ctime;
-			valid |= CAT_CTIME;
-		}
-
-		if (lustre_msg_get_opc(req->rq_reqmsg) == OST_WRITE) {
-			struct lov_oinfo *loi = cl2osc(obj)->oo_oinfo;
-			loff_t last_off = last->oap_count + last->oap_obj_off +
-				last->oap_page_off;
-
-			/* Change file size if this is an out of quota or
-			 * direct IO write and it extends the file size */
-			if (loi->loi_lvb.lvb_size < last_off) {
-				attr->cat_size = last_off;
-				valid |= CAT_SIZE;
-			}
-			/* Extend KMS if it's not a lockless write */
-			if (loi->loi_kms < last_off &&
-			    oap2osc_page(last)->ops_srvlock == 0) {
-				attr->cat_kms = last_off;
-				valid |= CAT_KMS;
-			}
-		}
-
-		if (valid != 0)
-			cl_object_attr_update(env, obj, attr, valid);
-		cl_object_attr_unlock(obj);
 	}
+	osc_release_brw_objs(aa->aa_objs, aa->aa_obj_count);
+	aa->aa_objs = NULL;
 	OBD_SLAB_FREE_PTR(aa->aa_oa, osc_obdo_kmem);
 	aa->aa_oa = NULL;
 
@@ -2455,10 +2971,125 @@ static void brw_commit(struct ptlrpc_request *req)
 	}
 }
 
+/**
+ * Set up the objects of a write RPC built from the extents of several
+ * objects, which are grouped by object in \a ext_list.
+ *
+ * Every object gets its own obdo, with the grant and layout version of its
+ * extents.  The server accounts the quota of the whole RPC to the owner of
+ * the first object and the request carries one jobid, so the objects with
+ * another owner or jobid do not share the RPC, nor do those of encrypted
+ * files, their extents are moved to \a others.
+ *
+ * \retval	number of objects left in the RPC, described by *objsp
+ * \retval	negative errno on failure
+ */
+static int osc_brw_objs_init(const struct lu_env *env,
+			     struct list_head *ext_list,
+			     struct list_head *others, u32 obj_count,
+			     struct osc_brw_obj **objsp)
+{
+	struct cl_req_attr *crattr = &osc_env_info(env)->oti_req_attr;
+	char jobid[LUSTRE_JOBID_SIZE] = "";
+	struct osc_brw_obj *objs;
+	struct osc_brw_obj *kept;
+	struct osc_object *obj = NULL;
+	struct osc_extent *ext;
+	struct osc_extent *tmp;
+	struct obdo *first = NULL;
+	struct obdo *oa = NULL;
+	bool encrypted = false;
+	bool keep = true;
+	u32 count = 0;
+	int rc = 0;
+
+	OBD_ALLOC_PTR_ARRAY(objs, obj_count);
+	if (objs == NULL)
+		return -ENOMEM;
+
+	list_for_each_entry_safe(ext, tmp, ext_list, oe_link) {
+		if (ext->oe_obj != obj) {
+			struct osc_async_page *oap;
+			struct inode *inode;
+
+			obj = ext->oe_obj;
+			oap = list_first_entry(&ext->oe_pages,
+					       struct osc_async_page,
+					       oap_pending_item);
+			inode = page2inode(oap->oap_page);
+
+			OBD_SLAB_ALLOC_PTR_GFP(oa, osc_obdo_kmem, GFP_NOFS);
+			if (oa == NULL)
+				GOTO(out, rc = -ENOMEM);
+
+			memset(crattr, 0, sizeof(*crattr));
+			crattr->cra_type = CRT_WRITE;
+			crattr->cra_flags = ~0ULL;
+			crattr->cra_page = oap2cl_page(oap);
+			crattr->cra_oa = oa;
+			cl_req_attr_set(env, osc2cl(obj), crattr);
+
+			if (count == 0) {
+				first = oa;
+				encrypted = inode != NULL && IS_ENCRYPTED(inode);
+				memcpy(jobid, crattr->cra_jobid, sizeof(jobid));
+				keep = true;
+			} else {
+				keep = !encrypted &&
+				       !(inode != NULL && IS_ENCRYPTED(inode)) &&
+				       oa->o_uid == first->o_uid &&
+				       oa->o_gid == first->o_gid &&
+				       oa->o_projid == first->o_projid &&
+				       strcmp(jobid, crattr->cra_jobid) == 0;
+			}
+
+			if (keep) {
+				objs[count++].obo_oa = oa;
+			} else {
+				OBD_SLAB_FREE_PTR(oa, osc_obdo_kmem);
+				oa = NULL;
+			}
+		}
+
+		if (!keep) {
+			list_move_tail(&ext->oe_link, others);
+			continue;
+		}
+
+		objs[count - 1].obo_page_count += ext->oe_nr_pages;
+		oa->o_grant_used += ext->oe_grants;
+		if (ext->oe_layout_version > oa->o_layout_version) {
+			oa->o_layout_version = ext->oe_layout_version;
+			oa->o_valid |= OBD_MD_LAYOUT_VERSION;
+		}
+	}
+
+	/* the array is freed by its number of objects */
+	if (count < obj_count) {
+		OBD_ALLOC_PTR_ARRAY(kept, count);
+		if (kept == NULL)
+			GOTO(out, rc = -ENOMEM);
+		memcpy(kept, objs, count * sizeof(*objs));
+		OBD_FREE_PTR_ARRAY(objs, obj_count);
+		objs = kept;
+	}
+
+	*objsp = objs;
+	return count;
+out:
+	while (count > 0)
+		OBD_SLAB_FREE_PTR(objs[--count].obo_oa, osc_obdo_kmem);
+	OBD_FREE_PTR_ARRAY(objs, obj_count);
+	return rc;
+}
+
 /**
  * Build an RPC by the list of extent @ext_list. The caller must ensure
  * that the total pages in this list are NOT over max pages per RPC.
  * Extents in the list must be in OES_RPC state.
+ *
+ * The extents of a write RPC may belong to several objects, grouped by
+ * object in @ext_list, if the server supports OBD_CONNECT2_BRW_MULTI.
  */
 int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 		  struct list_head *ext_list, int cmd)
@@ -2468,8 +3099,10 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	struct brw_page			**pga = NULL;
 	struct osc_brw_async_args	*aa = NULL;
 	struct obdo			*oa = NULL;
+	struct osc_brw_obj		*objs = NULL;
 	struct osc_async_page		*oap;
 	struct osc_object		*obj = NULL;
+	struct osc_object		*cur = NULL;
 	struct cl_req_attr		*crattr = NULL;
 	loff_t				starting_offset = OBD_OBJECT_EOF;
 	loff_t				ending_offset = 0;
@@ -2482,12 +3115,33 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	int				i;
 	int				grant = 0;
 	int				rc;
+	u32				obj_count = 0;
+	u32				k;
 	__u32				layout_version = 0;
 	LIST_HEAD(rpc_list);
+	LIST_HEAD(others);
 	struct ost_body			*body;
 	ENTRY;
 	LASSERT(!list_empty(ext_list));
 
+	list_for_each_entry(ext, ext_list, oe_link) {
+		if (ext->oe_obj != obj) {
+			obj = ext->oe_obj;
+			obj_count++;
+		}
+	}
+	obj = NULL;
+
+	if (obj_count > 1) {
+		LASSERT(cmd == OBD_BRW_WRITE);
+		rc = osc_brw_objs_init(env, ext_list, &others, obj_count,
+				       &objs);
+		if (rc < 0)
+			GOTO(out, rc);
+		obj_count = rc;
+		oa = objs[0].obo_oa;
+	}
+
 	/* add pages into rpc_list to build BRW rpc */
 	list_for_each_entry(ext, ext_list, oe_link) {
 		LASSERT(ext->oe_state == OES_RPC);
@@ -2507,12 +3161,20 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	if (pga == NULL)
 		GOTO(out, rc = -ENOMEM);
 
-	OBD_SLAB_ALLOC_PTR_GFP(oa, osc_obdo_kmem, GFP_NOFS);
-	if (oa == NULL)
-		GOTO(out, rc = -ENOMEM);
+	if (oa == NULL) {
+		OBD_SLAB_ALLOC_PTR_GFP(oa, osc_obdo_kmem, GFP_NOFS);
+		if (oa == NULL)
+			GOTO(out, rc = -ENOMEM);
+	}
 
 	i = 0;
 	list_for_each_entry(ext, ext_list, oe_link) {
+		/* the offsets are checked per object */
+		if (ext->oe_obj != cur) {
+			cur = ext->oe_obj;
+			starting_offset = OBD_OBJECT_EOF;
+			ending_offset = 0;
+		}
 		list_for_each_entry(oap, &ext->oe_pages, oap_pending_item) {
 			if (mem_tight)
 				oap->oap_brw_flags |= OBD_BRW_MEMALLOC;
@@ -2550,7 +3212,8 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	crattr->cra_oa = oa;
 	cl_req_attr_set(env, osc2cl(obj), crattr);
 
-	if (cmd == OBD_BRW_WRITE) {
+	/* the objects of a multi-object RPC are set in osc_brw_objs_init() */
+	if (cmd == OBD_BRW_WRITE && objs == NULL) {
 		oa->o_grant_used = grant;
 		if (layout_version > 0) {
 			CDEBUG(D_LAYOUT, DFID": write with layout version %u\n",
@@ -2561,8 +3224,15 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 		}
 	}
 
-	sort_brw_pages(pga, page_count);
-	rc = osc_brw_prep_request(cmd, cli, oa, page_count, pga, &req, 0);
+	if (objs == NULL) {
+		sort_brw_pages(pga, page_count);
+		obj_count = 1;
+	} else {
+		for (i = k = 0; k < obj_count; i += objs[k++].obo_page_count)
+			sort_brw_pages(pga + i, objs[k].obo_page_count);
+	}
+	rc = osc_brw_prep_request(cmd, cli, oa, page_count, pga, objs,
+				  obj_count, &req, 0);
 	if (rc != 0) {
 		CERROR("prep_req failed: %d\n", rc);
 		GOTO(out, rc);
@@ -2597,7 +3267,8 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	list_splice_init(ext_list, &aa->aa_exts);
 
 	spin_lock(&cli->cl_loi_list_lock);
-	starting_offset >>= PAGE_SHIFT;
+	/* offset in the first object of the RPC */
+	starting_offset = pga[0]->off >> PAGE_SHIFT;
 	if (cmd == OBD_BRW_READ) {
 		cli->cl_r_in_flight++;
 		lprocfs_oh_tally_log2(&cli->cl_read_page_hist, page_count);
@@ -2606,6 +3277,7 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 				      starting_offset + 1);
 	} else {
 		cli->cl_w_in_flight++;
+		cli->cl_last_write_rpc = ktime_get_seconds();
 		lprocfs_oh_tally_log2(&cli->cl_write_page_hist, page_count);
 		lprocfs_oh_tally(&cli->cl_write_rpc_hist, cli->cl_w_in_flight);
 		lprocfs_oh_tally_log2(&cli->cl_write_offset_hist,
@@ -2629,6 +3301,7 @@ out:
 	if (rc != 0) {
 		LASSERT(req == NULL);
 
+		osc_release_brw_objs(objs, obj_count);
 		if (oa)
 			OBD_SLAB_FREE_PTR(oa, osc_obdo_kmem);
 		if (pga) {
@@ -2637,6 +3310,7 @@ out:
 		}
 		/* this should happen rarely and is pretty bad, it makes the
 		 * pending list not follow the dirty order */
+		list_splice_init(&others, ext_list);
 		while (!list_empty(ext_list)) {
 			ext = list_entry(ext_list->next, struct osc_extent,
 					 oe_link);
@@ -2644,6 +3318,10 @@ out:
 			osc_extent_finish(env, ext, 0, rc);
 		}
 	}
+
+	/* the objects which could not share this RPC get another one */
+	if (!list_empty(&others))
+		rc = osc_build_rpc(env, cli, &others, cmd);
 	RETURN(rc);
 }
 
@@ -3685,12 +4363,18 @@ static int __init osc_init(void)
 	if (osc_rq_pool == NULL)
 		GOTO(out_type, rc = -ENOMEM);
 
-	rc = osc_start_grant_work();
+	rc = osc_brw_wqs_init();
 	if (rc != 0)
 		GOTO(out_req_pool, rc);
 
+	rc = osc_start_grant_work();
+	if (rc != 0)
+		GOTO(out_brw_wqs, rc);
+
 	RETURN(rc);
 
+out_brw_wqs:
+	osc_brw_wqs_fini();
 out_req_pool:
 	ptlrpc_free_rq_pool(osc_rq_pool);
 out_type:
@@ -3704,6 +4388,7 @@ out_kmem:
 static void __exit osc_exit(void)
 {
 	osc_stop_grant_work();
+	osc_brw_wqs_fini();
 	remove_shrinker(osc_cache_shrinker);
 	class_unregister_type(LUSTRE_OSC_NAME);
 	lu_kmem_fini(osc_caches);
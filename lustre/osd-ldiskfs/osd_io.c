@@ -775,6 +775,7 @@ static int osd_bufs_put(const struct lu_env *env, struct dt_object *dt,
 			struct niobuf_local *lnb, int npages)
 {
 	struct osd_thread_info *oti = osd_oti_get(env);
+	struct page *dio_page = NULL;
 	struct pagevec pvec;
 	int i;
 
@@ -790,6 +791,8 @@ static int osd_bufs_put(const struct lu_env *env, struct dt_object *dt,
 		 * to prevent reuse
 		 */
 		if (PagePrivate2(page)) {
+			if (dio_page == NULL)
+				dio_page = page;
 			oti->oti_dio_pages_used--;
 		} else {
 			if (lnb[i].lnb_locked)
@@ -801,7 +804,13 @@ static int osd_bufs_put(const struct lu_env *env, struct dt_object *dt,
 		lnb[i].lnb_page = NULL;
 	}
 
-	LASSERTF(oti->oti_dio_pages_used == 0, "%d\n", oti->oti_dio_pages_used);
+	/* a multi-object write holds the pages of all its objects until they
+	 * are committed, the pages of each object must be released in the
+	 * reverse order they were taken, see tgt_brw_write() */
+	LASSERTF(oti->oti_dio_pages_used >= 0 &&
+		 (dio_page == NULL ||
+		  dio_page == oti->oti_dio_pages[oti->oti_dio_pages_used]),
+		 "%d\n", oti->oti_dio_pages_used);
 
 	/* Release any partial pagevec */
 	pagevec_release(&pvec);
@@ -1228,6 +1228,9 @@ void ptlrpc_set_add_new_req(struct ptlrpcd_ctl *pc,
 		 */
 		for (i = 0; i < pc->pc_npartners; i++)
 			wake_up(&pc->pc_partners[i]->pc_set->set_waitq);
+	} else {
+		/* the thread is busy and its queue grows, get some help */
+		ptlrpcd_wake_thief(pc, count, 1);
 	}
 }
 
@@ -406,6 +406,10 @@ void reply_out_callback(struct lnet_event *ev)
                  ev->type == LNET_EVENT_ACK ||
                  ev->type == LNET_EVENT_UNLINK);
 
+	if (ev->unlinked && rs->rs_sent != 0)
+		ptlrpc_lat_tally(svcpt->scp_service, rs->rs_opc,
+				 PTLRPC_LAT_REPLY, rs->rs_sent, ktime_get_real());
+
         if (!rs->rs_difficult) {
                 /* 'Easy' replies have no further processing so I drop the
                  * net's ref on 'rs' */
@@ -656,6 +656,17 @@ static const struct req_msg_field *ost_brw_client[] = {
 	&RMF_SHORT_IO
 };
 
+/* ost_brw_client followed by one obdo per object of the RPC */
+static const struct req_msg_field *ost_brw_multi_client[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_OST_BODY,
+	&RMF_OBD_IOOBJ,
+	&RMF_NIOBUF_REMOTE,
+	&RMF_CAPA1,
+	&RMF_SHORT_IO,
+	&RMF_OBDO_ARRAY
+};
+
 static const struct req_msg_field *ost_brw_read_server[] = {
 	&RMF_PTLRPC_BODY,
 	&RMF_OST_BODY,
@@ -829,6 +840,7 @@ static struct req_format *req_formats[] = {
 	&RQF_OST_DESTROY,
 	&RQF_OST_BRW_READ,
 	&RQF_OST_BRW_WRITE,
+	&RQF_OST_BRW_WRITE_MULTI,
 	&RQF_OST_STATFS,
 	&RQF_OST_SET_GRANT_INFO,
 	&RQF_OST_GET_INFO,
@@ -1197,6 +1209,11 @@ struct req_msg_field RMF_OBD_IOOBJ =
                     sizeof(struct obd_ioobj), lustre_swab_obd_ioobj, dump_ioo);
 EXPORT_SYMBOL(RMF_OBD_IOOBJ);
 
+struct req_msg_field RMF_OBDO_ARRAY =
+	DEFINE_MSGF("obdo_array", RMF_F_STRUCT_ARRAY,
+		    sizeof(struct obdo), lustre_swab_obdo, dump_obdo);
+EXPORT_SYMBOL(RMF_OBDO_ARRAY);
+
 struct req_msg_field RMF_NIOBUF_REMOTE =
         DEFINE_MSGF("niobuf_remote", RMF_F_STRUCT_ARRAY,
                     sizeof(struct niobuf_remote), lustre_swab_niobuf_remote,
@@ -1761,6 +1778,11 @@ struct req_format RQF_OST_BRW_WRITE =
         DEFINE_REQ_FMT0("OST_BRW_WRITE", ost_brw_client, ost_brw_write_server);
 EXPORT_SYMBOL(RQF_OST_BRW_WRITE);
 
+struct req_format RQF_OST_BRW_WRITE_MULTI =
+	DEFINE_REQ_FMT0("OST_BRW_WRITE_MULTI", ost_brw_multi_client,
+			ost_brw_write_server);
+EXPORT_SYMBOL(RQF_OST_BRW_WRITE_MULTI);
+
 struct req_format RQF_OST_STATFS =
         DEFINE_REQ_FMT0("OST_STATFS", empty, obd_statfs_server);
 EXPORT_SYMBOL(RQF_OST_STATFS);
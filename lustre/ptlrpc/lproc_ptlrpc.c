@@ -472,6 +472,228 @@ static ssize_t threads_max_store(struct kobject *kobj, struct attribute *attr,
 }
 LUSTRE_RW_ATTR(threads_max);
 
+static ssize_t threads_delay_target_us_show(struct kobject *kobj,
+					    struct attribute *attr,
+					    char *buf)
+{
+	struct ptlrpc_service *svc = container_of(kobj, struct ptlrpc_service,
+						  srv_kobj);
+
+	return sprintf(buf, "%u\n", svc->srv_nthrs_delay_target);
+}
+
+static ssize_t threads_delay_target_us_store(struct kobject *kobj,
+					     struct attribute *attr,
+					     const char *buffer, size_t count)
+{
+	struct ptlrpc_service *svc = container_of(kobj, struct ptlrpc_service,
+						  srv_kobj);
+	struct ptlrpc_service_part *svcpt;
+	unsigned int val;
+	int rc;
+	int i;
+
+	rc = kstrtouint(buffer, 10, &val);
+	if (rc < 0)
+		return rc;
+
+	spin_lock(&svc->srv_lock);
+	svc->srv_nthrs_delay_target = val;
+	spin_unlock(&svc->srv_lock);
+
+	/* look at the pools already grown beyond threads_min */
+	if (val != 0) {
+		ptlrpc_service_for_each_part(svcpt, i, svc)
+			mod_timer(&svcpt->scp_thr_ctl_timer, jiffies +
+				  cfs_time_seconds(PTLRPC_THR_CTL_INTERVAL));
+	}
+
+	return count;
+}
+LUSTRE_RW_ATTR(threads_delay_target_us);
+
+static int ptlrpc_lprocfs_thread_pool_seq_show(struct seq_file *m, void *n)
+{
+	struct ptlrpc_service *svc = m->private;
+	struct ptlrpc_service_part *svcpt;
+	int i;
+
+	seq_printf(m, "delay_target_us: %u\n", svc->srv_nthrs_delay_target);
+	seq_printf(m, "threads_min: %d\nthreads_max: %d\npartitions:\n",
+		   svc->srv_nthrs_cpt_init, svc->srv_nthrs_cpt_limit);
+
+	ptlrpc_service_for_each_part(svcpt, i, svc) {
+		spin_lock(&svcpt->scp_lock);
+		seq_printf(m, "  - cpt: %d\n"
+			   "    threads_running: %d\n"
+			   "    threads_target: %d\n"
+			   "    queue_wait_us: %u\n"
+			   "    service_us: %u\n"
+			   "    grown: %lu\n"
+			   "    shrunk: %lu\n",
+			   svcpt->scp_cpt, svcpt->scp_nthrs_running,
+			   svcpt->scp_nthrs_target, svcpt->scp_thr_wait_avg,
+			   svcpt->scp_thr_svc_avg, svcpt->scp_thr_grown,
+			   svcpt->scp_thr_shrunk);
+		spin_unlock(&svcpt->scp_lock);
+	}
+
+	return 0;
+}
+
+LDEBUGFS_SEQ_FOPS_RO(ptlrpc_lprocfs_thread_pool);
+
+static const char * const ptlrpc_lat_phase_names[] = {
+	[PTLRPC_LAT_ENQUEUE]	= "enqueue",
+	[PTLRPC_LAT_NRS]	= "nrs_wait",
+	[PTLRPC_LAT_HANDLER]	= "handler",
+	[PTLRPC_LAT_COMMIT]	= "commit_wait",
+	[PTLRPC_LAT_REPLY]	= "reply_send",
+};
+
+/**
+ * Account the time from \a start to \a end to \a phase of opcode \a opc.
+ *
+ * The histograms of an opcode are allocated by the first request that is
+ * enqueued with it, so PTLRPC_LAT_ENQUEUE must be called from a thread that
+ * may sleep; the later phases, which can be timed from LNet callbacks, are
+ * dropped if the histograms do not exist.
+ */
+void ptlrpc_lat_tally(struct ptlrpc_service *svc, __u32 opc,
+		      enum ptlrpc_lat_phase phase, ktime_t start, ktime_t end)
+{
+	struct ptlrpc_lat_hist __percpu *hist;
+	int idx = opcode_offset(opc);
+	s64 usecs;
+	int bucket = 0;
+
+	if (unlikely(idx < 0 || idx >= LUSTRE_MAX_OPCODES))
+		return;
+
+	hist = READ_ONCE(svc->srv_lat_hist[idx]);
+	if (unlikely(hist == NULL)) {
+		if (phase != PTLRPC_LAT_ENQUEUE)
+			return;
+
+		hist = alloc_percpu(struct ptlrpc_lat_hist);
+		if (hist == NULL)
+			return;
+
+		if (cmpxchg(&svc->srv_lat_hist[idx], NULL, hist) != NULL) {
+			free_percpu(hist);
+			hist = svc->srv_lat_hist[idx];
+		}
+	}
+
+	usecs = ktime_us_delta(end, start);
+	if (likely(usecs > 0))
+		bucket = min_t(int, fls64(usecs - 1), OBD_HIST_MAX - 1);
+
+	this_cpu_inc(hist->lh_buckets[phase][bucket]);
+}
+
+void ptlrpc_lat_hist_free(struct ptlrpc_service *svc)
+{
+	int i;
+
+	for (i = 0; i < LUSTRE_MAX_OPCODES; i++) {
+		if (svc->srv_lat_hist[i] != NULL) {
+			free_percpu(svc->srv_lat_hist[i]);
+			svc->srv_lat_hist[i] = NULL;
+		}
+	}
+}
+
+static int ptlrpc_lprocfs_req_latency_seq_show(struct seq_file *m, void *n)
+{
+	struct ptlrpc_service *svc = m->private;
+	struct ptlrpc_lat_hist *sum;
+	struct timespec64 now;
+	int i;
+
+	OBD_ALLOC_PTR(sum);
+	if (sum == NULL)
+		return -ENOMEM;
+
+	ktime_get_real_ts64(&now);
+	seq_printf(m, "snapshot_time: %llu.%09lu\n",
+		   (s64)now.tv_sec, now.tv_nsec);
+
+	for (i = 0; i < LUSTRE_MAX_OPCODES; i++) {
+		struct ptlrpc_lat_hist __percpu *hist;
+		int phase;
+		int cpu;
+
+		hist = READ_ONCE(svc->srv_lat_hist[i]);
+		if (hist == NULL)
+			continue;
+
+		memset(sum, 0, sizeof(*sum));
+		for_each_possible_cpu(cpu) {
+			struct ptlrpc_lat_hist *h = per_cpu_ptr(hist, cpu);
+			int b;
+
+			for (phase = 0; phase < PTLRPC_LAT_MAX; phase++)
+				for (b = 0; b < OBD_HIST_MAX; b++)
+					sum->lh_buckets[phase][b] +=
+						h->lh_buckets[phase][b];
+		}
+
+		seq_printf(m, "%s:\n", ll_rpc_opcode_table[i].opname);
+		for (phase = 0; phase < PTLRPC_LAT_MAX; phase++) {
+			unsigned long samples = 0;
+			bool first = true;
+			int b;
+
+			for (b = 0; b < OBD_HIST_MAX; b++)
+				samples += sum->lh_buckets[phase][b];
+			if (samples == 0)
+				continue;
+
+			seq_printf(m, "  %s:\n    samples: %lu\n    usec: { ",
+				   ptlrpc_lat_phase_names[phase], samples);
+			for (b = 0; b < OBD_HIST_MAX; b++) {
+				if (sum->lh_buckets[phase][b] == 0)
+					continue;
+				seq_printf(m, "%s%llu: %lu", first ? "" : ", ",
+					   1ULL << b, sum->lh_buckets[phase][b]);
+				first = false;
+			}
+			seq_puts(m, " }\n");
+		}
+	}
+
+	OBD_FREE_PTR(sum);
+	return 0;
+}
+
+static ssize_t
+ptlrpc_lprocfs_req_latency_seq_write(struct file *file,
+				     const char __user *buffer,
+				     size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct ptlrpc_service *svc = m->private;
+	int i;
+	int cpu;
+
+	/* any write clears the histograms, like the stats files */
+	for (i = 0; i < LUSTRE_MAX_OPCODES; i++) {
+		struct ptlrpc_lat_hist __percpu *hist;
+
+		hist = READ_ONCE(svc->srv_lat_hist[i]);
+		if (hist == NULL)
+			continue;
+
+		for_each_possible_cpu(cpu)
+			memset(per_cpu_ptr(hist, cpu), 0, sizeof(*hist));
+	}
+
+	return count;
+}
+
+LDEBUGFS_SEQ_FOPS(ptlrpc_lprocfs_req_latency);
+
 /**
  * Translates \e ptlrpc_nrs_pol_state values to human-readable strings.
  *
@@ -1153,6 +1375,7 @@ static struct attribute *ptlrpc_svc_attrs[] = {
 	&lustre_attr_threads_min.attr,
 	&lustre_attr_threads_started.attr,
 	&lustre_attr_threads_max.attr,
+	&lustre_attr_threads_delay_target_us.attr,
 	&lustre_attr_high_priority_ratio.attr,
 	NULL,
 };
@@ -1208,6 +1431,12 @@ void ptlrpc_ldebugfs_register_service(struct dentry *entry,
 		{ .name = "req_buffers_max",
 		  .fops = &ptlrpc_lprocfs_req_buffers_max_fops,
 		  .data = svc },
+		{ .name = "thread_pool",
+		  .fops = &ptlrpc_lprocfs_thread_pool_fops,
+		  .data = svc },
+		{ .name = "req_latency",
+		  .fops = &ptlrpc_lprocfs_req_latency_fops,
+		  .data = svc },
 		{ NULL }
         };
         static struct file_operations req_history_fops = {
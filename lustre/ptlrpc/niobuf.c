@@ -639,6 +639,11 @@ int ptlrpc_send_reply(struct ptlrpc_request *req, int flags)
                 goto out;
 
 	req->rq_sent = ktime_get_real_seconds();
+	/* early replies are not timed, the final one will be */
+	if (!(flags & PTLRPC_REPLY_EARLY) && req->rq_reqmsg != NULL) {
+		rs->rs_opc = lustre_msg_get_opc(req->rq_repmsg);
+		rs->rs_sent = ktime_get_real();
+	}
 
 	rc = ptl_send_buf(&rs->rs_md_h, rs->rs_repbuf, rs->rs_repdata_len,
 			  (rs->rs_difficult && !rs->rs_no_ack) ?
@@ -0,0 +1,903 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License version 2 for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ * lustre/ptlrpc/nrs_edf.c
+ *
+ * Network Request Scheduler (NRS) Earliest Deadline First (EDF) policy
+ *
+ * This policy gives each request a deadline, derived from its arrival time
+ * and the latency objective of the rule the request matches, and always
+ * handles the queued request with the earliest deadline first.
+ */
+
+#ifdef HAVE_SERVER_SUPPORT
+
+/**
+ * \addtogoup nrs
+ * @{
+ */
+
+#define DEBUG_SUBSYSTEM S_RPC
+
+#include <obd_support.h>
+#include <obd_class.h>
+#include "ptlrpc_internal.h"
+
+/**
+ * \name edf
+ *
+ * Rules match requests by jobid, UID, client NID or opcode, and assign a
+ * latency objective (deadline) in milliseconds to the requests they match.
+ * Requests matching no other rule use the "default" rule. Unlike TBF, the
+ * policy is work-conserving: a request is never held back while a service
+ * thread is idle, only reordered.
+ *
+ * Each rule counts the requests it has handled, and how many of them
+ * completed after their deadline, so that objectives can be tuned and
+ * monitored through the nrs_edf_rule file.
+ *
+ * @{
+ */
+
+#define NRS_POL_NAME_EDF		"edf"
+
+/* Name of the catch-all rule */
+#define NRS_EDF_DEFAULT_RULE		"default"
+/* Deadline of the default rule, in milliseconds */
+#define NRS_EDF_DEFAULT_DEADLINE	10000
+/* Largest deadline that can be set, in milliseconds */
+#define NRS_EDF_DEADLINE_MAX		3600000
+
+enum nrs_edf_cmd_type {
+	NRS_EDF_CMD_START,
+	NRS_EDF_CMD_CHANGE,
+	NRS_EDF_CMD_STOP,
+};
+
+/**
+ * A parsed nrs_edf_rule command, applied to each policy instance in turn.
+ */
+struct nrs_edf_cmd {
+	enum nrs_edf_cmd_type	 ec_cmd;
+	char			*ec_name;
+	enum nrs_edf_match	 ec_match;
+	union {
+		char		*ec_jobid;
+		__u32		 ec_uid;
+		lnet_nid_t	 ec_nid;
+		__u32		 ec_opcode;
+	};
+	__u32			 ec_deadline_ms;
+};
+
+/**
+ * Binary heap predicate.
+ *
+ * Requests are ordered by their deadline; requests with the same deadline are
+ * ordered by their arrival in the policy, so that the policy degrades to FIFO
+ * when all requests share one objective.
+ *
+ * \retval 0 e1 is to be handled after e2
+ * \retval 1 e1 is to be handled before e2
+ */
+static int edf_req_compare(struct cfs_binheap_node *e1,
+			   struct cfs_binheap_node *e2)
+{
+	struct ptlrpc_nrs_request *nrq1;
+	struct ptlrpc_nrs_request *nrq2;
+
+	nrq1 = container_of(e1, struct ptlrpc_nrs_request, nr_node);
+	nrq2 = container_of(e2, struct ptlrpc_nrs_request, nr_node);
+
+	if (ktime_before(nrq1->nr_u.edf.edf_deadline,
+			 nrq2->nr_u.edf.edf_deadline))
+		return 1;
+	if (ktime_after(nrq1->nr_u.edf.edf_deadline,
+			nrq2->nr_u.edf.edf_deadline))
+		return 0;
+
+	return nrq1->nr_u.edf.edf_sequence < nrq2->nr_u.edf.edf_sequence;
+}
+
+static struct cfs_binheap_ops nrs_edf_heap_ops = {
+	.hop_enter	= NULL,
+	.hop_exit	= NULL,
+	.hop_compare	= edf_req_compare,
+};
+
+static struct nrs_edf_rule *
+nrs_edf_rule_alloc(struct ptlrpc_nrs_policy *policy, const char *name,
+		   __u32 deadline_ms, gfp_t gfp)
+{
+	struct nrs_edf_rule *rule;
+
+	OBD_CPT_ALLOC_GFP(rule, nrs_pol2cptab(policy), nrs_pol2cptid(policy),
+			  sizeof(*rule), gfp);
+	if (rule == NULL)
+		return NULL;
+
+	INIT_LIST_HEAD(&rule->er_list);
+	strlcpy(rule->er_name, name, sizeof(rule->er_name));
+	rule->er_match = NRS_EDF_MATCH_ALL;
+	rule->er_deadline_ms = deadline_ms;
+	/* the reference of nrs_edf_head::eh_rules */
+	atomic_set(&rule->er_ref, 1);
+
+	return rule;
+}
+
+static void nrs_edf_rule_put(struct nrs_edf_rule *rule)
+{
+	if (atomic_dec_and_test(&rule->er_ref)) {
+		LASSERT(list_empty(&rule->er_list));
+		OBD_FREE_PTR(rule);
+	}
+}
+
+static struct nrs_edf_rule *
+nrs_edf_rule_find_nolock(struct nrs_edf_head *head, const char *name)
+{
+	struct nrs_edf_rule *rule;
+
+	list_for_each_entry(rule, &head->eh_rules, er_list) {
+		if (strcmp(rule->er_name, name) == 0)
+			return rule;
+	}
+
+	return NULL;
+}
+
+/**
+ * Checks whether request \a req is matched by \a rule.
+ *
+ * \param[in] rule the rule
+ * \param[in] req  the request
+ * \param[in] id   the request's UID/GID, or NULL if they could not be found
+ */
+static bool nrs_edf_rule_match(struct nrs_edf_rule *rule,
+			       struct ptlrpc_request *req, struct tbf_id *id)
+{
+	const char *jobid;
+
+	switch (rule->er_match) {
+	default:
+	case NRS_EDF_MATCH_ALL:
+		return true;
+	case NRS_EDF_MATCH_JOBID:
+		jobid = lustre_msg_get_jobid(req->rq_reqmsg);
+		return jobid != NULL && jobid[0] != '\0' &&
+		       nrs_match_wildcard(rule->er_jobid, jobid);
+	case NRS_EDF_MATCH_UID:
+		return id != NULL && id->ti_uid == rule->er_uid;
+	case NRS_EDF_MATCH_NID:
+		return req->rq_peer.nid == rule->er_nid;
+	case NRS_EDF_MATCH_OPCODE:
+		return lustre_msg_get_opc(req->rq_reqmsg) == rule->er_opcode;
+	}
+}
+
+/**
+ * Is called before the policy transitions into
+ * ptlrpc_nrs_pol_state::NRS_POL_STATE_STARTED; allocates and initializes
+ * the EDF-specific private data structure and the default rule.
+ *
+ * \param[in] policy The policy to start
+ * \param[in] arg    Generic char buffer; unused in this policy
+ *
+ * \retval -ENOMEM OOM error
+ * \retval  0	   success
+ *
+ * \see nrs_policy_register()
+ * \see nrs_policy_ctl()
+ */
+static int nrs_edf_start(struct ptlrpc_nrs_policy *policy, char *arg)
+{
+	struct nrs_edf_head *head;
+	int rc = 0;
+
+	ENTRY;
+
+	OBD_CPT_ALLOC_PTR(head, nrs_pol2cptab(policy), nrs_pol2cptid(policy));
+	if (head == NULL)
+		RETURN(-ENOMEM);
+
+	head->eh_binheap = cfs_binheap_create(&nrs_edf_heap_ops,
+					      CBH_FLAG_ATOMIC_GROW, 4096, NULL,
+					      nrs_pol2cptab(policy),
+					      nrs_pol2cptid(policy));
+	if (head->eh_binheap == NULL)
+		GOTO(out_free_head, rc = -ENOMEM);
+
+	head->eh_default = nrs_edf_rule_alloc(policy, NRS_EDF_DEFAULT_RULE,
+					      NRS_EDF_DEFAULT_DEADLINE,
+					      GFP_NOFS);
+	if (head->eh_default == NULL)
+		GOTO(out_free_heap, rc = -ENOMEM);
+
+	INIT_LIST_HEAD(&head->eh_rules);
+	spin_lock_init(&head->eh_rule_lock);
+	list_add(&head->eh_default->er_list, &head->eh_rules);
+
+	policy->pol_private = head;
+
+	RETURN(0);
+
+out_free_heap:
+	cfs_binheap_destroy(head->eh_binheap);
+out_free_head:
+	OBD_FREE_PTR(head);
+
+	RETURN(rc);
+}
+
+/**
+ * Is called before the policy transitions into
+ * ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPED; deallocates the EDF-specific
+ * private data structure and all rules.
+ *
+ * \param[in] policy The policy to stop
+ *
+ * \see nrs_policy_stop0()
+ */
+static void nrs_edf_stop(struct ptlrpc_nrs_policy *policy)
+{
+	struct nrs_edf_head *head = policy->pol_private;
+	struct nrs_edf_rule *rule;
+	struct nrs_edf_rule *tmp;
+
+	LASSERT(head != NULL);
+	LASSERT(head->eh_binheap != NULL);
+	LASSERT(cfs_binheap_is_empty(head->eh_binheap));
+
+	list_for_each_entry_safe(rule, tmp, &head->eh_rules, er_list) {
+		list_del_init(&rule->er_list);
+		LASSERT(atomic_read(&rule->er_ref) == 1);
+		nrs_edf_rule_put(rule);
+	}
+
+	cfs_binheap_destroy(head->eh_binheap);
+	OBD_FREE_PTR(head);
+}
+
+/**
+ * Is called for obtaining an EDF policy resource.
+ *
+ * The resource hierarchy has two levels; the top level is the policy head,
+ * and the bottom level is the rule that \a nrq matches.
+ *
+ * \param[in]  policy	  The policy on which the request is being asked for
+ * \param[in]  nrq	  The request for which resources are being taken
+ * \param[in]  parent	  Parent resource, embedded in nrs_edf_head for the
+ *			  EDF policy
+ * \param[out] resp	  Resources references are placed in this array
+ * \param[in]  moving_req Signifies limited caller context; no memory is
+ *			  allocated here, so it is unused
+ *
+ * \retval 0 we are returning a top-level, parent resource, one that is
+ *	     embedded in an nrs_edf_head object
+ * \retval 1 we are returning a bottom-level resource, one that is embedded in
+ *	     an nrs_edf_rule object
+ *
+ * \see nrs_resource_get_safe()
+ */
+static int nrs_edf_res_get(struct ptlrpc_nrs_policy *policy,
+			   struct ptlrpc_nrs_request *nrq,
+			   const struct ptlrpc_nrs_resource *parent,
+			   struct ptlrpc_nrs_resource **resp, bool moving_req)
+{
+	struct nrs_edf_head *head = policy->pol_private;
+	struct ptlrpc_request *req = container_of(nrq, struct ptlrpc_request,
+						  rq_nrq);
+	struct nrs_edf_rule *rule;
+	struct tbf_id id;
+	bool have_id;
+
+	if (parent == NULL) {
+		*resp = &head->eh_res;
+		return 0;
+	}
+
+	have_id = nrs_tbf_id_cli_set(req, &id, NRS_TBF_FLAG_UID) == 0;
+
+	spin_lock(&head->eh_rule_lock);
+	/* the default rule is last in the list and matches everything */
+	list_for_each_entry(rule, &head->eh_rules, er_list) {
+		if (nrs_edf_rule_match(rule, req, have_id ? &id : NULL))
+			break;
+	}
+	LASSERT(&rule->er_list != &head->eh_rules);
+	atomic_inc(&rule->er_ref);
+	spin_unlock(&head->eh_rule_lock);
+
+	*resp = &rule->er_res;
+
+	return 1;
+}
+
+/**
+ * Called when releasing references to the resource hierachy obtained for a
+ * request for scheduling using the EDF policy.
+ *
+ * \param[in] policy   the policy the resource belongs to
+ * \param[in] res      the resource to be released
+ */
+static void nrs_edf_res_put(struct ptlrpc_nrs_policy *policy,
+			    const struct ptlrpc_nrs_resource *res)
+{
+	/**
+	 * Do nothing for freeing parent, nrs_edf_head resources
+	 */
+	if (res->res_parent == NULL)
+		return;
+
+	nrs_edf_rule_put(container_of(res, struct nrs_edf_rule, er_res));
+}
+
+/**
+ * Called when getting a request from the EDF policy for handling, or just
+ * peeking; removes the request from the policy when it is to be handled.
+ *
+ * \param[in] policy The policy
+ * \param[in] peek   When set, signifies that we just want to examine the
+ *		     request, and not handle it, so the request is not removed
+ *		     from the policy.
+ * \param[in] force  Unused; the policy never holds requests back
+ *
+ * \retval the request with the earliest deadline
+ * \retval NULL no request available
+ *
+ * \see ptlrpc_nrs_req_get_nolock()
+ * \see nrs_request_get()
+ */
+static
+struct ptlrpc_nrs_request *nrs_edf_req_get(struct ptlrpc_nrs_policy *policy,
+					   bool peek, bool force)
+{
+	struct nrs_edf_head *head = policy->pol_private;
+	struct cfs_binheap_node *node;
+	struct ptlrpc_nrs_request *nrq;
+
+	node = cfs_binheap_root(head->eh_binheap);
+	nrq = unlikely(node == NULL) ? NULL :
+	      container_of(node, struct ptlrpc_nrs_request, nr_node);
+
+	if (likely(!peek && nrq != NULL)) {
+		struct ptlrpc_request *req = container_of(nrq,
+							  struct ptlrpc_request,
+							  rq_nrq);
+
+		cfs_binheap_remove(head->eh_binheap, &nrq->nr_node);
+
+		CDEBUG(D_RPCTRACE,
+		       "NRS: starting to handle %s request from %s, seq: %llu, deadline in %lldms\n",
+		       policy->pol_desc->pd_name, libcfs_id2str(req->rq_peer),
+		       nrq->nr_u.edf.edf_sequence,
+		       ktime_ms_delta(nrq->nr_u.edf.edf_deadline,
+				      ktime_get_real()));
+	}
+
+	return nrq;
+}
+
+/**
+ * Adds request \a nrq to an EDF \a policy instance's set of queued requests.
+ *
+ * The deadline of the request is its arrival time plus the latency objective
+ * of the rule it was matched to in nrs_edf_res_get().
+ *
+ * \param[in] policy The policy
+ * \param[in] nrq    The request to add
+ *
+ * \retval 0	 request added
+ * \retval != 0	 error
+ */
+static int nrs_edf_req_add(struct ptlrpc_nrs_policy *policy,
+			   struct ptlrpc_nrs_request *nrq)
+{
+	struct nrs_edf_head *head = policy->pol_private;
+	struct ptlrpc_request *req = container_of(nrq, struct ptlrpc_request,
+						  rq_nrq);
+	struct nrs_edf_rule *rule;
+
+	rule = container_of(nrs_request_resource(nrq), struct nrs_edf_rule,
+			    er_res);
+
+	nrq->nr_u.edf.edf_deadline =
+		ktime_add_ms(timespec64_to_ktime(req->rq_srv.sr_arrival_time),
+			     rule->er_deadline_ms);
+	nrq->nr_u.edf.edf_sequence = head->eh_sequence++;
+
+	return cfs_binheap_insert(head->eh_binheap, &nrq->nr_node);
+}
+
+/**
+ * Removes request \a nrq from \a policy's list of queued requests.
+ *
+ * \param[in] policy The policy
+ * \param[in] nrq    The request to remove
+ */
+static void nrs_edf_req_del(struct ptlrpc_nrs_policy *policy,
+			    struct ptlrpc_nrs_request *nrq)
+{
+	struct nrs_edf_head *head = policy->pol_private;
+
+	cfs_binheap_remove(head->eh_binheap, &nrq->nr_node);
+}
+
+/**
+ * Accounts request \a nrq against its rule right before it stops being
+ * handled, counting it as a deadline miss if it completed too late.
+ *
+ * \param[in] policy The policy handling the request
+ * \param[in] nrq    The request being handled
+ *
+ * \see ptlrpc_server_finish_request()
+ * \see ptlrpc_nrs_req_stop_nolock()
+ */
+static void nrs_edf_req_stop(struct ptlrpc_nrs_policy *policy,
+			     struct ptlrpc_nrs_request *nrq)
+{
+	struct ptlrpc_request *req = container_of(nrq, struct ptlrpc_request,
+						  rq_nrq);
+	struct nrs_edf_rule *rule;
+	s64 late;
+
+	rule = container_of(nrs_request_resource(nrq), struct nrs_edf_rule,
+			    er_res);
+	late = ktime_ms_delta(ktime_get_real(), nrq->nr_u.edf.edf_deadline);
+
+	rule->er_handled++;
+	if (late > 0)
+		rule->er_missed++;
+
+	DEBUG_REQ(D_RPCTRACE, req,
+		  "NRS: finished request of rule %s, %lldms %s deadline",
+		  rule->er_name, late > 0 ? late : -late,
+		  late > 0 ? "after" : "before");
+}
+
+static void nrs_edf_rule_dump(struct nrs_edf_rule *rule, struct seq_file *m)
+{
+	seq_printf(m, "%s ", rule->er_name);
+
+	switch (rule->er_match) {
+	default:
+	case NRS_EDF_MATCH_ALL:
+		seq_puts(m, "{*}");
+		break;
+	case NRS_EDF_MATCH_JOBID:
+		seq_printf(m, "jobid={%s}", rule->er_jobid);
+		break;
+	case NRS_EDF_MATCH_UID:
+		seq_printf(m, "uid={%u}", rule->er_uid);
+		break;
+	case NRS_EDF_MATCH_NID:
+		seq_printf(m, "nid={%s}", libcfs_nid2str(rule->er_nid));
+		break;
+	case NRS_EDF_MATCH_OPCODE:
+		seq_printf(m, "opcode={%s}", ll_opcode2str(rule->er_opcode));
+		break;
+	}
+
+	seq_printf(m, " deadline=%u, handled=%llu, missed=%llu, ref %d\n",
+		   rule->er_deadline_ms, rule->er_handled, rule->er_missed,
+		   atomic_read(&rule->er_ref) - 1);
+}
+
+static int nrs_edf_command(struct ptlrpc_nrs_policy *policy,
+			   struct nrs_edf_head *head, struct nrs_edf_cmd *cmd)
+{
+	struct nrs_edf_rule *rule;
+	struct nrs_edf_rule *new = NULL;
+	int rc = 0;
+
+	if (cmd->ec_cmd == NRS_EDF_CMD_START) {
+		new = nrs_edf_rule_alloc(policy, cmd->ec_name,
+					 cmd->ec_deadline_ms, GFP_ATOMIC);
+		if (new == NULL)
+			return -ENOMEM;
+
+		new->er_match = cmd->ec_match;
+		switch (cmd->ec_match) {
+		default:
+			LBUG();
+		case NRS_EDF_MATCH_JOBID:
+			strlcpy(new->er_jobid, cmd->ec_jobid,
+				sizeof(new->er_jobid));
+			break;
+		case NRS_EDF_MATCH_UID:
+			new->er_uid = cmd->ec_uid;
+			break;
+		case NRS_EDF_MATCH_NID:
+			new->er_nid = cmd->ec_nid;
+			break;
+		case NRS_EDF_MATCH_OPCODE:
+			new->er_opcode = cmd->ec_opcode;
+			break;
+		}
+	}
+
+	spin_lock(&head->eh_rule_lock);
+	rule = nrs_edf_rule_find_nolock(head, cmd->ec_name);
+	switch (cmd->ec_cmd) {
+	case NRS_EDF_CMD_START:
+		if (rule != NULL) {
+			rc = -EEXIST;
+			break;
+		}
+		/* newer rules take precedence over older ones */
+		list_add(&new->er_list, &head->eh_rules);
+		new = NULL;
+		break;
+	case NRS_EDF_CMD_CHANGE:
+		if (rule == NULL)
+			rc = -ENOENT;
+		else
+			rule->er_deadline_ms = cmd->ec_deadline_ms;
+		break;
+	case NRS_EDF_CMD_STOP:
+		if (rule == NULL) {
+			rc = -ENOENT;
+		} else if (rule == head->eh_default) {
+			rc = -EPERM;
+		} else {
+			list_del_init(&rule->er_list);
+			nrs_edf_rule_put(rule);
+		}
+		break;
+	}
+	spin_unlock(&head->eh_rule_lock);
+
+	/* the rule was not needed after all */
+	if (new != NULL)
+		nrs_edf_rule_put(new);
+
+	return rc;
+}
+
+/**
+ * Performs ctl functions specific to EDF policy instances; similar to ioctl
+ *
+ * \param[in]     policy the policy instance
+ * \param[in]     opc    the opcode
+ * \param[in,out] arg    used for passing parameters and information
+ *
+ * \pre assert_spin_locked(&policy->pol_nrs->->nrs_lock)
+ * \post assert_spin_locked(&policy->pol_nrs->->nrs_lock)
+ *
+ * \retval 0   operation carried out successfully
+ * \retval -ve error
+ */
+static int nrs_edf_ctl(struct ptlrpc_nrs_policy *policy,
+		       enum ptlrpc_nrs_ctl opc, void *arg)
+{
+	struct nrs_edf_head *head = policy->pol_private;
+	int rc = 0;
+
+	ENTRY;
+
+	assert_spin_locked(&policy->pol_nrs->nrs_lock);
+
+	switch ((enum nrs_ctl_edf)opc) {
+	default:
+		RETURN(-EINVAL);
+
+	case NRS_CTL_EDF_RD_RULE: {
+		struct seq_file *m = arg;
+		struct nrs_edf_rule *rule;
+
+		seq_printf(m, "CPT %d:\n", nrs_pol2cptid(policy));
+
+		spin_lock(&head->eh_rule_lock);
+		list_for_each_entry(rule, &head->eh_rules, er_list)
+			nrs_edf_rule_dump(rule, m);
+		spin_unlock(&head->eh_rule_lock);
+		break;
+	}
+
+	case NRS_CTL_EDF_WR_RULE:
+		rc = nrs_edf_command(policy, head, arg);
+		break;
+	}
+
+	RETURN(rc);
+}
+
+/**
+ * debugfs interface
+ */
+
+static int
+ptlrpc_lprocfs_nrs_edf_rule_seq_show(struct seq_file *m, void *data)
+{
+	struct ptlrpc_service *svc = m->private;
+	int rc;
+
+	seq_printf(m, "regular_requests:\n");
+	/**
+	 * Perform two separate calls to this as only one of the NRS heads'
+	 * policies may be in the ptlrpc_nrs_pol_state::NRS_POL_STATE_STARTED or
+	 * ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPING state.
+	 */
+	rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_REG,
+				       NRS_POL_NAME_EDF,
+				       NRS_CTL_EDF_RD_RULE,
+				       false, m);
+	/**
+	 * Ignore -ENODEV as the regular NRS head's policy may be in the
+	 * ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPED state.
+	 */
+	if (rc != 0 && rc != -ENODEV)
+		return rc;
+
+	if (!nrs_svc_has_hp(svc))
+		return 0;
+
+	seq_printf(m, "high_priority_requests:\n");
+	rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_HP,
+				       NRS_POL_NAME_EDF,
+				       NRS_CTL_EDF_RD_RULE,
+				       false, m);
+	if (rc == -ENODEV)
+		rc = 0;
+
+	return rc;
+}
+
+/**
+ * Parses the match key of a start command, one of "jobid={pattern}",
+ * "uid={n}", "nid={nid}" or "opcode={name}".
+ */
+static int nrs_edf_match_parse(struct nrs_edf_cmd *cmd, char *token)
+{
+	char *key;
+	char *val;
+	size_t len;
+
+	key = strsep(&token, "=");
+	if (token == NULL)
+		return -EINVAL;
+
+	/* strip the braces around the value */
+	val = token;
+	len = strlen(val);
+	if (len < 3 || val[0] != '{' || val[len - 1] != '}')
+		return -EINVAL;
+	val[len - 1] = '\0';
+	val++;
+
+	if (strcmp(key, "jobid") == 0) {
+		if (strlen(val) >= LUSTRE_JOBID_SIZE)
+			return -EINVAL;
+		cmd->ec_match = NRS_EDF_MATCH_JOBID;
+		cmd->ec_jobid = val;
+	} else if (strcmp(key, "uid") == 0) {
+		if (kstrtou32(val, 0, &cmd->ec_uid))
+			return -EINVAL;
+		cmd->ec_match = NRS_EDF_MATCH_UID;
+	} else if (strcmp(key, "nid") == 0) {
+		cmd->ec_nid = libcfs_str2nid(val);
+		if (cmd->ec_nid == LNET_NID_ANY)
+			return -EINVAL;
+		cmd->ec_match = NRS_EDF_MATCH_NID;
+	} else if (strcmp(key, "opcode") == 0) {
+		int opc = ll_str2opcode(val);
+
+		if (opc < 0)
+			return -EINVAL;
+		cmd->ec_opcode = opc;
+		cmd->ec_match = NRS_EDF_MATCH_OPCODE;
+	} else {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/**
+ * Parses a rule command, in the format:
+ *
+ *   start <name> <key>={<value>} deadline=<ms>
+ *   change <name> deadline=<ms>
+ *   stop <name>
+ */
+static int nrs_edf_parse_cmd(struct nrs_edf_cmd *cmd, char *buffer)
+{
+	char *token;
+	char *val = buffer;
+	int rc;
+
+	token = strsep(&val, " ");
+	if (strcmp(token, "start") == 0)
+		cmd->ec_cmd = NRS_EDF_CMD_START;
+	else if (strcmp(token, "change") == 0)
+		cmd->ec_cmd = NRS_EDF_CMD_CHANGE;
+	else if (strcmp(token, "stop") == 0)
+		cmd->ec_cmd = NRS_EDF_CMD_STOP;
+	else
+		return -EINVAL;
+
+	token = strsep(&val, " ");
+	if (token == NULL || token[0] == '\0' ||
+	    strlen(token) >= NRS_EDF_RULE_NAME_MAX)
+		return -EINVAL;
+	cmd->ec_name = token;
+
+	if (cmd->ec_cmd == NRS_EDF_CMD_STOP)
+		return val == NULL ? 0 : -EINVAL;
+
+	if (cmd->ec_cmd == NRS_EDF_CMD_START) {
+		token = strsep(&val, " ");
+		if (token == NULL)
+			return -EINVAL;
+		rc = nrs_edf_match_parse(cmd, token);
+		if (rc)
+			return rc;
+	}
+
+	token = strsep(&val, " ");
+	if (token == NULL || val != NULL ||
+	    strncmp(token, "deadline=", strlen("deadline=")) != 0)
+		return -EINVAL;
+
+	rc = kstrtou32(token + strlen("deadline="), 10, &cmd->ec_deadline_ms);
+	if (rc)
+		return rc;
+	if (cmd->ec_deadline_ms == 0 ||
+	    cmd->ec_deadline_ms > NRS_EDF_DEADLINE_MAX)
+		return -EINVAL;
+
+	return 0;
+}
+
+#define LPROCFS_WR_NRS_EDF_MAX_CMD (256)
+
+/**
+ * Starts, changes or stops an EDF rule on the regular and/or high-priority
+ * NRS head of a service.
+ *
+ * For example:
+ *
+ * lctl set_param ost.OSS.ost_io.nrs_edf_rule=
+ *	"start interactive jobid={bash.*} deadline=50"
+ * lctl set_param ost.OSS.ost_io.nrs_edf_rule=
+ *	"reg change default deadline=2000"
+ * lctl set_param ost.OSS.ost_io.nrs_edf_rule="stop interactive"
+ */
+static ssize_t
+ptlrpc_lprocfs_nrs_edf_rule_seq_write(struct file *file,
+				      const char __user *buffer,
+				      size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct ptlrpc_service *svc = m->private;
+	enum ptlrpc_nrs_queue_type queue = PTLRPC_NRS_QUEUE_BOTH;
+	struct nrs_edf_cmd cmd = { 0 };
+	char *kernbuf;
+	char *val;
+	char *token;
+	int rc;
+
+	if (count > LPROCFS_WR_NRS_EDF_MAX_CMD - 1)
+		return -EINVAL;
+
+	OBD_ALLOC(kernbuf, LPROCFS_WR_NRS_EDF_MAX_CMD);
+	if (kernbuf == NULL)
+		return -ENOMEM;
+
+	if (copy_from_user(kernbuf, buffer, count))
+		GOTO(out_free_kernbuff, rc = -EFAULT);
+
+	val = strim(kernbuf);
+	token = strsep(&val, " ");
+	if (val == NULL)
+		GOTO(out_free_kernbuff, rc = -EINVAL);
+
+	if (strcmp(token, "reg") == 0) {
+		queue = PTLRPC_NRS_QUEUE_REG;
+	} else if (strcmp(token, "hp") == 0) {
+		queue = PTLRPC_NRS_QUEUE_HP;
+	} else {
+		token[strlen(token)] = ' ';
+		val = token;
+	}
+
+	if (queue == PTLRPC_NRS_QUEUE_HP && !nrs_svc_has_hp(svc))
+		GOTO(out_free_kernbuff, rc = -ENODEV);
+	else if (queue == PTLRPC_NRS_QUEUE_BOTH && !nrs_svc_has_hp(svc))
+		queue = PTLRPC_NRS_QUEUE_REG;
+
+	rc = nrs_edf_parse_cmd(&cmd, val);
+	if (rc)
+		GOTO(out_free_kernbuff, rc);
+
+	/**
+	 * Serialize NRS core lprocfs operations with policy registration/
+	 * unregistration.
+	 */
+	mutex_lock(&nrs_core.nrs_mutex);
+	rc = ptlrpc_nrs_policy_control(svc, queue, NRS_POL_NAME_EDF,
+				       NRS_CTL_EDF_WR_RULE, false, &cmd);
+	mutex_unlock(&nrs_core.nrs_mutex);
+
+out_free_kernbuff:
+	OBD_FREE(kernbuf, LPROCFS_WR_NRS_EDF_MAX_CMD);
+
+	return rc ? rc : count;
+}
+
+LDEBUGFS_SEQ_FOPS(ptlrpc_lprocfs_nrs_edf_rule);
+
+/**
+ * Initializes an EDF policy's lprocfs interface for service \a svc
+ *
+ * \param[in] svc the service
+ *
+ * \retval 0	success
+ * \retval != 0	error
+ */
+static int nrs_edf_lprocfs_init(struct ptlrpc_service *svc)
+{
+	struct ldebugfs_vars nrs_edf_lprocfs_vars[] = {
+		{ .name		= "nrs_edf_rule",
+		  .fops		= &ptlrpc_lprocfs_nrs_edf_rule_fops,
+		  .data		= svc },
+		{ NULL }
+	};
+
+	if (!svc->srv_debugfs_entry)
+		return 0;
+
+	ldebugfs_add_vars(svc->srv_debugfs_entry, nrs_edf_lprocfs_vars, NULL);
+
+	return 0;
+}
+
+/**
+ * EDF policy operations
+ */
+static const struct ptlrpc_nrs_pol_ops nrs_edf_ops = {
+	.op_policy_start	= nrs_edf_start,
+	.op_policy_stop		= nrs_edf_stop,
+	.op_policy_ctl		= nrs_edf_ctl,
+	.op_res_get		= nrs_edf_res_get,
+	.op_res_put		= nrs_edf_res_put,
+	.op_req_get		= nrs_edf_req_get,
+	.op_req_enqueue		= nrs_edf_req_add,
+	.op_req_dequeue		= nrs_edf_req_del,
+	.op_req_stop		= nrs_edf_req_stop,
+	.op_lprocfs_init	= nrs_edf_lprocfs_init,
+};
+
+/**
+ * EDF policy configuration
+ */
+struct ptlrpc_nrs_pol_conf nrs_conf_edf = {
+	.nc_name		= NRS_POL_NAME_EDF,
+	.nc_ops			= &nrs_edf_ops,
+	.nc_compat		= nrs_policy_compat_all,
+};
+
+/** @} edf */
+
+/** @} nrs */
+
+#endif /* HAVE_SERVER_SUPPORT */
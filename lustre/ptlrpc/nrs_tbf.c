@@ -50,6 +50,14 @@
  *
  * Token Bucket Filter over client NIDs
  *
+ * Rules can be arranged in a hierarchy. A rule with a ceiling ("ceil=")
+ * higher than its rate lets each of its clients borrow tokens beyond the
+ * rate, up to the ceiling, whenever no client in the policy instance has a
+ * token of its own left; so clients are still served in deadline order under
+ * contention, but a throttled client does not leave the server idle. The
+ * borrowed RPCs of all clients of a rule are bounded by the rule's "share=",
+ * and by the shares of its ancestors named through "parent=".
+ *
  * @{
  */
 
@@ -82,12 +90,16 @@ static enum hrtimer_restart nrs_tbf_timer_cb(struct hrtimer *timer)
 
 #define NRS_TBF_DEFAULT_RULE "default"
 
+static void nrs_tbf_rule_put(struct nrs_tbf_rule *rule);
+
 static void nrs_tbf_rule_fini(struct nrs_tbf_rule *rule)
 {
 	LASSERT(atomic_read(&rule->tr_ref) == 0);
 	LASSERT(list_empty(&rule->tr_cli_list));
 	LASSERT(list_empty(&rule->tr_linkage));
 
+	if (rule->tr_parent != NULL)
+		nrs_tbf_rule_put(rule->tr_parent);
 	rule->tr_head->th_ops->o_rule_fini(rule);
 	OBD_FREE_PTR(rule);
 }
@@ -124,6 +136,142 @@ nrs_tbf_cli_rule_put(struct nrs_tbf_client *cli)
 	cli->tc_rule = NULL;
 }
 
+/**
+ * Whether client \a cli may exceed its RPC rate with borrowed tokens.
+ */
+static inline bool nrs_tbf_cli_can_borrow(struct nrs_tbf_client *cli)
+{
+	return cli->tc_ceil_rate > cli->tc_rpc_rate;
+}
+
+static void nrs_tbf_cli_ceil_refill(struct nrs_tbf_client *cli, __u64 now)
+{
+	__u64 ntoken;
+
+	if (now <= cli->tc_ceil_check_time)
+		return;
+
+	ntoken = (now - cli->tc_ceil_check_time) * cli->tc_ceil_rate;
+	do_div(ntoken, NSEC_PER_SEC);
+	/* keep the time check-point until a whole token is earned */
+	if (ntoken == 0)
+		return;
+
+	ntoken += cli->tc_ceil_ntoken;
+	cli->tc_ceil_ntoken = min(ntoken, cli->tc_depth);
+	cli->tc_ceil_check_time = now;
+}
+
+static inline void nrs_tbf_cli_ceil_deadline(struct nrs_tbf_client *cli)
+{
+	cli->tc_ceil_deadline = cli->tc_ceil_check_time;
+	if (cli->tc_ceil_ntoken == 0)
+		cli->tc_ceil_deadline += cli->tc_ceil_nsecs;
+}
+
+/**
+ * Takes a ceiling token for an RPC of \a cli, whether it was handled with a
+ * token of its own or a borrowed one.
+ */
+static void nrs_tbf_cli_ceil_charge(struct nrs_tbf_client *cli, __u64 now)
+{
+	if (!nrs_tbf_cli_can_borrow(cli))
+		return;
+
+	nrs_tbf_cli_ceil_refill(cli, now);
+	if (cli->tc_ceil_ntoken > 0)
+		cli->tc_ceil_ntoken--;
+	nrs_tbf_cli_ceil_deadline(cli);
+}
+
+/**
+ * Keeps client \a cli in the heap of borrowing clients as long as it has
+ * queued requests and its rule lets it borrow.
+ */
+static void nrs_tbf_cli_borrow_update(struct nrs_tbf_head *head,
+				      struct nrs_tbf_client *cli)
+{
+	bool borrow = cli->tc_in_heap && nrs_tbf_cli_can_borrow(cli);
+
+	if (borrow && cli->tc_in_borrow_heap) {
+		cfs_binheap_relocate(head->th_borrow_binheap,
+				     &cli->tc_borrow_node);
+	} else if (borrow) {
+		/* a client which can not be added just does not borrow */
+		if (cfs_binheap_insert(head->th_borrow_binheap,
+				       &cli->tc_borrow_node) == 0)
+			cli->tc_in_borrow_heap = true;
+	} else if (cli->tc_in_borrow_heap) {
+		cfs_binheap_remove(head->th_borrow_binheap,
+				   &cli->tc_borrow_node);
+		cli->tc_in_borrow_heap = false;
+	}
+}
+
+static void nrs_tbf_rule_share_refill(struct nrs_tbf_rule *rule, __u64 now)
+{
+	__u64 ntoken;
+
+	if (now <= rule->tr_share_check_time)
+		return;
+
+	ntoken = (now - rule->tr_share_check_time) * rule->tr_share_rate;
+	do_div(ntoken, NSEC_PER_SEC);
+	if (ntoken == 0)
+		return;
+
+	ntoken += rule->tr_share_ntoken;
+	rule->tr_share_ntoken = min(ntoken, rule->tr_depth);
+	rule->tr_share_check_time = now;
+}
+
+/**
+ * Checks whether \a rule and all of its ancestors have a shared token left
+ * to lend.
+ *
+ * \param[in]  rule	  the rule of the borrowing client
+ * \param[in]  now	  current time, in nanoseconds
+ * \param[out] deadline  when a token is not available, the time by which
+ *			  all exhausted shares have a token again
+ */
+static bool nrs_tbf_rule_share_avail(struct nrs_tbf_rule *rule, __u64 now,
+				     __u64 *deadline)
+{
+	bool avail = true;
+
+	*deadline = now;
+	for (; rule != NULL; rule = rule->tr_parent) {
+		if (rule->tr_share_rate == 0)
+			continue;
+
+		nrs_tbf_rule_share_refill(rule, now);
+		if (rule->tr_share_ntoken == 0) {
+			avail = false;
+			*deadline = max(*deadline, rule->tr_share_check_time +
+						   rule->tr_nsecs_per_share);
+		}
+	}
+
+	return avail;
+}
+
+/**
+ * Takes a shared token of \a rule and of all of its ancestors for an RPC
+ * handled under \a rule. RPCs within the rate of their client are never held
+ * back by the shares, but leave less to be borrowed.
+ */
+static void nrs_tbf_rule_share_charge(struct nrs_tbf_rule *rule, __u64 now)
+{
+	for (; rule != NULL; rule = rule->tr_parent) {
+		if (rule->tr_share_rate == 0)
+			continue;
+
+		nrs_tbf_rule_share_refill(rule, now);
+		if (rule->tr_share_ntoken > 0)
+			rule->tr_share_ntoken--;
+	}
+}
+
 static void
 nrs_tbf_cli_reset_value(struct nrs_tbf_head *head,
 			struct nrs_tbf_client *cli)
@@ -136,12 +284,24 @@ nrs_tbf_cli_reset_value(struct nrs_tbf_head *head,
 	cli->tc_depth = rule->tr_depth;
 	cli->tc_ntoken = rule->tr_depth;
 	cli->tc_check_time = ktime_to_ns(ktime_get());
+	if (rule->tr_ceil_rate != 0) {
+		cli->tc_ceil_rate = rule->tr_ceil_rate;
+		cli->tc_ceil_nsecs = rule->tr_nsecs_per_ceil;
+	} else {
+		cli->tc_ceil_rate = rule->tr_rpc_rate;
+		cli->tc_ceil_nsecs = rule->tr_nsecs_per_rpc;
+	}
+	cli->tc_ceil_ntoken = rule->tr_depth;
+	cli->tc_ceil_check_time = cli->tc_check_time;
+	nrs_tbf_cli_ceil_deadline(cli);
 	cli->tc_rule_sequence = atomic_read(&head->th_rule_sequence);
 	cli->tc_rule_generation = rule->tr_generation;
 
-	if (cli->tc_in_heap)
+	if (cli->tc_in_heap) {
 		cfs_binheap_relocate(head->th_binheap,
 				     &cli->tc_node);
+		nrs_tbf_cli_borrow_update(head, cli);
+	}
 }
 
 static void
@@ -171,6 +331,22 @@ nrs_tbf_rule_dump(struct nrs_tbf_rule *rule, struct seq_file *m)
 	return rule->tr_head->th_ops->o_rule_dump(rule, m);
 }
 
+/**
+ * Prints the borrowing settings of \a rule which differ from the defaults,
+ * and ends the line of the rule.
+ */
+static void
+nrs_tbf_rule_dump_borrow(struct nrs_tbf_rule *rule, struct seq_file *m)
+{
+	if (rule->tr_ceil_rate > rule->tr_rpc_rate)
+		seq_printf(m, ", ceil %u", rule->tr_ceil_rate);
+	if (rule->tr_share_rate != 0)
+		seq_printf(m, ", share %u", rule->tr_share_rate);
+	if (rule->tr_parent != NULL)
+		seq_printf(m, ", parent %s", rule->tr_parent->tr_name);
+	seq_putc(m, '\n');
+}
+
 static int
 nrs_tbf_rule_dump_all(struct nrs_tbf_head *head, struct seq_file *m)
 {
@@ -271,6 +447,7 @@ nrs_tbf_cli_fini(struct nrs_tbf_client *cli)
 {
 	LASSERT(list_empty(&cli->tc_list));
 	LASSERT(!cli->tc_in_heap);
+	LASSERT(!cli->tc_in_borrow_heap);
 	LASSERT(atomic_read(&cli->tc_ref) == 0);
 	spin_lock(&cli->tc_rule_lock);
 	nrs_tbf_cli_rule_put(cli);
@@ -287,8 +464,13 @@ nrs_tbf_rule_start(struct ptlrpc_nrs_policy *policy,
 	struct nrs_tbf_rule	*tmp_rule;
 	struct nrs_tbf_rule	*next_rule;
 	char			*next_name = start->u.tc_start.ts_next_name;
+	char			*parent_name = start->u.tc_start.ts_parent_name;
 	int			 rc;
 
+	if (start->u.tc_start.ts_ceil_rate != 0 &&
+	    start->u.tc_start.ts_ceil_rate < start->u.tc_start.ts_rpc_rate)
+		return -EINVAL;
+
 	rule = nrs_tbf_rule_find(head, start->tc_name);
 	if (rule) {
 		nrs_tbf_rule_put(rule);
@@ -304,6 +486,15 @@ nrs_tbf_rule_start(struct ptlrpc_nrs_policy *policy,
 	rule->tr_flags = start->u.tc_start.ts_rule_flags;
 	rule->tr_nsecs_per_rpc = NSEC_PER_SEC / rule->tr_rpc_rate;
 	rule->tr_depth = tbf_depth;
+	rule->tr_ceil_rate = start->u.tc_start.ts_ceil_rate;
+	if (rule->tr_ceil_rate != 0)
+		rule->tr_nsecs_per_ceil = NSEC_PER_SEC / rule->tr_ceil_rate;
+	rule->tr_share_rate = start->u.tc_start.ts_share_rate;
+	if (rule->tr_share_rate != 0) {
+		rule->tr_nsecs_per_share = NSEC_PER_SEC / rule->tr_share_rate;
+		rule->tr_share_ntoken = rule->tr_depth;
+		rule->tr_share_check_time = ktime_to_ns(ktime_get());
+	}
 	atomic_set(&rule->tr_ref, 1);
 	INIT_LIST_HEAD(&rule->tr_cli_list);
 	INIT_LIST_HEAD(&rule->tr_nids);
@@ -327,6 +518,16 @@ nrs_tbf_rule_start(struct ptlrpc_nrs_policy *policy,
 		return -EEXIST;
 	}
 
+	if (parent_name) {
+		/* the reference is dropped when the rule is freed */
+		rule->tr_parent = nrs_tbf_rule_find_nolock(head, parent_name);
+		if (!rule->tr_parent) {
+			spin_unlock(&head->th_rule_lock);
+			nrs_tbf_rule_put(rule);
+			return -ENOENT;
+		}
+	}
+
 	if (next_name) {
 		next_rule = nrs_tbf_rule_find_nolock(head, next_name);
 		if (!next_rule) {
@@ -349,8 +550,10 @@ nrs_tbf_rule_start(struct ptlrpc_nrs_policy *policy,
 		head->th_rule = rule;
 	}
 
-	CDEBUG(D_RPCTRACE, "TBF starts rule@%p rate %u gen %llu\n",
-	       rule, rule->tr_rpc_rate, rule->tr_generation);
+	CDEBUG(D_RPCTRACE,
+	       "TBF starts rule@%p rate %u ceil %u share %u gen %llu\n",
+	       rule, rule->tr_rpc_rate, rule->tr_ceil_rate,
+	       rule->tr_share_rate, rule->tr_generation);
 
 	return 0;
 }
@@ -417,6 +620,50 @@ nrs_tbf_rule_change_rate(struct ptlrpc_nrs_policy *policy,
 
 	rule->tr_rpc_rate = rate;
 	rule->tr_nsecs_per_rpc = NSEC_PER_SEC / rule->tr_rpc_rate;
+	/* the ceiling is never below the rate, if no ceiling was set it
+	 * follows the rate */
+	if (rule->tr_ceil_rate != 0 && rule->tr_ceil_rate < rule->tr_rpc_rate) {
+		rule->tr_ceil_rate = rule->tr_rpc_rate;
+		rule->tr_nsecs_per_ceil = rule->tr_nsecs_per_rpc;
+	}
+	rule->tr_generation++;
+	nrs_tbf_rule_put(rule);
+
+	return 0;
+}
+
+static int
+nrs_tbf_rule_change_borrow(struct ptlrpc_nrs_policy *policy,
+			   struct nrs_tbf_head *head,
+			   char *name,
+			   __u64 ceil,
+			   __u64 share)
+{
+	struct nrs_tbf_rule *rule;
+
+	assert_spin_locked(&policy->pol_nrs->nrs_lock);
+
+	rule = nrs_tbf_rule_find(head, name);
+	if (rule == NULL)
+		return -ENOENT;
+
+	if (ceil != 0 && ceil < rule->tr_rpc_rate) {
+		nrs_tbf_rule_put(rule);
+		return -EINVAL;
+	}
+
+	if (ceil != 0) {
+		rule->tr_ceil_rate = ceil;
+		rule->tr_nsecs_per_ceil = NSEC_PER_SEC / rule->tr_ceil_rate;
+	}
+	if (share != 0) {
+		if (rule->tr_share_rate == 0) {
+			rule->tr_share_ntoken = rule->tr_depth;
+			rule->tr_share_check_time = ktime_to_ns(ktime_get());
+		}
+		rule->tr_nsecs_per_share = NSEC_PER_SEC / share;
+		rule->tr_share_rate = share;
+	}
 	rule->tr_generation++;
 	nrs_tbf_rule_put(rule);
 
@@ -429,6 +676,8 @@ nrs_tbf_rule_change(struct ptlrpc_nrs_policy *policy,
 		    struct nrs_tbf_cmd *change)
 {
 	__u64	 rate = change->u.tc_change.tc_rpc_rate;
+	__u64	 ceil = change->u.tc_change.tc_ceil_rate;
+	__u64	 share = change->u.tc_change.tc_share_rate;
 	char	*next_name = change->u.tc_change.tc_next_name;
 	int	 rc;
 
@@ -439,6 +688,13 @@ nrs_tbf_rule_change(struct ptlrpc_nrs_policy *policy,
 			return rc;
 	}
 
+	if (ceil != 0 || share != 0) {
+		rc = nrs_tbf_rule_change_borrow(policy, head, change->tc_name,
+						ceil, share);
+		if (rc)
+			return rc;
+	}
+
 	if (next_name) {
 		rc = nrs_tbf_rule_change_rank(policy, head, change->tc_name,
 					      next_name);
@@ -455,17 +711,31 @@ nrs_tbf_rule_stop(struct ptlrpc_nrs_policy *policy,
 		  struct nrs_tbf_cmd *stop)
 {
 	struct nrs_tbf_rule *rule;
+	struct nrs_tbf_rule *tmp_rule;
 
 	assert_spin_locked(&policy->pol_nrs->nrs_lock);
 
 	if (strcmp(stop->tc_name, NRS_TBF_DEFAULT_RULE) == 0)
 		return -EPERM;
 
-	rule = nrs_tbf_rule_find(head, stop->tc_name);
-	if (rule == NULL)
+	spin_lock(&head->th_rule_lock);
+	rule = nrs_tbf_rule_find_nolock(head, stop->tc_name);
+	if (rule == NULL) {
+		spin_unlock(&head->th_rule_lock);
 		return -ENOENT;
+	}
+
+	/* Child rules have to be stopped first */
+	list_for_each_entry(tmp_rule, &head->th_list, tr_linkage) {
+		if (tmp_rule->tr_parent == rule) {
+			spin_unlock(&head->th_rule_lock);
+			nrs_tbf_rule_put(rule);
+			return -EBUSY;
+		}
+	}
 
 	list_del_init(&rule->tr_linkage);
+	spin_unlock(&head->th_rule_lock);
 	rule->tr_flags |= NTRS_STOPPING;
 	nrs_tbf_rule_put(rule);
 	nrs_tbf_rule_put(rule);
@@ -544,6 +814,40 @@ static struct cfs_binheap_ops nrs_tbf_heap_ops = {
 	.hop_compare	= tbf_cli_compare,
 };
 
+/**
+ * Binary heap predicate of the heap of borrowing clients; the client which
+ * may borrow the earliest comes first.
+ *
+ * \param[in] e1 the first binheap node to compare
+ * \param[in] e2 the second binheap node to compare
+ *
+ * \retval 0 e1 > e2
+ * \retval 1 e1 < e2
+ */
+static int
+tbf_cli_borrow_compare(struct cfs_binheap_node *e1,
+		       struct cfs_binheap_node *e2)
+{
+	struct nrs_tbf_client *cli1;
+	struct nrs_tbf_client *cli2;
+
+	cli1 = container_of(e1, struct nrs_tbf_client, tc_borrow_node);
+	cli2 = container_of(e2, struct nrs_tbf_client, tc_borrow_node);
+
+	if (cli1->tc_ceil_deadline < cli2->tc_ceil_deadline)
+		return 1;
+	else if (cli1->tc_ceil_deadline > cli2->tc_ceil_deadline)
+		return 0;
+
+	return cli1->tc_deadline <= cli2->tc_deadline;
+}
+
+static struct cfs_binheap_ops nrs_tbf_borrow_heap_ops = {
+	.hop_enter	= NULL,
+	.hop_exit	= NULL,
+	.hop_compare	= tbf_cli_borrow_compare,
+};
+
 static unsigned nrs_tbf_jobid_hop_hash(struct cfs_hash *hs, const void *key,
 				  unsigned mask)
 {
@@ -835,8 +1139,8 @@ nrs_tbf_jobid_list_add(struct cfs_lstr *id, struct list_head *jobid_list)
 	return 0;
 }
 
-static bool
-cfs_match_wildcard(const char *pattern, const char *content)
+bool
+nrs_match_wildcard(const char *pattern, const char *content)
 {
 	if (*pattern == '\0' && *content == '\0')
 		return true;
@@ -856,8 +1160,8 @@ cfs_match_wildcard(const char *pattern, const char *content)
 	}
 
 	if (*pattern == '*')
-		return (cfs_match_wildcard(pattern + 1, content) ||
-			cfs_match_wildcard(pattern, content + 1));
+		return (nrs_match_wildcard(pattern + 1, content) ||
+			nrs_match_wildcard(pattern, content + 1));
 
 	return false;
 }
@@ -869,7 +1173,7 @@ nrs_tbf_jobid_match(const struct nrs_tbf_jobid *jobid, const char *id)
 		return strcmp(jobid->tj_id, id) == 0;
 
 	if (jobid->tj_match_flag == NRS_TBF_MATCH_WILDCARD)
-		return cfs_match_wildcard(jobid->tj_id, id);
+		return nrs_match_wildcard(jobid->tj_id, id);
 
 	return false;
 }
@@ -1000,9 +1304,10 @@ static int nrs_tbf_jobid_rule_init(struct ptlrpc_nrs_policy *policy,
 static int
 nrs_tbf_jobid_rule_dump(struct nrs_tbf_rule *rule, struct seq_file *m)
 {
-	seq_printf(m, "%s {%s} %u, ref %d\n", rule->tr_name,
+	seq_printf(m, "%s {%s} %u, ref %d", rule->tr_name,
 		   rule->tr_jobids_str, rule->tr_rpc_rate,
 		   atomic_read(&rule->tr_ref) - 1);
+	nrs_tbf_rule_dump_borrow(rule, m);
 	return 0;
 }
 
@@ -1205,9 +1510,10 @@ static int nrs_tbf_nid_rule_init(struct ptlrpc_nrs_policy *policy,
 static int
 nrs_tbf_nid_rule_dump(struct nrs_tbf_rule *rule, struct seq_file *m)
 {
-	seq_printf(m, "%s {%s} %u, ref %d\n", rule->tr_name,
+	seq_printf(m, "%s {%s} %u, ref %d", rule->tr_name,
 		   rule->tr_nids_str, rule->tr_rpc_rate,
 		   atomic_read(&rule->tr_ref) - 1);
+	nrs_tbf_rule_dump_borrow(rule, m);
 	return 0;
 }
 
@@ -1589,8 +1895,8 @@ static int ldlm_tbf_id_cli_set(struct ptlrpc_request *req,
 	return 0;
 }
 
-static int nrs_tbf_id_cli_set(struct ptlrpc_request *req, struct tbf_id *id,
-			      enum nrs_tbf_flag ti_type)
+int nrs_tbf_id_cli_set(struct ptlrpc_request *req, struct tbf_id *id,
+		       enum nrs_tbf_flag ti_type)
 {
 	u32 opc = lustre_msg_get_opc(req->rq_reqmsg);
 	struct req_format *fmt = req_fmt(opc);
@@ -2059,9 +2365,10 @@ nrs_tbf_rule_init(struct ptlrpc_nrs_policy *policy,
 static int
 nrs_tbf_generic_rule_dump(struct nrs_tbf_rule *rule, struct seq_file *m)
 {
-	seq_printf(m, "%s %s %u, ref %d\n", rule->tr_name,
+	seq_printf(m, "%s %s %u, ref %d", rule->tr_name,
 		   rule->tr_conds_str, rule->tr_rpc_rate,
 		   atomic_read(&rule->tr_ref) - 1);
+	nrs_tbf_rule_dump_borrow(rule, m);
 	return 0;
 }
 
@@ -2349,9 +2656,10 @@ static int nrs_tbf_opcode_rule_init(struct ptlrpc_nrs_policy *policy,
 static int
 nrs_tbf_opcode_rule_dump(struct nrs_tbf_rule *rule, struct seq_file *m)
 {
-	seq_printf(m, "%s {%s} %u, ref %d\n", rule->tr_name,
+	seq_printf(m, "%s {%s} %u, ref %d", rule->tr_name,
 		   rule->tr_opcodes_str, rule->tr_rpc_rate,
 		   atomic_read(&rule->tr_ref) - 1);
+	nrs_tbf_rule_dump_borrow(rule, m);
 	return 0;
 }
 
@@ -2664,9 +2972,10 @@ nrs_tbf_id_rule_init(struct ptlrpc_nrs_policy *policy,
 static int
 nrs_tbf_id_rule_dump(struct nrs_tbf_rule *rule, struct seq_file *m)
 {
-	seq_printf(m, "%s {%s} %u, ref %d\n", rule->tr_name,
+	seq_printf(m, "%s {%s} %u, ref %d", rule->tr_name,
 		   rule->tr_ids_str, rule->tr_rpc_rate,
 		   atomic_read(&rule->tr_ref) - 1);
+	nrs_tbf_rule_dump_borrow(rule, m);
 	return 0;
 }
 
@@ -2793,6 +3102,14 @@ static int nrs_tbf_start(struct ptlrpc_nrs_policy *policy, char *arg)
 	if (head->th_binheap == NULL)
 		GOTO(out_free_head, rc = -ENOMEM);
 
+	head->th_borrow_binheap = cfs_binheap_create(&nrs_tbf_borrow_heap_ops,
+						     CBH_FLAG_ATOMIC_GROW, 4096,
+						     NULL,
+						     nrs_pol2cptab(policy),
+						     nrs_pol2cptid(policy));
+	if (head->th_borrow_binheap == NULL)
+		GOTO(out_free_heap, rc = -ENOMEM);
+
 	atomic_set(&head->th_rule_sequence, 0);
 	spin_lock_init(&head->th_rule_lock);
 	INIT_LIST_HEAD(&head->th_list);
@@ -2800,10 +3117,12 @@ static int nrs_tbf_start(struct ptlrpc_nrs_policy *policy, char *arg)
 	head->th_timer.function = nrs_tbf_timer_cb;
 	rc = head->th_ops->o_startup(policy, head);
 	if (rc)
-		GOTO(out_free_heap, rc);
+		GOTO(out_free_borrow_heap, rc);
 
 	policy->pol_private = head;
 	return 0;
+out_free_borrow_heap:
+	cfs_binheap_destroy(head->th_borrow_binheap);
 out_free_heap:
 	cfs_binheap_destroy(head->th_binheap);
 out_free_head:
@@ -2840,6 +3159,8 @@ static void nrs_tbf_stop(struct ptlrpc_nrs_policy *policy)
 	LASSERT(head->th_binheap != NULL);
 	LASSERT(cfs_binheap_is_empty(head->th_binheap));
 	cfs_binheap_destroy(head->th_binheap);
+	LASSERT(cfs_binheap_is_empty(head->th_borrow_binheap));
+	cfs_binheap_destroy(head->th_borrow_binheap);
 	OBD_FREE_PTR(head);
 	nrs->nrs_throttling = 0;
 	wake_up(&policy->pol_nrs->nrs_svcpt->scp_waitq);
@@ -3020,6 +3341,46 @@ static void nrs_tbf_res_put(struct ptlrpc_nrs_policy *policy,
 	head->th_ops->o_cli_put(head, cli);
 }
 
+/**
+ * Picks a client which may handle a request with a borrowed token. This is
+ * only called when no client has a token of its own, so borrowing does not
+ * take anything from clients within their rate.
+ *
+ * \param[in]  head	  the TBF policy instance
+ * \param[in]  now	  current time, in nanoseconds
+ * \param[out] deadline  if no client may borrow now, the time to check again;
+ *			  left unchanged if no client may borrow at all
+ *
+ * \retval the client to borrow a token for, with a ceiling token available
+ * \retval NULL no client may borrow now
+ */
+static struct nrs_tbf_client *
+nrs_tbf_borrow_get(struct nrs_tbf_head *head, __u64 now, __u64 *deadline)
+{
+	struct cfs_binheap_node *node;
+	struct nrs_tbf_client *cli;
+	__u64 share_deadline;
+
+	node = cfs_binheap_root(head->th_borrow_binheap);
+	if (node == NULL)
+		return NULL;
+
+	cli = container_of(node, struct nrs_tbf_client, tc_borrow_node);
+	LASSERT(cli->tc_in_borrow_heap);
+	nrs_tbf_cli_ceil_refill(cli, now);
+	if (cli->tc_ceil_ntoken == 0) {
+		*deadline = cli->tc_ceil_deadline;
+		return NULL;
+	}
+
+	if (!nrs_tbf_rule_share_avail(cli->tc_rule, now, &share_deadline)) {
+		*deadline = share_deadline;
+		return NULL;
+	}
+
+	return cli;
+}
+
 /**
  * Called when getting a request from the TBF policy for handling, or just
  * peeking; removes the request from the policy when it is to be handled.
@@ -3099,6 +3460,8 @@ struct ptlrpc_nrs_request *nrs_tbf_req_get(struct ptlrpc_nrs_policy *policy,
 			ntoken--;
 			cli->tc_ntoken = ntoken;
 			cli->tc_check_time = now;
+			nrs_tbf_cli_ceil_charge(cli, now);
+			nrs_tbf_rule_share_charge(rule, now);
 			list_del_init(&nrq->nr_u.tbf.tr_list);
 			if (list_empty(&cli->tc_list)) {
 				cfs_binheap_remove(head->th_binheap,
@@ -3110,6 +3473,7 @@ struct ptlrpc_nrs_request *nrs_tbf_req_get(struct ptlrpc_nrs_policy *policy,
 				cfs_binheap_relocate(head->th_binheap,
 						     &cli->tc_node);
 			}
+			nrs_tbf_cli_borrow_update(head, cli);
 			CDEBUG(D_RPCTRACE,
 			       "TBF dequeues: class@%p rate %u gen %llu "
 			       "token %llu, rule@%p rate %u gen %llu\n",
@@ -3118,6 +3482,8 @@ struct ptlrpc_nrs_request *nrs_tbf_req_get(struct ptlrpc_nrs_policy *policy,
 			       cli->tc_rule, cli->tc_rule->tr_rpc_rate,
 			       cli->tc_rule->tr_generation);
 		} else {
+			struct nrs_tbf_client *bcli;
+			__u64 bdeadline = deadline;
 			ktime_t time;
 
 			if (rule->tr_flags & NTRS_REALTIME) {
@@ -3129,6 +3495,32 @@ struct ptlrpc_nrs_request *nrs_tbf_req_get(struct ptlrpc_nrs_policy *policy,
 					return nrs_tbf_req_get(policy,
 							       peek, force);
 			}
+
+			bcli = nrs_tbf_borrow_get(head, now, &bdeadline);
+			if (bcli != NULL) {
+				nrq = list_entry(bcli->tc_list.next,
+						 struct ptlrpc_nrs_request,
+						 nr_u.tbf.tr_list);
+				bcli->tc_ceil_ntoken--;
+				nrs_tbf_cli_ceil_deadline(bcli);
+				nrs_tbf_rule_share_charge(bcli->tc_rule, now);
+				list_del_init(&nrq->nr_u.tbf.tr_list);
+				/* the own token bucket is left untouched */
+				if (list_empty(&bcli->tc_list)) {
+					cfs_binheap_remove(head->th_binheap,
+							   &bcli->tc_node);
+					bcli->tc_in_heap = false;
+				}
+				nrs_tbf_cli_borrow_update(head, bcli);
+				CDEBUG(D_RPCTRACE,
+				       "TBF dequeues borrowed: class@%p rate %u ceil %u token %llu, rule@%p\n",
+				       bcli, bcli->tc_rpc_rate,
+				       bcli->tc_ceil_rate,
+				       bcli->tc_ceil_ntoken, bcli->tc_rule);
+				return nrq;
+			}
+			deadline = min(deadline, bdeadline);
+
 			policy->pol_nrs->nrs_throttling = 1;
 			head->th_deadline = deadline;
 			time = ktime_set(0, 0);
@@ -3168,11 +3560,16 @@ static int nrs_tbf_req_add(struct ptlrpc_nrs_policy *policy,
 		rc = cfs_binheap_insert(head->th_binheap, &cli->tc_node);
 		if (rc == 0) {
 			cli->tc_in_heap = true;
+			nrs_tbf_cli_borrow_update(head, cli);
 			nrq->nr_u.tbf.tr_sequence = head->th_sequence++;
 			list_add_tail(&nrq->nr_u.tbf.tr_list,
 					  &cli->tc_list);
 			if (policy->pol_nrs->nrs_throttling) {
 				__u64 deadline = cli->tc_deadline;
+
+				if (cli->tc_in_borrow_heap)
+					deadline = min(deadline,
+						       cli->tc_ceil_deadline);
 				if ((head->th_deadline > deadline) &&
 				    (hrtimer_try_to_cancel(&head->th_timer)
 				     >= 0)) {
@@ -3233,6 +3630,7 @@ static void nrs_tbf_req_del(struct ptlrpc_nrs_policy *policy,
 		cfs_binheap_relocate(head->th_binheap,
 				     &cli->tc_node);
 	}
+	nrs_tbf_cli_borrow_update(head, cli);
 }
 
 /**
@@ -3429,6 +3827,40 @@ nrs_tbf_parse_value_pair(struct nrs_tbf_cmd *cmd, char *buffer)
 			cmd->u.tc_change.tc_next_name = val;
 		else
 			return -EINVAL;
+	} else if (strcmp(key, "ceil") == 0) {
+		rc = kstrtoull(val, 10, &rate);
+		if (rc)
+			return rc;
+
+		if (rate <= 0 || rate >= LPROCFS_NRS_RATE_MAX)
+			return -EINVAL;
+
+		if (cmd->tc_cmd == NRS_CTL_TBF_START_RULE)
+			cmd->u.tc_start.ts_ceil_rate = rate;
+		else if (cmd->tc_cmd == NRS_CTL_TBF_CHANGE_RULE)
+			cmd->u.tc_change.tc_ceil_rate = rate;
+		else
+			return -EINVAL;
+	} else if (strcmp(key, "share") == 0) {
+		rc = kstrtoull(val, 10, &rate);
+		if (rc)
+			return rc;
+
+		if (rate <= 0 || rate > UINT_MAX)
+			return -EINVAL;
+
+		if (cmd->tc_cmd == NRS_CTL_TBF_START_RULE)
+			cmd->u.tc_start.ts_share_rate = rate;
+		else if (cmd->tc_cmd == NRS_CTL_TBF_CHANGE_RULE)
+			cmd->u.tc_change.tc_share_rate = rate;
+		else
+			return -EINVAL;
+	} else if (strcmp(key, "parent") == 0) {
+		if (!name_is_valid(val) ||
+		    cmd->tc_cmd != NRS_CTL_TBF_START_RULE)
+			return -EINVAL;
+
+		cmd->u.tc_start.ts_parent_name = val;
 	} else if (strcmp(key, "realtime") == 0) {
 		unsigned long realtime;
 
@@ -3466,6 +3898,8 @@ nrs_tbf_parse_value_pairs(struct nrs_tbf_cmd *cmd, char *buffer)
 		break;
 	case NRS_CTL_TBF_CHANGE_RULE:
 		if (cmd->u.tc_change.tc_rpc_rate == 0 &&
+		    cmd->u.tc_change.tc_ceil_rate == 0 &&
+		    cmd->u.tc_change.tc_share_rate == 0 &&
 		    cmd->u.tc_change.tc_next_name == NULL)
 			return -EINVAL;
 		break;
@@ -52,6 +52,12 @@ extern struct ptlrpc_nrs_pol_conf nrs_conf_orr;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_trr;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_tbf;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_delay;
+extern struct ptlrpc_nrs_pol_conf nrs_conf_edf;
+
+/* nrs_tbf.c */
+int nrs_tbf_id_cli_set(struct ptlrpc_request *req, struct tbf_id *id,
+		       enum nrs_tbf_flag ti_type);
+bool nrs_match_wildcard(const char *pattern, const char *content);
 #endif /* HAVE_SERVER_SUPPORT */
 
 /**
@@ -69,6 +75,7 @@ extern struct percpu_ref ptlrpc_pending;
 int ptlrpc_start_thread(struct ptlrpc_service_part *svcpt, int wait);
 /* ptlrpcd.c */
 int ptlrpcd_start(struct ptlrpcd_ctl *pc);
+void ptlrpcd_wake_thief(struct ptlrpcd_ctl *pc, int count, int added);
 
 /* client.c */
 void ptlrpc_at_adj_net_latency(struct ptlrpc_request *req,
@@ -115,6 +122,9 @@ void ptlrpc_sysfs_unregister_service(struct ptlrpc_service *svc);
 
 void ptlrpc_ldebugfs_register_service(struct dentry *debugfs_entry,
 				      struct ptlrpc_service *svc);
+void ptlrpc_lat_tally(struct ptlrpc_service *svc, __u32 opc,
+		      enum ptlrpc_lat_phase phase, ktime_t start, ktime_t end);
+void ptlrpc_lat_hist_free(struct ptlrpc_service *svc);
 #ifdef CONFIG_PROC_FS
 void ptlrpc_lprocfs_unregister_service(struct ptlrpc_service *svc);
 void ptlrpc_lprocfs_rpc_sent(struct ptlrpc_request *req, long amount);
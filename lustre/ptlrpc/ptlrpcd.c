@@ -63,6 +63,11 @@
 
 #include "ptlrpc_internal.h"
 
+static inline void ptlrpc_reqset_get(struct ptlrpc_request_set *set)
+{
+	atomic_inc(&set->set_refcount);
+}
+
 /* One of these per CPT. */
 struct ptlrpcd {
 	int			pd_size;
@@ -71,6 +76,8 @@ struct ptlrpcd {
 	int			pd_cursor;
 	int			pd_nthreads;
 	int			pd_groupsize;
+	/* indexes of the other ptlrpcds, nearest CPT first */
+	int			*pd_peers;
 	struct ptlrpcd_ctl	pd_threads[0];
 };
 
@@ -137,6 +144,17 @@ module_param(ptlrpcd_cpts, charp, 0644);
 MODULE_PARM_DESC(ptlrpcd_cpts,
 		 "CPU partitions ptlrpcd threads should run in");
 
+/*
+ * ptlrpcd_steal_depth: Number of queued RPCs from which an idle ptlrpcd
+ * thread may take work from any other ptlrpcd thread, not only from its
+ * partners. Threads of the same CPT are tried first, then those of the
+ * nearest CPTs. 0 restricts stealing to partner threads.
+ */
+static int ptlrpcd_steal_depth = 4;
+module_param(ptlrpcd_steal_depth, int, 0644);
+MODULE_PARM_DESC(ptlrpcd_steal_depth,
+		 "Queued RPCs from which any idle ptlrpcd may take some");
+
 /* ptlrpcds_cpt_idx maps cpt numbers to an index in the ptlrpcds array. */
 static int		*ptlrpcds_cpt_idx;
 
@@ -156,6 +174,8 @@ static struct ptlrpcd_ctl ptlrpcd_rcv;
 struct mutex ptlrpcd_mutex;
 static int ptlrpcd_users = 0;
 
+static struct dentry *ptlrpcd_debugfs_entry;
+
 void ptlrpcd_wake(struct ptlrpc_request *req)
 {
 	struct ptlrpc_request_set *set = req->rq_set;
@@ -231,36 +251,185 @@ void ptlrpcd_add_rqset(struct ptlrpc_request_set *set)
 		 */
 		for (i = 0; i < pc->pc_npartners; i++)
 			wake_up(&pc->pc_partners[i]->pc_set->set_waitq);
+	} else {
+		ptlrpcd_wake_thief(pc, count, i);
+	}
+}
+
+/* The ptlrpcd the regular thread \a pc belongs to */
+static struct ptlrpcd *ptlrpcd_of(struct ptlrpcd_ctl *pc)
+{
+	if (test_bit(LIOD_RECOVERY, &pc->pc_flags))
+		return NULL;
+
+	return ptlrpcds[ptlrpcds_cpt_idx == NULL ? pc->pc_cpt :
+			ptlrpcds_cpt_idx[pc->pc_cpt]];
+}
+
+/**
+ * Wake up an idle thread to take RPCs from the queue of \a pc, which has
+ * just grown by \a added to \a count RPCs. This is done each time the queue
+ * grows past a multiple of ptlrpcd_steal_depth. Idle threads of the same
+ * CPT are preferred to those of the nearest CPTs.
+ */
+void ptlrpcd_wake_thief(struct ptlrpcd_ctl *pc, int count, int added)
+{
+	int depth = ptlrpcd_steal_depth;
+	struct ptlrpcd *pd;
+	struct ptlrpcd *peer;
+	int i;
+	int j;
+
+	if (depth <= 0 || count / depth == (count - added) / depth)
+		return;
+
+	pd = ptlrpcd_of(pc);
+	if (pd == NULL)
+		return;
+
+	for (i = -1; i < ptlrpcds_num - 1; i++) {
+		peer = i < 0 ? pd : ptlrpcds[pd->pd_peers[i]];
+		if (peer == NULL)
+			continue;
+
+		for (j = 0; j < peer->pd_nthreads; j++) {
+			struct ptlrpcd_ctl *thief = &peer->pd_threads[j];
+
+			if (thief == pc || !READ_ONCE(thief->pc_idle))
+				continue;
+
+			spin_lock(&thief->pc_lock);
+			if (thief->pc_set != NULL)
+				wake_up(&thief->pc_set->set_waitq);
+			spin_unlock(&thief->pc_lock);
+			return;
+		}
 	}
 }
 
 /**
+ * Move the newest half of the RPCs queued on \a victim to the set of \a pc,
+ * leaving the oldest ones to the owner of the queue.
+ *
  * Return transferred RPCs count.
  */
-static int ptlrpcd_steal_rqset(struct ptlrpc_request_set *des,
+static int ptlrpcd_steal_rqset(struct ptlrpcd_ctl *pc,
+			       struct ptlrpcd_ctl *victim,
 			       struct ptlrpc_request_set *src)
 {
-	struct list_head *tmp, *pos;
+	struct ptlrpc_request_set *des = pc->pc_set;
 	struct ptlrpc_request *req;
+	struct ptlrpc_request *tmp;
+	int count;
 	int rc = 0;
 
 	spin_lock(&src->set_new_req_lock);
-	if (likely(!list_empty(&src->set_new_requests))) {
-		list_for_each_safe(pos, tmp, &src->set_new_requests) {
-			req = list_entry(pos, struct ptlrpc_request,
-					 rq_set_chain);
-			req->rq_set = des;
-		}
-		list_splice_init(&src->set_new_requests,
-				 &des->set_requests);
-		rc = atomic_read(&src->set_new_count);
+	count = (atomic_read(&src->set_new_count) + 1) / 2;
+	list_for_each_entry_safe_reverse(req, tmp, &src->set_new_requests,
+					 rq_set_chain) {
+		if (rc == count)
+			break;
+		req->rq_set = des;
+		list_move(&req->rq_set_chain, &des->set_requests);
+		rc++;
+	}
+	if (rc > 0) {
 		atomic_add(rc, &des->set_remaining);
-		atomic_set(&src->set_new_count, 0);
+		atomic_sub(rc, &src->set_new_count);
+		victim->pc_stolen += rc;
 	}
 	spin_unlock(&src->set_new_req_lock);
 	return rc;
 }
 
+/**
+ * Take RPCs from the queue of \a victim if it holds at least \a depth.
+ *
+ * Return transferred RPCs count.
+ */
+static int ptlrpcd_try_steal(struct ptlrpcd_ctl *pc,
+			     struct ptlrpcd_ctl *victim, int depth)
+{
+	struct ptlrpc_request_set *ps;
+	int rc = 0;
+
+	if (victim == NULL || victim == pc)
+		return 0;
+
+	spin_lock(&victim->pc_lock);
+	ps = victim->pc_set;
+	if (ps == NULL) {
+		spin_unlock(&victim->pc_lock);
+		return 0;
+	}
+
+	ptlrpc_reqset_get(ps);
+	spin_unlock(&victim->pc_lock);
+
+	if (atomic_read(&ps->set_new_count) >= depth) {
+		rc = ptlrpcd_steal_rqset(pc, victim, ps);
+		if (rc > 0) {
+			pc->pc_steals += rc;
+			if (victim->pc_cpt != pc->pc_cpt)
+				pc->pc_remote_steals += rc;
+			CDEBUG(D_RPCTRACE, "transfer %d async RPCs [%s->%s]\n",
+			       rc, victim->pc_name, pc->pc_name);
+		}
+	}
+	ptlrpc_reqset_put(ps);
+
+	return rc;
+}
+
+/**
+ * Look for work in the queues of other threads: first those of the partner
+ * threads, whatever their length, then the queues holding at least
+ * ptlrpcd_steal_depth RPCs of any thread, nearest CPT first.
+ *
+ * Return transferred RPCs count.
+ */
+static int ptlrpcd_steal(struct ptlrpcd_ctl *pc)
+{
+	struct ptlrpcd *pd;
+	struct ptlrpcd *peer;
+	int rc = 0;
+	int i;
+	int j;
+
+	if (pc->pc_npartners > 0) {
+		int first = pc->pc_cursor;
+
+		do {
+			rc = ptlrpcd_try_steal(pc,
+					       pc->pc_partners[pc->pc_cursor++],
+					       1);
+			if (pc->pc_cursor >= pc->pc_npartners)
+				pc->pc_cursor = 0;
+		} while (rc == 0 && pc->pc_cursor != first);
+		if (rc > 0)
+			pc->pc_partner_steals += rc;
+	}
+
+	pd = ptlrpcd_of(pc);
+	if (rc > 0 || ptlrpcd_steal_depth <= 0 || pd == NULL)
+		return rc;
+
+	for (i = -1; i < ptlrpcds_num - 1; i++) {
+		peer = i < 0 ? pd : ptlrpcds[pd->pd_peers[i]];
+		if (peer == NULL)
+			continue;
+
+		for (j = 0; j < peer->pd_nthreads; j++) {
+			rc = ptlrpcd_try_steal(pc, &peer->pd_threads[j],
+					       ptlrpcd_steal_depth);
+			if (rc > 0)
+				return rc;
+		}
+	}
+
+	return 0;
+}
+
 /**
  * Requests that are added to the ptlrpcd queue are sent via
  * ptlrpcd_check->ptlrpc_check_set().
@@ -307,11 +476,6 @@ void ptlrpcd_add_req(struct ptlrpc_request *req)
 }
 EXPORT_SYMBOL(ptlrpcd_add_req);
 
-static inline void ptlrpc_reqset_get(struct ptlrpc_request_set *set)
-{
-	atomic_inc(&set->set_refcount);
-}
-
 /**
  * Check if there is more work to do on ptlrpcd set.
  * Returns 1 if yes.
@@ -387,43 +551,15 @@ static int ptlrpcd_check(struct lu_env *env, struct ptlrpcd_ctl *pc)
 
 		/*
 		 * If we have nothing to do, check whether we can take some
-		 * work from our partner threads.
+		 * work from other threads.
 		 */
-		if (rc == 0 && pc->pc_npartners > 0) {
-			struct ptlrpcd_ctl *partner;
-			struct ptlrpc_request_set *ps;
-			int first = pc->pc_cursor;
-
-			do {
-				partner = pc->pc_partners[pc->pc_cursor++];
-				if (pc->pc_cursor >= pc->pc_npartners)
-					pc->pc_cursor = 0;
-				if (partner == NULL)
-					continue;
-
-				spin_lock(&partner->pc_lock);
-				ps = partner->pc_set;
-				if (ps == NULL) {
-					spin_unlock(&partner->pc_lock);
-					continue;
-				}
-
-				ptlrpc_reqset_get(ps);
-				spin_unlock(&partner->pc_lock);
-
-				if (atomic_read(&ps->set_new_count)) {
-					rc = ptlrpcd_steal_rqset(set, ps);
-					if (rc > 0)
-						CDEBUG(D_RPCTRACE,
-						       "transfer %d async RPCs [%d->%d]\n",
-						       rc, partner->pc_index,
-						       pc->pc_index);
-				}
-				ptlrpc_reqset_put(ps);
-			} while (rc == 0 && pc->pc_cursor != first);
-		}
+		if (rc == 0 && !test_bit(LIOD_STOP, &pc->pc_flags))
+			rc = ptlrpcd_steal(pc);
 	}
 
+	/* let threads with a backlog know that we could help */
+	WRITE_ONCE(pc->pc_idle, rc == 0 && !atomic_read(&set->set_remaining));
+
 	RETURN(rc || test_bit(LIOD_STOP, &pc->pc_flags));
 }
 
@@ -698,6 +834,44 @@ out:
 	EXIT;
 }
 
+/* Show the queue of every ptlrpcd thread and how much work was stolen */
+static int ptlrpcd_stats_seq_show(struct seq_file *m, void *v)
+{
+	struct ptlrpc_request_set *set;
+	struct ptlrpcd_ctl *pc;
+	int queued;
+	int active;
+	int i;
+	int j;
+
+	/* ptlrpcd_fini() removes this file before freeing ptlrpcds */
+	for (i = 0; ptlrpcds != NULL && i < ptlrpcds_num; i++) {
+		if (ptlrpcds[i] == NULL)
+			break;
+		for (j = 0; j < ptlrpcds[i]->pd_nthreads; j++) {
+			pc = &ptlrpcds[i]->pd_threads[j];
+			queued = active = 0;
+			spin_lock(&pc->pc_lock);
+			set = pc->pc_set;
+			if (set != NULL) {
+				queued = atomic_read(&set->set_new_count);
+				active = atomic_read(&set->set_remaining);
+			}
+			spin_unlock(&pc->pc_lock);
+
+			seq_printf(m, "%s: { cpt: %d, queued: %d, active: %d, ",
+				   pc->pc_name, pc->pc_cpt, queued, active);
+			seq_printf(m, "steals: %lu, partner_steals: %lu, ",
+				   pc->pc_steals, pc->pc_partner_steals);
+			seq_printf(m, "remote_steals: %lu, stolen: %lu }\n",
+				   pc->pc_remote_steals, pc->pc_stolen);
+		}
+	}
+
+	return 0;
+}
+LDEBUGFS_SEQ_FOPS_RO(ptlrpcd_stats);
+
 static void ptlrpcd_fini(void)
 {
 	int	i;
@@ -706,14 +880,24 @@ static void ptlrpcd_fini(void)
 
 	ENTRY;
 
+	debugfs_remove(ptlrpcd_debugfs_entry);
+	ptlrpcd_debugfs_entry = NULL;
+
 	if (ptlrpcds != NULL) {
-		for (i = 0; i < ptlrpcds_num; i++) {
-			if (ptlrpcds[i] == NULL)
-				break;
+		/* any thread may take work from any other, so all must be
+		 * stopped before any ptlrpcd is freed */
+		for (i = 0; i < ptlrpcds_num && ptlrpcds[i] != NULL; i++)
 			for (j = 0; j < ptlrpcds[i]->pd_nthreads; j++)
 				ptlrpcd_stop(&ptlrpcds[i]->pd_threads[j], 0);
+		for (i = 0; i < ptlrpcds_num && ptlrpcds[i] != NULL; i++)
 			for (j = 0; j < ptlrpcds[i]->pd_nthreads; j++)
 				ptlrpcd_free(&ptlrpcds[i]->pd_threads[j]);
+		for (i = 0; i < ptlrpcds_num; i++) {
+			if (ptlrpcds[i] == NULL)
+				break;
+			if (ptlrpcds[i]->pd_peers != NULL)
+				OBD_FREE_PTR_ARRAY(ptlrpcds[i]->pd_peers,
+						   ptlrpcds_num - 1);
 			OBD_FREE(ptlrpcds[i], ptlrpcds[i]->pd_size);
 			ptlrpcds[i] = NULL;
 		}
@@ -733,6 +917,44 @@ static void ptlrpcd_fini(void)
 	EXIT;
 }
 
+/*
+ * Order the other ptlrpcds by the NUMA distance of their CPT to the one of
+ * \a pd, which is the order idle threads of \a pd look for work in them.
+ */
+static int ptlrpcd_peers(struct ptlrpcd *pd)
+{
+	unsigned int	dist;
+	int		npeers = 0;
+	int		i;
+	int		j;
+
+	if (ptlrpcds_num <= 1)
+		return 0;
+
+	OBD_CPT_ALLOC(pd->pd_peers, cfs_cpt_tab, pd->pd_cpt,
+		      sizeof(pd->pd_peers[0]) * (ptlrpcds_num - 1));
+	if (pd->pd_peers == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < ptlrpcds_num; i++) {
+		if (i == pd->pd_index)
+			continue;
+
+		dist = cfs_cpt_distance(cfs_cpt_tab, pd->pd_cpt,
+					ptlrpcds[i]->pd_cpt);
+		for (j = npeers; j > 0; j--) {
+			if (cfs_cpt_distance(cfs_cpt_tab, pd->pd_cpt,
+				ptlrpcds[pd->pd_peers[j - 1]]->pd_cpt) <= dist)
+				break;
+			pd->pd_peers[j] = pd->pd_peers[j - 1];
+		}
+		pd->pd_peers[j] = i;
+		npeers++;
+	}
+
+	return 0;
+}
+
 static int ptlrpcd_init(void)
 {
 	int			nthreads;
@@ -922,6 +1144,20 @@ static int ptlrpcd_init(void)
 			if (rc < 0)
 				GOTO(out, rc);
 		}
+	}
+
+	/*
+	 * Idle threads can also take work from the threads of any other
+	 * CPT, so all ptlrpcds must be set up before any thread is started.
+	 */
+	for (i = 0; i < ncpts; i++) {
+		rc = ptlrpcd_peers(ptlrpcds[i]);
+		if (rc < 0)
+			GOTO(out, rc);
+	}
+
+	for (i = 0; i < ncpts; i++) {
+		pd = ptlrpcds[i];
 
 		/* XXX: We start nthreads ptlrpc daemons on this cpt.
 		 *      Each of them can process any non-recovery
@@ -942,12 +1178,16 @@ static int ptlrpcd_init(void)
 		 *      load among all the ptlrpc daemons becomes
 		 *      another trouble.
 		 */
-		for (j = 0; j < nthreads; j++) {
+		for (j = 0; j < pd->pd_nthreads; j++) {
 			rc = ptlrpcd_start(&pd->pd_threads[j]);
 			if (rc < 0)
 				GOTO(out, rc);
 		}
 	}
+
+	ptlrpcd_debugfs_entry = debugfs_create_file("ptlrpcd_stats", 0444,
+						    debugfs_lustre_root, NULL,
+						    &ptlrpcd_stats_fops);
 out:
 	if (rc != 0)
 		ptlrpcd_fini();
@@ -332,6 +332,10 @@ static void rs_batch_add(struct rs_batch *b, struct ptlrpc_reply_state *rs)
 		b->rsb_svcpt = svcpt;
 	}
 	spin_lock(&rs->rs_lock);
+	if (!rs->rs_committed && rs->rs_sent != 0)
+		ptlrpc_lat_tally(svcpt->scp_service, rs->rs_opc,
+				 PTLRPC_LAT_COMMIT, rs->rs_sent,
+				 ktime_get_real());
 	rs->rs_scheduled_ever = 1;
 	if (rs->rs_scheduled == 0) {
 		list_move(&rs->rs_list, &b->rsb_replies);
@@ -490,6 +494,16 @@ static void ptlrpc_at_timer(cfs_timer_cb_arg_t data)
 	wake_up(&svcpt->scp_waitq);
 }
 
+static void ptlrpc_thread_ctl_timer(cfs_timer_cb_arg_t data)
+{
+	struct ptlrpc_service_part *svcpt;
+
+	svcpt = cfs_from_timer(svcpt, data, scp_thr_ctl_timer);
+
+	svcpt->scp_thr_ctl_check = 1;
+	wake_up(&svcpt->scp_waitq);
+}
+
 static void ptlrpc_server_nthreads_check(struct ptlrpc_service *svc,
 					 struct ptlrpc_service_conf *conf)
 {
@@ -662,6 +676,8 @@ static int ptlrpc_service_part_init(struct ptlrpc_service *svc,
 
 	cfs_timer_setup(&svcpt->scp_at_timer, ptlrpc_at_timer,
 			(unsigned long)svcpt, 0);
+	cfs_timer_setup(&svcpt->scp_thr_ctl_timer, ptlrpc_thread_ctl_timer,
+			(unsigned long)svcpt, 0);
 
 	/*
 	 * At SOW, service time should be quick; 10s seems generous. If client
@@ -1888,6 +1904,12 @@ static int ptlrpc_server_request_add(struct ptlrpc_service_part *svcpt,
 	req->rq_svc_thread = NULL;
 	req->rq_session.lc_thread = NULL;
 
+	req->rq_srv.sr_enqueue_time = ktime_get_real();
+	ptlrpc_lat_tally(svcpt->scp_service,
+			 lustre_msg_get_opc(req->rq_reqmsg), PTLRPC_LAT_ENQUEUE,
+			 timespec64_to_ktime(req->rq_arrival_time),
+			 req->rq_srv.sr_enqueue_time);
+
 	ptlrpc_nrs_req_add(svcpt, req, hp);
 
 	RETURN(0);
@@ -2213,6 +2235,30 @@ err_req:
 	RETURN(1);
 }
 
+static inline unsigned int ptlrpc_thr_avg(unsigned int avg, s64 usecs)
+{
+	usecs = clamp_t(s64, usecs, 0, UINT_MAX);
+
+	return avg - (avg >> 3) + ((unsigned int)usecs >> 3);
+}
+
+/**
+ * Feed the thread pool controller with the queue wait \a wait_usecs and the
+ * handling time \a svc_usecs of a request.
+ *
+ * The averages are updated without locking; a sample lost to a racing
+ * thread only makes the controller react a little later.
+ */
+static void ptlrpc_thread_ctl_sample(struct ptlrpc_service_part *svcpt,
+				     s64 wait_usecs, s64 svc_usecs)
+{
+	svcpt->scp_thr_wait_avg = ptlrpc_thr_avg(svcpt->scp_thr_wait_avg,
+						 wait_usecs);
+	svcpt->scp_thr_svc_avg = ptlrpc_thr_avg(svcpt->scp_thr_svc_avg,
+						svc_usecs);
+	svcpt->scp_thr_ctl_nreqs++;
+}
+
 /**
  * Main incoming request handling logic.
  * Calls handler function from service to do actual processing.
@@ -2253,6 +2299,9 @@ static int ptlrpc_server_handle_request(struct ptlrpc_service_part *svcpt,
 	work_start = ktime_get_real();
 	arrived = timespec64_to_ktime(request->rq_arrival_time);
 	timediff_usecs = ktime_us_delta(work_start, arrived);
+	ptlrpc_lat_tally(svc, lustre_msg_get_opc(request->rq_reqmsg),
+			 PTLRPC_LAT_NRS, request->rq_srv.sr_enqueue_time,
+			 work_start);
 	if (likely(svc->srv_stats != NULL)) {
 		lprocfs_counter_add(svc->srv_stats, PTLRPC_REQWAIT_CNTR,
 				    timediff_usecs);
@@ -2311,6 +2360,8 @@ static int ptlrpc_server_handle_request(struct ptlrpc_service_part *svcpt,
 		thread->t_env->le_ses = &request->rq_session;
 	}
 	svc->srv_ops.so_req_handler(request);
+	ptlrpc_lat_tally(svc, lustre_msg_get_opc(request->rq_reqmsg),
+			 PTLRPC_LAT_HANDLER, work_start, ktime_get_real());
 
 	ptlrpc_rqphase_move(request, RQ_PHASE_COMPLETE);
 
@@ -2326,6 +2377,8 @@ put_conn:
 	work_end = ktime_get_real();
 	timediff_usecs = ktime_us_delta(work_end, work_start);
 	arrived_usecs = ktime_us_delta(work_end, arrived);
+	ptlrpc_thread_ctl_sample(svcpt, arrived_usecs - timediff_usecs,
+				 timediff_usecs);
 	CDEBUG(D_RPCTRACE,
 	       "Handled RPC req@%p pname:cluuid+ref:pid:xid:nid:opc:job %s:%s+%d:%d:x%llu:%s:%d:%s Request processed in %lldus (%lldus total) trans %llu rc %d/%d\n",
 	       request, current->comm,
@@ -2559,6 +2612,25 @@ static inline int ptlrpc_threads_enough(struct ptlrpc_service_part *svcpt)
 	       (svcpt->scp_service->srv_ops.so_hpreq_handler != NULL);
 }
 
+/**
+ * # threads the partition may run now.
+ *
+ * Without a delay target, or while requests wait longer than the target,
+ * this is the configured threads_max; otherwise the pool is held at the size
+ * the thread pool controller settled on, see ptlrpc_thread_ctl_check().
+ */
+static inline int ptlrpc_threads_limit(struct ptlrpc_service_part *svcpt)
+{
+	struct ptlrpc_service *svc = svcpt->scp_service;
+
+	if (svc->srv_nthrs_delay_target == 0 ||
+	    svcpt->scp_thr_wait_avg >= svc->srv_nthrs_delay_target)
+		return svc->srv_nthrs_cpt_limit;
+
+	return clamp(svcpt->scp_nthrs_target, svc->srv_nthrs_cpt_init,
+		     svc->srv_nthrs_cpt_limit);
+}
+
 /**
  * allowed to create more threads
  * user can call it w/o any lock but need to hold
@@ -2568,7 +2640,7 @@ static inline int ptlrpc_threads_increasable(struct ptlrpc_service_part *svcpt)
 {
 	return svcpt->scp_nthrs_running +
 	       svcpt->scp_nthrs_starting <
-	       svcpt->scp_service->srv_nthrs_cpt_limit;
+	       ptlrpc_threads_limit(svcpt);
 }
 
 /**
@@ -2591,10 +2663,80 @@ static inline bool ptlrpc_thread_should_stop(struct ptlrpc_thread *thread)
 {
 	struct ptlrpc_service_part *svcpt = thread->t_svcpt;
 
-	return thread->t_id >= svcpt->scp_service->srv_nthrs_cpt_limit &&
+	return thread->t_id >= ptlrpc_threads_limit(svcpt) &&
 		thread->t_id == svcpt->scp_thr_nextid - 1;
 }
 
+static inline int ptlrpc_thread_ctl_pending(struct ptlrpc_service_part *svcpt)
+{
+	return svcpt->scp_thr_ctl_check;
+}
+
+/**
+ * Thread pool controller of a service partition.
+ *
+ * Runs every PTLRPC_THR_CTL_INTERVAL seconds while the partition has more
+ * than srv_nthrs_cpt_init threads and a delay target is set. Growing is left
+ * to ptlrpc_threads_need_create(), which may go up to threads_max as soon as
+ * the average queue wait reaches the target. Here the highest numbered thread
+ * is retired when requests wait less than half the target, some threads are
+ * idle, and the arrival rate times the average handling time (Little's law)
+ * says the remaining threads can keep up.
+ */
+static void ptlrpc_thread_ctl_check(struct ptlrpc_service_part *svcpt)
+{
+	struct ptlrpc_service *svc = svcpt->scp_service;
+	unsigned int target = svc->srv_nthrs_delay_target;
+	unsigned int nreqs;
+	bool shrink = false;
+	int nthrs;
+	u64 needed;
+
+	spin_lock(&svcpt->scp_lock);
+	if (!svcpt->scp_thr_ctl_check) {
+		spin_unlock(&svcpt->scp_lock);
+		return;
+	}
+	svcpt->scp_thr_ctl_check = 0;
+
+	nreqs = svcpt->scp_thr_ctl_nreqs;
+	svcpt->scp_thr_ctl_nreqs = 0;
+	/* nothing was handled, let the stale wait time decay */
+	if (nreqs == 0)
+		svcpt->scp_thr_wait_avg >>= 1;
+
+	nthrs = svcpt->scp_thr_nextid;
+	if (target == 0 || svc->srv_is_stopping ||
+	    nthrs <= svc->srv_nthrs_cpt_init) {
+		spin_unlock(&svcpt->scp_lock);
+		return;
+	}
+
+	needed = div_u64((u64)nreqs * svcpt->scp_thr_svc_avg,
+			 PTLRPC_THR_CTL_INTERVAL * USEC_PER_SEC) + 1 +
+		 (svc->srv_ops.so_hpreq_handler != NULL);
+
+	if (svcpt->scp_nthrs_starting == 0 &&
+	    svcpt->scp_thr_wait_avg < target / 2 &&
+	    ptlrpc_threads_enough(svcpt) && needed < nthrs) {
+		svcpt->scp_nthrs_target = nthrs - 1;
+		svcpt->scp_thr_shrunk++;
+		shrink = true;
+	}
+
+	mod_timer(&svcpt->scp_thr_ctl_timer,
+		  jiffies + cfs_time_seconds(PTLRPC_THR_CTL_INTERVAL));
+	spin_unlock(&svcpt->scp_lock);
+
+	if (shrink) {
+		CDEBUG(D_RPCTRACE, "%s[%d]: retire a thread of %d: wait %uus svc %uus nreqs %u\n",
+		       svc->srv_name, svcpt->scp_cpt, nthrs,
+		       svcpt->scp_thr_wait_avg, svcpt->scp_thr_svc_avg, nreqs);
+		/* the retiring thread may be any of the sleepers */
+		wake_up_all(&svcpt->scp_waitq);
+	}
+}
+
 static void ptlrpc_stop_thread(struct ptlrpc_thread *thread)
 {
 	CDEBUG(D_INFO, "Stopping thread %s #%u\n",
@@ -2602,16 +2744,20 @@ static void ptlrpc_stop_thread(struct ptlrpc_thread *thread)
 	thread_add_flags(thread, SVC_STOPPING);
 }
 
-static inline void ptlrpc_thread_stop(struct ptlrpc_thread *thread)
+static inline bool ptlrpc_thread_stop(struct ptlrpc_thread *thread)
 {
 	struct ptlrpc_service_part *svcpt = thread->t_svcpt;
+	bool stopped = false;
 
 	spin_lock(&svcpt->scp_lock);
 	if (ptlrpc_thread_should_stop(thread)) {
 		ptlrpc_stop_thread(thread);
 		svcpt->scp_thr_nextid--;
+		stopped = true;
 	}
 	spin_unlock(&svcpt->scp_lock);
+
+	return stopped;
 }
 
 static inline int ptlrpc_rqbd_pending(struct ptlrpc_service_part *svcpt)
@@ -2707,14 +2853,18 @@ ptlrpc_wait_event(struct ptlrpc_service_part *svcpt,
 			ptlrpc_server_request_incoming(svcpt) ||
 			ptlrpc_server_request_pending(svcpt, false) ||
 			ptlrpc_rqbd_pending(svcpt) ||
-			ptlrpc_at_check(svcpt));
+			ptlrpc_at_check(svcpt) ||
+			ptlrpc_thread_ctl_pending(svcpt) ||
+			ptlrpc_thread_should_stop(thread));
 	else if (wait_event_idle_exclusive_lifo_timeout(
 			 svcpt->scp_waitq,
 			 ptlrpc_thread_stopping(thread) ||
 			 ptlrpc_server_request_incoming(svcpt) ||
 			 ptlrpc_server_request_pending(svcpt, false) ||
 			 ptlrpc_rqbd_pending(svcpt) ||
-			 ptlrpc_at_check(svcpt),
+			 ptlrpc_at_check(svcpt) ||
+			 ptlrpc_thread_ctl_pending(svcpt) ||
+			 ptlrpc_thread_should_stop(thread),
 			 svcpt->scp_rqbd_timeout) == 0)
 		svcpt->scp_rqbd_timeout = 0;
 
@@ -2740,6 +2890,7 @@ static int ptlrpc_main(void *arg)
 	struct ptlrpc_reply_state *rs;
 	struct group_info *ginfo = NULL;
 	struct lu_env *env;
+	bool retired = false;
 	int counter = 0, rc = 0;
 
 	ENTRY;
@@ -2864,6 +3015,9 @@ static int ptlrpc_main(void *arg)
 		if (ptlrpc_at_check(svcpt))
 			ptlrpc_at_check_timed(svcpt);
 
+		if (ptlrpc_thread_ctl_pending(svcpt))
+			ptlrpc_thread_ctl_check(svcpt);
+
 		if (ptlrpc_server_request_pending(svcpt, false)) {
 			lu_context_enter(&env->le_ctx);
 			ptlrpc_server_handle_request(svcpt, thread);
@@ -2882,12 +3036,13 @@ static int ptlrpc_main(void *arg)
 			       svcpt->scp_nrqbds_posted);
 		}
 		/*
-		 * If the number of threads has been tuned downward and this
-		 * thread should be stopped, then stop in reverse order so the
+		 * If the number of threads has been tuned downward, or the
+		 * thread pool controller shrank the pool, and this thread
+		 * should be stopped, then stop in reverse order so the
 		 * the threads always have contiguous thread index values.
 		 */
 		if (unlikely(ptlrpc_thread_should_stop(thread)))
-			ptlrpc_thread_stop(thread);
+			retired = ptlrpc_thread_stop(thread);
 	}
 
 	ptlrpc_watchdog_disable(&thread->t_watchdog);
@@ -2917,6 +3072,18 @@ out:
 	thread->t_id = rc;
 	thread_add_flags(thread, SVC_STOPPED);
 
+	/*
+	 * Nobody waits for a thread retired while the service is running,
+	 * so drop it now rather than letting grow/shrink cycles pile up
+	 * stopped threads until ptlrpc_svcpt_stop_threads().
+	 */
+	if (retired && !svc->srv_is_stopping) {
+		list_del(&thread->t_link);
+		spin_unlock(&svcpt->scp_lock);
+		OBD_FREE_PTR(thread);
+		return rc;
+	}
+
 	wake_up(&thread->t_ctl_waitq);
 	spin_unlock(&svcpt->scp_lock);
 
@@ -3226,6 +3393,17 @@ int ptlrpc_start_thread(struct ptlrpc_service_part *svcpt, int wait)
 	thread_add_flags(thread, SVC_STARTING);
 	thread->t_svcpt = svcpt;
 
+	/* keep the grown pool until the controller finds it idle */
+	if (svcpt->scp_nthrs_target < svcpt->scp_thr_nextid)
+		svcpt->scp_nthrs_target = svcpt->scp_thr_nextid;
+	if (thread->t_id >= svc->srv_nthrs_cpt_init) {
+		svcpt->scp_thr_grown++;
+		if (svc->srv_nthrs_delay_target != 0 &&
+		    !timer_pending(&svcpt->scp_thr_ctl_timer))
+			mod_timer(&svcpt->scp_thr_ctl_timer, jiffies +
+				  cfs_time_seconds(PTLRPC_THR_CTL_INTERVAL));
+	}
+
 	list_add(&thread->t_link, &svcpt->scp_threads);
 	spin_unlock(&svcpt->scp_lock);
 
@@ -3375,10 +3553,12 @@ ptlrpc_service_del_atimer(struct ptlrpc_service *svc)
 	struct ptlrpc_service_part *svcpt;
 	int i;
 
-	/* early disarm AT timer... */
+	/* early disarm AT and thread pool timers... */
 	ptlrpc_service_for_each_part(svcpt, i, svc) {
-		if (svcpt->scp_service != NULL)
+		if (svcpt->scp_service != NULL) {
 			del_timer(&svcpt->scp_at_timer);
+			del_timer(&svcpt->scp_thr_ctl_timer);
+		}
 	}
 }
 
@@ -3535,6 +3715,7 @@ ptlrpc_service_free(struct ptlrpc_service *svc)
 
 		/* In case somebody rearmed this in the meantime */
 		del_timer(&svcpt->scp_at_timer);
+		del_timer(&svcpt->scp_thr_ctl_timer);
 		array = &svcpt->scp_at_array;
 
 		if (array->paa_reqs_array != NULL) {
@@ -3556,6 +3737,8 @@ ptlrpc_service_free(struct ptlrpc_service *svc)
 	if (svc->srv_cpts != NULL)
 		cfs_expr_list_values_free(svc->srv_cpts, svc->srv_ncpts);
 
+	ptlrpc_lat_hist_free(svc);
+
 	OBD_FREE(svc, offsetof(struct ptlrpc_service,
 			       srv_parts[svc->srv_ncpts]));
 }
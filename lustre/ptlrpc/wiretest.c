@@ -1383,6 +1383,54 @@ void lustre_assert_wire_constants(void)
 		 OBD_CONNECT2_LSEEK);
 	LASSERTF(OBD_CONNECT2_DOM_LVB == 0x80000ULL, "found 0x%.16llxULL\n",
 		 OBD_CONNECT2_DOM_LVB);
+	LASSERTF(OBD_CONNECT2_REP_MBITS == 0x100000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_REP_MBITS);
+	LASSERTF(OBD_CONNECT2_MODE_CONVERT == 0x200000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_MODE_CONVERT);
+	LASSERTF(OBD_CONNECT2_BATCH_RPCS == 0x400000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_BATCH_RPCS);
+	LASSERTF(OBD_CONNECT2_PCCRO == 0x800000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_PCCRO);
+	LASSERTF(OBD_CONNECT2_MNE_TYPE == 0x1000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_MNE_TYPE);
+	LASSERTF(OBD_CONNECT2_LOCK_CONTENTION == 0x2000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_LOCK_CONTENTION);
+	LASSERTF(OBD_CONNECT2_ATOMIC_OPEN_LOCK == 0x4000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_ATOMIC_OPEN_LOCK);
+	LASSERTF(OBD_CONNECT2_ENCRYPT_NAME == 0x8000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_ENCRYPT_NAME);
+	LASSERTF(OBD_CONNECT2_MKDIR_REPLAY == 0x10000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_MKDIR_REPLAY);
+	LASSERTF(OBD_CONNECT2_DMV_IMP_INHERIT == 0x20000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_DMV_IMP_INHERIT);
+	LASSERTF(OBD_CONNECT2_ENCRYPT_FID2PATH == 0x40000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_ENCRYPT_FID2PATH);
+	LASSERTF(OBD_CONNECT2_REPLAY_CREATE == 0x80000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_REPLAY_CREATE);
+	LASSERTF(OBD_CONNECT2_LARGE_NID == 0x100000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_LARGE_NID);
+	LASSERTF(OBD_CONNECT2_COMPRESS == 0x200000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_COMPRESS);
+	LASSERTF(OBD_CONNECT2_UNALIGNED_DIO == 0x400000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_UNALIGNED_DIO);
+	LASSERTF(OBD_CONNECT2_CONN_POLICY == 0x800000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_CONN_POLICY);
+	LASSERTF(OBD_CONNECT2_SPARSE == 0x1000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_SPARSE);
+	LASSERTF(OBD_CONNECT2_MIRROR_ID_FIX == 0x2000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_MIRROR_ID_FIX);
+	LASSERTF(OBD_CONNECT2_UPDATE_LAYOUT == 0x4000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_UPDATE_LAYOUT);
+	LASSERTF(OBD_CONNECT2_READDIR_OPEN == 0x8000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_READDIR_OPEN);
+	LASSERTF(OBD_CONNECT2_FLR_EC == 0x10000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_FLR_EC);
+	LASSERTF(OBD_CONNECT2_WBC == 0x20000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_WBC);
+	LASSERTF(OBD_CONNECT2_BRW_MULTI == 0x40000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_BRW_MULTI);
+	LASSERTF(OBD_CONNECT2_BATCH_BL_AST == 0x80000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_BATCH_BL_AST);
 	LASSERTF(OBD_CKSUM_CRC32 == 0x00000001UL, "found 0x%.8xUL\n",
 		(unsigned)OBD_CKSUM_CRC32);
 	LASSERTF(OBD_CKSUM_ADLER == 0x00000002UL, "found 0x%.8xUL\n",
@@ -1671,6 +1719,7 @@ void lustre_assert_wire_constants(void)
 	BUILD_BUG_ON(OBD_FL_NOSPC_BLK != 0x00100000);
 	BUILD_BUG_ON(OBD_FL_FLUSH != 0x00200000);
 	BUILD_BUG_ON(OBD_FL_SHORT_IO != 0x00400000);
+	BUILD_BUG_ON(OBD_FL_GRANT_RECLAIM != 0x00800000);
 
 	/* Checks for struct lov_ost_data_v1 */
 	LASSERTF((int)sizeof(struct lov_ost_data_v1) == 24, "found %lld\n",
@@ -1860,6 +1909,8 @@ void lustre_assert_wire_constants(void)
 		 (long long)LCM_FL_WRITE_PENDING);
 	LASSERTF(LCM_FL_SYNC_PENDING == 3, "found %lld\n",
 		 (long long)LCM_FL_SYNC_PENDING);
+	LASSERTF(LCM_FL_PCC_RDONLY == 8, "found %lld\n",
+		 (long long)LCM_FL_PCC_RDONLY);
 
 	/* Checks for struct lmv_mds_md_v1 */
 	LASSERTF((int)sizeof(struct lmv_mds_md_v1) == 56, "found %lld\n",
@@ -2381,6 +2432,8 @@ void lustre_assert_wire_constants(void)
 		(unsigned)MDS_PCC_ATTACH);
 	LASSERTF(MDS_CLOSE_UPDATE_TIMES == 0x00100000UL, "found 0x%.8xUL\n",
 		(unsigned)MDS_CLOSE_UPDATE_TIMES);
+	LASSERTF(MDS_WBC_LOCKLESS == 0x00200000UL, "found 0x%.8xUL\n",
+		(unsigned)MDS_WBC_LOCKLESS);
 
 	/* Checks for struct mdt_body */
 	LASSERTF((int)sizeof(struct mdt_body) == 216, "found %lld\n",
@@ -4800,6 +4853,10 @@ void lustre_assert_wire_constants(void)
 		 (long long)LAYOUT_INTENT_RELEASE);
 	LASSERTF(LAYOUT_INTENT_RESTORE == 6, "found %lld\n",
 		 (long long)LAYOUT_INTENT_RESTORE);
+	LASSERTF(LAYOUT_INTENT_PCCRO_SET == 7, "found %lld\n",
+		 (long long)LAYOUT_INTENT_PCCRO_SET);
+	LASSERTF(LAYOUT_INTENT_PCCRO_CLEAR == 8, "found %lld\n",
+		 (long long)LAYOUT_INTENT_PCCRO_CLEAR);
 
 	/* Checks for struct hsm_action_item */
 	LASSERTF((int)sizeof(struct hsm_action_item) == 72, "found %lld\n",
@@ -81,6 +81,83 @@
 /* Clients typically hold 2x their max_rpcs_in_flight of grant space */
 #define TGT_GRANT_SHRINK_LIMIT(exp)	(2ULL * 8 * exp_max_brw_size(exp))
 
+/* Sampling period of the write rates used to balance grant, in seconds */
+#define TGT_GRANT_RATE_PERIOD		5
+
+/**
+ * Return the average write rate, aged by the periods elapsed without any
+ * write, so that an export which stopped writing is quickly seen as idle.
+ * Caller must hold tgd_grant_lock spinlock.
+ */
+static u64 tgt_write_rate_get(const struct tg_write_rate *twr)
+{
+	time64_t periods;
+
+	periods = (ktime_get_seconds() - twr->twr_stamp) /
+		  TGT_GRANT_RATE_PERIOD;
+	if (periods <= 1)
+		return twr->twr_rate;
+
+	return periods < 64 ? twr->twr_rate >> (periods - 1) : 0;
+}
+
+/**
+ * Account \a bytes written in the rate \a twr, folding the bytes seen in
+ * the last period into the average once the period is over.
+ * A new or idle writer has no average yet, it is seeded from its first
+ * write so that it is not denied grant until its first period is over.
+ * Caller must hold tgd_grant_lock spinlock.
+ */
+static void tgt_write_rate_add(struct tg_write_rate *twr, u64 bytes)
+{
+	time64_t now = ktime_get_seconds();
+	time64_t elapsed = now - twr->twr_stamp;
+
+	if (elapsed >= TGT_GRANT_RATE_PERIOD) {
+		twr->twr_rate = (tgt_write_rate_get(twr) +
+				 div64_u64(twr->twr_bytes, elapsed)) / 2;
+		twr->twr_bytes = 0;
+		twr->twr_stamp = now;
+	}
+	if (twr->twr_rate == 0 && twr->twr_bytes == 0)
+		twr->twr_rate = max_t(u64, div_u64(bytes, TGT_GRANT_RATE_PERIOD),
+				      1);
+	twr->twr_bytes += bytes;
+}
+
+/**
+ * Check whether the ungranted space \a left is too small for all of the
+ * clients to hold a full grant, i.e. grant must be given to those clients
+ * which use it. This is also when grant shrink requests are honoured.
+ */
+static inline bool tgt_grant_space_tight(struct obd_export *exp, u64 left)
+{
+	struct tg_grants_data *tgd = &exp->exp_obd->u.obt.obt_lut->lut_tgd;
+
+	return left < tgd->tgd_tot_granted_clients *
+		      TGT_GRANT_SHRINK_LIMIT(exp);
+}
+
+/**
+ * Part of the ungranted space \a left that \a exp may be granted when the
+ * space is tight: its share of the target write rate.
+ * Caller must hold tgd_grant_lock spinlock.
+ */
+static u64 tgt_grant_rate_share(struct obd_export *exp, u64 left)
+{
+	struct tg_grants_data *tgd = &exp->exp_obd->u.obt.obt_lut->lut_tgd;
+	u64 tot_rate = tgt_write_rate_get(&tgd->tgd_write_rate);
+	u64 rate = tgt_write_rate_get(&exp->exp_target_data.ted_write_rate);
+
+	if (tot_rate == 0)
+		/* nothing written lately, share evenly */
+		return div64_u64(left, max(tgd->tgd_tot_granted_clients, 1));
+	if (rate >= tot_rate)
+		return left;
+
+	return (left >> 10) * div64_u64(rate << 10, tot_rate);
+}
+
 /* Helpers to inflate/deflate grants for clients that do not support the grant
  * parameters */
 static inline u64 tgt_grant_inflate(struct tg_grants_data *tgd, u64 val)
@@ -565,6 +642,12 @@ static void tgt_grant_incoming(const struct lu_env *env, struct obd_export *exp,
 	ted->ted_grant -= dropped;
 	ted->ted_dirty = dirty;
 
+	/* how much of its grant the client actually fills with dirty data */
+	if (ted->ted_grant > 0)
+		lprocfs_oh_tally(&ted->ted_grant_eff,
+				 min_t(long, ted->ted_dirty * 10 /
+					     ted->ted_grant, 10));
+
 	if (ted->ted_dirty < 0 || ted->ted_grant < 0 || ted->ted_pending < 0) {
 		CERROR("%s: cli %s/%p dirty %ld pend %ld grant %ld\n",
 		       obd->obd_name, exp->exp_client_uuid.uuid, exp,
@@ -599,8 +682,7 @@ static void tgt_grant_shrink(struct obd_export *exp, struct obdo *oa,
 
 	assert_spin_locked(&tgd->tgd_grant_lock);
 	LASSERT(exp);
-	if (left_space >= tgd->tgd_tot_granted_clients *
-			  TGT_GRANT_SHRINK_LIMIT(exp))
+	if (!tgt_grant_space_tight(exp, left_space))
 		return;
 
 	grant_shrink = oa->o_grant;
@@ -899,6 +981,7 @@ static long tgt_grant_alloc(struct obd_export *exp, u64 curgrant,
 	struct tg_grants_data	*tgd = &obd->u.obt.obt_lut->lut_tgd;
 	struct tg_export_data	*ted = &exp->exp_target_data;
 	u64			 grant;
+	u64			 share = OBD_MAX_GRANT;
 
 	ENTRY;
 
@@ -935,6 +1018,13 @@ static long tgt_grant_alloc(struct obd_export *exp, u64 curgrant,
 	if (obd->obd_recovering)
 		conservative = false;
 
+	/* When there is not enough space left for every client to hold a
+	 * full grant, hand it out by write rate so that the clients actively
+	 * writing keep their cache going and idle ones get nothing more */
+	if (conservative && obd->obd_self_export != exp &&
+	    tgt_grant_space_tight(exp, left))
+		share = tgt_grant_rate_share(exp, left);
+
 	if (conservative)
 		/* don't grant more than 1/8th of the remaining free space in
 		 * one chunk */
@@ -951,6 +1041,12 @@ static long tgt_grant_alloc(struct obd_export *exp, u64 curgrant,
 	if ((grant > chunk) && conservative)
 		grant = chunk;
 
+	if (grant > share) {
+		grant = share & ~((1ULL << tgd->tgd_blockbits) - 1);
+		if (!grant)
+			RETURN(0);
+	}
+
 	/*
 	 * Limit grant so that export' grant does not exceed what the
 	 * client would like to have by more than grants for 2 full
@@ -1220,13 +1316,19 @@ void tgt_grant_prepare_write(const struct lu_env *env,
 	struct obd_device	*obd = exp->exp_obd;
 	struct lu_target	*lut = obd->u.obt.obt_lut;
 	struct tg_grants_data	*tgd = &lut->lut_tgd;
+	struct tg_export_data	*ted = &exp->exp_target_data;
 	u64			 left;
+	u64			 bytes = 0;
 	int			 from_cache;
 	int			 force = 0; /* can use cached data intially */
 	long			 chunk = tgt_grant_chunk(exp, lut, NULL);
+	int			 i;
 
 	ENTRY;
 
+	for (i = 0; i < niocount; i++)
+		bytes += rnb[i].rnb_len;
+
 refresh:
 	/* get statfs information from OSD layer */
 	tgt_grant_statfs(env, exp, force, &from_cache);
@@ -1251,7 +1353,6 @@ refresh:
 	 * much space as possible. */
 	if (!obd->obd_recovering && force != 2 && left < chunk) {
 		bool from_grant = true;
-		int  i;
 
 		/* That said, it is worth running a sync only if some pages did
 		 * not consume grant space on the client and could thus fail
@@ -1278,6 +1379,11 @@ refresh:
 	/* check limit */
 	tgt_grant_check(env, exp, oa, rnb, niocount, &left);
 
+	if (!obd->obd_recovering) {
+		tgt_write_rate_add(&ted->ted_write_rate, bytes);
+		tgt_write_rate_add(&tgd->tgd_write_rate, bytes);
+	}
+
 	if (!(oa->o_valid & OBD_MD_FLGRANT)) {
 		spin_unlock(&tgd->tgd_grant_lock);
 		RETURN_EXIT;
@@ -1293,6 +1399,19 @@ refresh:
 		oa->o_grant = tgt_grant_alloc(exp, oa->o_grant, oa->o_undirty,
 					      left, chunk, true);
 
+	/* Space is tight and this client holds more grant than its writes
+	 * justify: ask it to release the extra grant right away rather than
+	 * at its next periodic shrink, so that busier clients can use it */
+	if (!obd->obd_recovering && ted->ted_grant > chunk &&
+	    tgt_grant_space_tight(exp, left) &&
+	    tgt_grant_rate_share(exp, left) < chunk) {
+		if (oa->o_valid & OBD_MD_FLFLAGS)
+			oa->o_flags |= OBD_FL_GRANT_RECLAIM;
+		else
+			oa->o_flags = OBD_FL_GRANT_RECLAIM;
+		oa->o_valid |= OBD_MD_FLFLAGS;
+	}
+
 	if (!exp_grant_param_supp(exp))
 		oa->o_grant = tgt_grant_deflate(tgd, oa->o_grant);
 	spin_unlock(&tgd->tgd_grant_lock);
@@ -1614,6 +1733,36 @@ ssize_t tot_pending_show(struct kobject *kobj, struct attribute *attr,
 }
 EXPORT_SYMBOL(tot_pending_show);
 
+/**
+ * Show the recent write rate of the target, in bytes per second.
+ *
+ * This is the rate per-export write rates are weighed against to share grant
+ * space when the target is short of it.
+ *
+ * @kobj		kobject embedded in obd_device
+ * @attr		unused
+ * @buf			buf used by sysfs to print out data
+ *
+ * Return:		0 on success
+ *			negative value on error
+ */
+ssize_t grant_write_rate_show(struct kobject *kobj, struct attribute *attr,
+			      char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct tg_grants_data *tgd;
+	u64 rate;
+
+	tgd = &obd->u.obt.obt_lut->lut_tgd;
+	spin_lock(&tgd->tgd_grant_lock);
+	rate = tgt_write_rate_get(&tgd->tgd_write_rate);
+	spin_unlock(&tgd->tgd_grant_lock);
+
+	return scnprintf(buf, PAGE_SIZE, "%llu\n", rate);
+}
+EXPORT_SYMBOL(grant_write_rate_show);
+
 /**
  * Show if grants compatibility mode is disabled.
  *
@@ -185,12 +185,85 @@ out:
 }
 EXPORT_SYMBOL(tgt_validate_obdo);
 
+/**
+ * Unpack the obdos of a write RPC carrying several objects.
+ *
+ * The first object is described by the ost_body, as for a single object
+ * write, and the obdo array gives the attributes of all of them, its first
+ * entry is not used.  The other obdos are validated and mapped like the
+ * ost_body in tgt_ost_body_unpack(), and set the object of their ioobj,
+ * so the ioobjs are valid for the high priority checks of the OFD.
+ * Only the ost_body carries grant information.
+ *
+ * \param[in] tsi	target session environment for this request
+ * \param[in] ioo	ioobj array of the request
+ * \param[in] objcount	number of objects in the request
+ * \param[in] rnb	remote buffers of all the objects
+ * \param[in] niocount	number of remote buffers
+ *
+ * \retval		0 if successful
+ * \retval		negative value on error
+ */
+static int tgt_brw_multi_unpack(struct tgt_session_info *tsi,
+				struct obd_ioobj *ioo, int objcount,
+				struct niobuf_remote *rnb, int niocount)
+{
+	struct req_capsule *pill = tsi->tsi_pill;
+	struct lu_nodemap *nodemap;
+	struct obdo *oa;
+	int rc = 0;
+	int i;
+
+	ENTRY;
+
+	req_capsule_extend(pill, &RQF_OST_BRW_WRITE_MULTI);
+	oa = req_capsule_client_get(pill, &RMF_OBDO_ARRAY);
+	if (oa == NULL ||
+	    req_capsule_get_size(pill, &RMF_OBDO_ARRAY, RCL_CLIENT) !=
+	    objcount * sizeof(*oa))
+		RETURN(-EPROTO);
+
+	if (req_capsule_get_size(pill, &RMF_NIOBUF_REMOTE, RCL_CLIENT) !=
+	    niocount * sizeof(*rnb))
+		RETURN(-EPROTO);
+
+	/* clients never pack lockless writes, tgt_brw_lock() only locks one
+	 * object */
+	for (i = 0; i < niocount; i++)
+		if (rnb[i].rnb_flags & OBD_BRW_SRVLOCK)
+			RETURN(-EPROTO);
+
+	nodemap = nodemap_get_from_exp(tsi->tsi_exp);
+	if (IS_ERR(nodemap))
+		RETURN(PTR_ERR(nodemap));
+
+	for (i = 1; i < objcount; i++) {
+		rc = tgt_validate_obdo(tsi, &oa[i]);
+		if (rc)
+			break;
+
+		oa[i].o_uid = nodemap_map_id(nodemap, NODEMAP_UID,
+					     NODEMAP_CLIENT_TO_FS,
+					     oa[i].o_uid);
+		oa[i].o_gid = nodemap_map_id(nodemap, NODEMAP_GID,
+					     NODEMAP_CLIENT_TO_FS,
+					     oa[i].o_gid);
+		oa[i].o_valid &= ~OBD_MD_FLGRANT;
+		ioo[i].ioo_oid = oa[i].o_oi;
+	}
+	nodemap_putref(nodemap);
+
+	RETURN(rc);
+}
+
 static int tgt_io_data_unpack(struct tgt_session_info *tsi, struct ost_id *oi)
 {
 	unsigned		 max_brw;
 	struct niobuf_remote	*rnb;
 	struct obd_ioobj	*ioo;
 	int			 obj_count;
+	int			 niocount = 0;
+	int			 i;
 
 	ENTRY;
 
@@ -217,24 +290,36 @@ static int tgt_io_data_unpack(struct tgt_session_info *tsi, struct ost_id *oi)
 	if (obj_count == 0) {
 		CERROR("%s: short ioobj\n", tgt_name(tsi->tsi_tgt));
 		RETURN(-EPROTO);
-	} else if (obj_count > 1) {
+	} else if (obj_count > 1 &&
+		   !(exp_connect_brw_multi(tsi->tsi_exp) &&
+		     lustre_msg_get_opc(tgt_ses_req(tsi)->rq_reqmsg) ==
+		     OST_WRITE)) {
+		/* only writes of clients with OBD_CONNECT2_BRW_MULTI carry
+		 * several objects, see tgt_brw_write() */
 		CERROR("%s: too many ioobjs (%d)\n", tgt_name(tsi->tsi_tgt),
 		       obj_count);
 		RETURN(-EPROTO);
 	}
 
-	if (ioo->ioo_bufcnt == 0) {
-		CERROR("%s: ioo has zero bufcnt\n", tgt_name(tsi->tsi_tgt));
-		RETURN(-EPROTO);
+	for (i = 0; i < obj_count; i++) {
+		if (ioo[i].ioo_bufcnt == 0) {
+			CERROR("%s: ioo has zero bufcnt\n",
+			       tgt_name(tsi->tsi_tgt));
+			RETURN(-EPROTO);
+		}
+		niocount += ioo[i].ioo_bufcnt;
 	}
 
-	if (ioo->ioo_bufcnt > PTLRPC_MAX_BRW_PAGES) {
+	if (niocount > PTLRPC_MAX_BRW_PAGES) {
 		DEBUG_REQ(D_RPCTRACE, tgt_ses_req(tsi),
-			  "bulk has too many pages (%d)",
-			  ioo->ioo_bufcnt);
+			  "bulk has too many pages (%d)", niocount);
 		RETURN(-EPROTO);
 	}
 
+	if (obj_count > 1)
+		RETURN(tgt_brw_multi_unpack(tsi, ioo, obj_count, rnb,
+					    niocount));
+
 	RETURN(0);
 }
 
@@ -2494,6 +2579,58 @@ static void tgt_warn_on_cksum(struct ptlrpc_request *req,
 			   client_cksum, server_cksum);
 }
 
+/**
+ * Commit the objects of a multi-object write prepared by tgt_brw_write().
+ *
+ * The objects are committed in the reverse order of their preparation, as
+ * the OSD releases the pages of an object only after those of the objects
+ * prepared after it.  Every prepared object is committed even if another
+ * one fails, the overquota flags of all of them are returned to the client
+ * in \a repbody, as they all belong to the same owner.
+ *
+ * \retval		first error of \a old_rc and the commits
+ */
+static int tgt_brw_multi_commitrw(const struct lu_env *env,
+				  struct obd_export *exp,
+				  struct ost_body *repbody, struct obdo *obdos,
+				  struct obd_ioobj *ioo,
+				  struct niobuf_remote *rnb, int *obj_pages,
+				  int nprep, struct niobuf_local *lnb,
+				  int old_rc)
+{
+	__u32 quota_flags = 0;
+	int rc = old_rc;
+	int i;
+
+	for (i = 0; i < nprep; i++) {
+		rnb += ioo[i].ioo_bufcnt;
+		lnb += obj_pages[i];
+	}
+
+	for (i = nprep - 1; i >= 0; i--) {
+		struct obdo *oa = i == 0 ? &repbody->oa : &obdos[i];
+		int rc2;
+
+		rnb -= ioo[i].ioo_bufcnt;
+		lnb -= obj_pages[i];
+
+		rc2 = obd_commitrw(env, OBD_BRW_WRITE, exp, oa, 1, &ioo[i],
+				   rnb, obj_pages[i], lnb, old_rc);
+		if (rc == 0)
+			rc = rc2;
+
+		if (i > 0 && (oa->o_valid & OBD_MD_FLALLQUOTA))
+			quota_flags |= oa->o_flags & (OBD_FL_NO_USRQUOTA |
+						      OBD_FL_NO_GRPQUOTA |
+						      OBD_FL_NO_PRJQUOTA);
+	}
+
+	if (repbody->oa.o_valid & OBD_MD_FLALLQUOTA)
+		repbody->oa.o_flags |= quota_flags;
+
+	return rc;
+}
+
 int tgt_brw_write(struct tgt_session_info *tsi)
 {
 	struct ptlrpc_request	*req = tgt_ses_req(tsi);
@@ -2504,8 +2641,11 @@ int tgt_brw_write(struct tgt_session_info *tsi)
 	struct obd_ioobj	*ioo;
 	struct ost_body		*body, *repbody;
 	struct lustre_handle	 lockh = {0};
+	struct obdo		*obdos = NULL;
 	__u32			*rcs;
+	int			*obj_pages = NULL;
 	int			 objcount, niocount, npages;
+	int			 nprep = 0;
 	int			 rc, i, j;
 	enum cksum_types cksum_type = OBD_CKSUM_CRC32;
 	bool			 no_reply = false, mmap;
@@ -2570,6 +2710,20 @@ int tgt_brw_write(struct tgt_session_info *tsi)
 			sizeof(*remote_nb))
 		RETURN(err_serious(-EPROTO));
 
+	if (objcount > 1) {
+		/* unpacked by tgt_brw_multi_unpack() */
+		obdos = req_capsule_client_get(&req->rq_pill, &RMF_OBDO_ARRAY);
+		LASSERT(obdos != NULL);
+
+		OBD_ALLOC_PTR_ARRAY(obj_pages, objcount);
+		if (obj_pages == NULL)
+			RETURN(-ENOMEM);
+
+		/* each object is committed in its own transaction, the reply
+		 * must carry the transno of the last one */
+		tgt_th_info(tsi->tsi_env)->tti_mult_trans = 1;
+	}
+
 	if ((remote_nb[0].rnb_flags & OBD_BRW_MEMALLOC) &&
 	    ptlrpc_connection_is_local(exp->exp_connection))
 		mpflags = memalloc_noreclaim_save();
@@ -2618,11 +2772,36 @@ int tgt_brw_write(struct tgt_session_info *tsi)
 		GOTO(out_lock, rc = -ENOMEM);
 	repbody->oa = body->oa;
 
-	npages = PTLRPC_MAX_BRW_PAGES;
-	rc = obd_preprw(tsi->tsi_env, OBD_BRW_WRITE, exp, &repbody->oa,
-			objcount, ioo, remote_nb, &npages, local_nb);
-	if (rc < 0)
-		GOTO(out_lock, rc);
+	if (objcount == 1) {
+		npages = PTLRPC_MAX_BRW_PAGES;
+		rc = obd_preprw(tsi->tsi_env, OBD_BRW_WRITE, exp,
+				&repbody->oa, objcount, ioo, remote_nb,
+				&npages, local_nb);
+		if (rc < 0)
+			GOTO(out_lock, rc);
+	} else {
+		struct niobuf_remote *rnb = remote_nb;
+
+		/* the objects are prepared one by one, their pages follow
+		 * each other in local_nb and in the bulk, and they are
+		 * committed in the reverse order by tgt_brw_multi_commitrw() */
+		for (npages = 0; nprep < objcount; nprep++) {
+			obj_pages[nprep] = PTLRPC_MAX_BRW_PAGES - npages;
+			rc = obd_preprw(tsi->tsi_env, OBD_BRW_WRITE, exp,
+					nprep == 0 ? &repbody->oa :
+						     &obdos[nprep],
+					1, &ioo[nprep], rnb,
+					&obj_pages[nprep], local_nb + npages);
+			if (rc < 0)
+				break;
+			npages += obj_pages[nprep];
+			rnb += ioo[nprep].ioo_bufcnt;
+		}
+		if (rc < 0 && nprep == 0)
+			GOTO(out_lock, rc);
+		if (rc < 0)
+			GOTO(out_commitrw, rc);
+	}
 	if (body->oa.o_valid & OBD_MD_FLFLAGS &&
 	    body->oa.o_flags & OBD_FL_SHORT_IO) {
 		unsigned int short_io_size;
@@ -2702,8 +2881,14 @@ skip_transfer:
 
 out_commitrw:
 	/* Must commit after prep above in all cases */
-	rc = obd_commitrw(tsi->tsi_env, OBD_BRW_WRITE, exp, &repbody->oa,
-			  objcount, ioo, remote_nb, npages, local_nb, rc);
+	if (objcount == 1)
+		rc = obd_commitrw(tsi->tsi_env, OBD_BRW_WRITE, exp,
+				  &repbody->oa, objcount, ioo, remote_nb,
+				  npages, local_nb, rc);
+	else
+		rc = tgt_brw_multi_commitrw(tsi->tsi_env, exp, repbody,
+					    obdos, ioo, remote_nb, obj_pages,
+					    nprep, local_nb, rc);
 	if (rc == -ENOTCONN)
 		/* quota acquire process has been given up because
 		 * either the client has been evicted or the client
@@ -2764,6 +2949,9 @@ out:
 	if (mpflags)
 		memalloc_noreclaim_restore(mpflags);
 
+	if (obj_pages != NULL)
+		OBD_FREE_PTR_ARRAY(obj_pages, objcount);
+
 	RETURN(rc);
 }
 EXPORT_SYMBOL(tgt_brw_write);
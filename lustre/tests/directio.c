@@ -59,17 +59,18 @@ int main(int argc, char **argv)
 {
 #ifdef O_DIRECT
 	int fd;
-	char *buf, *fname;
+	char *map, *buf, *fname;
 	int blocks, seek_blocks;
 	long len;
 	off64_t seek;
+	long bufoff = 0;
 	struct stat64 st;
 	char pad = 0xba;
 	int action;
 	int rc;
 
-	if (argc < 5 || argc > 6) {
-		printf("Usage: %s <read/write/rdwr/readhole> file seek nr_blocks [blocksize]\n",
+	if (argc < 5 || argc > 7) {
+		printf("Usage: %s <read/write/rdwr/readhole> file seek nr_blocks [blocksize [buffer_offset]]\n",
 		       argv[0]);
 		return 1;
 	}
@@ -104,6 +105,9 @@ int main(int argc, char **argv)
 		return 1;
 	}
 
+	if (argc >= 7)
+		bufoff = strtoul(argv[6], 0, 0);
+
 	if (argc >= 6) {
 		st.st_blksize = strtoul(argv[5], 0, 0);
 	} else if (fstat64(fd, &st) < 0) {
@@ -117,12 +121,14 @@ int main(int argc, char **argv)
 	seek = (off64_t)seek_blocks * (off64_t)st.st_blksize;
 	len = blocks * st.st_blksize;
 
-	buf = mmap(0, len,
+	/* a non-zero buffer_offset makes the user buffer unaligned */
+	map = mmap(0, len + bufoff,
 		   PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, 0, 0);
-	if (buf == MAP_FAILED) {
+	if (map == MAP_FAILED) {
 		printf("No memory %s\n", strerror(errno));
 		return 1;
 	}
+	buf = map + bufoff;
 	memset(buf, pad, len);
 
 	if (action == O_WRONLY || action == O_RDWR) {
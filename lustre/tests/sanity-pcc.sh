@@ -143,6 +143,18 @@ check_lpcc_state()
 		"$lustre_path expected pcc state: $expected_state, but got: $state"
 }
 
+wait_lpcc_state()
+{
+	local lustre_path="$1"
+	local expected_state="$2"
+	local facet=${3:-$SINGLEAGT}
+	local cmd="$LFS pcc state $lustre_path |
+		awk -F 'type: ' '{print \$2}' | awk -F ',' '{print \$1}'"
+
+	wait_update_facet $facet "$cmd" "$expected_state" 30 ||
+		error "$lustre_path expected pcc state: $expected_state"
+}
+
 # initiate variables
 init_agt_vars
 
@@ -1485,6 +1497,61 @@ test_20() {
 }
 run_test 20 "Auto attach works after the inode was once evicted from cache"
 
+test_21() {
+	local loopfile="$TMP/$tfile"
+	local mntpt="/mnt/pcc.$tdir"
+	local hsm_root="$mntpt/$tdir"
+	local file=$DIR/$tdir/$tfile
+	local file2=$DIR2/$tdir/$tfile
+
+	setup_loopdev $SINGLEAGT $loopfile $mntpt 50
+	do_facet $SINGLEAGT mkdir -p $hsm_root ||
+		error "mkdir $hsm_root failed"
+	setup_pcc_mapping $SINGLEAGT "fname={*.ro}\ roid=5\ ropcc=1"
+
+	mkdir -p $DIR/$tdir || error "mkdir $DIR/$tdir failed"
+	do_facet $SINGLEAGT "echo -n ro_data > $file"
+	do_facet $SINGLEAGT $LFS pcc attach -r -i 5 $file ||
+		error "RO-PCC attach $file failed"
+	check_lpcc_state $file "readonly"
+	check_file_data $SINGLEAGT $file "ro_data"
+	check_lpcc_state $file "readonly"
+
+	echo "Write from another mount point invalidates the copy"
+	echo -n new_data > $file2 || error "write $file2 failed"
+	check_lpcc_state $file "none"
+	check_file_data $SINGLEAGT $file "new_data"
+
+	echo "Open for write on this client detaches the file"
+	do_facet $SINGLEAGT $LFS pcc attach -r -i 5 $file ||
+		error "RO-PCC attach $file failed"
+	check_lpcc_state $file "readonly"
+	do_facet $SINGLEAGT "echo -n local_data > $file"
+	check_lpcc_state $file "none"
+	check_file_data $SINGLEAGT $file "local_data"
+
+	echo "Read-only open attaches files matching the rule"
+	do_facet $SINGLEAGT "echo -n rule_data > $file.ro"
+	check_file_data $SINGLEAGT $file.ro "rule_data"
+	# The copy is made in the background
+	wait_lpcc_state $file.ro "readonly"
+	# Revoke the layout lock, the still valid copy is reused at open
+	do_facet $SINGLEAGT $LCTL \
+		set_param ldlm.namespaces.*mdc*.lru_size=clear
+	check_file_data $SINGLEAGT $file.ro "rule_data"
+	check_lpcc_state $file.ro "readonly"
+
+	echo "A copy made before a write is not reused"
+	echo -n new_rule_data > $file2.ro || error "write $file2.ro failed"
+	check_lpcc_state $file.ro "none"
+	check_file_data $SINGLEAGT $file.ro "new_rule_data"
+	wait_lpcc_state $file.ro "readonly"
+	check_file_data $SINGLEAGT $file.ro "new_rule_data"
+	do_facet $SINGLEAGT $LFS pcc detach $file.ro ||
+		error "PCC detach $file.ro failed"
+}
+run_test 21 "RO-PCC attach, invalidation by writers and attach at open"
+
 complete $SECONDS
 check_and_cleanup_lustre
 exit_status
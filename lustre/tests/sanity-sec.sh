@@ -4170,6 +4170,48 @@ test_56() {
 }
 run_test 56 "FIEMAP on encrypted file"
 
+test_57() {
+	local testfile=$DIR/$tdir/$tfile
+	local tmpfile=$TMP/$tfile
+	local param=/sys/module/osc/parameters/osc_brw_split_pages
+	local split
+
+	$LCTL get_param mdc.*.import | grep -q client_encryption ||
+		skip "client encryption not supported"
+
+	mount.lustre --help |& grep -q "test_dummy_encryption:" ||
+		skip "need dummy encryption support"
+
+	[[ -f $param ]] || skip "no parallel bulk encryption support"
+
+	stack_trap cleanup_for_enc_tests EXIT
+	setup_for_enc_tests
+
+	split=$(cat $param)
+	stack_trap "echo $split > $param" EXIT
+	stack_trap "rm -f $tmpfile" EXIT
+	dd if=/dev/urandom of=$tmpfile bs=1M count=16 ||
+		error "could not create $tmpfile"
+
+	# split every bulk over as many workers as possible
+	echo 1 > $param
+	dd if=$tmpfile of=$testfile bs=4M conv=fsync ||
+		error "could not write to $testfile"
+	cancel_lru_locks osc
+	cmp -bl $tmpfile $testfile || error "$testfile is corrupted"
+
+	dd if=$tmpfile of=$testfile bs=4M oflag=direct ||
+		error "could not write to $testfile with direct IO"
+	cmp -bl $tmpfile <(dd if=$testfile bs=4M iflag=direct 2>/dev/null) ||
+		error "$testfile is corrupted with direct IO"
+
+	# serial processing reads the same data
+	echo 0 > $param
+	cancel_lru_locks osc
+	cmp -bl $tmpfile $testfile || error "$testfile differs serially"
+}
+run_test 57 "encryption and decryption of bulk pages in parallel"
+
 log "cleanup: ======================================================"
 
 sec_unsetup() {
@@ -4911,6 +4911,34 @@ test_42e() { # bug22074
 }
 run_test 42e "verify sub-RPC writes are not done synchronously"
 
+test_42f() {
+	local old=$($LCTL get_param -n osc.*OST0000*.max_pages_per_rpc | head -1)
+	local size=$((32 * 1048576 + 123))
+	local sum1
+	local sum2
+
+	test_mkdir $DIR/$tdir
+	$LFS setstripe -c 1 -i 0 $DIR/$tdir || error "setstripe failed"
+
+	# small RPCs make the writer switch its active extent often, KMS must
+	# cover every extent before it is written
+	$LCTL set_param osc.*OST0000*.max_pages_per_rpc=16
+	stack_trap "$LCTL set_param osc.*OST0000*.max_pages_per_rpc=$old"
+
+	dd if=/dev/urandom of=$TMP/$tfile bs=$size count=1 iflag=fullblock ||
+		error "dd to $TMP/$tfile failed"
+	stack_trap "rm -f $TMP/$tfile"
+	cp $TMP/$tfile $DIR/$tdir/$tfile || error "cp failed"
+	sum1=$(md5sum < $TMP/$tfile)
+
+	cancel_lru_locks osc
+	(( $(stat -c %s $DIR/$tdir/$tfile) == size )) ||
+		error "size $(stat -c %s $DIR/$tdir/$tfile) != $size"
+	sum2=$(md5sum < $DIR/$tdir/$tfile)
+	[[ "$sum1" == "$sum2" ]] || error "data mismatch"
+}
+run_test 42f "KMS of streaming writes across many extents"
+
 test_43A() { # was test_43
 	test_mkdir $DIR/$tdir
 	cp -p /bin/ls $DIR/$tdir/$tfile
@@ -5012,6 +5040,45 @@ test_44a() {
 }
 run_test 44a "test sparse pwrite ==============================="
 
+test_44b() {
+	local ref=$TMP/$tfile.ref
+	local size=32
+	local pids=()
+	local flag
+	local off
+	local len
+	local i
+
+	dd if=/dev/urandom of=$ref bs=1M count=$size || error "dd ref failed"
+	stack_trap "rm -f $ref"
+	$TRUNCATE $DIR/$tfile $((size * 1048576)) || error "truncate failed"
+
+	# disjoint and overlapping writes of the same data, small ones lock a
+	# single region of the range lock tree, large ones several regions
+	for ((i = 0; i < size * 2; i++)); do
+		off=$(( (i * 128) % (size * 256) ))
+		len=$(( i % 4 == 0 ? 768 : 128 ))
+		(( off + len > size * 256 )) && len=$((size * 256 - off))
+		flag=direct
+		(( i % 3 == 0 )) && flag=sync
+		dd if=$ref of=$DIR/$tfile bs=4k skip=$off seek=$off count=$len \
+			conv=notrunc oflag=$flag 2>/dev/null &
+		pids+=($!)
+	done
+	# direct reads take the range lock shared
+	for ((i = 0; i < 8; i++)); do
+		dd if=$DIR/$tfile of=/dev/null bs=1M iflag=direct \
+			2>/dev/null &
+		pids+=($!)
+	done
+	for i in ${pids[@]}; do
+		wait $i || error "IO $i failed"
+	done
+
+	cmp $ref $DIR/$tfile || error "data mismatch"
+}
+run_test 44b "concurrent overlapping writes to one file"
+
 dirty_osc_total() {
 	tot=0
 	for d in `lctl get_param -n ${OSC}.*.cur_dirty_bytes`; do
@@ -5403,6 +5470,96 @@ test_51f() {
 }
 run_test 51f "check many open files limit"
 
+test_51g() {
+	local count=500
+	local saved
+	local nr
+
+	$LCTL get_param -n mdc.*.connect_flags | grep -qw md_wbc ||
+		skip "MDS does not support metadata write-back cache"
+
+	saved=$($LCTL get_param -n llite.*.wbc_enable | head -n 1)
+	stack_trap "$LCTL set_param llite.*.wbc_enable=$saved"
+	$LCTL set_param llite.*.wbc_enable=1
+	$LCTL set_param llite.*.stats=clear
+
+	# plain directory, owned by this client once created
+	mkdir $DIR/$tdir || error "mkdir $tdir failed"
+	mkdir $DIR/$tdir/sub || error "mkdir sub failed"
+	createmany -m $DIR/$tdir/sub/f $count ||
+		error "mknod $count files failed"
+	createmany -d $DIR/$tdir/sub/d 10 || error "mkdir 10 dirs failed"
+
+	$LCTL get_param -n llite.*.stats | grep -q wbc_create ||
+		error "no write-back creates"
+
+	nr=$(ls $DIR/$tdir/sub | wc -l)
+	(( nr == count + 10 )) || error "ls found $nr of $((count + 10))"
+
+	# names dropped from the dcache are still found on the MDT
+	echo 2 > /proc/sys/vm/drop_caches
+	mkdir $DIR/$tdir/sub/f0 2>/dev/null &&
+		error "mkdir over existing f0 succeeded"
+	mknod $DIR/$tdir/sub/d0 p 2>/dev/null &&
+		error "mknod over existing d0 succeeded"
+
+	# another client takes the directory, the creates are flushed
+	if [[ -n "$MOUNT2" ]] && is_mounted $MOUNT2; then
+		nr=$(ls $DIR2/$tdir/sub | wc -l)
+		(( nr == count + 10 )) ||
+			error "$DIR2 found $nr of $((count + 10))"
+	fi
+
+	chmod 0600 $DIR/$tdir/sub/f0 || error "chmod f0 failed"
+	rm -rf $DIR/$tdir || error "rm $tdir failed"
+}
+run_test 51g "metadata write-back cache creates"
+
+test_51h() {
+	local saved
+
+	$LCTL get_param -n mdc.*.connect_flags | grep -q wbc ||
+		skip "MDS does not support metadata write-back cache"
+
+	saved=$($LCTL get_param -n llite.*.wbc_enable | head -n 1)
+	stack_trap "$LCTL set_param llite.*.wbc_enable=$saved"
+	$LCTL set_param llite.*.wbc_enable=1
+
+	mkdir $DIR/$tdir || error "mkdir $tdir failed"
+	mkdir $DIR/$tdir/sub || error "mkdir sub failed"
+	$MULTIOP $DIR/$tdir/sub Dyc || error "fsync of sub failed"
+
+	# the create fails on the MDT after mkdir returned
+	#define OBD_FAIL_MDS_REINT_CREATE	0x10b
+	do_facet mds1 $LCTL set_param fail_loc=0x8000010b
+	stack_trap "do_facet mds1 $LCTL set_param fail_loc=0"
+	mkdir $DIR/$tdir/sub/d0 || error "write-back mkdir d0 failed"
+
+	$MULTIOP $DIR/$tdir/sub Dyc &&
+		error "fsync of sub did not return the failed create"
+	do_facet mds1 $LCTL set_param fail_loc=0
+
+	# the error is returned once
+	$MULTIOP $DIR/$tdir/sub Dyc || error "second fsync of sub failed"
+	[[ -e $DIR/$tdir/sub/d0 ]] && error "failed create d0 still exists"
+
+	mkdir $DIR/$tdir/sub/d1 || error "mkdir d1 failed"
+	$MULTIOP $DIR/$tdir/sub Dyc || error "fsync after d1 failed"
+	[[ -d $DIR/$tdir/sub/d1 ]] || error "d1 does not exist"
+
+	# close of the directory returns the error as well
+	do_facet mds1 $LCTL set_param fail_loc=0x8000010b
+	mkdir $DIR/$tdir/sub/d2 || error "write-back mkdir d2 failed"
+	# stat waits for the create of d2
+	stat $DIR/$tdir/sub/d2 && error "failed create d2 still exists"
+	do_facet mds1 $LCTL set_param fail_loc=0
+	$MULTIOP $DIR/$tdir/sub Dc &&
+		error "close of sub did not return the failed create"
+
+	rm -rf $DIR/$tdir || error "rm $tdir failed"
+}
+run_test 51h "metadata write-back cache reports failed creates"
+
 test_52a() {
 	[ -f $DIR/$tdir/foo ] && chattr -a $DIR/$tdir/foo
 	test_mkdir $DIR/$tdir
@@ -8136,6 +8293,66 @@ test_64f() {
 }
 run_test 64f "check grant consumption (with grant allocation)"
 
+test_64g() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+
+	local osc_tgt="$FSNAME-OST0000-osc-$($LFS getname -i $DIR)"
+	local nr=$(( $(nproc) * 2 ))
+	local pids=()
+	local dirty
+	local i
+
+	test_mkdir $DIR/$tdir
+	$LFS setstripe -c 1 -i 0 $DIR/$tdir || error "setstripe failed"
+
+	# writers to different objects on the same OST take dirty page and
+	# grant credits in batches, which must all be given back
+	for ((i = 0; i < nr; i++)); do
+		dd if=/dev/zero of=$DIR/$tdir/$tfile.$i bs=1M count=8 \
+			2>/dev/null &
+		pids+=($!)
+	done
+	for i in ${pids[@]}; do
+		wait $i || error "write $i failed"
+	done
+	sync
+
+	dirty=$($LCTL get_param -n osc.$osc_tgt.cur_dirty_bytes)
+	(( dirty == 0 )) || error "$dirty dirty bytes left after sync"
+	dirty=$($LCTL get_param -n osc.$osc_tgt.cur_dirty_grant_bytes)
+	(( dirty == 0 )) || error "$dirty dirty grant bytes left after sync"
+}
+run_test 64g "dirty and grant accounting of concurrent writers"
+
+test_64h() {
+	do_facet ost1 $LCTL get_param -n \
+		obdfilter.$FSNAME-OST0000.grant_write_rate &> /dev/null ||
+		skip "OST does not track write rates for grant"
+
+	local rate
+
+	$LFS setstripe -c 1 -i 0 $DIR/$tfile || error "setstripe failed"
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=16 conv=fsync ||
+		error "first write failed"
+	# a new writer has a rate as soon as it writes, not after 5s
+	rate=$(do_facet ost1 $LCTL get_param -n \
+		obdfilter.$FSNAME-OST0000.exports.*.export |
+		awk '/write_rate:/ { if ($2 > max) max = $2 } END { print max+0 }')
+	(( rate > 0 )) || error "export write rate $rate after first write"
+	# the rate is folded into the average once the 5s period is over
+	sleep 6
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=1 seek=16 conv=fsync ||
+		error "second write failed"
+
+	rate=$(do_facet ost1 $LCTL get_param -n \
+		obdfilter.$FSNAME-OST0000.grant_write_rate)
+	(( rate > 0 )) || error "OST write rate $rate after writes"
+
+	do_facet ost1 $LCTL get_param obdfilter.$FSNAME-OST0000.exports.*.export |
+		grep -q "dirty_pct_hist:" || error "no grant efficiency in exports"
+}
+run_test 64h "OST tracks write rate and grant efficiency for grant sharing"
+
 # bug 1414 - set/get directories' stripe info
 test_65a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
@@ -9096,6 +9313,45 @@ test_77l() {
 }
 run_test 77l "preferred checksum type is remembered after reconnected"
 
+test_77m() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+	$GSS && skip_env "could not run with gss"
+
+	local param=/sys/module/osc/parameters/osc_brw_split_pages
+	local split
+	local algo
+
+	[[ -f $param ]] || skip "no parallel bulk checksum support"
+	[[ " $CKSUM_TYPES " =~ " t10" ]] || skip "no T10-PI checksum type"
+
+	[ ! -f $F77_TMP ] && setup_f77
+	split=$(cat $param)
+	stack_trap "echo $split > $param" EXIT
+	set_checksums 1
+	stack_trap "set_checksums $ORIG_CSUM" EXIT
+	stack_trap "set_checksum_type $ORIG_CSUM_TYPE" EXIT
+
+	for algo in $CKSUM_TYPES; do
+		[[ $algo == t10* ]] || continue
+		set_checksum_type $algo || error "fail to set checksum type $algo"
+
+		# generate the guard tags of every bulk on many workers
+		echo 1 > $param
+		dd if=$F77_TMP of=$DIR/$tfile bs=1M count=$F77SZ conv=fsync ||
+			error "dd error with $algo"
+		cancel_lru_locks osc
+		cmp $F77_TMP $DIR/$tfile || error "file compare failed, $algo"
+
+		# serial checksums verify the same data
+		echo 0 > $param
+		cancel_lru_locks osc
+		cmp $F77_TMP $DIR/$tfile ||
+			error "serial file compare failed, $algo"
+	done
+	rm -f $DIR/$tfile
+}
+run_test 77m "T10-PI guard tags generated in parallel"
+
 [ "$ORIG_CSUM" ] && set_checksums $ORIG_CSUM || true
 rm -f $F77_TMP
 unset F77_TMP
@@ -9779,6 +10035,97 @@ test_101j() {
 }
 run_test 101j "A complete read block should be submitted when no RA"
 
+test_101k() {
+	local rows=32
+	local hit
+	local miss
+
+	$LFS setstripe -c 1 $DIR/$tfile || error "setstripe $DIR/$tfile failed"
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=$rows ||
+		error "dd $DIR/$tfile failed"
+	cancel_lru_locks osc
+	$LCTL set_param -n llite.*.read_ahead_stats=0
+
+	# 2-D nested stride on one file descriptor: every other page of the
+	# first 8 pages in each 1MiB row, each dd skips from the last read
+	local row_pages=$((1048576 / PAGE_SIZE))
+	local skip
+
+	exec 3< $DIR/$tfile
+	for ((i = 0; i < rows; i++)); do
+		for ((j = 0; j < 4; j++)); do
+			if ((j > 0)); then
+				skip=1
+			elif ((i > 0)); then
+				skip=$((row_pages - 7))
+			else
+				skip=0
+			fi
+			dd bs=$PAGE_SIZE count=1 skip=$skip of=/dev/null \
+				<&3 2>/dev/null ||
+				error "read row $i column $j failed"
+		done
+	done
+	exec 3<&-
+
+	$LCTL get_param llite.*.read_ahead_stats
+	hit=$($LCTL get_param -n llite.*.read_ahead_stats |
+	      get_named_value 'pattern nested hit' | cut -d" " -f1 | calc_total)
+	miss=$($LCTL get_param -n llite.*.read_ahead_stats |
+	       get_named_value 'pattern nested miss' | cut -d" " -f1 |
+	       calc_total)
+	(( ${hit:-0} > ${miss:-0} )) ||
+		error "nested stride predicted ${hit:-0} reads, missed ${miss:-0}"
+	rm -f $DIR/$tfile
+}
+run_test 101k "read-ahead detects nested stride reads"
+
+test_101l() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+
+	local cache_limit=64
+	local nfiles=$(( $(nproc) > 8 ? 8 : $(nproc) ))
+	local pids=()
+	local used
+	local i
+
+	(( nfiles > 1 )) || skip "need more than one CPU"
+
+	test_mkdir $DIR/$tdir
+	$LFS setstripe -c 1 -i 0 $DIR/$tdir || error "setstripe failed"
+	for ((i = 0; i < nfiles; i++)); do
+		dd if=/dev/zero of=$DIR/$tdir/$tfile.$i bs=1M count=32 ||
+			error "dd to $tfile.$i failed"
+	done
+	sync
+
+	stack_trap "$LCTL set_param -n llite.*.max_cached_mb $CACHE_MAX"
+	$LCTL set_param -n llite.*.max_cached_mb $cache_limit
+	cancel_lru_locks osc
+
+	# pages read on different CPUs go to different LRU lists, reclaim
+	# has to drain all of them to stay within the cache limit
+	for ((i = 0; i < nfiles; i++)); do
+		dd if=$DIR/$tdir/$tfile.$i of=/dev/null bs=1M &
+		pids+=($!)
+	done
+	for i in ${pids[@]}; do
+		wait $i || error "read $i failed"
+	done
+	$LCTL get_param osc.*OST0000*.osc_cached_mb
+
+	used=$($LCTL get_param -n osc.*OST0000*.osc_cached_mb |
+	       awk '/used_mb/ { print $2 }' | head -1)
+	(( used <= cache_limit )) ||
+		error "$used MB cached over the $cache_limit MB limit"
+
+	$LCTL set_param osc.*OST0000*.osc_cached_mb=0
+	used=$($LCTL get_param -n osc.*OST0000*.osc_cached_mb |
+	       awk '/used_mb/ { print $2 }' | head -1)
+	(( used == 0 )) || error "$used MB still cached after shrink"
+}
+run_test 101l "cached pages are reclaimed from all LRU lists"
+
 setup_test102() {
 	test_mkdir $DIR/$tdir
 	chown $RUNAS_ID $DIR/$tdir
@@ -10754,6 +11101,57 @@ test_115() {
 }
 run_test 115 "verify dynamic thread creation===================="
 
+test_115b() {
+	remote_ost_nodsh && skip "remote OST with nodsh"
+
+	local param="ost.OSS.ost_io"
+	local facets=$(get_facets OST)
+	local save_params="$TMP/sanity-$TESTNAME.parameters"
+	local thread_min
+	local thread_peak
+	local thread_started
+
+	do_facet ost1 "$LCTL get_param -n $param.threads_delay_target_us" \
+		&> /dev/null || skip "ost_io has no thread delay target"
+
+	save_lustre_params $facets "$param.threads_delay_target_us" > \
+		$save_params
+	stack_trap "restore_lustre_params < $save_params; rm -f $save_params"
+
+	# a one second delay target is never reached once the I/O is done
+	do_nodes $(comma_list $(osts_nodes)) \
+		"$LCTL set_param $param.threads_delay_target_us=1000000" ||
+		error "set threads_delay_target_us failed"
+
+	thread_min=$(do_facet ost1 \
+		"$LCTL get_param -n $param.threads_min")
+
+	test_mkdir $DIR/$tdir
+	for i in $(seq 32); do
+		$LFS setstripe -c 1 -i 0 $DIR/$tdir/$tfile-$i
+		dd if=/dev/zero of=$DIR/$tdir/$tfile-$i bs=1M count=32 \
+			oflag=direct &
+	done
+	wait
+	thread_peak=$(do_facet ost1 \
+		"$LCTL get_param -n $param.threads_started")
+	echo "threads_min $thread_min, $thread_peak started after I/O"
+	do_facet ost1 "$LCTL get_param -n $param.thread_pool"
+
+	(( thread_peak > thread_min )) ||
+		skip "ost_io did not grow beyond threads_min"
+
+	wait_update_facet ost1 \
+		"$LCTL get_param -n $param.threads_started" \
+		$thread_min 120 || {
+		do_facet ost1 "$LCTL get_param -n $param.thread_pool"
+		error "idle ost_io threads were not retired"
+	}
+	do_facet ost1 "$LCTL get_param -n $param.thread_pool" |
+		grep -q "shrunk: [1-9]" || error "no thread retirement recorded"
+}
+run_test 115b "retire idle service threads toward the delay target"
+
 free_min_max () {
 	wait_delete_completed
 	AVAIL=($(lctl get_param -n osc.*[oO][sS][cC]-[^M]*.kbytesavail))
@@ -11429,6 +11827,149 @@ test_119d() # bug 15950
 }
 run_test 119d "The DIO path should try to send a new rpc once one is completed"
 
+test_119e()
+{
+	local bsize=$((1024 * 1024))
+	local after
+
+	$LCTL set_param llite.*.stats=clear
+	$DIRECTIO write $DIR/$tfile 0 4 $bsize 1 ||
+		error "unaligned buffer directio write failed"
+	$DIRECTIO read $DIR/$tfile 0 4 $bsize 3 ||
+		error "unaligned buffer directio read failed"
+	$DIRECTIO read $DIR/$tfile 0 4 $bsize ||
+		error "aligned buffer directio read failed"
+
+	after=$($LCTL get_param -n llite.*.stats |
+		awk '/dio_bounce_bytes/ { print $7 }' | head -n 1)
+	(( ${after:-0} == 8 * bsize )) ||
+		error "bounced ${after:-0} bytes, expected $((8 * bsize))"
+	rm -f $DIR/$tfile
+}
+run_test 119e "Direct IO with unaligned user buffer goes through bounce pages"
+
+test_119f()
+{
+	local hybrid=$($LCTL get_param -n llite.*.hybrid_io | head -n 1)
+	local rthresh=$($LCTL get_param -n \
+		llite.*.hybrid_io_read_threshold_mb | head -n 1)
+	local wthresh=$($LCTL get_param -n \
+		llite.*.hybrid_io_write_threshold_mb | head -n 1)
+	local bsize=$((4 * 1024 * 1024))
+	local written
+	local read
+
+	[[ -n "$hybrid" ]] || skip "client does not support hybrid IO"
+	$LCTL set_param llite.*.hybrid_io=1 ||
+		skip "hybrid IO not supported by this kernel"
+	stack_trap "$LCTL set_param llite.*.hybrid_io=$hybrid" EXIT
+	stack_trap "$LCTL set_param \
+		llite.*.hybrid_io_read_threshold_mb=$rthresh \
+		llite.*.hybrid_io_write_threshold_mb=$wthresh" EXIT
+	$LCTL set_param llite.*.hybrid_io_read_threshold_mb=4 \
+		llite.*.hybrid_io_write_threshold_mb=4
+
+	dd if=/dev/urandom of=$TMP/$tfile bs=$bsize count=2 ||
+		error "dd to $TMP/$tfile failed"
+	stack_trap "rm -f $TMP/$tfile" EXIT
+
+	$LCTL set_param llite.*.stats=clear
+	# small writes stay buffered, large ones are done as direct IO
+	dd if=$TMP/$tfile of=$DIR/$tfile bs=64k count=64 conv=notrunc ||
+		error "small write failed"
+	dd if=$TMP/$tfile of=$DIR/$tfile bs=$bsize count=2 conv=notrunc ||
+		error "large write failed"
+	cancel_lru_locks osc
+	dd if=$DIR/$tfile of=/dev/null bs=$bsize count=2 ||
+		error "large read failed"
+	cmp $TMP/$tfile $DIR/$tfile || error "data mismatch"
+
+	written=$($LCTL get_param -n llite.*.stats |
+		awk '/hybrid_write_bytes/ { print $7 }' | head -n 1)
+	(( ${written:-0} == 2 * bsize )) ||
+		error "hybrid IO wrote ${written:-0} bytes, expected $((2 * bsize))"
+	read=$($LCTL get_param -n llite.*.stats |
+		awk '/hybrid_read_bytes/ { print $7 }' | head -n 1)
+	(( ${read:-0} >= 2 * bsize )) ||
+		error "hybrid IO read ${read:-0} bytes, expected $((2 * bsize))"
+	rm -f $DIR/$tfile
+}
+run_test 119f "large buffered IO is switched to direct IO by hybrid IO"
+
+test_119g()
+{
+	(( OSTCOUNT >= 2 )) || skip_env "needs >= 2 OSTs"
+
+	local pio=$($LCTL get_param -n llite.*.pio | head -n 1)
+	local thresh=$($LCTL get_param -n llite.*.pio_threshold_mb |
+		head -n 1)
+	local bsize=$((8 * 1024 * 1024))
+	local written
+	local read
+
+	[[ -n "$pio" ]] || skip "client does not support parallel IO"
+	$LCTL set_param llite.*.pio=1 ||
+		skip "parallel IO not supported by this kernel"
+	stack_trap "$LCTL set_param llite.*.pio=$pio" EXIT
+	stack_trap "$LCTL set_param llite.*.pio_threshold_mb=$thresh" EXIT
+	$LCTL set_param llite.*.pio_threshold_mb=8
+
+	dd if=/dev/urandom of=$TMP/$tfile bs=$bsize count=4 ||
+		error "dd to $TMP/$tfile failed"
+	stack_trap "rm -f $TMP/$tfile" EXIT
+
+	$LFS setstripe -c -1 -S 1M $DIR/$tfile ||
+		error "setstripe $DIR/$tfile failed"
+	$LCTL set_param llite.*.stats=clear
+	dd if=$TMP/$tfile of=$DIR/$tfile bs=$bsize count=4 conv=notrunc ||
+		error "large write failed"
+	cancel_lru_locks osc
+	# readahead may bring in pages served by fast read, so only check
+	# that some of the data was read in parallel
+	dd if=$DIR/$tfile of=/dev/null bs=$bsize count=4 ||
+		error "large read failed"
+	cmp $TMP/$tfile $DIR/$tfile || error "data mismatch"
+
+	written=$($LCTL get_param -n llite.*.stats |
+		awk '/pio_write_bytes/ { print $7 }' | head -n 1)
+	(( ${written:-0} == 4 * bsize )) ||
+		error "parallel IO wrote ${written:-0} bytes, expected $((4 * bsize))"
+	read=$($LCTL get_param -n llite.*.stats |
+		awk '/pio_read_bytes/ { print $7 }' | head -n 1)
+	(( ${read:-0} > 0 )) || error "no parallel IO read"
+	rm -f $DIR/$tfile
+}
+run_test 119g "large buffered IO is split over stripes by parallel IO"
+
+test_119h()
+{
+	local tmp=$TMP/$tfile
+	local bs=6000
+	local count=1000
+
+	stack_trap "rm -f $tmp $tmp.new $tmp.read"
+	dd if=/dev/urandom of=$tmp bs=1M count=9 || error "create $tmp failed"
+	cp $tmp $DIR/$tfile || error "copy to $DIR/$tfile failed"
+
+	# offsets and lengths aren't page aligned, and the IO is split into
+	# several rounds of bounce pages
+	dd if=/dev/urandom of=$tmp.new bs=$bs count=$count ||
+		error "create $tmp.new failed"
+	dd if=$tmp.new of=$tmp bs=$bs seek=1 conv=notrunc ||
+		error "update $tmp failed"
+	dd if=$tmp.new of=$DIR/$tfile bs=$bs seek=1 oflag=direct \
+		conv=notrunc || error "unaligned offset directio write failed"
+	cancel_lru_locks osc
+	cmp $tmp $DIR/$tfile ||
+		error "data mismatch after unaligned offset directio write"
+
+	dd if=$DIR/$tfile of=$tmp.read bs=$bs skip=3 count=$count \
+		iflag=direct || error "unaligned offset directio read failed"
+	cmp -n $((bs * count)) $tmp $tmp.read $((bs * 3)) 0 ||
+		error "data mismatch after unaligned offset directio read"
+}
+run_test 119h "Direct IO at unaligned file offset goes through bounce pages"
+
 test_120a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
 	remote_mds_nodsh && skip "remote MDS with nodsh"
@@ -13218,6 +13759,34 @@ test_133h() {
 }
 run_test 133h "Proc files should end with newlines"
 
+test_133i() {
+	remote_ost_nodsh && skip "remote OST with nodsh"
+
+	local param="ost.OSS.ost_io.req_latency"
+	local phase
+
+	do_facet ost1 "$LCTL get_param -n $param" &> /dev/null ||
+		skip "ost_io has no request latency histograms"
+
+	do_facet ost1 "$LCTL set_param $param=clear" ||
+		error "clear $param failed"
+
+	$LFS setstripe -c 1 -i 0 $DIR/$tfile
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=4 oflag=direct ||
+		error "dd failed"
+
+	do_facet ost1 "$LCTL get_param -n $param"
+	for phase in enqueue nrs_wait handler reply_send; do
+		do_facet ost1 "$LCTL get_param -n $param" |
+			awk -v phase="  $phase:" '
+				/^[a-z]/ { opc = $1 }
+				opc == "ost_write:" && $0 == phase { found = 1 }
+				END { exit !found }' ||
+			error "no ost_write $phase samples"
+	done
+}
+run_test 133i "Verifying per-opcode request latency histograms"
+
 test_134a() {
 	remote_mds_nodsh && skip "remote MDS with nodsh"
 	[[ $MDS1_VERSION -lt $(version_code 2.7.54) ]] &&
@@ -19398,6 +19967,172 @@ test_248b() {
 }
 run_test 248b "test short_io read and write for both small and large sizes"
 
+test_248c() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+
+	local osc=$($LCTL dl | awk '/OST0000-osc-[^M]/ { print $4 }')
+	local nfiles=64
+	local before
+	local rpcs
+	local save
+	local i
+
+	$LCTL get_param -n osc.$osc.import | grep -q brw_multi ||
+		skip "server does not support multi-object writes"
+
+	save=$($LCTL get_param -n osc.$osc.brw_multi_objects)
+	stack_trap "$LCTL set_param osc.$osc.brw_multi_objects=$save" EXIT
+
+	$LCTL set_param osc.$osc.brw_multi_objects=0 &&
+		error "brw_multi_objects=0 allowed"
+	$LCTL set_param osc.$osc.brw_multi_objects=16 ||
+		error "set brw_multi_objects failed"
+
+	test_mkdir $DIR/$tdir
+	$LFS setstripe -c 1 -i 0 $DIR/$tdir
+	dd if=/dev/urandom of=$TMP/$tfile bs=4k count=1 ||
+		error "dd to $TMP/$tfile failed"
+	stack_trap "rm -f $TMP/$tfile" EXIT
+	cancel_lru_locks osc
+
+	before=$($LCTL get_param -n osc.$osc.stats |
+		 awk '/ost_write/ { print $2 }')
+	for ((i = 0; i < nfiles; i++)); do
+		cp $TMP/$tfile $DIR/$tdir/f$i || error "cp to f$i failed"
+	done
+	sync
+	rpcs=$(( $($LCTL get_param -n osc.$osc.stats |
+		    awk '/ost_write/ { print $2 }') - ${before:-0} ))
+	echo "$nfiles small files written with $rpcs write RPCs"
+	(( rpcs < nfiles )) ||
+		error "$rpcs write RPCs for $nfiles files"
+
+	cancel_lru_locks osc
+	for ((i = 0; i < nfiles; i++)); do
+		cmp $TMP/$tfile $DIR/$tdir/f$i || error "compare f$i failed"
+	done
+}
+run_test 248c "small writes of several objects share write RPCs"
+
+ost_busy_objects() {
+	do_facet ost1 $LCTL get_param -n obdfilter.$FSNAME-OST0000.site_stats |
+		awk -F/ '{ print $1 }'
+}
+
+test_248d() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+	remote_ost_nodsh && skip "remote OST with nodsh"
+
+	local osc=$($LCTL dl | awk '/OST0000-osc-[^M]/ { print $4 }')
+	local nfiles=32
+	local busy_before
+	local busy
+	local save
+	local i
+
+	$LCTL get_param -n osc.$osc.import | grep -q brw_multi ||
+		skip "server does not support multi-object writes"
+
+	save=$($LCTL get_param -n osc.$osc.brw_multi_objects)
+	stack_trap "$LCTL set_param osc.$osc.brw_multi_objects=$save" EXIT
+	$LCTL set_param osc.$osc.brw_multi_objects=16 ||
+		error "set brw_multi_objects failed"
+
+	test_mkdir $DIR/$tdir
+	$LFS setstripe -c 1 -i 0 $DIR/$tdir
+	# a different content for each file, at different offsets
+	for ((i = 0; i < nfiles; i++)); do
+		dd if=/dev/urandom of=$TMP/$tfile.$i bs=4k count=1 \
+			2> /dev/null || error "dd to $TMP/$tfile.$i failed"
+	done
+	stack_trap "rm -f $TMP/$tfile.*" EXIT
+	cancel_lru_locks osc
+	sync
+	busy_before=$(ost_busy_objects)
+
+	for ((i = 0; i < nfiles; i++)); do
+		dd if=$TMP/$tfile.$i of=$DIR/$tdir/f$i bs=4k seek=$((i % 4)) \
+			conv=notrunc 2> /dev/null || error "write to f$i failed"
+	done
+	sync
+
+	# drop the client cache so the data is read back from the OST
+	cancel_lru_locks osc
+	for ((i = 0; i < nfiles; i++)); do
+		(( $(stat -c %s $DIR/$tdir/f$i) == (i % 4 + 1) * 4096 )) ||
+			error "f$i has size $(stat -c %s $DIR/$tdir/f$i)"
+		cmp -n 4096 $TMP/$tfile.$i $DIR/$tdir/f$i 0 $((i % 4 * 4096)) ||
+			error "compare f$i failed"
+	done
+
+	# the OST must have dropped the references it took on every object
+	for ((i = 0; i < 10; i++)); do
+		busy=$(ost_busy_objects)
+		(( busy <= busy_before )) && break
+		sleep 1
+	done
+	echo "busy OST objects: $busy_before before writes, $busy after"
+	(( busy < busy_before + nfiles / 2 )) ||
+		error "OST objects still referenced: $busy, was $busy_before"
+}
+run_test 248d "data and object references of multi-object writes"
+
+test_248e() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+	remote_ost_nodsh && skip "remote OST with nodsh"
+
+	local p="$TMP/$TESTSUITE-$TESTNAME.parameters"
+	local osc=$($LCTL dl | awk '/OST0000-osc-[^M]/ { print $4 }')
+	local nfiles=64
+	local before
+	local rpcs
+	local save
+	local i
+
+	$LCTL get_param -n osc.$osc.import | grep -q brw_multi ||
+		skip "server does not support multi-object writes"
+
+	save=$($LCTL get_param -n osc.$osc.brw_multi_objects)
+	stack_trap "$LCTL set_param osc.$osc.brw_multi_objects=$save" EXIT
+	$LCTL set_param osc.$osc.brw_multi_objects=16 ||
+		error "set brw_multi_objects failed"
+
+	# without the page cache the OST writes every object of the RPC
+	# through its private pages, held until all of them are committed
+	save_lustre_params $(get_facets OST) \
+		"osd-*.*.read_cache_enable" > $p
+	save_writethrough $p.wt
+	stack_trap "restore_lustre_params < $p; rm -f $p" EXIT
+	stack_trap "restore_lustre_params < $p.wt; rm -f $p.wt" EXIT
+	set_cache read off
+	set_cache writethrough off
+
+	test_mkdir $DIR/$tdir
+	$LFS setstripe -c 1 -i 0 $DIR/$tdir
+	dd if=/dev/urandom of=$TMP/$tfile bs=4k count=1 ||
+		error "dd to $TMP/$tfile failed"
+	stack_trap "rm -f $TMP/$tfile" EXIT
+	cancel_lru_locks osc
+
+	before=$($LCTL get_param -n osc.$osc.stats |
+		 awk '/ost_write/ { print $2 }')
+	for ((i = 0; i < nfiles; i++)); do
+		cp $TMP/$tfile $DIR/$tdir/f$i || error "cp to f$i failed"
+	done
+	sync
+	rpcs=$(( $($LCTL get_param -n osc.$osc.stats |
+		    awk '/ost_write/ { print $2 }') - ${before:-0} ))
+	echo "$nfiles small files written with $rpcs write RPCs"
+	(( rpcs < nfiles )) ||
+		error "$rpcs write RPCs for $nfiles files"
+
+	cancel_lru_locks osc
+	for ((i = 0; i < nfiles; i++)); do
+		cmp $TMP/$tfile $DIR/$tdir/f$i || error "compare f$i failed"
+	done
+}
+run_test 248e "multi-object writes without OST writethrough cache"
+
 test_249() { # LU-7890
 	[ $MDS1_VERSION -lt $(version_code 2.8.53) ] &&
 		skip "Need at least version 2.8.54"
@@ -22442,9 +23177,23 @@ test_398d() { #  LU-13846
 
 	diff $DIR/$tfile $aio_file || "file diff after aiocp"
 
-	# make sure we don't crash and fail properly
-	aiocp -a 512 -b 64M -s 64M -f O_DIRECT $DIR/$tfile $aio_file &&
-		error "aio not aligned with PAGE SIZE should fail"
+	# buffers not aligned with PAGE_SIZE go through bounce pages
+	rm -f $aio_file
+	aiocp -a 512 -b 64M -s 64M -f O_DIRECT $DIR/$tfile $aio_file ||
+		error "aio not aligned with PAGE SIZE failed"
+	diff $DIR/$tfile $aio_file || error "file diff after unaligned aiocp"
+
+	# with few bounce pages the rounds have to wait for each other
+	local bounce_max=$($LCTL get_param -n llite.*.dio_bounce_max_mb |
+			   head -n 1)
+
+	stack_trap "$LCTL set_param llite.*.dio_bounce_max_mb=$bounce_max"
+	$LCTL set_param llite.*.dio_bounce_max_mb=4
+	rm -f $aio_file
+	aiocp -a 512 -b 64M -s 64M -f O_DIRECT $DIR/$tfile $aio_file ||
+		error "aio with dio_bounce_max_mb=4 failed"
+	diff $DIR/$tfile $aio_file ||
+		error "file diff after aiocp with dio_bounce_max_mb=4"
 
 	rm -rf $DIR/$tfile $aio_file
 }
@@ -24083,6 +24832,68 @@ test_431() { # LU-14187
 }
 run_test 431 "Restart transaction for IO"
 
+# sum of field $1 of the ptlrpcd threads of the client
+ptlrpcd_stat_sum() {
+	$LCTL get_param -n ptlrpcd_stats |
+		awk -v f="$1:" '{ for (i = 1; i < NF; i++)
+					if ($i == f) { v = $(i + 1);
+						       sub(/,/, "", v);
+						       sum += v } }
+				END { print sum + 0 }'
+}
+
+ptlrpcd_load_432() {
+	local i
+
+	for ((i = 0; i < 4; i++)); do
+		dd if=/dev/zero of=$DIR/$tdir/$tfile.$i bs=1M count=64 \
+			2> /dev/null || error "dd to $tfile.$i failed"
+	done
+	sync
+	rm -f $DIR/$tdir/$tfile.*
+}
+
+test_432() {
+	local param=/sys/module/ptlrpc/parameters/ptlrpcd_steal_depth
+	local nthreads
+	local steals
+	local others
+	local save
+
+	$LCTL get_param -n ptlrpcd_stats &> /dev/null ||
+		skip "no ptlrpcd_stats on the client"
+	[[ -w $param ]] || skip "no ptlrpcd_steal_depth on the client"
+	nthreads=$($LCTL get_param -n ptlrpcd_stats | wc -l)
+	(( nthreads > 2 )) || skip "only $nthreads ptlrpcd threads"
+
+	save=$(cat $param)
+	stack_trap "echo $save > $param" EXIT
+
+	test_mkdir $DIR/$tdir
+	$LFS setstripe -c -1 $DIR/$tdir || error "setstripe failed"
+
+	# idle threads take work from any thread with a queued RPC
+	echo 1 > $param
+	steals=$(ptlrpcd_stat_sum steals)
+	ptlrpcd_load_432
+	$LCTL get_param -n ptlrpcd_stats
+	steals=$(( $(ptlrpcd_stat_sum steals) - steals ))
+	echo "$steals RPCs stolen by $nthreads ptlrpcd threads"
+	(( steals > 0 )) || error "no RPC stolen with ptlrpcd_steal_depth=1"
+
+	# only partners take work from each other with stealing disabled
+	echo 0 > $param
+	others=$(( $(ptlrpcd_stat_sum steals) -
+		   $(ptlrpcd_stat_sum partner_steals) ))
+	ptlrpcd_load_432
+	$LCTL get_param -n ptlrpcd_stats
+	others=$(( $(ptlrpcd_stat_sum steals) -
+		   $(ptlrpcd_stat_sum partner_steals) - others ))
+	(( others == 0 )) ||
+		error "$others RPCs stolen from non-partner ptlrpcd threads"
+}
+run_test 432 "ptlrpcd threads take work from each other"
+
 prep_801() {
 	[[ $MDS1_VERSION -lt $(version_code 2.9.55) ]] ||
 	[[ $OST1_VERSION -lt $(version_code 2.9.55) ]] &&
@@ -25221,6 +26032,45 @@ test_820() {
 }
 run_test 820 "update max EA from open intent"
 
+test_821() {
+	local file_heat_sav=$($LCTL get_param -n llite.*.file_heat 2>/dev/null)
+	[ -z "$file_heat_sav" ] && skip "no file heat support"
+	$LCTL get_param -n llite.*.heat_hot_threshold > /dev/null 2>&1 ||
+		skip "no heat policy support"
+
+	local threshold=$($LCTL get_param -n llite.*.heat_hot_threshold |
+			  head -n1)
+	local hot
+	local ra
+	local i
+
+	stack_trap "$LCTL set_param -n llite.*.file_heat=$file_heat_sav" EXIT
+	stack_trap "$LCTL set_param -n llite.*.heat_hot_threshold=$threshold" \
+		EXIT
+	$LCTL set_param -n llite.*.file_heat=1
+	$LCTL set_param -n llite.*.heat_hot_threshold=8
+	$LCTL set_param -n llite.*.stats=clear
+
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=16 || error "dd failed"
+	# small reads make the file hot
+	for i in $(seq 16); do
+		dd if=$DIR/$tfile of=/dev/null bs=4k count=1 2>/dev/null
+	done
+	hot=$(calc_stats llite.*.stats heat_hot)
+	(( hot >= 1 )) || error "$tfile is not hot ($hot)"
+
+	# a sequential read of the hot file gets the full readahead window
+	cancel_lru_locks osc
+	dd if=$DIR/$tfile of=/dev/null bs=4k || error "read failed"
+	ra=$(calc_stats llite.*.stats heat_readahead)
+	$LCTL get_param llite.*.stats | grep heat_
+	(( ra >= 1 )) || error "no readahead boost ($ra)"
+
+	$LCTL get_param osc.*.osc_cached_mb | grep hot_kept ||
+		error "no hot_kept in osc_cached_mb"
+}
+run_test 821 "heat-driven readahead of hot files"
+
 #
 # tests that do cleanup/setup should be run at the end
 #
@@ -528,6 +528,57 @@ test_16e() { # LU-13227
 }
 run_test 16e "Verify size consistency for O_DIRECT write"
 
+osc_lock_count() {
+	$LCTL get_param -n ldlm.namespaces.*-OST0000-osc-[^M]*.lock_count |
+		awk '{ sum += $1 } END { print sum + 0 }'
+}
+
+test_16f() {
+	$LCTL get_param osc.*-OST0000-osc-[^M]*.import |
+		grep -q "connect_flags:.*batch_bl_ast" ||
+		skip "server does not support batch_bl_ast"
+
+	local file1=$DIR1/$tfile
+	local file2=$DIR2/$tfile
+	local nlocks=16
+	local i
+
+	$LFS setstripe -i 0 -c 1 $file1 || error "setstripe $file1 failed"
+	dd if=/dev/zero of=$file1 bs=1M count=$nlocks ||
+		error "dd to $file1 failed"
+	cancel_lru_locks osc
+
+	# lockahead locks are not expanded, so client1 gets one lock for
+	# every extent, and all of them conflict with the truncate below
+	for ((i = 0; i < nlocks; i++)); do
+		$LFS ladvise -a lockahead --start ${i}M --length 4096 \
+			--mode READ $file1 || error "lockahead $i failed"
+	done
+	# lockahead requests are granted asynchronously
+	for ((i = 0; i < 10; i++)); do
+		(( $(osc_lock_count) >= nlocks )) && break
+		sleep 1
+	done
+	(( $(osc_lock_count) >= nlocks )) ||
+		error "only $(osc_lock_count) of $nlocks locks granted"
+
+	local bl1=$($LCTL get_param -n ldlm.services.ldlm_cbd.stats |
+		    awk '/ldlm_bl_callback/ { print $2 }')
+
+	$TRUNCATE $file2 0 || error "truncate $file2 failed"
+
+	local bl2=$($LCTL get_param -n ldlm.services.ldlm_cbd.stats |
+		    awk '/ldlm_bl_callback/ { print $2 }')
+	local nasts=$((${bl2:-0} - ${bl1:-0}))
+
+	echo "$nasts blocking ASTs for $nlocks locks"
+	(( nasts > 0 && nasts < nlocks )) ||
+		error "$nasts blocking ASTs sent for $nlocks locks"
+	(( $(osc_lock_count) <= 1 )) ||
+		error "$(osc_lock_count) locks left after truncate"
+}
+run_test 16f "Blocking AST for many locks of a client is sent in one RPC"
+
 test_17() { # bug 3513, 3667
 	remote_ost_nodsh && skip "remote OST with nodsh" && return
 
@@ -4412,6 +4463,103 @@ test_77n() { #LU-10802
 }
 run_test 77n "check wildcard support for TBF JobID NRS policy"
 
+test_77o() {
+	do_facet ost1 $LCTL get_param -n ost.OSS.ost_io.nrs_policies |
+		grep -q "name: edf" || skip "OST has no EDF NRS policy"
+
+	local nodes=$(comma_list $(osts_nodes))
+
+	do_nodes $nodes lctl set_param ost.OSS.ost_io.nrs_policies="edf" ||
+		error "failed to set edf policy"
+	do_nodes $nodes lctl set_param \
+		ost.OSS.ost_io.nrs_edf_rule="start\ ost_writes\ opcode={ost_write}\ deadline=100" \
+		ost.OSS.ost_io.nrs_edf_rule="change\ default\ deadline=5000" ||
+		error "failed to start edf rule"
+
+	# the default rule can not be stopped
+	do_facet ost1 lctl set_param \
+		ost.OSS.ost_io.nrs_edf_rule="stop\ default" &&
+		error "stopping the default edf rule should fail"
+
+	nrs_write_read
+
+	do_facet ost1 lctl get_param -n ost.OSS.ost_io.nrs_edf_rule
+	local handled=$(do_facet ost1 lctl get_param -n \
+			ost.OSS.ost_io.nrs_edf_rule |
+			awk '/^ost_writes / { sub(/handled=/, "", $4);
+					      sub(/,/, "", $4); sum += $4 }
+			     END { print sum + 0 }')
+	(( handled > 0 )) || error "no request handled by the ost_writes rule"
+
+	do_nodes $nodes lctl set_param \
+		ost.OSS.ost_io.nrs_edf_rule="stop\ ost_writes" \
+		ost.OSS.ost_io.nrs_policies="fifo" ||
+		error "failed to set policy back to fifo"
+}
+run_test 77o "check EDF NRS policy deadline rules"
+
+test_77p() {
+	local nodes=$(comma_list $(osts_nodes))
+	local dir=$DIR/$tdir
+	local np=$(check_cpt_number ost1)
+
+	do_nodes $nodes lctl set_param ost.OSS.ost_io.nrs_policies="tbf" ||
+		error "failed to set TBF policy"
+	stack_trap "do_nodes $nodes lctl set_param \
+		ost.OSS.ost_io.nrs_policies=fifo" EXIT
+	do_facet ost1 lctl set_param \
+		ost.OSS.ost_io.nrs_tbf_rule="start\ ext_c\ uid={501}\ rate=50\ ceil=100" ||
+		skip "OST TBF rules can not borrow"
+	do_facet ost1 lctl set_param \
+		ost.OSS.ost_io.nrs_tbf_rule="stop\ ext_c"
+
+	# without a ceiling a rule stays a hard limit when its rate is lowered
+	do_facet ost1 lctl set_param \
+		ost.OSS.ost_io.nrs_tbf_rule="start\ ext_h\ uid={501}\ rate=50" \
+		ost.OSS.ost_io.nrs_tbf_rule="change\ ext_h\ rate=5" ||
+		error "failed to start and change rule ext_h"
+	do_facet ost1 lctl get_param -n ost.OSS.ost_io.nrs_tbf_rule |
+		grep "^ext_h " | grep -q "ceil" &&
+		error "rule ext_h without a ceiling can borrow"
+	do_facet ost1 lctl set_param \
+		ost.OSS.ost_io.nrs_tbf_rule="stop\ ext_h"
+
+	do_nodes $nodes lctl set_param \
+		ost.OSS.ost_io.nrs_tbf_rule="start\ ext_p\ uid={500}\ rate=50\ share=100" \
+		ost.OSS.ost_io.nrs_tbf_rule="start\ ext_w\ uid={500}\&opcode={ost_write}\ rate=5\ ceil=50\ parent=ext_p" ||
+		error "failed to start hierarchical TBF rules"
+	stack_trap "do_nodes $nodes lctl set_param \
+		ost.OSS.ost_io.nrs_tbf_rule='stop ext_w' \
+		ost.OSS.ost_io.nrs_tbf_rule='stop ext_p'" EXIT
+
+	do_facet ost1 lctl get_param -n ost.OSS.ost_io.nrs_tbf_rule
+	do_facet ost1 lctl get_param -n ost.OSS.ost_io.nrs_tbf_rule |
+		grep -q "^ext_w .*, ceil 50, parent ext_p" ||
+		error "ceil and parent of ext_w not shown"
+
+	# a rule can not be stopped while it is the parent of another rule
+	do_facet ost1 lctl set_param \
+		ost.OSS.ost_io.nrs_tbf_rule="stop\ ext_p" &&
+		error "stopping rule ext_p with a child rule should fail"
+
+	mkdir $dir || error "mkdir $dir failed"
+	$LFS setstripe -c 1 -i 0 $dir || error "setstripe to $dir failed"
+	chmod 777 $dir
+
+	# with an idle server, writes borrow beyond their rate of 5 RPC/s
+	local start=$SECONDS
+	do_node ${CLIENT1:-$(hostname)} runas -u 500 dd if=/dev/zero \
+		of=$dir/tbf bs=1M count=100 oflag=direct ||
+		error "dd on client failed"
+	local runtime=$((SECONDS - start + 1))
+
+	echo "Write runtime is $runtime s"
+	(( runtime < 100 / (5 * np) )) ||
+		error "writes did not borrow tokens: $runtime s"
+	rm -rf $dir
+}
+run_test 77p "check TBF borrowing between hierarchical rules"
+
 test_78() { #LU-6673
 	local rc
 
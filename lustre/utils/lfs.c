@@ -365,14 +365,19 @@ command_t mirror_cmdlist[] = {
 command_t pcc_cmdlist[] = {
 	{ .pc_name = "attach", .pc_func = lfs_pcc_attach,
 	  .pc_help = "Attach given files to the Persistent Client Cache.\n"
-		"usage: lfs pcc attach <--id|-i NUM> <file> ...\n"
-		"\t-i: archive id for RW-PCC\n" },
+		"usage: lfs pcc attach <--id|-i NUM> [--readonly|-r] "
+		"<file> ...\n"
+		"\t-i: archive id for RW-PCC, archive or readonly id "
+		"for RO-PCC\n"
+		"\t-r: attach the files into RO-PCC\n" },
 	{ .pc_name = "attach_fid", .pc_func = lfs_pcc_attach_fid,
 	  .pc_help = "Attach given files into PCC by FID(s).\n"
 		"usage: lfs pcc attach_id <--id|-i NUM> <--mnt|-m mnt> "
-		"<fid> ...\n"
-		"\t-i: archive id for RW-PCC\n"
-		"\t-m: Lustre mount point\n" },
+		"[--readonly|-r] <fid> ...\n"
+		"\t-i: archive id for RW-PCC, archive or readonly id "
+		"for RO-PCC\n"
+		"\t-m: Lustre mount point\n"
+		"\t-r: attach the files into RO-PCC\n" },
 	{ .pc_name = "state", .pc_func = lfs_pcc_state,
 	  .pc_help = "Display the PCC state for given files.\n"
 		"usage: lfs pcc state <file> ...\n" },
@@ -11276,6 +11281,7 @@ static int lfs_pcc_attach(int argc, char **argv)
 {
 	struct option long_opts[] = {
 	{ .val = 'i',	.name = "id",	.has_arg = required_argument },
+	{ .val = 'r',	.name = "readonly",	.has_arg = no_argument },
 	{ .name = NULL } };
 	int c;
 	int rc = 0;
@@ -11286,7 +11292,7 @@ static int lfs_pcc_attach(int argc, char **argv)
 	enum lu_pcc_type type = LU_PCC_READWRITE;
 
 	optind = 0;
-	while ((c = getopt_long(argc, argv, "i:",
+	while ((c = getopt_long(argc, argv, "i:r",
 				long_opts, NULL)) != -1) {
 		switch (c) {
 		case 'i':
@@ -11298,6 +11304,9 @@ static int lfs_pcc_attach(int argc, char **argv)
 				return CMD_HELP;
 			}
 			break;
+		case 'r':
+			type = LU_PCC_READONLY;
+			break;
 		case '?':
 			return CMD_HELP;
 		default:
@@ -11347,8 +11356,9 @@ static int lfs_pcc_attach_fid(int argc, char **argv)
 	struct option long_opts[] = {
 	{ .val = 'i',	.name = "id",	.has_arg = required_argument },
 	{ .val = 'm',	.name = "mnt",	.has_arg = required_argument },
+	{ .val = 'r',	.name = "readonly",	.has_arg = no_argument },
 	{ .name = NULL } };
-	char			 short_opts[] = "i:m:";
+	char			 short_opts[] = "i:m:r";
 	int			 c;
 	int			 rc = 0;
 	__u32			 archive_id = 0;
@@ -11373,6 +11383,9 @@ static int lfs_pcc_attach_fid(int argc, char **argv)
 		case 'm':
 			mntpath = optarg;
 			break;
+		case 'r':
+			type = LU_PCC_READONLY;
+			break;
 		case '?':
 			return CMD_HELP;
 		default:
@@ -628,6 +628,30 @@ check_obd_connect_data(void)
 	CHECK_DEFINE_64X(OBD_CONNECT2_GETATTR_PFID);
 	CHECK_DEFINE_64X(OBD_CONNECT2_LSEEK);
 	CHECK_DEFINE_64X(OBD_CONNECT2_DOM_LVB);
+	CHECK_DEFINE_64X(OBD_CONNECT2_REP_MBITS);
+	CHECK_DEFINE_64X(OBD_CONNECT2_MODE_CONVERT);
+	CHECK_DEFINE_64X(OBD_CONNECT2_BATCH_RPCS);
+	CHECK_DEFINE_64X(OBD_CONNECT2_PCCRO);
+	CHECK_DEFINE_64X(OBD_CONNECT2_MNE_TYPE);
+	CHECK_DEFINE_64X(OBD_CONNECT2_LOCK_CONTENTION);
+	CHECK_DEFINE_64X(OBD_CONNECT2_ATOMIC_OPEN_LOCK);
+	CHECK_DEFINE_64X(OBD_CONNECT2_ENCRYPT_NAME);
+	CHECK_DEFINE_64X(OBD_CONNECT2_MKDIR_REPLAY);
+	CHECK_DEFINE_64X(OBD_CONNECT2_DMV_IMP_INHERIT);
+	CHECK_DEFINE_64X(OBD_CONNECT2_ENCRYPT_FID2PATH);
+	CHECK_DEFINE_64X(OBD_CONNECT2_REPLAY_CREATE);
+	CHECK_DEFINE_64X(OBD_CONNECT2_LARGE_NID);
+	CHECK_DEFINE_64X(OBD_CONNECT2_COMPRESS);
+	CHECK_DEFINE_64X(OBD_CONNECT2_UNALIGNED_DIO);
+	CHECK_DEFINE_64X(OBD_CONNECT2_CONN_POLICY);
+	CHECK_DEFINE_64X(OBD_CONNECT2_SPARSE);
+	CHECK_DEFINE_64X(OBD_CONNECT2_MIRROR_ID_FIX);
+	CHECK_DEFINE_64X(OBD_CONNECT2_UPDATE_LAYOUT);
+	CHECK_DEFINE_64X(OBD_CONNECT2_READDIR_OPEN);
+	CHECK_DEFINE_64X(OBD_CONNECT2_FLR_EC);
+	CHECK_DEFINE_64X(OBD_CONNECT2_WBC);
+	CHECK_DEFINE_64X(OBD_CONNECT2_BRW_MULTI);
+	CHECK_DEFINE_64X(OBD_CONNECT2_BATCH_BL_AST);
 
 	CHECK_VALUE_X(OBD_CKSUM_CRC32);
 	CHECK_VALUE_X(OBD_CKSUM_ADLER);
@@ -763,6 +787,7 @@ check_obdo(void)
 	CHECK_CVALUE_X(OBD_FL_NOSPC_BLK);
 	CHECK_CVALUE_X(OBD_FL_FLUSH);
 	CHECK_CVALUE_X(OBD_FL_SHORT_IO);
+	CHECK_CVALUE_X(OBD_FL_GRANT_RECLAIM);
 }
 
 static void
@@ -860,6 +885,7 @@ check_lov_comp_md_v1(void)
 	CHECK_VALUE(LCM_FL_RDONLY);
 	CHECK_VALUE(LCM_FL_WRITE_PENDING);
 	CHECK_VALUE(LCM_FL_SYNC_PENDING);
+	CHECK_VALUE(LCM_FL_PCC_RDONLY);
 }
 
 static void
@@ -1105,6 +1131,7 @@ check_mds_op_bias(void)
 	CHECK_VALUE_X(MDS_TRUNC_KEEP_LEASE);
 	CHECK_VALUE_X(MDS_PCC_ATTACH);
 	CHECK_VALUE_X(MDS_CLOSE_UPDATE_TIMES);
+	CHECK_VALUE_X(MDS_WBC_LOCKLESS);
 }
 
 static void
@@ -2300,6 +2327,8 @@ static void check_layout_intent(void)
 	CHECK_VALUE(LAYOUT_INTENT_TRUNC);
 	CHECK_VALUE(LAYOUT_INTENT_RELEASE);
 	CHECK_VALUE(LAYOUT_INTENT_RESTORE);
+	CHECK_VALUE(LAYOUT_INTENT_PCCRO_SET);
+	CHECK_VALUE(LAYOUT_INTENT_PCCRO_CLEAR);
 }
 
 static void check_hsm_state_set(void)